@@ -5,41 +5,121 @@
 #include "dial_controller.h"
 
 #include <algorithm>
+#include <array>
+
+#include "hot_path.h"
 
 namespace {
 
 constexpr uint8_t kBasePosition = 0;
 
-uint8_t ConvertGrayToBinary(uint8_t gray) {
-  uint8_t binary = gray;
-  uint8_t mask = gray >> 1;
+// Sensors have up to 6 bits.
+constexpr uint8_t kCodeMask = 0x3f;
+
+// Samples a non-adjacent position needs to stay before it is accepted.
+constexpr uint8_t kResyncSamples = 8;
 
-  while (mask) {
-    binary ^= mask;
-    mask >>= 1;
+constexpr std::array<uint8_t, kCodeMask + 1> kGrayToBinary = [] {
+  std::array<uint8_t, kCodeMask + 1> table{};
+  for (uint8_t binary = 0; binary <= kCodeMask; ++binary) {
+    table[binary ^ (binary >> 1)] = binary;
   }
-  return binary;
+  return table;
+}();
+
+bool IsAdjacent(uint8_t a, uint8_t b) {
+  return a + 1 == b || b + 1 == a;
 }
 
 }  // namespace
 
-DialController::DialController() {}
+DialController::DialController(uint8_t confirm_samples)
+    : confirm_samples_(std::max<uint8_t>(confirm_samples, 1)) {}
 
-void DialController::Update(uint8_t sensor_gray_code) {
-  position_ = ConvertGrayToBinary(sensor_gray_code);
-  max_position_ = std::max(max_position_, position_);
-  if (position_ == kBasePosition && max_position_ != kBasePosition) {
-    decided_position_ = max_position_;
-    max_position_ = kBasePosition;
+void DialController::SetConfirmTime(uint32_t confirm_us) {
+  confirm_us_ = confirm_us;
+}
+
+void DialController::SetEarlyCommit(bool enable, uint32_t dwell_us) {
+  early_commit_ = enable;
+  dwell_us_ = dwell_us;
+}
+
+void DIAL_HOT_PATH(DialController::Update)(uint8_t sensor_gray_code,
+                                           uint32_t time_us) {
+  uint8_t position = kGrayToBinary[sensor_gray_code & kCodeMask];
+  if (position == position_) {
+    if (candidate_samples_) {
+      // The dial bounced back, or the previous sample was a glitch.
+      ++error_counts_.unconfirmed;
+      candidate_samples_ = 0;
+    }
+    return;
+  }
+
+  if (!candidate_samples_ || position != candidate_position_) {
+    if (candidate_samples_) {
+      ++error_counts_.unconfirmed;
+    }
+    candidate_position_ = position;
+    candidate_samples_ = 0;
+    candidate_time_us_ = time_us;
+  }
+  if (candidate_samples_ < UINT8_MAX) {
+    ++candidate_samples_;
   }
+
+  // A mark between two adjacent positions changes only one sensor bit, so a
+  // jump over positions is a misread, unless it stays. It is counted once,
+  // on its first sample.
+  bool adjacent = IsAdjacent(position, position_);
+  if (!adjacent && candidate_samples_ == 1) {
+    ++error_counts_.non_adjacent;
+  }
+  uint8_t required_samples =
+      adjacent ? confirm_samples_ : std::max(confirm_samples_, kResyncSamples);
+  if (candidate_samples_ < required_samples ||
+      time_us - candidate_time_us_ < confirm_us_) {
+    return;
+  }
+  if (!adjacent) {
+    ++error_counts_.resyncs;
+  }
+  candidate_samples_ = 0;
+  Commit(position, time_us);
 }
 
-bool DialController::IsBasePosition() const {
+bool DIAL_HOT_PATH(DialController::IsBasePosition)() const {
   return position_ == kBasePosition;
 }
 
-std::optional<uint8_t> DialController::PopDecidedPosition() {
+std::optional<uint8_t> DIAL_HOT_PATH(DialController::PopDecidedPosition)() {
   auto result = decided_position_;
   decided_position_ = std::nullopt;
   return result;
-}
\ No newline at end of file
+}
+
+void DIAL_HOT_PATH(DialController::Commit)(uint8_t position, uint32_t time_us) {
+  if (early_commit_ && !decided_early_ && position < position_ &&
+      position_ == max_position_ && time_us - position_time_us_ >= dwell_us_) {
+    decided_position_ = max_position_;
+    decided_time_us_ = time_us;
+    decided_early_ = true;
+  }
+  // Turned on past the position decided early, before the base: the new
+  // furthest position is decided again, early or at the base.
+  if (decided_early_ && position > max_position_) {
+    decided_early_ = false;
+  }
+  position_ = position;
+  position_time_us_ = time_us;
+  max_position_ = std::max(max_position_, position_);
+  if (position_ == kBasePosition && max_position_ != kBasePosition) {
+    if (!decided_early_) {
+      decided_position_ = max_position_;
+      decided_time_us_ = time_us;
+    }
+    max_position_ = kBasePosition;
+    decided_early_ = false;
+  }
+}
@@ -10,19 +10,71 @@
 
 class DialController {
  public:
-  DialController();
+  // Counts of sensor readings that were not taken as they are.
+  struct ErrorCounts {
+    // A new position that went away before it was confirmed.
+    uint32_t unconfirmed = 0;
+    // New positions that skip one or more positions from the current one,
+    // counted once each however long they stay.
+    uint32_t non_adjacent = 0;
+    // Non-adjacent positions accepted after they stayed for a while, e.g. a
+    // dial that was held at boot.
+    uint32_t resyncs = 0;
+  };
+
+  static constexpr uint8_t kDefaultConfirmSamples = 2;
+  static constexpr uint32_t kDefaultDwellUs = 20000;
+
+  // A new position is taken once it is read for `confirm_samples` samples in
+  // a row, and only if it is next to the current position.
+  explicit DialController(uint8_t confirm_samples = kDefaultConfirmSamples);
   DialController(const DialController&) = delete;
   DialController& operator=(const DialController&) = delete;
   ~DialController() = default;
 
-  void Update(uint8_t sensor_gray_code);
+  // A new position also has to stay for `confirm_us` from its first sample.
+  // For edge-driven sampling, where two samples can be very close.
+  void SetConfirmTime(uint32_t confirm_us);
+
+  // Decides the position as soon as the dial starts returning from where it
+  // stayed for `dwell_us` or longer, i.e. the user let it go at the finger
+  // stop, instead of when it is back at the base. The base position does not
+  // decide it again, unless the dial turns on past the decided position
+  // first; then the new furthest position is decided too. If the dial turns
+  // back without such a stay, the position is decided at the base as usual.
+  void SetEarlyCommit(bool enable, uint32_t dwell_us = kDefaultDwellUs);
+
+  // `time_us` is the time of the sample, e.g. time_us_32().
+  void Update(uint8_t sensor_gray_code, uint32_t time_us);
   bool IsBasePosition() const;
+  // The confirmed position, counted from the base position at 0.
+  uint8_t position() const { return position_; }
+  // False while a new position is waiting for confirmation.
+  bool IsSettled() const { return !candidate_samples_; }
   std::optional<uint8_t> PopDecidedPosition();
+  // The time of the sample that decided the last position.
+  uint32_t decided_time_us() const { return decided_time_us_; }
+
+  const ErrorCounts& error_counts() const { return error_counts_; }
 
  private:
+  void Commit(uint8_t position, uint32_t time_us);
+
+  const uint8_t confirm_samples_;
+  uint32_t confirm_us_ = 0;
+  bool early_commit_ = false;
+  uint32_t dwell_us_ = kDefaultDwellUs;
   uint8_t position_ = 0u;
+  uint32_t position_time_us_ = 0u;
   uint8_t max_position_ = 0u;
+  bool decided_early_ = false;
   std::optional<uint8_t> decided_position_;
+  uint32_t decided_time_us_ = 0u;
+
+  uint8_t candidate_position_ = 0u;
+  uint8_t candidate_samples_ = 0u;
+  uint32_t candidate_time_us_ = 0u;
+  ErrorCounts error_counts_;
 };
 
-#endif  // COMMON_DIAL_CONTROLLER_H
\ No newline at end of file
+#endif  // COMMON_DIAL_CONTROLLER_H
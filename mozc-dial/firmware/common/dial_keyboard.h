@@ -0,0 +1,173 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef COMMON_DIAL_KEYBOARD_H_
+#define COMMON_DIAL_KEYBOARD_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+#include "pico.h"
+
+#include "dial_controller.h"
+#include "hot_path.h"
+#include "keymap.h"
+#include "trace.h"
+#include "usb_hid_keyboard.h"
+
+// The dials a board senses itself, as a keyboard: `N` DialControllers fed from
+// a SensorSource, that run their motors through a MotorSink, and type the
+// positions they decide by the keymap. The dial count and both parts are
+// template parameters, so that the work on each dial is unrolled for each
+// board, with no virtual calls or tables of pointers.
+//
+// A SensorSource, e.g. SensorBank, has Sample(), Read(index) for the Gray code
+// of a sensor in the last sample, and size(), and for edge-driven sensing,
+// PopEdge() as in SensorBank. A MotorSink has Drive(dial, position), with
+// position 0 at the base, where the motor stops.
+template <size_t N, typename SensorSource, typename MotorSink>
+class DialKeyboard final {
+ public:
+  static constexpr size_t kNumDials = N;
+
+  DialKeyboard(SensorSource& sensors, MotorSink& motors)
+      : sensors_(sensors), motors_(motors) {
+    hard_assert(sensors.size() == N);
+  }
+  DialKeyboard(const DialKeyboard&) = delete;
+  DialKeyboard& operator=(const DialKeyboard&) = delete;
+  ~DialKeyboard() = default;
+
+  void SetEarlyCommit(bool enable) {
+    ForEachDial([enable](DialController& dial, size_t) {
+      dial.SetEarlyCommit(enable);
+    });
+  }
+  void SetConfirmTime(uint32_t confirm_us) {
+    ForEachDial([confirm_us](DialController& dial, size_t) {
+      dial.SetConfirmTime(confirm_us);
+    });
+  }
+
+  // Feeds the captured edges to the dials with their own times, so that they
+  // see every code even if the loop was busy.
+  void DIAL_HOT_PATH(SenseEdges)() {
+    while (std::optional<uint32_t> edge_time = sensors_.PopEdge()) {
+      ForEachDial([this, edge_time](DialController& dial, size_t i) {
+        dial.Update(sensors_.Read(i), *edge_time);
+      });
+    }
+  }
+
+  // Samples all sensors at once, at `time_us`, and drives the motor of each
+  // dial from its position.
+  void DIAL_HOT_PATH(Sense)(uint32_t time_us) {
+    trace::Begin(trace::Stage::kSensorRead);
+    sensors_.Sample();
+    ForEachDial([this, time_us](DialController& dial, size_t i) {
+      dial.Update(sensors_.Read(i), time_us);
+      motors_.Drive(i, dial.position());
+    });
+    trace::End(trace::Stage::kSensorRead);
+  }
+
+  // Calls `decided(dial, position, time_us)` for each dial with a decided
+  // position, in the order of the dials.
+  //
+  // A position is decided once the dial returns to the base from non-base
+  // positions, as the position where it started returning. With early commit,
+  // it is decided when the dial starts returning instead.
+  template <typename Callback>
+  void DIAL_HOT_PATH(PopDecided)(Callback&& decided) {
+    ForEachDial([&decided](DialController& dial, size_t i) {
+      if (std::optional<uint8_t> position = dial.PopDecidedPosition()) {
+        decided(i, *position, dial.decided_time_us());
+      }
+    });
+  }
+
+  // All dials are at the base, with no new position waiting for confirmation.
+  bool IsIdle() const {
+    bool idle = true;
+    ForEachDial([&idle](const DialController& dial, size_t) {
+      idle = idle && dial.IsBasePosition() && dial.IsSettled();
+    });
+    return idle;
+  }
+  // No dial has a new position waiting for confirmation.
+  bool IsSettled() const {
+    bool settled = true;
+    ForEachDial([&settled](const DialController& dial, size_t) {
+      settled = settled && dial.IsSettled();
+    });
+    return settled;
+  }
+
+  // Types by `layout` from the next key on, starting at its base layer. It
+  // must stay valid until another one is set. Callable from any core.
+  void SetLayout(const keymap::Layout& layout) {
+    layout_.store(&layout, std::memory_order_release);
+  }
+
+  // Types `position` of `dial`, decided at `time_us`, on `keyboard` by the
+  // keymap in the current layer. Modifier and layer keys hold for the next
+  // usage. Dials after those of the keymap repeat them, as larger boards
+  // repeat the main's and the sub's wiring, so this also takes dials sensed
+  // elsewhere. May run on another core than Sense().
+  void DIAL_HOT_PATH(Type)(UsbHidKeyboard& keyboard,
+                           size_t dial,
+                           uint8_t position,
+                           uint32_t time_us) {
+    const keymap::Layout* layout = layout_.load(std::memory_order_acquire);
+    if (layout != typed_layout_) {
+      typed_layout_ = layout;
+      layer_ = keymap::kLayerBase;
+    }
+    keymap::Key key = keymap::Lookup(*layout, layer_,
+                                     dial % layout->num_dials, position);
+    switch (key.type) {
+      case keymap::KeyType::kUsage:
+        keyboard.PressByUsageId(key.value, time_us);
+        layer_ = keymap::kLayerBase;
+        break;
+      case keymap::KeyType::kModifier:
+        keyboard.SetModifiers(keyboard.GetModifiers() | key.value);
+        break;
+      case keymap::KeyType::kLayer:
+        layer_ = key.value;
+        break;
+      case keymap::KeyType::kNone:
+        break;
+    }
+  }
+
+ private:
+  template <typename Function>
+  void ForEachDial(Function&& function) {
+    [&]<size_t... I>(std::index_sequence<I...>) {
+      (function(dials_[I], I), ...);
+    }(std::make_index_sequence<N>());
+  }
+  template <typename Function>
+  void ForEachDial(Function&& function) const {
+    [&]<size_t... I>(std::index_sequence<I...>) {
+      (function(dials_[I], I), ...);
+    }(std::make_index_sequence<N>());
+  }
+
+  SensorSource& sensors_;
+  MotorSink& motors_;
+  std::array<DialController, N> dials_;
+  std::atomic<const keymap::Layout*> layout_ = &keymap::kBuiltInLayout;
+  // The layout Type() last used, and its layer, back to the base one after
+  // each usage.
+  const keymap::Layout* typed_layout_ = &keymap::kBuiltInLayout;
+  uint8_t layer_ = keymap::kLayerBase;
+};
+
+#endif  // COMMON_DIAL_KEYBOARD_H_
@@ -0,0 +1,211 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#include "heap_monitor.h"
+
+#include <malloc.h>
+#if PICO_ON_DEVICE
+#include <reent.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <optional>
+
+#include "hardware/sync.h"
+#include "pico.h"
+
+namespace {
+
+heap_monitor::Stats sStats = {};
+std::optional<heap_monitor::Stats> sPrintedStats;
+
+// Counts the block at `pointer`, if any, as allocated now.
+void* CountAllocation(void* pointer) {
+  if (!pointer) {
+    return nullptr;
+  }
+  // Handlers on the same core may allocate too.
+  uint32_t status = save_and_disable_interrupts();
+  ++sStats.allocations;
+  if (__get_current_exception()) {
+    ++sStats.isr_allocations;
+  }
+  sStats.bytes += malloc_usable_size(pointer);
+  sStats.peak_bytes = std::max(sStats.peak_bytes, sStats.bytes);
+  restore_interrupts(status);
+  return pointer;
+}
+
+// Counts the block at `pointer`, if any, as freed, before it is.
+void CountFree(void* pointer) {
+  if (!pointer) {
+    return;
+  }
+  uint32_t status = save_and_disable_interrupts();
+  sStats.bytes -= malloc_usable_size(pointer);
+  restore_interrupts(status);
+}
+
+// Reallocates `pointer` with `reallocate`, that leaves it as it is on
+// failure.
+template <typename Reallocate>
+void* CountReallocation(void* pointer, Reallocate reallocate) {
+  size_t bytes = pointer ? malloc_usable_size(pointer) : 0;
+  void* result = reallocate();
+  if (result) {
+    uint32_t status = save_and_disable_interrupts();
+    sStats.bytes -= bytes;
+    restore_interrupts(status);
+  }
+  return CountAllocation(result);
+}
+
+}  // namespace
+
+#if PICO_ON_DEVICE
+// newlib's malloc(), calloc(), realloc() and free() call these reentrant
+// versions, and so does its stdio for its buffers, without malloc(). They are
+// wrapped rather than malloc(), that the SDK's pico_malloc already wraps; see
+// main/CMakeLists.txt.
+extern "C" {
+
+void* __real__malloc_r(_reent* reent, size_t size);
+void* __real__calloc_r(_reent* reent, size_t count, size_t size);
+void* __real__realloc_r(_reent* reent, void* pointer, size_t size);
+void __real__free_r(_reent* reent, void* pointer);
+
+void* __wrap__malloc_r(_reent* reent, size_t size) {
+  return CountAllocation(__real__malloc_r(reent, size));
+}
+
+void* __wrap__calloc_r(_reent* reent, size_t count, size_t size) {
+  return CountAllocation(__real__calloc_r(reent, count, size));
+}
+
+void* __wrap__realloc_r(_reent* reent, void* pointer, size_t size) {
+  return CountReallocation(
+      pointer, [&] { return __real__realloc_r(reent, pointer, size); });
+}
+
+void __wrap__free_r(_reent* reent, void* pointer) {
+  CountFree(pointer);
+  __real__free_r(reent, pointer);
+}
+
+}  // extern "C"
+#else
+// The image's own, that it binds to as it is linked with -Bsymbolic, see
+// host/CMakeLists.txt; the simulator keeps the C library's.
+extern "C" {
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void __libc_free(void* pointer);
+
+void* malloc(size_t size) {
+  return CountAllocation(__libc_malloc(size));
+}
+
+void* calloc(size_t count, size_t size) {
+  return CountAllocation(__libc_calloc(count, size));
+}
+
+void* realloc(void* pointer, size_t size) {
+  return CountReallocation(pointer,
+                           [&] { return __libc_realloc(pointer, size); });
+}
+
+void free(void* pointer) {
+  CountFree(pointer);
+  __libc_free(pointer);
+}
+
+}  // extern "C"
+#endif
+
+// The SDK's own replacements are disabled with
+// PICO_CXX_DISABLE_ALLOCATION_OVERRIDES, see main/CMakeLists.txt. They go to
+// malloc(), and are counted there.
+void* operator new(size_t size) {
+  void* pointer = malloc(size ? size : 1);
+  hard_assert(pointer);
+  return pointer;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+// Used by the standard library, e.g. std::stable_sort().
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return malloc(size ? size : 1);
+}
+
+void operator delete(void* pointer) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+  free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+  free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+  free(pointer);
+}
+
+namespace heap_monitor {
+
+Stats GetStats() {
+  uint32_t status = save_and_disable_interrupts();
+  Stats stats = sStats;
+  restore_interrupts(status);
+#if PICO_ON_DEVICE
+  // The host's is shared by the whole process.
+  stats.heap_size = mallinfo().arena;
+#endif
+  return stats;
+}
+
+void Poll(const char* name) {
+  Stats stats = GetStats();
+  if (sPrintedStats && !memcmp(&stats, &*sPrintedStats, sizeof(stats))) {
+    return;
+  }
+  sPrintedStats = stats;
+  printf(
+      "%s: heap %lu allocations, %lu in interrupt handlers, %lu bytes, peak "
+      "%lu bytes, heap size %lu bytes\n",
+      name, static_cast<unsigned long>(stats.allocations),
+      static_cast<unsigned long>(stats.isr_allocations),
+      static_cast<unsigned long>(stats.bytes),
+      static_cast<unsigned long>(stats.peak_bytes),
+      static_cast<unsigned long>(stats.heap_size));
+}
+
+}  // namespace heap_monitor
+
+const heap_monitor::Stats* heap_monitor_stats() {
+  return &sStats;
+}
@@ -0,0 +1,48 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef COMMON_HEAP_MONITOR_H_
+#define COMMON_HEAP_MONITOR_H_
+
+#include <cstdint>
+
+// Counts heap allocations of the firmware, that is expected to allocate only
+// while starting, and never in interrupt handlers. Built with
+// DIAL_HEAP_MONITOR, that wraps malloc() and its kin, under the C library's
+// stdio as well, and replaces the global operator new and delete; otherwise
+// the functions below do nothing.
+namespace heap_monitor {
+
+struct Stats {
+  // Allocations through malloc(), calloc(), realloc() and operator new, and
+  // those of them made in interrupt handlers.
+  uint32_t allocations;
+  uint32_t isr_allocations;
+  // Bytes allocated through them now, and at most.
+  uint32_t bytes;
+  uint32_t peak_bytes;
+  // Bytes the C library heap has grown to, or 0 where it is unknown.
+  uint32_t heap_size;
+};
+
+#if DIAL_HEAP_MONITOR
+Stats GetStats();
+// Prints the stats over stdio, after `name`, on the first call and whenever
+// they change. Not to be called from interrupt handlers.
+void Poll(const char* name);
+#else
+inline Stats GetStats() {
+  return {};
+}
+inline void Poll(const char*) {}
+#endif
+
+}  // namespace heap_monitor
+
+#if DIAL_HEAP_MONITOR
+// The stats as they are, for the host simulation to read from each image.
+extern "C" const heap_monitor::Stats* heap_monitor_stats();
+#endif
+
+#endif  // COMMON_HEAP_MONITOR_H_
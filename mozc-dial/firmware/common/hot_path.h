@@ -0,0 +1,32 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef COMMON_HOT_PATH_H_
+#define COMMON_HOT_PATH_H_
+
+#include "pico.h"
+
+// Places code that runs in interrupt handlers, or on every iteration of a
+// main loop, in SRAM, as the SDK does for __not_in_flash_func, so that it
+// runs in constant time instead of waiting on XIP cache misses now and then.
+// Built with DIAL_RAM_HOT_PATHS; otherwise the code stays in flash, to
+// compare the two.
+//
+// A function placed with DIAL_HOT_PATH() may still be inlined, so it is
+// meant for those called from interrupts, by address, or from other hot
+// paths. A loop body called from main() takes DIAL_HOT_LOOP(), and a lambda
+// DIAL_HOT_LAMBDA(group) after its parameter list, that keep them out of
+// their caller in flash. Each shows up in the build report of the RAM code;
+// see ram_report.cmake.
+#if DIAL_RAM_HOT_PATHS
+#define DIAL_HOT_PATH(name) __not_in_flash_func(name)
+#define DIAL_HOT_LOOP(name) __attribute__((noinline)) __not_in_flash_func(name)
+#define DIAL_HOT_LAMBDA(group) __attribute__((noinline)) __not_in_flash(group)
+#else
+#define DIAL_HOT_PATH(name) name
+#define DIAL_HOT_LOOP(name) name
+#define DIAL_HOT_LAMBDA(group)
+#endif
+
+#endif  // COMMON_HOT_PATH_H_
@@ -0,0 +1,95 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef COMMON_ISR_LATENCY_H_
+#define COMMON_ISR_LATENCY_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "hardware/sync.h"
+
+// Measures how late a periodic interrupt handler runs, from the time it is
+// due to its entry, e.g. for the step timing jitter of XIP cache misses and
+// of code that masks interrupts. Built with DIAL_ISR_LATENCY; otherwise the
+// functions below do nothing, and compile to nothing.
+class IsrLatency final {
+ public:
+  // Latencies by their bit width: 0 us, 1 us, 2 to 3 us, and so on, the last
+  // one for those of 64 us or more.
+  static constexpr size_t kNumOfBuckets = 8;
+
+  struct Stats {
+    uint32_t count;
+    uint32_t max_us;
+    std::array<uint32_t, kNumOfBuckets> buckets;
+  };
+
+#if DIAL_ISR_LATENCY
+  // Expects the handler every `period_us`, from `due_us` on. Called with
+  // interrupts disabled, or before the interrupt is enabled.
+  void Expect(uint32_t due_us, uint32_t period_us) {
+    due_us_ = due_us;
+    period_us_ = period_us;
+  }
+
+  // Records an entry of the handler at `now_us`, and expects the next one a
+  // period after this one was due.
+  void Enter(uint32_t now_us) {
+    int32_t late_us = static_cast<int32_t>(now_us - due_us_);
+    uint32_t latency_us = late_us > 0 ? late_us : 0;
+    due_us_ += period_us_;
+    ++stats_.count;
+    if (latency_us > stats_.max_us) {
+      stats_.max_us = latency_us;
+    }
+    size_t bucket = latency_us ? 32 - __builtin_clz(latency_us) : 0;
+    ++stats_.buckets[bucket < kNumOfBuckets ? bucket : kNumOfBuckets - 1];
+  }
+
+  Stats GetStats() const {
+    uint32_t status = save_and_disable_interrupts();
+    Stats stats = stats_;
+    restore_interrupts(status);
+    return stats;
+  }
+
+  // Prints the stats over stdio, after `name` and what is measured, on the
+  // first entry and whenever the worst latency grows. Not to be called from
+  // interrupt handlers.
+  void Poll(const char* name, const char* what) {
+    Stats stats = GetStats();
+    if (!stats.count || (printed_ && stats.max_us <= printed_max_us_)) {
+      return;
+    }
+    printed_ = true;
+    printed_max_us_ = stats.max_us;
+    printf("%s: %s latency max %lu us in %lu calls, by bits:", name, what,
+           static_cast<unsigned long>(stats.max_us),
+           static_cast<unsigned long>(stats.count));
+    for (uint32_t count : stats.buckets) {
+      printf(" %lu", static_cast<unsigned long>(count));
+    }
+    printf("\n");
+  }
+#else
+  void Expect(uint32_t, uint32_t) {}
+  void Enter(uint32_t) {}
+  Stats GetStats() const { return {}; }
+  void Poll(const char*, const char*) {}
+#endif
+
+#if DIAL_ISR_LATENCY
+ private:
+  uint32_t due_us_ = 0;
+  uint32_t period_us_ = 0;
+  Stats stats_ = {};
+  bool printed_ = false;
+  uint32_t printed_max_us_ = 0;
+#endif
+};
+
+#endif  // COMMON_ISR_LATENCY_H_
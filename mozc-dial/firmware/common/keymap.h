@@ -0,0 +1,101 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef COMMON_KEYMAP_H_
+#define COMMON_KEYMAP_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Keys by layer, dial and dial position, compiled from gboard_dial.layout into
+// keymap_layout.h by host/layout_compiler. All of it is constexpr data in
+// flash.
+namespace keymap {
+
+enum class KeyType : uint8_t {
+  kNone,
+  // `value` is a keyboard usage.
+  kUsage,
+  // `value` is a bitmap of modifiers, for the next usage.
+  kModifier,
+  // `value` is the layer for keys until the next usage.
+  kLayer,
+};
+
+struct Key {
+  KeyType type = KeyType::kNone;
+  uint8_t value = 0;
+};
+
+// Where the keys of a dial start in each layer, and how many positions it has.
+struct DialIndex {
+  uint16_t first;
+  uint8_t positions;
+};
+
+// A keymap: the compiled-in one, or one that KeymapStore maps from flash.
+struct Layout {
+  size_t num_layers;
+  size_t num_dials;
+  size_t layer_size;
+  const DialIndex* dial_index;
+  const Key* keys;
+};
+
+// A keymap as stored, and sent over USB, e.g. by host/layout_compiler
+// --binary: this header, `num_dials` DialIndex entries of 4 bytes, the last
+// one padding, and `num_layers` * `layer_size` Keys of 2 bytes, all
+// little-endian. It is used in place, so the entries are as in memory.
+struct StoredLayout {
+  uint8_t num_layers;
+  uint8_t num_dials;
+  uint16_t layer_size;
+};
+static_assert(sizeof(DialIndex) == 4 && sizeof(Key) == 2);
+
+}  // namespace keymap
+
+#include "keymap_layout.h"
+
+namespace keymap {
+
+inline constexpr Layout kBuiltInLayout = {kNumLayers, kNumDials, kLayerSize,
+                                          kDialIndex, kKeys};
+
+// The key at `position`, from 1, of `dial` in `layer` of `layout`; a kNone
+// key out of the layout.
+constexpr Key Lookup(const Layout& layout,
+                     size_t layer,
+                     size_t dial,
+                     uint8_t position) {
+  if (layer >= layout.num_layers || dial >= layout.num_dials) {
+    return {};
+  }
+  const DialIndex& index = layout.dial_index[dial];
+  if (position == 0 || position > index.positions) {
+    return {};
+  }
+  return layout.keys[layer * layout.layer_size + index.first + position - 1];
+}
+
+// The key of the compiled-in keymap.
+constexpr Key Lookup(size_t layer, size_t dial, uint8_t position) {
+  return Lookup(kBuiltInLayout, layer, dial, position);
+}
+
+// The CRC-32 of stored keymaps, as in zlib.
+constexpr uint32_t Crc32(const uint8_t* data, size_t size) {
+  uint32_t crc = 0xffffffffu;
+  for (size_t i = 0; i < size; ++i) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ (0xedb88320u & (0u - (crc & 1u)));
+    }
+  }
+  return ~crc;
+}
+
+}  // namespace keymap
+
+#endif  // COMMON_KEYMAP_H_
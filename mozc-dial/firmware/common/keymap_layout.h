@@ -0,0 +1,213 @@
+// Generated by host/layout_compiler from gboard_dial.layout. Do not edit.
+// Included by keymap.h.
+
+#ifndef COMMON_KEYMAP_LAYOUT_H_
+#define COMMON_KEYMAP_LAYOUT_H_
+
+namespace keymap {
+
+enum Layer : uint8_t {
+  kLayerBase,
+  kLayerFn,
+};
+
+enum Dial : uint8_t {
+  kDialA,
+  kDialB,
+  kDialC,
+  kDialD,
+  kDialE,
+  kDialF,
+  kDialG,
+  kDialI,
+  kDialH,
+};
+
+inline constexpr size_t kNumLayers = 2;
+inline constexpr size_t kNumDials = 9;
+inline constexpr size_t kLayerSize = 74;
+
+inline constexpr DialIndex kDialIndex[kNumDials] = {
+    {0, 36},  // A
+    {36, 3},  // B
+    {39, 4},  // C
+    {43, 2},  // D
+    {45, 7},  // E
+    {52, 5},  // F
+    {57, 3},  // G
+    {60, 11},  // I
+    {71, 3},  // H
+};
+
+inline constexpr Key kKeys[kNumLayers * kLayerSize] = {
+    // base A
+    {},
+    {KeyType::kUsage, 0x2f},
+    {KeyType::kUsage, 0x34},
+    {KeyType::kUsage, 0x87},
+    {KeyType::kUsage, 0x13},
+    {KeyType::kUsage, 0x33},
+    {KeyType::kUsage, 0x38},
+    {KeyType::kUsage, 0x12},
+    {KeyType::kUsage, 0x0f},
+    {KeyType::kUsage, 0x37},
+    {KeyType::kUsage, 0x0c},
+    {KeyType::kUsage, 0x0e},
+    {KeyType::kUsage, 0x36},
+    {KeyType::kUsage, 0x18},
+    {KeyType::kUsage, 0x0d},
+    {KeyType::kUsage, 0x10},
+    {KeyType::kUsage, 0x1c},
+    {KeyType::kUsage, 0x0b},
+    {KeyType::kUsage, 0x11},
+    {KeyType::kUsage, 0x17},
+    {KeyType::kUsage, 0x0a},
+    {KeyType::kUsage, 0x05},
+    {KeyType::kUsage, 0x15},
+    {KeyType::kUsage, 0x09},
+    {KeyType::kUsage, 0x19},
+    {KeyType::kUsage, 0x08},
+    {KeyType::kUsage, 0x07},
+    {KeyType::kUsage, 0x06},
+    {KeyType::kUsage, 0x1a},
+    {KeyType::kUsage, 0x16},
+    {KeyType::kUsage, 0x1b},
+    {KeyType::kUsage, 0x14},
+    {KeyType::kUsage, 0x04},
+    {KeyType::kUsage, 0x1d},
+    {KeyType::kUsage, 0x39},
+    {KeyType::kUsage, 0x2c},
+    // base B
+    {KeyType::kUsage, 0x2e},
+    {KeyType::kUsage, 0x29},
+    {KeyType::kUsage, 0x2b},
+    // base C
+    {KeyType::kModifier, 0x02},
+    {KeyType::kModifier, 0x01},
+    {KeyType::kModifier, 0x04},
+    {KeyType::kLayer, 1},
+    // base D
+    {},
+    {KeyType::kUsage, 0x28},
+    // base E
+    {},
+    {KeyType::kUsage, 0x4d},
+    {KeyType::kUsage, 0x4e},
+    {KeyType::kUsage, 0x4b},
+    {KeyType::kUsage, 0x4a},
+    {KeyType::kUsage, 0x49},
+    {KeyType::kUsage, 0x4c},
+    // base F
+    {},
+    {KeyType::kUsage, 0x4f},
+    {KeyType::kUsage, 0x52},
+    {KeyType::kUsage, 0x50},
+    {KeyType::kUsage, 0x51},
+    // base G
+    {KeyType::kUsage, 0x55},
+    {KeyType::kUsage, 0x56},
+    {KeyType::kUsage, 0x63},
+    // base I
+    {},
+    {KeyType::kUsage, 0x26},
+    {KeyType::kUsage, 0x25},
+    {KeyType::kUsage, 0x24},
+    {KeyType::kUsage, 0x23},
+    {KeyType::kUsage, 0x22},
+    {KeyType::kUsage, 0x21},
+    {KeyType::kUsage, 0x20},
+    {KeyType::kUsage, 0x1f},
+    {KeyType::kUsage, 0x1e},
+    {KeyType::kUsage, 0x27},
+    // base H
+    {KeyType::kUsage, 0x57},
+    {KeyType::kUsage, 0x56},
+    {KeyType::kUsage, 0x67},
+    // fn A
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    // fn B
+    {},
+    {},
+    {},
+    // fn C
+    {KeyType::kModifier, 0x02},
+    {KeyType::kModifier, 0x01},
+    {KeyType::kModifier, 0x04},
+    {KeyType::kLayer, 1},
+    // fn D
+    {},
+    {},
+    // fn E
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    // fn F
+    {},
+    {},
+    {},
+    {},
+    {},
+    // fn G
+    {},
+    {},
+    {},
+    // fn I
+    {},
+    {KeyType::kUsage, 0x42},
+    {KeyType::kUsage, 0x41},
+    {KeyType::kUsage, 0x40},
+    {KeyType::kUsage, 0x3f},
+    {KeyType::kUsage, 0x3e},
+    {KeyType::kUsage, 0x3d},
+    {KeyType::kUsage, 0x3c},
+    {KeyType::kUsage, 0x3b},
+    {KeyType::kUsage, 0x3a},
+    {KeyType::kUsage, 0x43},
+    // fn H
+    {},
+    {},
+    {},
+};
+
+}  // namespace keymap
+
+#endif  // COMMON_KEYMAP_LAYOUT_H_
@@ -0,0 +1,242 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#include "keymap_store.h"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+
+#include "hardware/regs/addressmap.h"
+#include "pico/flash.h"
+
+namespace {
+
+constexpr uint32_t kPagesPerSector = FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE;
+// How long the other core and interrupts may take to get out of the way.
+constexpr uint32_t kFlashSafeTimeoutMs = 100;
+
+// A record to write, from the flash_safe_execute() callback.
+struct Program {
+  uint32_t first_page;
+  uint32_t num_pages;
+  // The header, then the keymap.
+  std::span<const uint8_t> header;
+  std::span<const uint8_t> data;
+  uint8_t* page_buffer;
+};
+
+bool IsBlank(const uint8_t* data, size_t size) {
+  return std::all_of(data, data + size,
+                     [](uint8_t byte) { return byte == 0xff; });
+}
+
+}  // namespace
+
+const keymap::Layout& KeymapStore::Load() {
+  // The highest sequence is current. If its CRC does not match, the next
+  // highest is tried. New records go after the highest sequence in the log,
+  // even if torn, so that no two records have the same.
+  std::optional<uint32_t> below;
+  while (true) {
+    std::optional<uint32_t> best_page;
+    uint32_t best_sequence = 0;
+    for (uint32_t page = 0; page < kNumPages;) {
+      RecordHeader header;
+      memcpy(&header, RegionPage(page), sizeof(header));
+      if (header.magic != kRecordMagic || header.format != kFormat ||
+          header.size > kMaxLayoutSize ||
+          page + RecordPages(header.size) > kNumPages) {
+        ++page;
+        continue;
+      }
+      last_sequence_ = std::max(last_sequence_, header.sequence);
+      if ((!below || header.sequence < *below) &&
+          (!best_page || header.sequence > best_sequence)) {
+        best_page = page;
+        best_sequence = header.sequence;
+      }
+      page += RecordPages(header.size);
+    }
+    if (!best_page) {
+      return *layout_;
+    }
+    if (Use(*best_page)) {
+      return *layout_;
+    }
+    below = best_sequence;
+  }
+}
+
+KeymapStore::Status KeymapStore::Begin(size_t size) {
+  if (size > kMaxLayoutSize) {
+    pending_size_ = 0;
+    return Status::kBadSize;
+  }
+  pending_size_ = size;
+  return Status::kOk;
+}
+
+KeymapStore::Status KeymapStore::Write(size_t offset,
+                                       std::span<const uint8_t> data) {
+  if (offset > pending_size_ || data.size() > pending_size_ - offset) {
+    return Status::kBadSize;
+  }
+  std::copy(data.begin(), data.end(), pending_.begin() + offset);
+  return Status::kOk;
+}
+
+KeymapStore::Status KeymapStore::Commit(uint32_t crc) {
+  std::span<const uint8_t> data(pending_.data(), pending_size_);
+  if (keymap::Crc32(data.data(), data.size()) != crc) {
+    return Status::kBadCrc;
+  }
+  keymap::Layout layout;
+  if (!data.empty() && !Parse(data, layout)) {
+    return Status::kBadLayout;
+  }
+  return Append(data, crc);
+}
+
+// static
+const uint8_t* KeymapStore::RegionPage(uint32_t page) {
+  return reinterpret_cast<const uint8_t*>(XIP_BASE + kRegionOffset) +
+         page * FLASH_PAGE_SIZE;
+}
+
+// static
+uint32_t KeymapStore::RecordPages(size_t size) {
+  return (sizeof(RecordHeader) + size + FLASH_PAGE_SIZE - 1) /
+         FLASH_PAGE_SIZE;
+}
+
+// static
+bool KeymapStore::Parse(std::span<const uint8_t> data,
+                        keymap::Layout& layout) {
+  keymap::StoredLayout stored;
+  if (data.size() < sizeof(stored)) {
+    return false;
+  }
+  memcpy(&stored, data.data(), sizeof(stored));
+  size_t num_keys = stored.num_layers * stored.layer_size;
+  if (!stored.num_layers || !stored.num_dials ||
+      data.size() != sizeof(stored) +
+                         stored.num_dials * sizeof(keymap::DialIndex) +
+                         num_keys * sizeof(keymap::Key)) {
+    return false;
+  }
+  auto dial_index = reinterpret_cast<const keymap::DialIndex*>(
+      data.data() + sizeof(stored));
+  auto keys = reinterpret_cast<const keymap::Key*>(dial_index +
+                                                   stored.num_dials);
+  for (size_t dial = 0; dial < stored.num_dials; ++dial) {
+    if (dial_index[dial].first + dial_index[dial].positions >
+        stored.layer_size) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < num_keys; ++i) {
+    if (keys[i].type > keymap::KeyType::kLayer ||
+        (keys[i].type == keymap::KeyType::kLayer &&
+         keys[i].value >= stored.num_layers)) {
+      return false;
+    }
+  }
+  layout = {stored.num_layers, stored.num_dials, stored.layer_size,
+            dial_index, keys};
+  return true;
+}
+
+bool KeymapStore::Use(uint32_t page) {
+  RecordHeader header;
+  memcpy(&header, RegionPage(page), sizeof(header));
+  std::span<const uint8_t> data(RegionPage(page) + sizeof(header),
+                                header.size);
+  if (keymap::Crc32(data.data(), data.size()) != header.crc) {
+    return false;
+  }
+  // The slot not in use, as the current layout may still be read.
+  keymap::Layout& layout =
+      layout_ == &layouts_[0] ? layouts_[1] : layouts_[0];
+  if (!data.empty() && !Parse(data, layout)) {
+    return false;
+  }
+  layout_ = data.empty() ? &keymap::kBuiltInLayout : &layout;
+  size_ = header.size;
+  crc_ = header.crc;
+  sequence_ = header.sequence;
+  next_page_ = (page + RecordPages(header.size)) % kNumPages;
+  return true;
+}
+
+KeymapStore::Status KeymapStore::Append(std::span<const uint8_t> data,
+                                        uint32_t crc) {
+  RecordHeader header = {.magic = kRecordMagic,
+                         .format = kFormat,
+                         .size = static_cast<uint16_t>(data.size()),
+                         .sequence = last_sequence_ + 1,
+                         .crc = crc};
+  uint32_t num_pages = RecordPages(data.size());
+  uint32_t page = next_page_;
+  if (page + num_pages > kNumPages) {
+    page = 0;
+  }
+  // Pages left in the sector of the current record are used if blank. If a
+  // torn record is there, the log goes on from the next sector.
+  if (page % kPagesPerSector &&
+      !IsBlank(RegionPage(page),
+               std::min(num_pages, kPagesPerSector - page % kPagesPerSector) *
+                   FLASH_PAGE_SIZE)) {
+    page = (page / kPagesPerSector + 1) * kPagesPerSector;
+    if (page + num_pages > kNumPages) {
+      page = 0;
+    }
+  }
+
+  Program program = {
+      .first_page = page,
+      .num_pages = num_pages,
+      .header = std::span(reinterpret_cast<const uint8_t*>(&header),
+                          sizeof(header)),
+      .data = data,
+      .page_buffer = page_buffer_.data()};
+  int result = flash_safe_execute(
+      [](void* param) {
+        const Program& program = *static_cast<const Program*>(param);
+        for (uint32_t i = 0; i < program.num_pages; ++i) {
+          uint32_t page = program.first_page + i;
+          uint32_t offset = kRegionOffset + page * FLASH_PAGE_SIZE;
+          // Sectors the log enters are erased, unless they are still blank.
+          if (page % kPagesPerSector == 0 &&
+              !IsBlank(RegionPage(page), FLASH_SECTOR_SIZE)) {
+            flash_range_erase(offset, FLASH_SECTOR_SIZE);
+          }
+          std::fill(program.page_buffer,
+                    program.page_buffer + FLASH_PAGE_SIZE, 0xff);
+          size_t start = i * FLASH_PAGE_SIZE;
+          for (size_t j = 0; j < FLASH_PAGE_SIZE; ++j) {
+            size_t k = start + j;
+            if (k < program.header.size()) {
+              program.page_buffer[j] = program.header[k];
+            } else if (k - program.header.size() < program.data.size()) {
+              program.page_buffer[j] =
+                  program.data[k - program.header.size()];
+            }
+          }
+          flash_range_program(offset, program.page_buffer, FLASH_PAGE_SIZE);
+        }
+      },
+      &program, kFlashSafeTimeoutMs);
+  if (result != PICO_OK) {
+    return Status::kFlashError;
+  }
+  last_sequence_ = header.sequence;
+  const uint8_t* written = RegionPage(page);
+  if (memcmp(written, &header, sizeof(header)) != 0 ||
+      !std::equal(data.begin(), data.end(), written + sizeof(header)) ||
+      !Use(page)) {
+    return Status::kFlashError;
+  }
+  return Status::kOk;
+}
@@ -0,0 +1,117 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef COMMON_KEYMAP_STORE_H_
+#define COMMON_KEYMAP_STORE_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "hardware/flash.h"
+
+#include "keymap.h"
+
+// Keymaps written at runtime, e.g. over USB, kept in a region at the end of
+// flash and used in place from XIP flash, so that a new layout needs no
+// reflashing and boot copies nothing.
+//
+// The region is a log of records, each a header and a keymap in the format
+// of keymap::StoredLayout, from a page boundary. A new record goes after the
+// current one, and the log wraps around the region, so each sector is erased
+// once a lap, right before the log enters it again. The current keymap is the
+// record with the highest sequence whose CRC matches; a record torn by a
+// reset is skipped, and the one before it is used. A record with no keymap
+// goes back to the built-in one.
+class KeymapStore final {
+ public:
+#ifdef PICO_FLASH_SIZE_BYTES
+  static constexpr uint32_t kFlashSize = PICO_FLASH_SIZE_BYTES;
+#else
+  static constexpr uint32_t kFlashSize = 2 * 1024 * 1024;
+#endif
+  static constexpr uint32_t kRegionSize = 16 * FLASH_SECTOR_SIZE;
+  static constexpr uint32_t kRegionOffset = kFlashSize - kRegionSize;
+  static constexpr size_t kMaxLayoutSize = 2048;
+
+  // Each is sent over USB as telemetry_protocol::KeymapStatus.
+  enum class Status : uint8_t {
+    kOk,
+    // Larger than kMaxLayoutSize, or data out of it.
+    kBadSize,
+    kBadCrc,
+    // Not a layout, e.g. keys out of their layer.
+    kBadLayout,
+    kFlashError,
+  };
+
+  KeymapStore() = default;
+  KeymapStore(const KeymapStore&) = delete;
+  KeymapStore& operator=(const KeymapStore&) = delete;
+  ~KeymapStore() = default;
+
+  // Finds the current keymap in flash, reading only the record headers and
+  // the CRC of the one it takes. Returns it, or the built-in keymap.
+  const keymap::Layout& Load();
+
+  // The current keymap, its size, CRC and the sequence of its record; the
+  // size and CRC are 0 for the built-in one, and all are before the first.
+  const keymap::Layout& layout() const { return *layout_; }
+  uint16_t size() const { return size_; }
+  uint32_t crc() const { return crc_; }
+  uint32_t sequence() const { return sequence_; }
+
+  // Takes a keymap of `size` bytes in pieces, to Commit() once all are in.
+  Status Begin(size_t size);
+  Status Write(size_t offset, std::span<const uint8_t> data);
+  // Checks the keymap taken against `crc`, appends it to the log and makes it
+  // current. An empty one goes back to the built-in keymap. Takes some 50 ms
+  // with interrupts disabled, and the other core paused, when the log enters
+  // a new sector.
+  Status Commit(uint32_t crc);
+
+ private:
+  struct RecordHeader {
+    uint32_t magic;
+    uint16_t format;
+    // Of the keymap that follows.
+    uint16_t size;
+    uint32_t sequence;
+    uint32_t crc;
+  };
+
+  static constexpr uint32_t kRecordMagic = 0x50414d4b;  // "KMAP"
+  static constexpr uint16_t kFormat = 1;
+  static constexpr uint32_t kNumPages = kRegionSize / FLASH_PAGE_SIZE;
+
+  static const uint8_t* RegionPage(uint32_t page);
+  // Pages a record of a keymap of `size` bytes takes.
+  static uint32_t RecordPages(size_t size);
+  // Whether `data` is a keymap, and if so, sets `layout` to it.
+  static bool Parse(std::span<const uint8_t> data, keymap::Layout& layout);
+
+  // Takes the record at `page` if its CRC matches.
+  bool Use(uint32_t page);
+  Status Append(std::span<const uint8_t> data, uint32_t crc);
+
+  // The layout in use is one of these, or the built-in one, so that the other
+  // can be set up for the next record.
+  std::array<keymap::Layout, 2> layouts_ = {};
+  const keymap::Layout* layout_ = &keymap::kBuiltInLayout;
+  uint16_t size_ = 0;
+  uint32_t crc_ = 0;
+  uint32_t sequence_ = 0;
+  // The highest sequence in the log.
+  uint32_t last_sequence_ = 0;
+  // The page after the current record, where the next one goes.
+  uint32_t next_page_ = 0;
+
+  // The keymap being taken, aligned as it is used in place.
+  alignas(4) std::array<uint8_t, kMaxLayoutSize> pending_;
+  size_t pending_size_ = 0;
+  std::array<uint8_t, FLASH_PAGE_SIZE> page_buffer_;
+};
+
+#endif  // COMMON_KEYMAP_STORE_H_
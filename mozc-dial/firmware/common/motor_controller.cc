@@ -4,49 +4,46 @@
 
 #include "motor_controller.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
 #include <initializer_list>
 
 #include "hardware/gpio.h"
+#include "hardware/sync.h"
 #include "pico/time.h"
+#include "hot_path.h"
+#include "trace.h"
 
-static constexpr int kMotorStepIntervalInUs = 2000;
-
-// Activate 1 of 8 motor drivers in a specific step phase.
-class MotorController::Decoder {
- public:
-  Decoder(int8_t a0, int8_t a1, int8_t a2, int8_t en)
-      : a0_(a0), a1_(a1), a2_(a2), en_(en) {
-    for (int8_t gpio : {en, a0, a1, a2}) {
-      gpio_init(gpio);
-      gpio_set_dir(gpio, GPIO_OUT);
-      gpio_put(gpio, false);
-    }
-  }
-  Decoder(const Decoder&) = delete;
-  Decoder& operator=(const Decoder&) = delete;
-  ~Decoder() = default;
+#if DIAL_MOTOR_PIO
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "motor_frames.pio.h"
+#endif
 
-  void Select(uint8_t index) {
-    hard_assert(index < 8);
-    gpio_put(a0_, index & 1);
-    gpio_put(a1_, index & 2);
-    gpio_put(a2_, index & 4);
-    gpio_put(en_, true);
-  }
-  void Unselect() { gpio_put(en_, false); }
+// Motor drivers on the decoders are energized in two groups in turn, as each
+// decoder selects one driver at a time.
+static constexpr int kRefreshIntervalInUs = 250;
 
- private:
-  int8_t a0_;
-  int8_t a1_;
-  int8_t a2_;
-  int8_t en_;
-};
+#if DIAL_MOTOR_PIO
+// The controller the DMA interrupt feeds. There is one per chip.
+static MotorController* sPioController = nullptr;
+#endif
 
-// static
-bool MotorController::OnAlarm(repeating_timer* t) {
-  static_cast<MotorController*>(t->user_data)->Step();
-  return true;
+MotorController::Decoder::Decoder(int8_t a0, int8_t a1, int8_t a2, int8_t en)
+    : a0_(a0), a1_(a1), a2_(a2), en_(en) {
+  for (int8_t gpio : {en, a0, a1, a2}) {
+    gpio_init(gpio);
+    gpio_set_dir(gpio, GPIO_OUT);
+    gpio_put(gpio, false);
+  }
+}
+
+uint32_t DIAL_HOT_PATH(MotorController::Decoder::Select)(uint8_t index) const {
+  hard_assert(index < 8);
+  return (index & 1 ? 1u << a0_ : 0) | (index & 2 ? 1u << a1_ : 0) |
+         (index & 4 ? 1u << a2_ : 0) | 1u << en_;
 }
 
 MotorController::MotorController(Mode mode) {
@@ -54,10 +51,11 @@ MotorController::MotorController(Mode mode) {
     // Each decoder is responsible for a specific phase to driver 1 of 8 motor
     // drivers. As we have 4 phases, it can drive 4 motors at the same time, and
     // by time division multiplexing, we make them drive 8 motors.
-    decoder_[0] = std::make_unique<Decoder>(1, 2, 3, 4);
-    decoder_[1] = std::make_unique<Decoder>(5, 6, 7, 8);
-    decoder_[2] = std::make_unique<Decoder>(9, 10, 11, 12);
-    decoder_[3] = std::make_unique<Decoder>(13, 14, 15, 16);
+    decoder_[0].emplace(1, 2, 3, 4);
+    decoder_[1].emplace(5, 6, 7, 8);
+    decoder_[2].emplace(9, 10, 11, 12);
+    decoder_[3].emplace(13, 14, 15, 16);
+    gpio_mask_ = 0xffffu << 1;
   }
 
   // 9th motor driver is controlled via GPIOs directly.
@@ -66,43 +64,260 @@ MotorController::MotorController(Mode mode) {
     gpio_set_dir(gpio, GPIO_OUT);
     gpio_put(gpio, false);
   }
+  gpio_mask_ |= 0xfu << 17;
+
+  for (size_t i = 0; i < kNumOfMotors; ++i) {
+    SetProfile(i, kDefaultProfile);
+  }
 
-  add_repeating_timer_us(-kMotorStepIntervalInUs, OnAlarm, this, &timer_);
+#if DIAL_MOTOR_PIO
+  // A state machine holds each frame on the motor GPIOs, which are
+  // consecutive, for a refresh, and the DMA keeps its FIFO filled.
+  hard_assert(!sPioController);
+  sPioController = this;
+  uint offset = 0;
+  hard_assert(pio_claim_free_sm_and_add_program(&motor_frames_program, &pio_,
+                                                &sm_, &offset));
+  uint first_gpio = __builtin_ctz(gpio_mask_);
+  uint num_gpios = 32 - __builtin_clz(gpio_mask_) - first_gpio;
+  for (uint gpio = first_gpio; gpio < first_gpio + num_gpios; ++gpio) {
+    pio_gpio_init(pio_, gpio);
+  }
+  pio_sm_set_pins_with_mask(pio_, sm_, 0, gpio_mask_);
+  pio_sm_set_consecutive_pindirs(pio_, sm_, first_gpio, num_gpios, true);
+  pio_sm_config config = motor_frames_program_get_default_config(offset);
+  sm_config_set_out_pins(&config, first_gpio, num_gpios);
+  sm_config_set_out_shift(&config, /*shift_right=*/true, /*autopull=*/false,
+                          /*pull_threshold=*/32);
+  sm_config_set_fifo_join(&config, PIO_FIFO_JOIN_TX);
+  // A cycle per microsecond.
+  sm_config_set_clkdiv(&config, clock_get_hz(clk_sys) / 1000000.0f);
+  pio_sm_init(pio_, sm_, offset, &config);
+  // The hold loop count, kept in ISR: a frame takes the count and 4 cycles.
+  pio_sm_put(pio_, sm_, kRefreshIntervalInUs - 4);
+  pio_sm_exec(pio_, sm_, pio_encode_pull(false, false));
+  pio_sm_exec(pio_, sm_, pio_encode_out(pio_isr, 32));
+  pio_sm_set_enabled(pio_, sm_, true);
+
+  dma_channel_ = dma_claim_unused_channel(true);
+  dma_channel_config dma_config =
+      dma_channel_get_default_config(dma_channel_);
+  channel_config_set_transfer_data_size(&dma_config, DMA_SIZE_32);
+  channel_config_set_read_increment(&dma_config, true);
+  channel_config_set_write_increment(&dma_config, false);
+  channel_config_set_dreq(&dma_config, pio_get_dreq(pio_, sm_, true));
+  dma_channel_configure(dma_channel_, &dma_config, &pio_->txf[sm_],
+                        frames_.data(), 0, false);
+  dma_channel_set_irq1_enabled(dma_channel_, true);
+  irq_add_shared_handler(DMA_IRQ_1, &OnDmaIrq,
+                         PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+  irq_set_enabled(DMA_IRQ_1, true);
+#endif
 }
 
-MotorController::~MotorController() {}
+MotorController::~MotorController() {
+#if DIAL_MOTOR_PIO
+  irq_remove_handler(DMA_IRQ_1, &OnDmaIrq);
+  dma_channel_set_irq1_enabled(dma_channel_, false);
+  dma_channel_abort(dma_channel_);
+  dma_channel_unclaim(dma_channel_);
+  pio_sm_set_enabled(pio_, sm_, false);
+  sPioController = nullptr;
+#else
+  if (refreshing_) {
+    cancel_repeating_timer(&timer_);
+  }
+#endif
+}
 
-void MotorController::Start(uint8_t index) {
+void MotorController::SetProfile(uint8_t index, const Profile& profile) {
   hard_assert(index < kNumOfMotors);
-  started_[index] = true;
+  hard_assert(profile.ramp_steps <= kMaxRampSteps);
+  std::array<uint16_t, kMaxRampSteps + 1> intervals = {};
+  // Constant acceleration: the squared speed grows linearly with the steps.
+  float start_speed = 1.0f / profile.start_interval_us;
+  float cruise_speed = 1.0f / profile.cruise_interval_us;
+  for (size_t step = 0; step < profile.ramp_steps; ++step) {
+    float speed = std::sqrt(start_speed * start_speed +
+                            (cruise_speed * cruise_speed -
+                             start_speed * start_speed) *
+                                step / profile.ramp_steps);
+    intervals[step] = static_cast<uint16_t>(1.0f / speed + 0.5f);
+  }
+  intervals[profile.ramp_steps] = profile.cruise_interval_us;
+
+  uint32_t status = save_and_disable_interrupts();
+  Motor& motor = motors_[index];
+  motor.ramp_intervals_us = intervals;
+  motor.ramp_steps = profile.ramp_steps;
+  motor.steps_per_position = profile.steps_per_position;
+  restore_interrupts(status);
+}
+
+void DIAL_HOT_PATH(MotorController::Start)(uint8_t index, uint8_t positions) {
+  hard_assert(index < kNumOfMotors);
+  uint32_t status = save_and_disable_interrupts();
+  Motor& motor = motors_[index];
+  if (!motor.started) {
+    motor.started = true;
+    motor.steps = 0;
+    motor.positions = kUnknownPositions;
+    motor.steps_to_base = UINT16_MAX;
+    motor.next_step_us = time_us_32();
+  }
+  if (positions != motor.positions) {
+    // The sensor has just seen the dial at `positions`.
+    motor.positions = positions;
+    motor.steps_to_base = positions == kUnknownPositions
+                              ? UINT16_MAX
+                              : positions * motor.steps_per_position;
+  }
+  Kick();
+  restore_interrupts(status);
 }
 
-void MotorController::Stop(uint8_t index) {
+void DIAL_HOT_PATH(MotorController::Stop)(uint8_t index) {
   hard_assert(index < kNumOfMotors);
-  started_[index] = false;
+  motors_[index].started = false;
+}
+
+void DIAL_HOT_PATH(MotorController::Advance)(Motor& motor, uint32_t now_us) {
+  if (static_cast<int32_t>(now_us - motor.next_step_us) < 0) {
+    return;
+  }
+  motor.phase = (motor.phase + kNumOfPhases - 1) % kNumOfPhases;
+  if (motor.steps != UINT16_MAX) {
+    ++motor.steps;
+  }
+  if (motor.steps_to_base && motor.steps_to_base != UINT16_MAX) {
+    --motor.steps_to_base;
+  }
+  // Up the ramp from the start, and down it to the base.
+  size_t ramp = std::min<size_t>(
+      {motor.steps, motor.steps_to_base, motor.ramp_steps});
+  motor.next_step_us += motor.ramp_intervals_us[ramp];
+  // A late refresh delays the following steps rather than bunching them.
+  if (static_cast<int32_t>(now_us - motor.next_step_us) > 0) {
+    motor.next_step_us = now_us;
+  }
 }
 
-void MotorController::Step() {
-  // Drive first 4 motor drivers in even phases, and later 4 ones in odd
-  // phases.
-  size_t start_index = (phase_ & 1) ? kNumOfPhases : 0;
-  size_t half_phase = phase_ >> 1;
-  for (size_t i = start_index; i < start_index + kNumOfPhases; ++i) {
-    if (!decoder_[i]) {
+#if DIAL_MOTOR_PIO
+// static
+void DIAL_HOT_PATH(MotorController::OnDmaIrq)() {
+  MotorController* controller = sPioController;
+  if (!dma_channel_get_irq1_status(controller->dma_channel_)) {
+    return;
+  }
+  trace::Begin(trace::Stage::kMotorRefresh);
+  dma_channel_acknowledge_irq1(controller->dma_channel_);
+  if (controller->refreshing_) {
+    controller->Feed();
+  }
+  trace::End(trace::Stage::kMotorRefresh);
+}
+
+void DIAL_HOT_PATH(MotorController::Feed)() {
+  // The frames go out after those still in the FIFO, so they are built that
+  // far ahead, on the time the state machine will show them.
+  size_t size = 0;
+  while (size < frames_.size()) {
+    bool running = IsRunning();
+    frames_[size++] = NextFrame(frame_time_us_) >> __builtin_ctz(gpio_mask_);
+    frame_time_us_ += kRefreshIntervalInUs;
+    if (!running) {
+      // The state machine keeps the all-off frame.
+      refreshing_ = false;
+      break;
+    }
+  }
+  dma_channel_transfer_from_buffer_now(dma_channel_, frames_.data(), size);
+}
+
+void DIAL_HOT_PATH(MotorController::Kick)() {
+  if (refreshing_) {
+    return;
+  }
+  refreshing_ = true;
+  // Otherwise the last transfer is still going, and its interrupt feeds on.
+  if (!dma_channel_is_busy(dma_channel_)) {
+    frame_time_us_ = time_us_32();
+    Feed();
+  }
+}
+#else
+// static
+bool DIAL_HOT_PATH(MotorController::OnAlarm)(repeating_timer* t) {
+  auto* controller = static_cast<MotorController*>(t->user_data);
+  controller->refresh_latency_.Enter(time_us_32());
+  trace::Begin(trace::Stage::kMotorRefresh);
+  bool running = controller->Refresh();
+  trace::End(trace::Stage::kMotorRefresh);
+  return running;
+}
+
+bool DIAL_HOT_PATH(MotorController::Refresh)() {
+  bool running = IsRunning();
+  gpio_put_masked(gpio_mask_, NextFrame(time_us_32()));
+  if (!running) {
+    // All coils are off until the next Start().
+    refreshing_ = false;
+  }
+  return running;
+}
+
+void DIAL_HOT_PATH(MotorController::Kick)() {
+  if (refreshing_) {
+    return;
+  }
+  refreshing_ = true;
+  refresh_latency_.Expect(time_us_32() + kRefreshIntervalInUs,
+                          kRefreshIntervalInUs);
+  add_repeating_timer_us(-kRefreshIntervalInUs, OnAlarm, this, &timer_);
+}
+#endif
+
+bool DIAL_HOT_PATH(MotorController::IsRunning)() const {
+  for (const Motor& motor : motors_) {
+    if (motor.started) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t DIAL_HOT_PATH(MotorController::NextFrame)(uint32_t now_us) {
+  uint32_t frame = 0;
+  // The first 4 motor drivers in even refreshes, and the later 4 ones in odd
+  // ones. Each motor takes the decoder of its coil; motors whose coils are on
+  // the same decoder, as they step at their own pace, take turns.
+  size_t start_index = group_ ? kNumOfPhases : 0;
+  std::array<bool, kNumOfPhases> selected = {};
+  for (size_t n = 0; n < kNumOfPhases; ++n) {
+    size_t i = start_index + (first_ + n) % kNumOfPhases;
+    Motor& motor = motors_[i];
+    if (!motor.started) {
       continue;
     }
-    if (started_[i]) {
-      decoder_[(i + half_phase) % kNumOfPhases]->Select(i);
-    } else {
-      decoder_[(i + half_phase) % kNumOfPhases]->Unselect();
+    Advance(motor, now_us);
+    size_t phase = (i + motor.phase) % kNumOfPhases;
+    std::optional<Decoder>& decoder = decoder_[phase];
+    if (decoder && !selected[phase]) {
+      frame |= decoder->Select(i);
+      selected[phase] = true;
     }
   }
-  // Drive the last 9th motor drivers.
-  bool on = started_[8] && phase_ & 1;
-  gpio_put(17, on && half_phase == 0);
-  gpio_put(18, on && half_phase == 1);
-  gpio_put(19, on && half_phase == 2);
-  gpio_put(20, on && half_phase == 3);
+  // Drive the last 9th motor drivers with the later group.
+  Motor& motor = motors_[8];
+  bool on = motor.started && group_;
+  if (on) {
+    Advance(motor, now_us);
+    frame |= 1u << (17 + motor.phase);
+  }
 
-  phase_ = (phase_ + 7) % 8;
-}
\ No newline at end of file
+  group_ ^= 1;
+  if (!group_) {
+    first_ = (first_ + 1) % kNumOfPhases;
+  }
+  return frame;
+}
@@ -5,34 +5,152 @@
 #ifndef COMMON_MOTOR_CONTROLLER_H_
 #define COMMON_MOTOR_CONTROLLER_H_
 
+#include <array>
 #include <cstdint>
-#include <memory>
+#include <optional>
 
+#if DIAL_MOTOR_PIO
+#include "hardware/pio.h"
+#else
 #include "pico/time.h"
+#endif
 
+#include "isr_latency.h"
+
+// Steps the motors that return the dials to the base position, each on its
+// own schedule: it speeds up from the start, cruises, and slows down again as
+// the dial nears the base.
+//
+// The coils are refreshed as frames of GPIO levels, written by a timer
+// callback, or built with DIAL_MOTOR_PIO, held by a PIO state machine that
+// DMA feeds a few milliseconds ahead. Either stops while no motor runs.
 class MotorController final {
  public:
   enum class Mode { k1Motor, k9Motor };
+
+  // A trapezoidal speed profile, in step intervals.
+  struct Profile {
+    // The interval of the first step, and of the last one at the base.
+    uint16_t start_interval_us;
+    // The interval once the motor is up to speed.
+    uint16_t cruise_interval_us;
+    // Steps to speed up from the start to the cruise speed, at a constant
+    // acceleration, and to slow down again; at most kMaxRampSteps.
+    uint8_t ramp_steps;
+    // Motor steps the dial takes to return by one position.
+    uint8_t steps_per_position;
+  };
+  static constexpr size_t kMaxRampSteps = 16;
+  // The speed of the motors before they had profiles.
+  static constexpr Profile kFixedProfile = {4000, 4000, 0, 5};
+  // Cruises at twice that speed. Not yet checked on a board, where motors on
+  // the same decoder take turns, and so have less torque, as they speed up.
+  static constexpr Profile kFastProfile = {4000, 2000, 8, 5};
+  // Every motor starts with this one. Built with DIAL_FAST_MOTOR_PROFILE, the
+  // fast one; otherwise the fixed one.
+#if DIAL_FAST_MOTOR_PROFILE
+  static constexpr Profile kDefaultProfile = kFastProfile;
+#else
+  static constexpr Profile kDefaultProfile = kFixedProfile;
+#endif
+
+  // A Start() without the dial position, that never slows down.
+  static constexpr uint8_t kUnknownPositions = 0;
+
   explicit MotorController(Mode = Mode::k9Motor);
   MotorController(const MotorController&) = delete;
   MotorController& operator=(const MotorController&) = delete;
   ~MotorController();
 
-  void Start(uint8_t index);
+  // Tunes the motor `index`, e.g. for the weight of its dial.
+  void SetProfile(uint8_t index, const Profile& profile);
+
+  // Runs the motor `index`, or keeps it running, for a dial `positions` away
+  // from the base.
+  void Start(uint8_t index, uint8_t positions = kUnknownPositions);
   void Stop(uint8_t index);
 
+  // How late the timer callback refreshes the coils, from when each refresh
+  // is due. Not measured when driven from PIO, that holds the frames ahead.
+  IsrLatency& refresh_latency() { return refresh_latency_; }
+
  private:
-  class Decoder;
+  // Activate 1 of 8 motor drivers in a specific step phase.
+  class Decoder {
+   public:
+    Decoder(int8_t a0, int8_t a1, int8_t a2, int8_t en);
+    Decoder(const Decoder&) = delete;
+    Decoder& operator=(const Decoder&) = delete;
+    ~Decoder() = default;
 
-  static bool OnAlarm(repeating_timer* t);
-  void Step();
+    // The GPIO levels that select the driver `index`.
+    uint32_t Select(uint8_t index) const;
+
+   private:
+    int8_t a0_;
+    int8_t a1_;
+    int8_t a2_;
+    int8_t en_;
+  };
 
   static constexpr size_t kNumOfPhases = 4;
   static constexpr size_t kNumOfMotors = 9;
-  std::unique_ptr<Decoder> decoder_[kNumOfPhases];
-  bool started_[kNumOfMotors] = { false };
-  uint8_t phase_ = 0;
+
+  struct Motor {
+    bool started = false;
+    // The coil energized, that runs backwards to return the dial.
+    uint8_t phase = 0;
+    uint8_t positions = kUnknownPositions;
+    // Steps since the start, and to the base, saturated.
+    uint16_t steps = 0;
+    uint16_t steps_to_base = UINT16_MAX;
+    uint32_t next_step_us = 0;
+    // Step intervals by the steps from either end of the ramp.
+    std::array<uint16_t, kMaxRampSteps + 1> ramp_intervals_us = {};
+    uint8_t ramp_steps = 0;
+    uint8_t steps_per_position = 0;
+  };
+
+#if DIAL_MOTOR_PIO
+  // Frames per DMA transfer, as many as the joined TX FIFO holds.
+  static constexpr size_t kFramesPerTransfer = 8;
+
+  static void OnDmaIrq();
+  // Builds the next frames and starts their transfer.
+  void Feed();
+#else
+  static bool OnAlarm(repeating_timer* t);
+  // Writes the next frame, and returns false once all motors stopped.
+  bool Refresh();
+#endif
+  // Starts refreshing the coils, if stopped. Called with interrupts disabled.
+  void Kick();
+  bool IsRunning() const;
+  // The GPIO levels of the refresh at `now_us`.
+  uint32_t NextFrame(uint32_t now_us);
+  void Advance(Motor& motor, uint32_t now_us);
+
+  std::optional<Decoder> decoder_[kNumOfPhases];
+  std::array<Motor, kNumOfMotors> motors_;
+  // The motor GPIOs.
+  uint32_t gpio_mask_ = 0;
+  // The group of motor drivers energized in this refresh, and the first one
+  // to get a decoder, rotated for fairness.
+  uint8_t group_ = 0;
+  uint8_t first_ = 0;
+  // True from Kick() until the all-off frame after the last motor stopped.
+  volatile bool refreshing_ = false;
+  IsrLatency refresh_latency_;
+#if DIAL_MOTOR_PIO
+  PIO pio_ = nullptr;
+  uint sm_ = 0;
+  uint dma_channel_ = 0;
+  // The time of the next frame to build.
+  uint32_t frame_time_us_ = 0;
+  std::array<uint32_t, kFramesPerTransfer> frames_ = {};
+#else
   repeating_timer timer_;
+#endif
 };
 
-#endif  // COMMON_MOTOR_CONTROLLER_H_
\ No newline at end of file
+#endif  // COMMON_MOTOR_CONTROLLER_H_
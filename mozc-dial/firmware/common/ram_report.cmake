@@ -0,0 +1,64 @@
+# Lists the functions a firmware image runs from SRAM, largest first, with
+# their total size, into <target>.ram.txt next to the ELF after each build:
+# the hot paths placed by common/hot_path.h, and those the SDK places itself,
+# e.g. its flash programming. The same file runs as the script of the report.
+
+if(CMAKE_SCRIPT_MODE_FILE)
+    # cmake -DREADELF=... -DELF=... -DOUTPUT=... -P ram_report.cmake
+    execute_process(
+            COMMAND ${READELF} --syms --wide --demangle ${ELF}
+            OUTPUT_VARIABLE symbols
+            RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${READELF} failed on ${ELF}")
+    endif()
+    # Square brackets, e.g. of ABI tags, would hold list separators together.
+    string(REPLACE "[" "<" symbols "${symbols}")
+    string(REPLACE "]" ">" symbols "${symbols}")
+    string(REPLACE ";" "," symbols "${symbols}")
+    string(REPLACE "\n" ";" lines "${symbols}")
+
+    set(entries)
+    set(total 0)
+    foreach(line IN LISTS lines)
+        # Num: Value Size Type Bind Vis Ndx Name, with SRAM at 0x20000000.
+        if(NOT line MATCHES
+                "^ *[0-9]+: 20[0-9a-f]+ +([0-9]+) FUNC +[A-Z]+ +[A-Z]+ +[0-9]+ (.+)$")
+            continue()
+        endif()
+        set(size ${CMAKE_MATCH_1})
+        set(name "${CMAKE_MATCH_2}")
+        math(EXPR total "${total} + ${size}")
+        # Padded, so that the entries sort by size.
+        string(LENGTH "${size}" digits)
+        math(EXPR padding "8 - ${digits}")
+        string(SUBSTRING "        " 0 ${padding} pad)
+        list(APPEND entries "${pad}${size}  ${name}")
+    endforeach()
+    list(SORT entries)
+    list(REVERSE entries)
+    list(LENGTH entries count)
+
+    set(report "# Functions in SRAM, in bytes\n")
+    foreach(entry IN LISTS entries)
+        string(APPEND report "${entry}\n")
+    endforeach()
+    string(APPEND report "# ${count} functions, ${total} bytes\n")
+    file(WRITE ${OUTPUT} "${report}")
+    get_filename_component(output_name ${OUTPUT} NAME)
+    message(STATUS "${output_name}: ${count} functions in SRAM, ${total} bytes")
+    return()
+endif()
+
+set(DIAL_RAM_REPORT_SCRIPT ${CMAKE_CURRENT_LIST_FILE})
+
+# Writes the report of `target` after each build of it.
+function(dial_add_ram_report target)
+    add_custom_command(TARGET ${target} POST_BUILD
+            COMMAND ${CMAKE_COMMAND}
+                    -DREADELF=${CMAKE_READELF}
+                    -DELF=$<TARGET_FILE:${target}>
+                    -DOUTPUT=$<TARGET_FILE_DIR:${target}>/${target}.ram.txt
+                    -P ${DIAL_RAM_REPORT_SCRIPT}
+            VERBATIM)
+endfunction()
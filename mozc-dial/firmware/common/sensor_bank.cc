@@ -0,0 +1,73 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#include "sensor_bank.h"
+
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+#include "hot_path.h"
+
+namespace {
+
+SensorBank* sCapturingBank = nullptr;
+
+}  // namespace
+
+SensorBank::SensorBank(std::initializer_list<Sensor> sensors) {
+  hard_assert(sensors.size() <= kMaxSensors);
+  for (const Sensor& sensor : sensors) {
+    hard_assert(sensor.width > 0 && sensor.width <= kMaxWidth);
+    hard_assert(sensor.first_gpio + sensor.width <= NUM_BANK0_GPIOS);
+    for (uint8_t gpio = sensor.first_gpio;
+         gpio < sensor.first_gpio + sensor.width; ++gpio) {
+      gpio_init(gpio);
+      gpio_set_dir(gpio, GPIO_IN);
+      gpio_pull_up(gpio);  // Built-in 50-80K pull-up
+    }
+    gpio_mask_ |= ((1u << sensor.width) - 1) << sensor.first_gpio;
+    shifts_[size_] = sensor.first_gpio;
+    masks_[size_] = (1u << sensor.width) - 1;
+    ++size_;
+  }
+}
+
+void DIAL_HOT_PATH(SensorBank::Sample)() {
+  snapshot_ = gpio_get_all();
+}
+
+uint8_t DIAL_HOT_PATH(SensorBank::ReadNow)(size_t index) const {
+  return Decode(gpio_get_all(), index);
+}
+
+void SensorBank::EnableEdgeCapture() {
+  hard_assert(!sCapturingBank);
+  sCapturingBank = this;
+  for (uint gpio = 0; gpio < NUM_BANK0_GPIOS; ++gpio) {
+    if (gpio_mask_ & (1u << gpio)) {
+      gpio_set_irq_enabled_with_callback(
+          gpio, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true, &OnGpioIrq);
+    }
+  }
+}
+
+std::optional<uint32_t> DIAL_HOT_PATH(SensorBank::PopEdge)() {
+  std::optional<Edge> edge = edges_.Pop();
+  if (!edge) {
+    return std::nullopt;
+  }
+  snapshot_ = edge->levels;
+  return edge->time_us;
+}
+
+// static
+void DIAL_HOT_PATH(SensorBank::OnGpioIrq)(uint gpio, uint32_t events) {
+  SensorBank* bank = sCapturingBank;
+  if (!bank || !(bank->gpio_mask_ & (1u << gpio))) {
+    return;
+  }
+  bank->edges_.Push({time_us_32(), gpio_get_all()});
+  __sev();
+}
@@ -0,0 +1,83 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef COMMON_SENSOR_BANK_H_
+#define COMMON_SENSOR_BANK_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+
+#include "pico/types.h"
+
+#include "spsc_ring.h"
+
+// Samples the photo sensors of several dials at the same instant with a single
+// read of all GPIO inputs, and extracts each dial's Gray code from that
+// snapshot with a precomputed mask and shift.
+class SensorBank final {
+ public:
+  // A sensor whose bits are wired to `width` consecutive GPIOs, from
+  // `first_gpio` for the least significant bit.
+  struct Sensor {
+    uint8_t first_gpio;
+    uint8_t width;
+  };
+
+  static constexpr size_t kMaxSensors = 9;
+
+  SensorBank(std::initializer_list<Sensor> sensors);
+  SensorBank(const SensorBank&) = delete;
+  SensorBank& operator=(const SensorBank&) = delete;
+  ~SensorBank() = default;
+
+  // Takes a snapshot of all sensors.
+  void Sample();
+
+  // Captures every edge on the sensor pins with a GPIO interrupt, with the
+  // time and the levels of all pins. Only one SensorBank can capture, and it
+  // takes the GPIO interrupt callback of the core. Each edge also signals an
+  // event, so that a main loop sleeping in __wfe() wakes up.
+  void EnableEdgeCapture();
+
+  // Makes the oldest captured edge the snapshot, and returns its time in us.
+  std::optional<uint32_t> PopEdge();
+  bool HasEdges() const { return !edges_.empty(); }
+  // Edges lost as the main loop did not pop them in time. The next Sample()
+  // still sees the current levels.
+  uint32_t dropped_edges() const { return edges_.dropped(); }
+
+  // Returns the Gray code of sensor `index` in the last snapshot.
+  uint8_t Read(size_t index) const { return Decode(snapshot_, index); }
+  // Returns the Gray code of sensor `index` now, leaving the snapshot as it
+  // is, for readers outside the main loop.
+  uint8_t ReadNow(size_t index) const;
+
+  size_t size() const { return size_; }
+
+ private:
+  static constexpr size_t kMaxWidth = 6;
+  static constexpr size_t kMaxEdges = 64;
+
+  struct Edge {
+    uint32_t time_us;
+    uint32_t levels;
+  };
+
+  static void OnGpioIrq(uint gpio, uint32_t events);
+  uint8_t Decode(uint32_t levels, size_t index) const {
+    return (levels >> shifts_[index]) & masks_[index];
+  }
+
+  std::array<uint8_t, kMaxSensors> shifts_ = {};
+  std::array<uint8_t, kMaxSensors> masks_ = {};
+  size_t size_ = 0;
+  uint32_t snapshot_ = 0;
+  uint32_t gpio_mask_ = 0;
+  SpscRing<Edge, kMaxEdges> edges_;
+};
+
+#endif  // COMMON_SENSOR_BANK_H_
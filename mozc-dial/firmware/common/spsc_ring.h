@@ -0,0 +1,63 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef COMMON_SPSC_RING_H_
+#define COMMON_SPSC_RING_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+// Lock-free ring buffer for one producer and one consumer, e.g. an interrupt
+// handler and the main loop, or the two cores. `N` must be a power of two.
+template <typename T, size_t N>
+class SpscRing final {
+ public:
+  static_assert(N && (N & (N - 1)) == 0, "N must be a power of two");
+
+  SpscRing() = default;
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+  ~SpscRing() = default;
+
+  // Called by the producer. Returns false, and counts the drop, if full.
+  bool Push(const T& value) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == N) {
+      dropped_.store(dropped_.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_relaxed);
+      return false;
+    }
+    items_[head % N] = value;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Called by the consumer.
+  std::optional<T> Pop() {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (head_.load(std::memory_order_acquire) == tail) {
+      return std::nullopt;
+    }
+    T value = items_[tail % N];
+    tail_.store(tail + 1, std::memory_order_release);
+    return value;
+  }
+
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  std::array<T, N> items_ = {};
+  std::atomic<uint32_t> head_ = 0;
+  std::atomic<uint32_t> tail_ = 0;
+  std::atomic<uint32_t> dropped_ = 0;
+};
+
+#endif  // COMMON_SPSC_RING_H_
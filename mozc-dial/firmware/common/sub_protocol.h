@@ -0,0 +1,174 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef COMMON_SUB_PROTOCOL_H_
+#define COMMON_SUB_PROTOCOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Registers of the sub-controllers on I2C, shared by main and sub. Multi-byte
+// registers are read or written in one burst from their first address, and
+// end with a CRC-8 of the preceding bytes.
+//
+// Each sub answers at the address of its slot, see SlotAddress(). Built with
+// DIAL_SUB_ADDRESS_ASSIGNMENT, every sub boots at kUnassignedAddress instead,
+// and main gives each an address from kFirstSubAddress on: it reads
+// kUniqueIdRegister there, that all unassigned subs answer at once, and writes
+// the ID that won the bus arbitration with a new address to
+// kAssignAddressRegister. Only the sub with that ID moves. That relies on the
+// I2C block of the RP2040 giving up as a target transmitter that loses the
+// arbitration, that is only modelled by the host simulator so far.
+//
+// Each sub decides the positions of its own dials, and runs the motors that
+// main pairs with them in kLocalMotorsRegister itself; main reads the
+// decided positions, with their age, from kDialStateRegister.
+namespace sub_protocol {
+
+constexpr uint8_t kUnassignedAddress = 68;
+constexpr uint8_t kFirstSubAddress = 0x50;
+constexpr size_t kMaxSubs = 8;
+
+// The address of the sub in `slot`. The sub in slot 0 keeps the address of
+// the only sub of the 9-dial edition.
+constexpr uint8_t SlotAddress(uint8_t slot) {
+  return slot ? kFirstSubAddress + slot : kUnassignedAddress;
+}
+
+// Bumped on incompatible changes to the registers below.
+constexpr uint8_t kVersion = 4;
+
+// Sensors and motors one sub can serve.
+constexpr size_t kMaxSubSensors = 8;
+constexpr size_t kMaxSubMotors = 16;
+
+// How long a new position has to stay before it is taken, on main and on the
+// subs alike: main and the subs both sample much more often than a misread
+// lasts, and the subs decide their dials as main did before them.
+constexpr uint32_t kConfirmTimeUs = 300;
+
+enum Register : uint8_t {
+  // Registers of the unversioned protocol, still served for an old main at
+  // kUnassignedAddress. Read: the first sensor's code. Write: motor 1-8
+  // bitmap.
+  kLegacySensorRegister = 0x00,
+  // Write: motor 9 in bit 0.
+  kLegacyMotor9Register = 0x01,
+
+  // Read: kVersion once the sub serves the registers below, or 0 before.
+  kVersionRegister = 0x10,
+
+  // Read: kCapabilitiesSize bytes.
+  kCapabilitiesRegister = 0x11,
+
+  // Read: kUniqueIdBurstSize bytes.
+  kUniqueIdRegister = 0x20,
+
+  // Write: kAssignAddressSize bytes. Applied only if the CRC matches, and only
+  // by the sub with the unique ID.
+  kAssignAddressRegister = 0x30,
+
+  // Write: MotorsSize() bytes. Applied only if the CRC matches, but not to
+  // the motors of kLocalMotorsRegister.
+  kMotorsRegister = 0x40,
+
+  // Read: DialStateSize() bytes. Reading it clears the attention line.
+  kDialStateRegister = 0x50,
+
+  // Write: LocalMotorsSize() bytes. Applied only if the CRC matches. Past the
+  // kMotorsRegister burst of kMaxSubMotors.
+  kLocalMotorsRegister = 0x60,
+};
+
+// kCapabilitiesRegister layout.
+enum CapabilitiesOffset : uint8_t {
+  // Where the sub's dials are on the board. Main lays out the dials of all
+  // subs in the order of their slots.
+  kCapabilitySlot = 0,
+  kCapabilitySensors = 1,
+  kCapabilityMotors = 2,
+  kCapabilityCrc = 3,
+};
+constexpr size_t kCapabilitiesSize = 4;
+
+// kUniqueIdRegister layout: the flash unique ID, and the CRC. A sub that loses
+// the arbitration stops sending, so main reads the lowest ID intact.
+constexpr size_t kUniqueIdSize = 8;
+constexpr size_t kUniqueIdCrc = kUniqueIdSize;
+constexpr size_t kUniqueIdBurstSize = kUniqueIdSize + 1;
+
+// kAssignAddressRegister layout: the unique ID, the new address, and the CRC.
+enum AssignAddressOffset : uint8_t {
+  kAssignUniqueId = 0,
+  kAssignAddress = kUniqueIdSize,
+  kAssignCrc = kUniqueIdSize + 1,
+};
+constexpr size_t kAssignAddressSize = kUniqueIdSize + 2;
+
+// kDialStateRegister layout: an entry per dial, and the CRC.
+enum DialStateOffset : uint8_t {
+  // The confirmed position, from the base at 0.
+  kDialPosition = 0,
+  // DialFlags.
+  kDialFlags = 1,
+  // Count of decided positions, wrapping at 256, and the last one.
+  kDialDecidedCount = 2,
+  kDialDecidedPosition = 3,
+  // Microseconds since the last position was decided, little endian,
+  // saturated at 0xffff.
+  kDialDecidedAgeLow = 4,
+  kDialDecidedAgeHigh = 5,
+};
+constexpr size_t kDialEntrySize = 6;
+constexpr uint16_t kMaxDecidedAgeUs = 0xffff;
+
+enum DialFlags : uint8_t {
+  // Off the base, or a new position is waiting for confirmation.
+  kDialBusy = 1 << 0,
+};
+
+constexpr size_t DialStateSize(size_t dials) {
+  return dials * kDialEntrySize + 1;
+}
+
+// kLocalMotorsRegister layout: a byte per dial of the sub, the motor of the
+// sub that returns it or kNoLocalMotor, and the CRC.
+constexpr uint8_t kNoLocalMotor = 0xff;
+
+constexpr size_t LocalMotorsSize(size_t dials) {
+  return dials + 1;
+}
+
+// kMotorsRegister layout: a byte per motor of the sub, and the CRC. Each is
+// how many positions its dial is away from the base, for the motor to slow
+// down as it nears it, or 0 to stop the motor.
+constexpr size_t MotorsSize(size_t motors) {
+  return motors + 1;
+}
+
+// With DIAL_SUB_ATTENTION, a sub pulls this GPIO high while a sensor code has
+// changed, or a position was decided, since kDialStateRegister was last read,
+// and main reads it on kMainAttentionGpio. Subs share the line: each drives it
+// only while it pulls it high, and main pulls it down.
+constexpr uint8_t kSubAttentionGpio = 21;
+// The sensor board wires the dial G to GPIO 21 and 22, as main does.
+constexpr uint8_t kSensorBoardAttentionGpio = 14;
+constexpr uint8_t kMainAttentionGpio = 0;
+
+// CRC-8 with polynomial x^8 + x^2 + x + 1, as SMBus PEC.
+constexpr uint8_t Crc8(std::span<const uint8_t> data) {
+  uint8_t crc = 0;
+  for (uint8_t byte : data) {
+    crc ^= byte;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+}  // namespace sub_protocol
+
+#endif  // COMMON_SUB_PROTOCOL_H_
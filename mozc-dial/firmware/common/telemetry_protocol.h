@@ -0,0 +1,143 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef COMMON_TELEMETRY_PROTOCOL_H_
+#define COMMON_TELEMETRY_PROTOCOL_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Packets of the vendor interface of main, shared by main and the host tools.
+// Packets are little-endian, and up to kPacketSize bytes.
+//
+// The host sends commands on the bulk OUT endpoint. Once it starts the
+// stream, main sends a Counters packet every period on the bulk IN endpoint,
+// and optionally a Decision packet for each decided position. Counters only
+// grow, and wrap around, until kCommandResetCounters; rates are their
+// differences over the time between two packets.
+//
+// A keymap in the format of keymap::StoredLayout is written with a
+// KeymapBegin, KeymapData packets for all of it, and a KeymapCommit, that
+// main answers with a KeymapStatus; see KeymapStore. kCommandKeymapQuery
+// gets the status of the current keymap.
+namespace telemetry_protocol {
+
+// Bumped on incompatible changes to the packets below.
+constexpr uint8_t kVersion = 1;
+
+// The interface and its endpoints, after the keyboard's interface 0 and
+// endpoint 1.
+constexpr uint8_t kInterfaceNumber = 1;
+constexpr uint8_t kEndPoint = 2;
+constexpr size_t kPacketSize = 64;
+
+// The first byte of a packet from the host.
+enum Command : uint8_t {
+  // StreamCommand: starts or stops the stream.
+  kCommandStream = 0x01,
+  // Zeroes the counters, and sends a Counters packet right away.
+  kCommandResetCounters = 0x02,
+  // KeymapBegin, KeymapData and KeymapCommit: writes a keymap.
+  kCommandKeymapBegin = 0x03,
+  kCommandKeymapData = 0x04,
+  kCommandKeymapCommit = 0x05,
+  // Sends a KeymapStatus packet of the current keymap.
+  kCommandKeymapQuery = 0x06,
+};
+
+// The first byte of a packet to the host.
+enum PacketType : uint8_t {
+  kPacketCounters = 0x81,
+  kPacketDecision = 0x82,
+  kPacketKeymapStatus = 0x83,
+};
+
+// Bits of StreamCommand::flags.
+constexpr uint8_t kStreamDecisions = 0x01;
+
+// Counters are sent at most this often.
+constexpr uint16_t kMinPeriodMs = 10;
+
+struct StreamCommand {
+  uint8_t command;  // kCommandStream
+  uint8_t flags;
+  // 0 stops the stream; otherwise at least kMinPeriodMs. A Counters packet
+  // is sent right away.
+  uint16_t period_ms;
+} __attribute__((packed));
+
+struct Counters {
+  uint8_t type;  // kPacketCounters
+  uint8_t version;
+  // Counts the Counters packets, to tell lost ones.
+  uint16_t sequence;
+  uint32_t time_us;
+  // Passes of the main loop over the sensors.
+  uint32_t loops;
+  // I2C transactions queued to the subs, and those that failed.
+  uint32_t i2c_transactions;
+  uint32_t i2c_failures;
+  // Keyboard events dropped as the report queue was full, and decided
+  // positions dropped on their way to it.
+  uint32_t dropped_events;
+  uint32_t dropped_positions;
+  // Packets of this interface dropped as the host did not take them.
+  uint16_t dropped_packets;
+  // Keyboard events waiting for reports.
+  uint8_t report_queue_depth;
+  uint8_t num_dials;
+  // Positions decided on each dial, wrapping around at 256.
+  std::array<uint8_t, 32> decided_counts;
+} __attribute__((packed));
+static_assert(sizeof(Counters) == kPacketSize);
+
+struct Decision {
+  uint8_t type;  // kPacketDecision
+  uint8_t dial;
+  uint8_t position;
+  uint8_t reserved;
+  // When the position was decided, and when its key was queued for the
+  // keyboard report.
+  uint32_t decided_time_us;
+  uint32_t queued_time_us;
+} __attribute__((packed));
+
+struct KeymapBegin {
+  uint8_t command;  // kCommandKeymapBegin
+  uint8_t reserved;
+  // Of the whole keymap; 0 goes back to the built-in one.
+  uint16_t size;
+} __attribute__((packed));
+
+struct KeymapData {
+  uint8_t command;  // kCommandKeymapData
+  uint8_t reserved;
+  uint16_t offset;
+  // Up to the end of the packet, or of the keymap.
+  std::array<uint8_t, 60> data;
+} __attribute__((packed));
+static_assert(sizeof(KeymapData) == kPacketSize);
+
+struct KeymapCommit {
+  uint8_t command;  // kCommandKeymapCommit
+  std::array<uint8_t, 3> reserved;
+  // CRC-32 of the keymap, as zlib's.
+  uint32_t crc;
+} __attribute__((packed));
+
+struct KeymapStatus {
+  uint8_t type;  // kPacketKeymapStatus
+  // A KeymapStore::Status; the keymap is left as it was unless 0.
+  uint8_t status;
+  // Of the current keymap, see KeymapStore; size and crc are 0 for the
+  // built-in one.
+  uint16_t size;
+  uint32_t sequence;
+  uint32_t crc;
+} __attribute__((packed));
+
+}  // namespace telemetry_protocol
+
+#endif  // COMMON_TELEMETRY_PROTOCOL_H_
@@ -0,0 +1,74 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#include "trace.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "hardware/sync.h"
+#include "pico/stdio.h"
+#include "pico/stdlib.h"
+
+#include "hot_path.h"
+
+namespace {
+
+trace::Ring sRings[trace::kNumOfCores] = {};
+volatile bool sPaused = false;
+
+}  // namespace
+
+namespace trace {
+
+void DIAL_HOT_PATH(Record)(Stage stage, Kind kind, uint16_t tag) {
+  if (sPaused) {
+    return;
+  }
+  uint32_t time_us = time_us_32();
+  Ring& ring = sRings[get_core_num()];
+  // Handlers on the same core may record too; the other core has its own
+  // ring.
+  uint32_t status = save_and_disable_interrupts();
+  uint32_t index = ring.count;
+  ring.events[index % kEventsPerCore] = {time_us, stage, kind, tag};
+  ring.count = index + 1;
+  restore_interrupts(status);
+}
+
+void Dump(const char* name) {
+  sPaused = true;
+  // Let a record in flight on the other core complete.
+  sleep_us(10);
+  for (size_t core = 0; core < kNumOfCores; ++core) {
+    Ring& ring = sRings[core];
+    uint32_t count = ring.count;
+    uint32_t first = count - std::min<uint32_t>(count, kEventsPerCore);
+    printf("%s: trace core %u, %lu events, %lu overwritten\n", name,
+           static_cast<unsigned>(core), static_cast<unsigned long>(count),
+           static_cast<unsigned long>(first));
+    for (uint32_t i = first; i < count; ++i) {
+      const Event& event = ring.events[i % kEventsPerCore];
+      printf("%s: trace %u %08lx %u %c %04x\n", name,
+             static_cast<unsigned>(core),
+             static_cast<unsigned long>(event.time_us),
+             static_cast<unsigned>(event.stage),
+             event.kind == Kind::kBegin ? 'b' : 'e', event.tag);
+    }
+    ring.count = 0;
+  }
+  sPaused = false;
+}
+
+void Poll(const char* name) {
+  if (getchar_timeout_us(0) == 't') {
+    Dump(name);
+  }
+}
+
+}  // namespace trace
+
+const trace::Ring* trace_rings() {
+  return sRings;
+}
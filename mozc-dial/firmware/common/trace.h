@@ -0,0 +1,111 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef COMMON_TRACE_H_
+#define COMMON_TRACE_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Records when the stages of the firmware begin and end, e.g. sensor reads,
+// I2C transactions and interrupt handlers, to find where the time goes.
+// Built with DIAL_TRACE; otherwise the functions below do nothing, and
+// compile to nothing.
+//
+// Events are 8 bytes, kept in a RAM ring per core that overwrites the oldest.
+// They may be recorded from interrupt handlers: each core writes to its own
+// ring with interrupts masked for a few instructions, and takes no lock.
+// Poll() prints the rings over stdio on request, and host/trace_decode turns
+// the output into a latency histogram per stage.
+namespace trace {
+
+enum class Stage : uint8_t {
+  // An iteration of the main loop.
+  kLoop,
+  // Sampling the local sensors, and updating their dials.
+  kSensorRead,
+  // I2C transactions of main, from being queued until they complete.
+  kI2CRead,
+  kI2CWrite,
+  // Taking decided positions from the dials, and queueing them.
+  kDecide,
+  // Looking up a queued position in the keymap, and passing it to USB.
+  kReport,
+  // A keyboard report, from being staged until the host takes it.
+  kUsbReport,
+  // Interrupt handlers.
+  kUsbIsr,
+  kI2CIsr,
+  kI2CDeviceIsr,
+  kMotorRefresh,
+  kNumOfStages,
+};
+
+constexpr std::array<const char*, static_cast<size_t>(Stage::kNumOfStages)>
+    kStageNames = {
+        "loop",
+        "sensor_read",
+        "i2c_read",
+        "i2c_write",
+        "decide",
+        "report",
+        "usb_report",
+        "usb_isr",
+        "i2c_isr",
+        "i2c_device_isr",
+        "motor_refresh",
+};
+
+enum class Kind : uint8_t { kBegin, kEnd };
+
+struct Event {
+  uint32_t time_us;
+  Stage stage;
+  Kind kind;
+  // Tells apart stages in flight at the same time, e.g. I2C transactions; an
+  // end pairs with the last begin of the same stage and tag.
+  uint16_t tag;
+};
+static_assert(sizeof(Event) == 8);
+
+constexpr size_t kNumOfCores = 2;
+constexpr size_t kEventsPerCore = 1024;
+
+struct Ring {
+  std::array<Event, kEventsPerCore> events;
+  // Events recorded so far, the last kEventsPerCore of them in `events`.
+  volatile uint32_t count;
+};
+
+#if DIAL_TRACE
+void Record(Stage stage, Kind kind, uint16_t tag);
+// Prints the rings over stdio, after `name`, and clears them. Recording pauses
+// meanwhile. Not to be called from interrupt handlers.
+void Dump(const char* name);
+// Dumps the rings when a 't' comes over stdio.
+void Poll(const char* name);
+#else
+inline void Record(Stage, Kind, uint16_t) {}
+inline void Dump(const char*) {}
+inline void Poll(const char*) {}
+#endif
+
+inline void Begin(Stage stage, uint16_t tag = 0) {
+  Record(stage, Kind::kBegin, tag);
+}
+
+inline void End(Stage stage, uint16_t tag = 0) {
+  Record(stage, Kind::kEnd, tag);
+}
+
+}  // namespace trace
+
+#if DIAL_TRACE
+// The rings of both cores as they are, for the host simulation to read from
+// each image.
+extern "C" const trace::Ring* trace_rings();
+#endif
+
+#endif  // COMMON_TRACE_H_
@@ -4,6 +4,7 @@
 
 #include "usb_device.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <memory>
@@ -12,22 +13,49 @@
 #include "hardware/regs/usb.h"
 #include "hardware/resets.h"
 #include "hardware/structs/usb.h"
+#include "hot_path.h"
 #include "pico/types.h"
+#include "trace.h"
 
 namespace {
 
 constexpr uint8_t kControlEndpoint = 0u;
 
+// DPRAM buffers are 64 byte aligned. Buffer B of a double buffered endpoint
+// follows buffer A.
+constexpr uint32_t kBufferSize = 64u;
+
+// Each half of a buffer control register controls one buffer.
+constexpr uint32_t kBufferControlShift = 16u;
+
+// Writes the control of buffer `buffer` alone, so that an update of the other
+// buffer by the controller is not lost.
+void WriteBufferControl(io_rw_32& reg, uint8_t buffer, uint16_t control) {
+  reinterpret_cast<volatile uint16_t*>(&reg)[buffer] = control;
+}
+
+uint16_t ReadBufferControl(const io_rw_32& reg, uint8_t buffer) {
+  return reg >> (kBufferControlShift * buffer);
+}
+
+// Language IDs: English (United States).
+constexpr uint8_t kLanguageIds[] = {0x04, UsbDevice::kDescriptorTypeString,
+                                    0x09, 0x04};
+// For string indices out of range.
+constexpr uint8_t kEmptyString[] = {0x02, UsbDevice::kDescriptorTypeString};
+
 UsbDevice* sUsbDevice = nullptr;
 
 }  // namespace
 
-extern "C" void isr_usbctrl(void) {
+extern "C" void DIAL_HOT_PATH(isr_usbctrl)(void) {
+  trace::Begin(trace::Stage::kUsbIsr);
   UsbDevice::HandleInterrupt();
+  trace::End(trace::Stage::kUsbIsr);
 }
 
 // static
-void UsbDevice::HandleInterrupt() {
+void DIAL_HOT_PATH(UsbDevice::HandleInterrupt)() {
   uint32_t status = usb_hw->ints;
 
   if (status & USB_INTS_SETUP_REQ_BITS) {
@@ -45,19 +73,15 @@ void UsbDevice::HandleInterrupt() {
   }
 }
 
-UsbDevice::UsbDevice(
-    const DeviceDescriptor& device_descriptor,
-    const ConfigurationDescriptor& configuration_descriptor,
-    const std::vector<InterfaceDescriptor>& interface_descriptors,
-    const std::vector<EndPointDescriptor>& endpoint_descriptors,
-    const std::vector<std::string>& strings)
-    : device_descriptor_(device_descriptor),
-      configuration_descriptor_(configuration_descriptor),
-      interface_descriptors_(interface_descriptors),
-      endpoint_descriptors_(endpoint_descriptors),
-      strings_(strings) {
+UsbDevice::UsbDevice(const DeviceDescriptor& device_descriptor,
+                     std::span<const uint8_t> configuration,
+                     std::initializer_list<std::span<const uint8_t>> strings)
+    : device_descriptor_(device_descriptor), configuration_(configuration) {
   hard_assert(sUsbDevice == nullptr);
   sUsbDevice = this;
+  hard_assert(strings.size() <= kMaxStrings);
+  num_strings_ = std::copy(strings.begin(), strings.end(), strings_.begin()) -
+                 strings_.begin();
 
   reset_unreset_block_num_wait_blocking(RESET_USBCTRL);
   memset(usb_dpram, 0, sizeof(*usb_dpram));
@@ -72,103 +96,91 @@ UsbDevice::UsbDevice(
   usb_hw->inte = USB_INTS_BUFF_STATUS_BITS | USB_INTS_BUS_RESET_BITS |
                  USB_INTS_SETUP_REQ_BITS;
 
-  sending_data_.push_back(std::span<const uint8_t>());
-  receiving_data_.push_back(std::span<uint8_t>());
-
+  in_endpoints_[kControlEndpoint] = {
+      .buffers = {usb_dpram->ep0_buf_a, usb_dpram->ep0_buf_a},
+      .max_packet_size = device_descriptor_.bMaxPacketSize0};
+  out_endpoints_[kControlEndpoint] = in_endpoints_[kControlEndpoint];
+  num_endpoints_ = 1;
+
+  hard_assert(configuration_.size() >= sizeof(ConfigurationDescriptor) &&
+              configuration_.size() ==
+                  reinterpret_cast<const ConfigurationDescriptor*>(
+                      configuration_.data())
+                      ->wTotalLength);
   uint32_t dpram_offset = offsetof(usb_device_dpram_t, epx_data);
-  for (size_t i = 0; i < endpoint_descriptors_.size(); ++i) {
-    uint32_t control =
-        EP_CTRL_ENABLE_BITS | EP_CTRL_INTERRUPT_PER_BUFFER |
-        (endpoint_descriptors_[i].bmAttributes << EP_CTRL_BUFFER_TYPE_LSB) |
-        dpram_offset;
-    if (endpoint_descriptors_[i].bEndpointAddress & kDirIn) {
-      usb_dpram->ep_ctrl[i].in = control;
+  uint8_t interface = kNoInterface;
+  for (size_t offset = 0; offset < configuration_.size();
+       offset += configuration_[offset]) {
+    hard_assert(configuration_[offset] >= 2 &&
+                offset + configuration_[offset] <= configuration_.size());
+    if (configuration_[offset + 1] == kDescriptorTypeInterface) {
+      interface = reinterpret_cast<const InterfaceDescriptor*>(
+                      &configuration_[offset])
+                      ->bInterfaceNumber;
+      continue;
+    }
+    if (configuration_[offset + 1] != kDescriptorTypeEndPoint) {
+      continue;
+    }
+    EndPointDescriptor descriptor;
+    memcpy(&descriptor, &configuration_[offset], sizeof(descriptor));
+    uint8_t number = descriptor.bEndpointAddress & 0x0f;
+    bool in = descriptor.bEndpointAddress & kDirIn;
+    EndPoint& endpoint = in ? in_endpoints_[number] : out_endpoints_[number];
+    hard_assert(descriptor.wMaxPacketSize <= kBufferSize && number != 0 &&
+                number < kMaxEndPoints && endpoint.max_packet_size == 0);
+    uint32_t control = EP_CTRL_ENABLE_BITS | EP_CTRL_INTERRUPT_PER_BUFFER |
+                       (descriptor.bmAttributes << EP_CTRL_BUFFER_TYPE_LSB) |
+                       dpram_offset;
+    uint8_t* buffer = reinterpret_cast<uint8_t*>(usb_dpram) + dpram_offset;
+    endpoint = {.buffers = {buffer, buffer + kBufferSize},
+                .max_packet_size = descriptor.wMaxPacketSize,
+                .interface = interface,
+                .double_buffered = in};
+    if (in) {
+      usb_dpram->ep_ctrl[number - 1].in =
+          control | EP_CTRL_DOUBLE_BUFFERED_BITS;
+      dpram_offset += kBufferSize * 2;
     } else {
-      usb_dpram->ep_ctrl[i].out = control;
+      usb_dpram->ep_ctrl[number - 1].out = control;
+      dpram_offset += kBufferSize;
     }
-    dpram_offset += endpoint_descriptors_[i].wMaxPacketSize;
-    sending_data_.push_back(std::span<const uint8_t>());
-    receiving_data_.push_back(std::span<uint8_t>());
+    num_endpoints_ = std::max<size_t>(num_endpoints_, number + 1);
   }
-  size_t endpoints = sending_data_.size();
-  in_next_pid_.resize(endpoints);
-  out_next_pid_.resize(endpoints);
+  ResetBufferSelection();
 
   static_cast<usb_hw_t*>(hw_set_alias_untyped(usb_hw))->sie_ctrl =
       USB_SIE_CTRL_PULLUP_EN_BITS;
 }
 
-void UsbDevice::FillConfigurations(std::vector<uint8_t>& buffer) {
-  buffer.clear();
-  buffer.reserve(configuration_descriptor_.wTotalLength);
-  std::span<const uint8_t> config_span(
-      reinterpret_cast<const uint8_t*>(&configuration_descriptor_),
-      sizeof(configuration_descriptor_));
-  buffer.insert(buffer.end(), config_span.begin(), config_span.end());
-  for (const auto& interface_descriptor : interface_descriptors_) {
-    std::span<const uint8_t> interface_span(
-        reinterpret_cast<const uint8_t*>(&interface_descriptor),
-        sizeof(interface_descriptor));
-    buffer.insert(buffer.end(), interface_span.begin(), interface_span.end());
-  }
-  for (const auto& endpoint_descriptor : endpoint_descriptors_) {
-    std::span<const uint8_t> endpoint_span(
-        reinterpret_cast<const uint8_t*>(&endpoint_descriptor),
-        sizeof(endpoint_descriptor));
-    buffer.insert(buffer.end(), endpoint_span.begin(), endpoint_span.end());
-  }
-}
-
 void UsbDevice::GetDescriptor(volatile SetupPacket* setup) {
   uint8_t type = setup->wValue >> 8;
+  std::span<const uint8_t> descriptor;
   switch (type) {
     case kDescriptorTypeDevice:
-      Send(kControlEndpoint, std::span<const uint8_t>(
-                  reinterpret_cast<const uint8_t*>(&device_descriptor_),
-                  std::min(sizeof(device_descriptor_),
-                           static_cast<size_t>(setup->wLength))));
+      descriptor = AsBytes(device_descriptor_);
       break;
-    case kDescriptorTypeConfiguration: {
-      FillConfigurations(setup_buffer_);
-      Send(kControlEndpoint, std::span<const uint8_t>(
-                  setup_buffer_.data(),
-                  std::min(setup_buffer_.size(),
-                           static_cast<size_t>(setup->wLength))));
+    case kDescriptorTypeConfiguration:
+      descriptor = configuration_;
       break;
-    }
     case kDescriptorTypeString: {
       uint8_t index = setup->wValue & 0xff;
-      setup_buffer_.clear();
       if (index == 0) {
-        setup_buffer_.reserve(4);
-        setup_buffer_.push_back(0x04);
-        setup_buffer_.push_back(kDescriptorTypeString);
-        setup_buffer_.push_back(0x09);
-        setup_buffer_.push_back(0x04);
-      } else if (index <= strings_.size()) {
-        size_t size = strings_[index - 1].size() * 2 + 2;
-        setup_buffer_.reserve(size);
-        setup_buffer_.push_back(size);
-        setup_buffer_.push_back(kDescriptorTypeString);
-        for (size_t i = 0; i < strings_[index - 1].size(); ++i) {
-          setup_buffer_.push_back(strings_[index - 1][i]);
-          setup_buffer_.push_back(0);
-        }
+        descriptor = kLanguageIds;
+      } else if (index <= num_strings_) {
+        descriptor = strings_[index - 1];
       } else {
-        setup_buffer_.reserve(2);
-        setup_buffer_.push_back(0x02);
-        setup_buffer_.push_back(kDescriptorTypeString);
+        descriptor = kEmptyString;
       }
-      Send(kControlEndpoint, std::span<const uint8_t>(
-                  setup_buffer_.data(),
-                  std::min(setup_buffer_.size(),
-                           static_cast<size_t>(setup->wLength))));
       break;
     }
     default:
       printf("unsupported get descriptor: $%02x\n", type);
-      break;
+      return;
   }
+  Send(kControlEndpoint,
+       descriptor.first(
+           std::min(descriptor.size(), static_cast<size_t>(setup->wLength))));
 }
 
 // Note: better to return STALL on unsupported requests.
@@ -206,31 +218,70 @@ void UsbDevice::AcknowledgeOutRequest() {
   Send(kControlEndpoint, std::span<uint8_t>({}));
 }
 
-void UsbDevice::Send(uint8_t endpoint, std::span<const uint8_t> data) {
+void DIAL_HOT_PATH(UsbDevice::Send)(uint8_t endpoint,
+                                    std::span<const uint8_t> data) {
   if (endpoint == kControlEndpoint) {
     in_next_pid_[endpoint] = 1u;
   }
   sending_data_[endpoint] = data;
   SendInternal(endpoint);
+  // Stage the next packet of a longer transfer too, if a buffer is free.
+  if (!sending_data_[endpoint].empty() && CanSend(endpoint)) {
+    SendInternal(endpoint);
+  }
 }
 
-void UsbDevice::Receive(uint8_t endpoint, std::span<uint8_t> data) {
+void DIAL_HOT_PATH(UsbDevice::Receive)(uint8_t endpoint,
+                                       std::span<uint8_t> data) {
+  if (endpoint == kControlEndpoint) {
+    out_next_pid_[endpoint] = 1u;
+  }
   receiving_data_[endpoint] = data;
-  out_next_pid_[endpoint] = 1u;
+  out_endpoints_[endpoint].received = 0;
   ReceiveInternal(endpoint);
 }
 
-void UsbDevice::SendInternal(uint8_t endpoint) {
-  size_t transfer_size = std::min(sending_data_[endpoint].size(), GetMaxPacketSize(endpoint));
-  uint8_t* buffer = GetTransferBuffer(endpoint);
-  memcpy(buffer, sending_data_[endpoint].data(), transfer_size);
+bool DIAL_HOT_PATH(UsbDevice::CanSend)(uint8_t endpoint) const {
+  const EndPoint& state = in_endpoints_[endpoint];
+  return (ready_ || endpoint == kControlEndpoint) &&
+         sending_data_[endpoint].empty() &&
+         state.in_flight < (state.double_buffered ? 2 : 1);
+}
+
+bool DIAL_HOT_PATH(UsbDevice::IsSending)(uint8_t endpoint) const {
+  return in_endpoints_[endpoint].in_flight;
+}
+
+void DIAL_HOT_PATH(UsbDevice::SendInternal)(uint8_t endpoint) {
+  EndPoint& state = in_endpoints_[endpoint];
+  size_t transfer_size =
+      std::min(sending_data_[endpoint].size(),
+               static_cast<size_t>(state.max_packet_size));
+  uint8_t buffer = state.double_buffered
+                       ? (state.first_in_flight + state.in_flight) % 2
+                       : 0;
+  memcpy(state.buffers[buffer], sending_data_[endpoint].data(), transfer_size);
   uint32_t pid =
       in_next_pid_[endpoint] ? USB_BUF_CTRL_DATA1_PID : USB_BUF_CTRL_DATA0_PID;
   in_next_pid_[endpoint] ^= 1u;
-  usb_dpram->ep_buf_ctrl[endpoint].in =
+  uint32_t control =
       transfer_size | USB_BUF_CTRL_AVAIL | USB_BUF_CTRL_FULL | pid;
-
+  // Marked before the packet is handed to the controller, that may send it
+  // right away.
   size_t remaining_size = sending_data_[endpoint].size() - transfer_size;
+  if (remaining_size) {
+    state.ends_transfer &= ~(1u << buffer);
+  } else {
+    state.ends_transfer |= 1u << buffer;
+  }
+  if (state.double_buffered) {
+    WriteBufferControl(usb_dpram->ep_buf_ctrl[endpoint].in, buffer, control);
+    ++state.in_flight;
+  } else {
+    usb_dpram->ep_buf_ctrl[endpoint].in = control;
+    state.in_flight = 1;
+  }
+
   if (remaining_size) {
     sending_data_[endpoint] =
         std::span(&sending_data_[endpoint][transfer_size], remaining_size);
@@ -239,10 +290,17 @@ void UsbDevice::SendInternal(uint8_t endpoint) {
   }
 }
 
-void UsbDevice::ReceiveInternal(uint8_t endpoint) {
-  size_t transfer_size = std::min(receiving_data_[endpoint].size(), GetMaxPacketSize(endpoint));
+void DIAL_HOT_PATH(UsbDevice::ReceiveInternal)(uint8_t endpoint) {
+  // Other endpoints take a whole packet, as the host may send any length up
+  // to it; what does not fit in `receiving_data_` is dropped.
+  size_t max_packet_size = out_endpoints_[endpoint].max_packet_size;
+  size_t transfer_size =
+      endpoint == kControlEndpoint
+          ? std::min(receiving_data_[endpoint].size(), max_packet_size)
+          : max_packet_size;
   uint32_t pid =
       out_next_pid_[endpoint] ? USB_BUF_CTRL_DATA1_PID : USB_BUF_CTRL_DATA0_PID;
+  out_next_pid_[endpoint] ^= 1u;
   usb_dpram->ep_buf_ctrl[endpoint].out =
       transfer_size | USB_BUF_CTRL_AVAIL | pid;
 }
@@ -250,12 +308,19 @@ void UsbDevice::ReceiveInternal(uint8_t endpoint) {
 void UsbDevice::HandleSetupRequest() {
   volatile SetupPacket* setup =
       reinterpret_cast<volatile SetupPacket*>(&usb_dpram->setup_packet);
+  uint8_t recipient =
+      setup->bmRequestType & (kRecipientInterface | kRecipientEndPoint);
+  uint8_t number = setup->wIndex & 0xff;
+  if (recipient == kRecipientInterface && number < kMaxInterfaces &&
+      interfaces_[number] && interfaces_[number]->HandleSetupRequest(setup)) {
+    return;
+  }
   HandleSetupRequest(setup);
 }
 
-void UsbDevice::HandleBufferStatus() {
+void DIAL_HOT_PATH(UsbDevice::HandleBufferStatus)() {
   uint32_t status = usb_hw->buf_status;
-  uint8_t endpoint_bits = (1 + endpoint_descriptors_.size()) * 2;
+  uint8_t endpoint_bits = num_endpoints_ * 2;
   for (uint8_t i = 0; i < endpoint_bits; ++i) {
     uint32_t bit = 1 << i;
     uint8_t endpoint = i >> 1;
@@ -264,12 +329,29 @@ void UsbDevice::HandleBufferStatus() {
       continue;
     }
     static_cast<usb_hw_t*>(hw_clear_alias_untyped(usb_hw))->buf_status = bit;
+    EndPoint& state = in_endpoints_[endpoint];
     if (out) {
       OnReceived(endpoint,
                  usb_dpram->ep_buf_ctrl[endpoint].out & USB_BUF_CTRL_LEN_MASK);
+    } else if (state.double_buffered) {
+      // Both buffers may have been sent since the last interrupt. The
+      // controller takes them in turn, and hands each back without AVAIL.
+      while (state.in_flight) {
+        uint16_t control = ReadBufferControl(
+            usb_dpram->ep_buf_ctrl[endpoint].in, state.first_in_flight);
+        if (control & USB_BUF_CTRL_AVAIL) {
+          break;
+        }
+        bool last = state.ends_transfer & (1u << state.first_in_flight);
+        state.first_in_flight ^= 1u;
+        --state.in_flight;
+        OnSent(endpoint, control & USB_BUF_CTRL_LEN_MASK, last);
+      }
     } else {
+      state.in_flight = 0;
       OnSent(endpoint,
-             usb_dpram->ep_buf_ctrl[endpoint].in & USB_BUF_CTRL_LEN_MASK);
+             usb_dpram->ep_buf_ctrl[endpoint].in & USB_BUF_CTRL_LEN_MASK,
+             state.ends_transfer & 1u);
     }
   }
 }
@@ -285,41 +367,91 @@ void UsbDevice::HandleBusReset() {
   for (auto& data : receiving_data_) {
     data = std::span<uint8_t>();
   }
+  ResetBufferSelection();
+  OnBusReset();
+  for (Interface* interface : interfaces_) {
+    if (interface) {
+      interface->OnBusReset();
+    }
+  }
 }
 
-void UsbDevice::OnSent(uint8_t endpoint, uint32_t length) {
+void DIAL_HOT_PATH(UsbDevice::OnSent)(uint8_t endpoint,
+                                      uint32_t length,
+                                      bool last) {
   if (should_set_address_) {
     usb_hw->dev_addr_ctrl = address_;
     should_set_address_ = false;
-  } else if (length == 0) {
     return;
-  } else if (sending_data_[endpoint].empty()) {
+  }
+  if (length == 0) {
+    return;
+  }
+  // The freed buffer takes the next packet, of this transfer or of the next.
+  if (!sending_data_[endpoint].empty()) {
+    SendInternal(endpoint);
+  }
+  // The other buffer may still hold the rest of this transfer.
+  if (!last) {
+    return;
+  }
+  if (endpoint == kControlEndpoint) {
+    // The status stage.
     Receive(endpoint, {});
-    OnCompleteToSend(endpoint);
+  }
+  if (Interface* interface = InterfaceOf(in_endpoints_[endpoint])) {
+    interface->OnCompleteToSend(endpoint);
   } else {
-    SendInternal(endpoint);
+    OnCompleteToSend(endpoint);
   }
 }
 
-void UsbDevice::OnReceived(uint8_t endpoint, uint32_t length) {
-  if (length == 0) {
+void UsbDevice::ResetBufferSelection() {
+  for (size_t endpoint = 0; endpoint < num_endpoints_; ++endpoint) {
+    EndPoint& state = in_endpoints_[endpoint];
+    state.first_in_flight = 0;
+    state.in_flight = 0;
+    state.ends_transfer = 0;
+    usb_dpram->ep_buf_ctrl[endpoint].in =
+        state.double_buffered ? USB_BUF_CTRL_SEL : 0;
+  }
+}
+
+void DIAL_HOT_PATH(UsbDevice::OnReceived)(uint8_t endpoint, uint32_t length) {
+  bool control = endpoint == kControlEndpoint;
+  if (control && length == 0) {
     return;
   }
+  EndPoint& state = out_endpoints_[endpoint];
   size_t receive_size =
       std::min(receiving_data_[endpoint].size(), static_cast<size_t>(length));
-  uint8_t* buffer = GetTransferBuffer(endpoint);
-  memcpy(receiving_data_[endpoint].data(), buffer, receive_size);
+  memcpy(receiving_data_[endpoint].data(), state.buffers[0], receive_size);
+  state.received += receive_size;
   size_t remaining_size = receiving_data_[endpoint].size() - receive_size;
-  if (remaining_size) {
+  bool short_packet = length < state.max_packet_size;
+  if (remaining_size && !(short_packet && !control)) {
     receiving_data_[endpoint] =
         std::span(&receiving_data_[endpoint][receive_size], remaining_size);
     ReceiveInternal(endpoint);
-  } else {
-    receiving_data_[endpoint] = std::span<uint8_t>();
+    return;
+  }
+  receiving_data_[endpoint] = std::span<uint8_t>();
+  if (control) {
+    // The status stage.
     Send(endpoint, {});
+  } else if (Interface* interface = InterfaceOf(state)) {
+    interface->OnCompleteToReceive(endpoint, state.received);
+  } else {
+    OnCompleteToReceive(endpoint, state.received);
   }
 }
 
+UsbDevice::Interface* DIAL_HOT_PATH(UsbDevice::InterfaceOf)(
+    const EndPoint& state) const {
+  return state.interface < kMaxInterfaces ? interfaces_[state.interface]
+                                          : nullptr;
+}
+
 void UsbDevice::SetAddress(volatile SetupPacket* setup) {
   address_ = setup->wValue & 0xff;
   should_set_address_ = true;
@@ -328,26 +460,21 @@ void UsbDevice::SetAddress(volatile SetupPacket* setup) {
 
 void UsbDevice::SetConfiguration(volatile SetupPacket* setup) {
   ready_ = true;
+  for (size_t endpoint = 1; endpoint < kMaxEndPoints; ++endpoint) {
+    in_next_pid_[endpoint] = 0;
+    out_next_pid_[endpoint] = 0;
+  }
   AcknowledgeOutRequest();
-}
-
-size_t UsbDevice::GetMaxPacketSize(uint8_t endpoint) {
-  if (endpoint == kControlEndpoint) {
-    return device_descriptor_.bMaxPacketSize0;
-  } else if (endpoint <= endpoint_descriptors_.size()) {
-    return endpoint_descriptors_[endpoint - 1].wMaxPacketSize;
+  OnConfigured();
+  for (Interface* interface : interfaces_) {
+    if (interface) {
+      interface->OnConfigured();
+    }
   }
-  hard_assert(false);
-  return 0;
 }
 
-uint8_t* UsbDevice::GetTransferBuffer(uint8_t endpoint) {
-  if (endpoint == kControlEndpoint) {
-    return usb_dpram->ep0_buf_a;
-  }
-  uint8_t* buffer = usb_dpram->epx_data;
-  for (size_t i = 1; i < endpoint; ++i) {
-    buffer += endpoint_descriptors_[i].wMaxPacketSize;
-  }
-  return buffer;
-}
\ No newline at end of file
+UsbDevice::Interface::Interface(UsbDevice& device, uint8_t number)
+    : device_(device) {
+  hard_assert(number < kMaxInterfaces && !device.interfaces_[number]);
+  device.interfaces_[number] = this;
+}
@@ -5,10 +5,11 @@
 #ifndef COMMON_USB_DEVICE_H_
 #define COMMON_USB_DEVICE_H_
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
+#include <initializer_list>
 #include <span>
-#include <string>
-#include <vector>
 
 class UsbDevice {
  public:
@@ -69,9 +70,18 @@ class UsbDevice {
     uint8_t bInterval;
   } __attribute__((packed));
 
+  // A string descriptor of `N` UTF-16 code units.
+  template <size_t N>
+  struct StringDescriptor {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    std::array<char16_t, N> bString;
+  } __attribute__((packed));
+
   static constexpr uint8_t kDirOut = 0x00u;
   static constexpr uint8_t kDirIn = 0x80u;
   static constexpr uint8_t kTypeClass = 0x20;
+  static constexpr uint8_t kTypeVendor = 0x40;
   static constexpr uint8_t kRecipientInterface = 0x01;
   static constexpr uint8_t kRecipientEndPoint = 0x02;
 
@@ -86,30 +96,137 @@ class UsbDevice {
   static constexpr uint8_t kDescriptorTypeInterface = 0x04u;
   static constexpr uint8_t kDescriptorTypeEndPoint = 0x05u;
 
+  static constexpr uint8_t kEndPointAttributeBulk = 0x02u;
   static constexpr uint8_t kEndPointAttributeInterrupt = 0x03u;
 
+  // String descriptors after the language IDs at index 0.
+  static constexpr size_t kMaxStrings = 4;
+  // Endpoint numbers, from 0 for the control endpoint. Each number has an IN
+  // and an OUT endpoint.
+  static constexpr size_t kMaxEndPoints = 8;
+  static constexpr size_t kMaxInterfaces = 4;
+
+  // A further interface of a composite device, next to those the device
+  // serves itself, e.g. a vendor interface next to a keyboard. It takes the
+  // requests to its interface, and the transfers on its endpoints.
+  class Interface {
+   public:
+    // `number` is the bInterfaceNumber of the interface in the configuration
+    // of `device`, that must outlive it.
+    Interface(UsbDevice& device, uint8_t number);
+    Interface(const Interface&) = delete;
+    Interface& operator=(const Interface&) = delete;
+    virtual ~Interface() = default;
+
+   protected:
+    // Class and vendor requests to the interface. Returns false to leave the
+    // request to the device.
+    virtual bool HandleSetupRequest(volatile SetupPacket* setup) {
+      return false;
+    }
+    // After SET_CONFIGURATION, that resets the data toggles.
+    virtual void OnConfigured() {}
+    virtual void OnCompleteToSend(uint8_t endpoint) {}
+    virtual void OnCompleteToReceive(uint8_t endpoint, size_t length) {}
+    virtual void OnBusReset() {}
+
+    void Send(uint8_t endpoint, std::span<const uint8_t> data) {
+      device_.Send(endpoint, data);
+    }
+    void Receive(uint8_t endpoint, std::span<uint8_t> data) {
+      device_.Receive(endpoint, data);
+    }
+    bool CanSend(uint8_t endpoint) const { return device_.CanSend(endpoint); }
+    void AcknowledgeOutRequest() { device_.AcknowledgeOutRequest(); }
+
+   private:
+    friend class UsbDevice;
+
+    UsbDevice& device_;
+  };
+
+  // Builds the string descriptor of an ASCII literal at compile time.
+  template <size_t N>
+  static constexpr StringDescriptor<N - 1> MakeStringDescriptor(
+      const char (&string)[N]) {
+    static_assert(sizeof(StringDescriptor<N - 1>) <= 0xff);
+    StringDescriptor<N - 1> descriptor = {
+        .bLength = sizeof(StringDescriptor<N - 1>),
+        .bDescriptorType = kDescriptorTypeString,
+        .bString = {}};
+    for (size_t i = 0; i < N - 1; ++i) {
+      descriptor.bString[i] = string[i];
+    }
+    return descriptor;
+  }
+
+  // The bytes of a descriptor, or of a packed struct of descriptors.
+  template <typename Descriptor>
+  static std::span<const uint8_t> AsBytes(const Descriptor& descriptor) {
+    return std::span<const uint8_t>(
+        reinterpret_cast<const uint8_t*>(&descriptor), sizeof(descriptor));
+  }
+
   static void HandleInterrupt();
 
+  // Serves the descriptors as they are, e.g. from flash, so they must outlive
+  // the device. `configuration` is the configuration descriptor followed by
+  // all its interface, class and endpoint descriptors, of wTotalLength bytes.
+  // Endpoints take the numbers of their addresses there, and belong to the
+  // interface they follow. `strings` are the descriptors from index 1.
   UsbDevice(const DeviceDescriptor& device_descriptor,
-            const ConfigurationDescriptor& configuration_descriptor,
-            const std::vector<InterfaceDescriptor>& interface_descriptors,
-            const std::vector<EndPointDescriptor>& endpoint_descriptors,
-            const std::vector<std::string>& strings);
+            std::span<const uint8_t> configuration,
+            std::initializer_list<std::span<const uint8_t>> strings);
   UsbDevice(const UsbDevice&) = delete;
   UsbDevice& operator=(const UsbDevice&) = delete;
   virtual ~UsbDevice() = default;
 
  protected:
-  virtual void FillConfigurations(std::vector<uint8_t>& buffer);
   virtual void GetDescriptor(volatile SetupPacket* setup);
   virtual void HandleSetupRequest(volatile SetupPacket* setup);
   virtual void OnCompleteToSend(uint8_t endpoint) {};
+  // An OUT transfer other than on the control endpoint completed with
+  // `length` bytes, on a short packet or once `data` of Receive() is full.
+  virtual void OnCompleteToReceive(uint8_t endpoint, size_t length) {};
+  virtual void OnBusReset() {};
+  // The host set the configuration, and the endpoints other than the control
+  // endpoint can send from now on.
+  virtual void OnConfigured() {};
 
   void AcknowledgeOutRequest();
   void Send(uint8_t endpoint, std::span<const uint8_t> data);
+  // Receives into `data` on OUT `endpoint`. Transfers other than on the
+  // control endpoint complete on a short packet too.
   void Receive(uint8_t endpoint, std::span<uint8_t> data);
 
+  // Whether Send() can take another transfer on `endpoint` now: the last one
+  // is all handed to the controller, and a buffer is free. IN endpoints other
+  // than the control endpoint are double buffered, so a packet can be staged
+  // while another is in flight. They take none before the host sets the
+  // configuration, that starts their data toggles over.
+  bool CanSend(uint8_t endpoint) const;
+  // Whether a packet is in flight on IN `endpoint`.
+  bool IsSending(uint8_t endpoint) const;
+
  private:
+  static constexpr uint8_t kNoInterface = 0xff;
+
+  // An endpoint's DPRAM buffers, laid out once at construction, and the IN
+  // packets in flight in them, or the bytes received of an OUT transfer.
+  struct EndPoint {
+    std::array<uint8_t*, 2> buffers = {};
+    uint16_t max_packet_size = 0;
+    // The interface it follows in the configuration.
+    uint8_t interface = kNoInterface;
+    // IN packets go to buffers A and B in turn, as the controller takes them.
+    bool double_buffered = false;
+    uint8_t first_in_flight = 0;
+    uint8_t in_flight = 0;
+    // A bit per buffer whose packet is the last of its transfer.
+    uint8_t ends_transfer = 0;
+    uint16_t received = 0;
+  };
+
   void HandleSetupRequest();
   void HandleBufferStatus();
   void HandleBusReset();
@@ -117,29 +234,37 @@ class UsbDevice {
   void SendInternal(uint8_t endpoint);
   void ReceiveInternal(uint8_t endpoint);
 
-  void OnSent(uint8_t endpoint, uint32_t length);
+  // `last` if the packet ends its transfer.
+  void OnSent(uint8_t endpoint, uint32_t length, bool last);
   void OnReceived(uint8_t endpoint, uint32_t length);
 
+  // The attached interface `state` belongs to, if any.
+  Interface* InterfaceOf(const EndPoint& state) const;
+
   void SetAddress(volatile SetupPacket*);
   void SetConfiguration(volatile SetupPacket*);
 
-  size_t GetMaxPacketSize(uint8_t endpoint);
-  uint8_t* GetTransferBuffer(uint8_t endpoint);
+  // Starts the controller's IN buffer selection of double buffered endpoints
+  // at buffer A again, with no buffer available.
+  void ResetBufferSelection();
 
   const DeviceDescriptor& device_descriptor_;
-  const ConfigurationDescriptor& configuration_descriptor_;
-  const std::vector<InterfaceDescriptor>& interface_descriptors_;
-  const std::vector<EndPointDescriptor>& endpoint_descriptors_;
-  const std::vector<std::string>& strings_;
+  std::span<const uint8_t> configuration_;
+  std::array<std::span<const uint8_t>, kMaxStrings> strings_ = {};
+  size_t num_strings_ = 0;
 
   uint8_t address_ = 0;
   bool should_set_address_ = false;
   bool ready_ = false;
-  std::vector<uint8_t> in_next_pid_ = {0u};
-  std::vector<uint8_t> out_next_pid_ = {0u};
-  std::vector<uint8_t> setup_buffer_;
-  std::vector<std::span<const uint8_t>> sending_data_;
-  std::vector<std::span<uint8_t>> receiving_data_;
+  std::array<EndPoint, kMaxEndPoints> in_endpoints_ = {};
+  std::array<EndPoint, kMaxEndPoints> out_endpoints_ = {};
+  // One more than the highest endpoint number in use.
+  size_t num_endpoints_ = 0;
+  std::array<Interface*, kMaxInterfaces> interfaces_ = {};
+  std::array<uint8_t, kMaxEndPoints> in_next_pid_ = {};
+  std::array<uint8_t, kMaxEndPoints> out_next_pid_ = {};
+  std::array<std::span<const uint8_t>, kMaxEndPoints> sending_data_ = {};
+  std::array<std::span<uint8_t>, kMaxEndPoints> receiving_data_ = {};
 };
 
 #endif  // COMMON_USB_DEVICE_H_
\ No newline at end of file
@@ -4,59 +4,31 @@
 
 #include "usb_hid_device.h"
 
+#include <algorithm>
+#include <cstdio>
+
+#include "hot_path.h"
+
 UsbHidDevice::UsbHidDevice(
     const DeviceDescriptor& device_descriptor,
-    const ConfigurationDescriptor& configuration_descriptor,
-    const std::vector<InterfaceDescriptor>& interface_descriptors,
-    const std::vector<EndPointDescriptor>& endpoint_descriptors,
-    const HidDescriptor& hid_descriptor,
-    const std::vector<uint8_t>& report_descriptor,
-    const std::vector<std::string>& strings)
-    : UsbDevice(device_descriptor,
-                configuration_descriptor,
-                interface_descriptors,
-                endpoint_descriptors,
-                strings),
-      configuration_descriptor_(configuration_descriptor),
-      interface_descriptors_(interface_descriptors),
-      endpoint_descriptors_(endpoint_descriptors),
-      hid_descriptor_(hid_descriptor),
+    std::span<const uint8_t> configuration,
+    std::span<const uint8_t> report_descriptor,
+    std::initializer_list<std::span<const uint8_t>> strings)
+    : UsbDevice(device_descriptor, configuration, strings),
       report_descriptor_(report_descriptor) {}
 
-void UsbHidDevice::Report(uint8_t endpoint, std::span<const uint8_t> report) {
+void DIAL_HOT_PATH(UsbHidDevice::Report)(uint8_t endpoint,
+                                         std::span<const uint8_t> report) {
   Send(endpoint, report);
 }
 
-void UsbHidDevice::FillConfigurations(std::vector<uint8_t>& buffer) {
-  buffer.clear();
-  buffer.reserve(configuration_descriptor_.wTotalLength);
-  std::span<const uint8_t> config_span(
-      reinterpret_cast<const uint8_t*>(&configuration_descriptor_),
-      sizeof(configuration_descriptor_));
-  buffer.insert(buffer.end(), config_span.begin(), config_span.end());
-  for (const auto& interface_descriptor : interface_descriptors_) {
-    std::span<const uint8_t> interface_span(
-        reinterpret_cast<const uint8_t*>(&interface_descriptor),
-        sizeof(interface_descriptor));
-    buffer.insert(buffer.end(), interface_span.begin(), interface_span.end());
-  }
-  std::span<const uint8_t> hid_span(
-      reinterpret_cast<const uint8_t*>(&hid_descriptor_),
-      sizeof(hid_descriptor_));
-  buffer.insert(buffer.end(), hid_span.begin(), hid_span.end());
-  for (const auto& endpoint_descriptor : endpoint_descriptors_) {
-    std::span<const uint8_t> endpoint_span(
-        reinterpret_cast<const uint8_t*>(&endpoint_descriptor),
-        sizeof(endpoint_descriptor));
-    buffer.insert(buffer.end(), endpoint_span.begin(), endpoint_span.end());
-  }
-}
-
 void UsbHidDevice::GetDescriptor(volatile SetupPacket* setup) {
   uint8_t type = setup->wValue >> 8;
   switch (type) {
     case UsbHidDevice::kDescriptorTypeReport:
-      Send(0, std::span<const uint8_t>(report_descriptor_));
+      Send(0, report_descriptor_.first(std::min(
+                  report_descriptor_.size(),
+                  static_cast<size_t>(setup->wLength))));
       break;
     default:
       UsbDevice::GetDescriptor(setup);
@@ -70,14 +42,15 @@ void UsbHidDevice::HandleSetupRequest(volatile SetupPacket* setup) {
   if (type == (kDirOut | kTypeClass)) {
     switch (setup->bRequest) {
       case kHidRequestSetReport:
-        receive_buffer_.resize(setup->wLength);
-        Receive(0, receive_buffer_);
+        Receive(0, std::span<uint8_t>(receive_buffer_)
+                       .first(std::min(receive_buffer_.size(),
+                                       static_cast<size_t>(setup->wLength))));
         break;
       case kHidRequestSetIdle:
         AcknowledgeOutRequest();
         break;
       case kHidRequestSetProtocol:
-        printf("set protocol: %s\n", setup->wValue ? "report" : "boot");
+        protocol_ = setup->wValue ? kProtocolReport : kProtocolBoot;
         AcknowledgeOutRequest();
         break;
       default:
@@ -86,9 +59,20 @@ void UsbHidDevice::HandleSetupRequest(volatile SetupPacket* setup) {
         break;
     }
   } else if (type == (kDirIn | kTypeClass)) {
-    AcknowledgeOutRequest();
-    printf("unsupported HID class setup in: $%02x\n", setup->bRequest);
+    switch (setup->bRequest) {
+      case kHidRequestGetProtocol:
+        Send(0, std::span<const uint8_t>(&protocol_, 1));
+        break;
+      default:
+        AcknowledgeOutRequest();
+        printf("unsupported HID class setup in: $%02x\n", setup->bRequest);
+        break;
+    }
   } else {
     UsbDevice::HandleSetupRequest(setup);
   }
+}
+
+void UsbHidDevice::OnBusReset() {
+  protocol_ = kProtocolReport;
 }
\ No newline at end of file
@@ -7,9 +7,10 @@
 
 #include "usb_device.h"
 
+#include <array>
 #include <cstdint>
-#include <string>
-#include <vector>
+#include <initializer_list>
+#include <span>
 
 class UsbHidDevice : public UsbDevice {
  public:
@@ -23,38 +24,44 @@ class UsbHidDevice : public UsbDevice {
     uint16_t wDescriptorLength;
   } __attribute__((packed));
 
+  static constexpr uint8_t kHidRequestGetProtocol = 0x03u;
   static constexpr uint8_t kHidRequestSetReport = 0x09u;
   static constexpr uint8_t kHidRequestSetIdle = 0x0au;
   static constexpr uint8_t kHidRequestSetProtocol = 0x0bu;
 
+  static constexpr uint8_t kProtocolBoot = 0x00u;
+  static constexpr uint8_t kProtocolReport = 0x01u;
+
   static constexpr uint8_t kDescriptorTypeHid = 0x21u;
   static constexpr uint8_t kDescriptorTypeReport = 0x22u;
 
+  // As UsbDevice, and `configuration` has the HID descriptor of
+  // `report_descriptor`.
   UsbHidDevice(const DeviceDescriptor& device_descriptor,
-               const ConfigurationDescriptor& configuration_descriptor,
-               const std::vector<InterfaceDescriptor>& interface_descriptors,
-               const std::vector<EndPointDescriptor>& endpoint_descriptors,
-               const HidDescriptor& hid_descriptor,
-               const std::vector<uint8_t>& report_descriptor,
-               const std::vector<std::string>& strings);
+               std::span<const uint8_t> configuration,
+               std::span<const uint8_t> report_descriptor,
+               std::initializer_list<std::span<const uint8_t>> strings);
   UsbHidDevice(const UsbHidDevice&) = delete;
   UsbHidDevice& operator=(const UsbHidDevice&) = delete;
   ~UsbHidDevice() override = default;
 
   void Report(uint8_t endpoint, std::span<const uint8_t> report);
 
+ protected:
+  // kProtocolReport, or kProtocolBoot once the host asks for it with
+  // SET_PROTOCOL. Goes back to kProtocolReport on bus reset.
+  uint8_t protocol() const { return protocol_; }
+
  private:
   // Implement UsbDevice.
-  void FillConfigurations(std::vector<uint8_t>& buffer) override;
   void GetDescriptor(volatile SetupPacket* setup_packet) override;
   void HandleSetupRequest(volatile SetupPacket* setup_packet) override;
+  void OnBusReset() override;
 
-  const ConfigurationDescriptor& configuration_descriptor_;
-  const std::vector<InterfaceDescriptor>& interface_descriptors_;
-  const std::vector<EndPointDescriptor>& endpoint_descriptors_;
-  const HidDescriptor& hid_descriptor_;
-  const std::vector<uint8_t>& report_descriptor_;
-  std::vector<uint8_t> receive_buffer_;
+  std::span<const uint8_t> report_descriptor_;
+  // Output reports, of one packet at most.
+  std::array<uint8_t, 64> receive_buffer_ = {};
+  uint8_t protocol_ = kProtocolReport;
 };
 
 #endif  // COMMON_USB_HID_DEVICE_H_
@@ -4,57 +4,25 @@
 
 #include "usb_hid_keyboard.h"
 
+#include <algorithm>
+#include <optional>
+
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "hot_path.h"
+#include "trace.h"
+
 namespace {
 
-constexpr uint8_t kManufacturerStringIndex = 1;
-constexpr uint8_t kProductStringIndex = 2;
-constexpr uint8_t kSerialNumberStringIndex = 3;
+constexpr uint8_t kKeyboardEndpoint = 1;
 
 constexpr uint8_t kModifierReportIndex = 0;
 constexpr uint8_t kKeycodeReportIndex = 2;
 
-UsbDevice::DeviceDescriptor device_descriptor = {
-    .bLength = sizeof(UsbDevice::DeviceDescriptor),
-    .bDescriptorType = UsbDevice::kDescriptorTypeDevice,
-    .bcdUSB = 0x0110,
-    .bDeviceClass = 0,
-    .bDeviceSubClass = 0,
-    .bDeviceProtocol = 0,
-    .bMaxPacketSize0 = 64,
-    .idVendor = 0,
-    .idProduct = 0,
-    .bcdDevice = 0,
-    .iManufacturer = kManufacturerStringIndex,
-    .iProduct = kProductStringIndex,
-    .iSerialNumber = kSerialNumberStringIndex,
-    .bNumConfigurations = 1};
-
-std::vector<UsbDevice::EndPointDescriptor> endpoint_descriptors = {
-    {.bLength = sizeof(UsbDevice::EndPointDescriptor),
-     .bDescriptorType = UsbDevice::kDescriptorTypeEndPoint,
-     .bEndpointAddress = UsbDevice::kDirIn | 1,
-     .bmAttributes = UsbDevice::kEndPointAttributeInterrupt,
-     .wMaxPacketSize = 64,
-     .bInterval = 10},
-    {.bLength = sizeof(UsbDevice::EndPointDescriptor),
-     .bDescriptorType = UsbDevice::kDescriptorTypeEndPoint,
-     .bEndpointAddress = UsbDevice::kDirOut | 1,
-     .bmAttributes = UsbDevice::kEndPointAttributeInterrupt,
-     .wMaxPacketSize = 64,
-     .bInterval = 10}};
-
-std::vector<UsbDevice::InterfaceDescriptor> interface_descriptors = {
-    {.bLength = sizeof(UsbDevice::InterfaceDescriptor),
-     .bDescriptorType = UsbDevice::kDescriptorTypeInterface,
-     .bInterfaceNumber = 0,
-     .bAlternateSetting = 0,
-     .bNumEndpoints = static_cast<uint8_t>(endpoint_descriptors.size()),
-     .bInterfaceClass = 3,     // HID
-     .bInterfaceSubClass = 1,  // Boot
-     .bInterfaceProtocol = 1,  // Keyboard
-     .iInterface = 0}};
-
-std::vector<uint8_t> report_descriptor = {
+constexpr size_t kBootReportKeys = 6;
+constexpr size_t kFirstModifierUsage = 0xe0;
+
+constexpr uint8_t kReportDescriptor[] = {
     0x05, 0x01, /* USAGE_PAGE (Generic Desktop) */
     0x09, 0x06, /* USAGE (Keyboard) */
     0xa1, 0x01, /* COLLECTION (Application) */
@@ -78,66 +46,30 @@ std::vector<uint8_t> report_descriptor = {
     0x75, 0x03, /*   REPORT_SIZE (3) */
     0x95, 0x01, /*   REPORT_COUNT (1) */
     0x91, 0x01, /*   OUTPUT (Constant); LED report padding */
-    0x75, 0x08, /*   REPORT_SIZE (8) */
-    0x95, 0x06, /*   REPORT_COUNT (6) */
+    0x75, 0x01, /*   REPORT_SIZE (1) */
+    0x95, 0xe0, /*   REPORT_COUNT (224) */
     0x15, 0x00, /*   LOGICAL_MINIMUM (0) */
-    0x25, 0x65, /*   LOGICAL_MAXIMUM (101) */
+    0x25, 0x01, /*   LOGICAL_MAXIMUM (1) */
     0x05, 0x07, /*   USAGE_PAGE (Keyboard) */
     0x19, 0x00, /*   USAGE_MINIMUM (0) */
-    0x29, 0x65, /*   USAGE_MAXIMUM (101) */
-    0x81, 0x00, /*   INPUT (Data,Ary,Abs) */
+    0x29, 0xdf, /*   USAGE_MAXIMUM (223) */
+    0x81, 0x02, /*   INPUT (Data,Var,Abs); Key bitmap */
     0xC0,       /* END_COLLECTION  */
 };
-
-UsbHidDevice::HidDescriptor hid_descriptor = {
-    .bLength = sizeof(UsbHidDevice::HidDescriptor),
-    .bDescriptorType = UsbHidDevice::kDescriptorTypeHid,
-    .bcdHID = 0x0110,
-    .bCountryCode = 0x00,
-    .bNumDescriptors = 1,
-    .bReportDescriptorType = UsbHidDevice::kDescriptorTypeReport,
-    .wDescriptorLength = static_cast<uint16_t>(report_descriptor.size())};
-
-UsbDevice::ConfigurationDescriptor configuration_descriptor = {
-    .bLength = sizeof(configuration_descriptor),
-    .bDescriptorType = UsbDevice::kDescriptorTypeConfiguration,
-    .wTotalLength = static_cast<uint16_t>(
-        sizeof(UsbDevice::ConfigurationDescriptor) +
-        sizeof(UsbDevice::InterfaceDescriptor) +
-        sizeof(UsbDevice::EndPointDescriptor) * endpoint_descriptors.size() +
-        sizeof(UsbHidDevice::HidDescriptor)),
-    .bNumInterfaces = static_cast<uint8_t>(interface_descriptors.size()),
-    .bConfigurationValue = 1,
-    .iConfiguration = 0,
-    .bmAttributes = 0xc0,
-    .bMaxPower = 250};
-
-std::vector<std::string> strings = {"", "", ""};
+static_assert(UsbHidKeyboard::kNkroUsages == 0xe0);
+static_assert(sizeof(kReportDescriptor) ==
+              UsbHidKeyboard::kReportDescriptorSize);
 
 }  // namespace
 
-UsbHidKeyboard::UsbHidKeyboard(uint16_t vendor_id,
-                               uint16_t product_id,
-                               uint16_t version,
-                               std::string vendor_name,
-                               std::string product_name,
-                               std::string version_name)
+UsbHidKeyboard::UsbHidKeyboard(
+    const DeviceDescriptor& device_descriptor,
+    std::span<const uint8_t> configuration,
+    std::initializer_list<std::span<const uint8_t>> strings)
     : UsbHidDevice(device_descriptor,
-                   configuration_descriptor,
-                   interface_descriptors,
-                   endpoint_descriptors,
-                   hid_descriptor,
-                   report_descriptor,
-                   strings) {
-  device_descriptor.idVendor = vendor_id;
-  device_descriptor.idProduct = product_id;
-  device_descriptor.bcdDevice = version;
-  strings[kManufacturerStringIndex - 1] = vendor_name;
-  strings[kProductStringIndex - 1] = product_name;
-  strings[kSerialNumberStringIndex - 1] = version_name;
-
-  report_.resize(8);
-}
+                   configuration,
+                   kReportDescriptor,
+                   strings) {}
 
 void UsbHidKeyboard::SetAutoKeyRelease(bool enabled) {
   auto_key_release_ = enabled;
@@ -148,56 +80,175 @@ void UsbHidKeyboard::SetModifiers(uint8_t modifiers) {
 }
 
 void UsbHidKeyboard::PressByUsageId(uint8_t usage_id) {
-  keycodes_.insert(usage_id);
-  if (reporting_) {
-    dirty_ = true;
+  PressByUsageId(usage_id, time_us_32());
+}
+
+void DIAL_HOT_PATH(UsbHidKeyboard::PressByUsageId)(uint8_t usage_id,
+                                                   uint32_t time_us) {
+  if (auto_key_release_) {
+    Enqueue({{time_us, usage_id, /*press=*/true, modifiers_},
+             {time_us, usage_id, /*press=*/false, /*modifiers=*/0}});
+    modifiers_ = 0;
   } else {
-    Report();
+    Enqueue({{time_us, usage_id, /*press=*/true, modifiers_}});
   }
 }
 
 void UsbHidKeyboard::ReleaseByUsageId(uint8_t usage_id) {
-  auto it = keycodes_.find(usage_id);
-  if (it != keycodes_.end()) {
-    keycodes_.erase(it);
-    if (reporting_) {
-      dirty_ = true;
-    } else {
+  ReleaseByUsageId(usage_id, time_us_32());
+}
+
+void DIAL_HOT_PATH(UsbHidKeyboard::ReleaseByUsageId)(uint8_t usage_id,
+                                                     uint32_t time_us) {
+  Enqueue({{time_us, usage_id, /*press=*/false, modifiers_}});
+}
+
+void DIAL_HOT_PATH(UsbHidKeyboard::OnCompleteToSend)(uint8_t endpoint) {
+  if (endpoint != kKeyboardEndpoint) {
+    return;
+  }
+  trace::End(trace::Stage::kUsbReport);
+  if (ShouldReport()) {
+    Report();
+  }
+}
+
+void UsbHidKeyboard::OnConfigured() {
+  // Events queued before the host configured the keyboard, or while it was
+  // reset.
+  if (ShouldReport()) {
+    Report();
+  }
+}
+
+void DIAL_HOT_PATH(UsbHidKeyboard::Enqueue)(
+    std::initializer_list<Event> events) {
+  // The USB interrupt takes events out of the queue.
+  uint32_t status = save_and_disable_interrupts();
+  if (num_events_ + events.size() > events_.size()) {
+    dropped_events_ += events.size();
+  } else {
+    for (const Event& event : events) {
+      // After the events of the same time, to keep their order.
+      size_t i = num_events_++;
+      for (; i && static_cast<int32_t>(events_[i - 1].time_us -
+                                       event.time_us) > 0;
+           --i) {
+        events_[i] = events_[i - 1];
+      }
+      events_[i] = event;
+    }
+    if (ShouldReport()) {
       Report();
     }
   }
+  restore_interrupts(status);
 }
 
-void UsbHidKeyboard::OnCompleteToSend(uint8_t endpoint) {
-  reporting_ = false;
-  if (dirty_) {
-    Report();
+bool DIAL_HOT_PATH(UsbHidKeyboard::ShouldReport)() const {
+  if (!num_events_ || !CanSend(kKeyboardEndpoint)) {
+    return false;
   }
+  // While a report is in flight, the next one is staged only once no event
+  // to come could join it.
+  return !IsSending(kKeyboardEndpoint) || PackableEvents() < num_events_;
 }
 
-void UsbHidKeyboard::Report() {
-  report_[0] = modifiers_;
-  report_[1] = 0x00;
-  if (keycodes_.size() > 6) {
-    // Phantom state
-    for (size_t i = 2; i < report_.size(); ++i) {
-      report_[i] = 0x01;
+size_t DIAL_HOT_PATH(UsbHidKeyboard::PackableEvents)() const {
+  bool boot = protocol() == kProtocolBoot;
+  // Keys pressed in the report, and keys pressed or released in it. A key
+  // released and pressed again in one report would look held to the host.
+  std::bitset<256> pressed;
+  std::bitset<256> changed;
+  std::optional<int> last_press;
+  std::optional<uint8_t> press_modifiers;
+  size_t next = 0;
+  for (; next < num_events_; ++next) {
+    const Event& event = events_[next];
+    if (!event.press) {
+      if (!pressed.test(event.usage_id)) {
+        changed.set(event.usage_id);
+      }
+      continue;
     }
-  } else {
-    size_t i = 2;
-    for (size_t keycode : keycodes_) {
-      report_[i++] = keycode;
+    // Hosts take new keys of a bitmap in usage order, and may take those of
+    // an array in any order.
+    if (changed.test(event.usage_id) ||
+        (last_press && (boot || event.usage_id < *last_press)) ||
+        (press_modifiers && *press_modifiers != event.modifiers)) {
+      break;
     }
-    while (i < 8) {
-      report_[i++] = 0x00;
+    pressed.set(event.usage_id);
+    changed.set(event.usage_id);
+    last_press = event.usage_id;
+    press_modifiers = event.modifiers;
+  }
+  return next;
+}
+
+void DIAL_HOT_PATH(UsbHidKeyboard::Report)() {
+  bool boot = protocol() == kProtocolBoot;
+  size_t end = PackableEvents();
+  // Releases of keys pressed in this report are kept for the next one.
+  std::bitset<256> pressed;
+  bool has_press = false;
+  uint8_t modifiers = report_modifiers_;
+  size_t kept = 0;
+  for (size_t next = 0; next < end; ++next) {
+    const Event& event = events_[next];
+    if (!event.press) {
+      if (pressed.test(event.usage_id)) {
+        events_[kept++] = event;
+        continue;
+      }
+      keycodes_.reset(event.usage_id);
+      if (!has_press) {
+        modifiers = event.modifiers;
+      }
+      continue;
     }
+    pressed.set(event.usage_id);
+    keycodes_.set(event.usage_id);
+    has_press = true;
+    modifiers = event.modifiers;
   }
-  dirty_ = false;
-  if (auto_key_release_ && !keycodes_.empty()) {
-    keycodes_.clear();
-    modifiers_ = 0;
-    dirty_ = true;
+  num_events_ = std::copy(events_.begin() + end,
+                          events_.begin() + num_events_,
+                          events_.begin() + kept) -
+                events_.begin();
+  report_modifiers_ = modifiers;
+
+  report_[kModifierReportIndex] = modifiers;
+  report_[1] = 0x00;
+  std::fill(report_.begin() + kKeycodeReportIndex, report_.end(), 0x00);
+  // Modifier usages go to the modifier byte in both protocols.
+  size_t boot_keys = 0;
+  for (size_t keycode = 0; keycode < keycodes_.size(); ++keycode) {
+    if (!keycodes_.test(keycode)) {
+      continue;
+    }
+    if (keycode >= kFirstModifierUsage && keycode < kFirstModifierUsage + 8) {
+      report_[kModifierReportIndex] |= 1 << (keycode - kFirstModifierUsage);
+    } else if (keycode >= kNkroUsages) {
+      continue;
+    } else if (boot) {
+      if (kKeycodeReportIndex + boot_keys < kBootReportSize) {
+        report_[kKeycodeReportIndex + boot_keys] = keycode;
+      }
+      ++boot_keys;
+    } else {
+      report_[kKeycodeReportIndex + keycode / 8] |= 1 << (keycode % 8);
+    }
   }
-  reporting_ = true;
-  UsbHidDevice::Report(1, report_);
-}
\ No newline at end of file
+  std::span<const uint8_t> report(report_);
+  if (boot) {
+    report = report.first(kBootReportSize);
+    if (boot_keys > kBootReportKeys) {
+      // Phantom state
+      std::fill(report_.begin() + kKeycodeReportIndex,
+                report_.begin() + kBootReportSize, 0x01);
+    }
+  }
+  trace::Begin(trace::Stage::kUsbReport);
+  UsbHidDevice::Report(kKeyboardEndpoint, report);
+}
@@ -5,45 +5,276 @@
 #ifndef COMMON_USB_HID_KEYBOARD_H_
 #define COMMON_USB_HID_KEYBOARD_H_
 
+#include <algorithm>
+#include <array>
+#include <bitset>
 #include <cstdint>
-#include <set>
-#include <string>
-#include <vector>
+#include <initializer_list>
+#include <span>
 
 #include "usb_hid_device.h"
 
+// A keyboard that reports all pressed keys as a bitmap in report protocol, and
+// up to 6 keys in the boot protocol report once the host selects it.
+//
+// Presses and releases are queued with their time, and sent in time order.
+// Each report takes as many queued events as the host can still tell apart in
+// order: new keys in ascending usage order with the same modifiers, in report
+// protocol, or one new key, in boot protocol. A key pressed in a report is
+// released in a later one. While a report is in flight, the next one is
+// staged in the other endpoint buffer once it can take no more events.
 class UsbHidKeyboard : public UsbHidDevice {
  public:
-  UsbHidKeyboard(uint16_t vendor_id,
-                 uint16_t product_id,
-                 uint16_t version,
-                 std::string vendor_name,
-                 std::string product_name,
-                 std::string version_name);
+  // Boot protocol report: modifiers, reserved, and 6 usages.
+  static constexpr size_t kBootReportSize = 8;
+  // Report protocol report: modifiers, reserved, and a bit for each usage
+  // below kNkroUsages.
+  static constexpr size_t kNkroUsages = 0xe0;
+  static constexpr size_t kNkroReportSize = 2 + kNkroUsages / 8;
+
+  static constexpr uint8_t kDefaultPollIntervalMs = 10;
+  // Events that can wait for reports. More are dropped.
+  static constexpr size_t kMaxEvents = 32;
+
+  static constexpr size_t kReportDescriptorSize = 63;
+  // IN and OUT.
+  static constexpr size_t kNumEndPoints = 2;
+
+  // The configuration descriptor with all that follows it, in the order the
+  // host reads them.
+  struct Configuration {
+    ConfigurationDescriptor configuration;
+    InterfaceDescriptor interface;
+    HidDescriptor hid;
+    std::array<EndPointDescriptor, kNumEndPoints> endpoints;
+  } __attribute__((packed));
+  static_assert(sizeof(Configuration) ==
+                sizeof(ConfigurationDescriptor) + sizeof(InterfaceDescriptor) +
+                    sizeof(HidDescriptor) +
+                    sizeof(EndPointDescriptor) * kNumEndPoints);
+
+  // The configuration of a keyboard followed by the descriptors of a further
+  // interface, numbered 1, for a composite device.
+  template <typename InterfaceDescriptors>
+  struct CompositeConfiguration {
+    Configuration keyboard;
+    InterfaceDescriptors interface;
+  } __attribute__((packed));
+
+  // All descriptors of a keyboard, of names with the given lengths.
+  template <size_t VendorNameLength,
+            size_t ProductNameLength,
+            size_t VersionNameLength,
+            typename ConfigurationType = Configuration>
+  struct Descriptors {
+    DeviceDescriptor device;
+    ConfigurationType configuration;
+    StringDescriptor<VendorNameLength> vendor_name;
+    StringDescriptor<ProductNameLength> product_name;
+    StringDescriptor<VersionNameLength> version_name;
+  };
+
+  // Builds the descriptors at compile time, for a constexpr that stays in
+  // flash. The host polls the keyboard every `poll_interval_ms`, from 1 to
+  // 255.
+  template <size_t VendorNameSize,
+            size_t ProductNameSize,
+            size_t VersionNameSize>
+  static constexpr Descriptors<VendorNameSize - 1,
+                               ProductNameSize - 1,
+                               VersionNameSize - 1>
+  MakeDescriptors(uint16_t vendor_id,
+                  uint16_t product_id,
+                  uint16_t version,
+                  const char (&vendor_name)[VendorNameSize],
+                  const char (&product_name)[ProductNameSize],
+                  const char (&version_name)[VersionNameSize],
+                  uint8_t poll_interval_ms = kDefaultPollIntervalMs);
+
+  // Adds `interface`, the descriptors of interface 1, e.g. those of
+  // UsbVendorInterface::MakeDescriptors(), to `descriptors` at compile time.
+  template <size_t VendorNameLength,
+            size_t ProductNameLength,
+            size_t VersionNameLength,
+            typename InterfaceDescriptors>
+  static constexpr Descriptors<VendorNameLength,
+                               ProductNameLength,
+                               VersionNameLength,
+                               CompositeConfiguration<InterfaceDescriptors>>
+  AddInterface(const Descriptors<VendorNameLength,
+                                 ProductNameLength,
+                                 VersionNameLength>& descriptors,
+               const InterfaceDescriptors& interface);
+
+  // `descriptors` must outlive the keyboard.
+  template <size_t VendorNameLength,
+            size_t ProductNameLength,
+            size_t VersionNameLength,
+            typename ConfigurationType>
+  explicit UsbHidKeyboard(const Descriptors<VendorNameLength,
+                                            ProductNameLength,
+                                            VersionNameLength,
+                                            ConfigurationType>& descriptors)
+      : UsbHidKeyboard(descriptors.device,
+                       AsBytes(descriptors.configuration),
+                       {AsBytes(descriptors.vendor_name),
+                        AsBytes(descriptors.product_name),
+                        AsBytes(descriptors.version_name)}) {}
   UsbHidKeyboard(const UsbHidKeyboard&) = delete;
   UsbHidKeyboard& operator=(const UsbHidKeyboard&) = delete;
   ~UsbHidKeyboard() override = default;
 
+  // Releases each key right after its press, and clears the modifiers.
   void SetAutoKeyRelease(bool enabled);
 
+  // Modifiers for the following presses.
   void SetModifiers(uint8_t modifiers);
   uint8_t GetModifiers() const { return modifiers_; }
 
+  // `time_us` is when the key was pressed or released, e.g. when the dial
+  // position was decided; events are reported in its order. Defaults to now.
   void PressByUsageId(uint8_t usage_id);
+  void PressByUsageId(uint8_t usage_id, uint32_t time_us);
   void ReleaseByUsageId(uint8_t usage_id);
+  void ReleaseByUsageId(uint8_t usage_id, uint32_t time_us);
+
+  // Events waiting for reports.
+  size_t queued_events() const { return num_events_; }
+  // Events dropped as the queue was full.
+  uint32_t dropped_events() const { return dropped_events_; }
 
  private:
+  struct Event {
+    uint32_t time_us;
+    uint8_t usage_id;
+    bool press;
+    // Modifiers to report along.
+    uint8_t modifiers;
+  };
+
+  static constexpr uint8_t kManufacturerStringIndex = 1;
+  static constexpr uint8_t kProductStringIndex = 2;
+  static constexpr uint8_t kSerialNumberStringIndex = 3;
+
+  UsbHidKeyboard(const DeviceDescriptor& device_descriptor,
+                 std::span<const uint8_t> configuration,
+                 std::initializer_list<std::span<const uint8_t>> strings);
+
   // Implement UsbDevice.
   void OnCompleteToSend(uint8_t endpoint) override;
+  void OnConfigured() override;
 
+  // Queues all of `events`, or none if they do not fit, and reports them if
+  // ShouldReport().
+  void Enqueue(std::initializer_list<Event> events);
+  bool ShouldReport() const;
+  // Returns how many of the queued events the next report takes, releases of
+  // its own keys included.
+  size_t PackableEvents() const;
   void Report();
 
   bool auto_key_release_ = false;
-  bool reporting_ = false;
-  bool dirty_ = false;
   uint8_t modifiers_ = 0;
-  std::set<uint8_t> keycodes_;
-  std::vector<uint8_t> report_;
+  // Sorted by time.
+  std::array<Event, kMaxEvents> events_ = {};
+  size_t num_events_ = 0;
+  uint32_t dropped_events_ = 0;
+  // Keys and modifiers in the last report.
+  std::bitset<256> keycodes_;
+  uint8_t report_modifiers_ = 0;
+  std::array<uint8_t, kNkroReportSize> report_ = {};
 };
 
+template <size_t VendorNameSize, size_t ProductNameSize, size_t VersionNameSize>
+constexpr UsbHidKeyboard::
+    Descriptors<VendorNameSize - 1, ProductNameSize - 1, VersionNameSize - 1>
+    UsbHidKeyboard::MakeDescriptors(uint16_t vendor_id,
+                                    uint16_t product_id,
+                                    uint16_t version,
+                                    const char (&vendor_name)[VendorNameSize],
+                                    const char (&product_name)[ProductNameSize],
+                                    const char (&version_name)[VersionNameSize],
+                                    uint8_t poll_interval_ms) {
+  EndPointDescriptor endpoint = {
+      .bLength = sizeof(EndPointDescriptor),
+      .bDescriptorType = kDescriptorTypeEndPoint,
+      .bEndpointAddress = kDirIn | 1,
+      .bmAttributes = kEndPointAttributeInterrupt,
+      .wMaxPacketSize = 64,
+      .bInterval = std::max<uint8_t>(poll_interval_ms, 1)};
+  Configuration configuration = {
+      .configuration = {.bLength = sizeof(ConfigurationDescriptor),
+                        .bDescriptorType = kDescriptorTypeConfiguration,
+                        .wTotalLength = sizeof(Configuration),
+                        .bNumInterfaces = 1,
+                        .bConfigurationValue = 1,
+                        .iConfiguration = 0,
+                        .bmAttributes = 0xc0,
+                        .bMaxPower = 250},
+      .interface = {.bLength = sizeof(InterfaceDescriptor),
+                    .bDescriptorType = kDescriptorTypeInterface,
+                    .bInterfaceNumber = 0,
+                    .bAlternateSetting = 0,
+                    .bNumEndpoints = kNumEndPoints,
+                    .bInterfaceClass = 3,     // HID
+                    .bInterfaceSubClass = 1,  // Boot
+                    .bInterfaceProtocol = 1,  // Keyboard
+                    .iInterface = 0},
+      .hid = {.bLength = sizeof(HidDescriptor),
+              .bDescriptorType = kDescriptorTypeHid,
+              .bcdHID = 0x0110,
+              .bCountryCode = 0x00,
+              .bNumDescriptors = 1,
+              .bReportDescriptorType = kDescriptorTypeReport,
+              .wDescriptorLength = kReportDescriptorSize},
+      .endpoints = {endpoint, endpoint}};
+  configuration.endpoints[1].bEndpointAddress = kDirOut | 1;
+  return {
+      .device = {.bLength = sizeof(DeviceDescriptor),
+                 .bDescriptorType = kDescriptorTypeDevice,
+                 .bcdUSB = 0x0110,
+                 .bDeviceClass = 0,
+                 .bDeviceSubClass = 0,
+                 .bDeviceProtocol = 0,
+                 .bMaxPacketSize0 = 64,
+                 .idVendor = vendor_id,
+                 .idProduct = product_id,
+                 .bcdDevice = version,
+                 .iManufacturer = kManufacturerStringIndex,
+                 .iProduct = kProductStringIndex,
+                 .iSerialNumber = kSerialNumberStringIndex,
+                 .bNumConfigurations = 1},
+      .configuration = configuration,
+      .vendor_name = MakeStringDescriptor(vendor_name),
+      .product_name = MakeStringDescriptor(product_name),
+      .version_name = MakeStringDescriptor(version_name)};
+}
+
+template <size_t VendorNameLength,
+          size_t ProductNameLength,
+          size_t VersionNameLength,
+          typename InterfaceDescriptors>
+constexpr UsbHidKeyboard::Descriptors<
+    VendorNameLength,
+    ProductNameLength,
+    VersionNameLength,
+    UsbHidKeyboard::CompositeConfiguration<InterfaceDescriptors>>
+UsbHidKeyboard::AddInterface(const Descriptors<VendorNameLength,
+                                               ProductNameLength,
+                                               VersionNameLength>& descriptors,
+                             const InterfaceDescriptors& interface) {
+  Descriptors<VendorNameLength, ProductNameLength, VersionNameLength,
+              CompositeConfiguration<InterfaceDescriptors>>
+      composite = {.device = descriptors.device,
+                   .configuration = {.keyboard = descriptors.configuration,
+                                     .interface = interface},
+                   .vendor_name = descriptors.vendor_name,
+                   .product_name = descriptors.product_name,
+                   .version_name = descriptors.version_name};
+  composite.configuration.keyboard.configuration.wTotalLength =
+      sizeof(CompositeConfiguration<InterfaceDescriptors>);
+  composite.configuration.keyboard.configuration.bNumInterfaces = 2;
+  return composite;
+}
+
 #endif  // COMMON_USB_HID_KEYBOARD_H_
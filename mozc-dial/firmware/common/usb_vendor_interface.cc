@@ -0,0 +1,77 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#include "usb_vendor_interface.h"
+
+#include <algorithm>
+
+#include "hardware/sync.h"
+
+#include "hot_path.h"
+
+UsbVendorInterface::UsbVendorInterface(UsbDevice& device,
+                                       const Descriptors& descriptors)
+    : UsbDevice::Interface(device, descriptors.interface.bInterfaceNumber),
+      endpoint_(descriptors.endpoints[0].bEndpointAddress & 0x0f) {}
+
+bool UsbVendorInterface::Write(std::span<const uint8_t> packet) {
+  uint32_t status = save_and_disable_interrupts();
+  bool queued = num_queued_ < queue_.size();
+  if (queued) {
+    Packet& next = queue_[(first_queued_ + num_queued_++) % queue_.size()];
+    next.size = std::min(packet.size(), kPacketSize);
+    std::copy(packet.begin(), packet.begin() + next.size, next.data.begin());
+    SendNext();
+  } else {
+    ++dropped_packets_;
+  }
+  restore_interrupts(status);
+  return queued;
+}
+
+size_t UsbVendorInterface::Read(std::span<uint8_t, kPacketSize> packet) {
+  if (!has_received_) {
+    return 0;
+  }
+  size_t size = received_size_;
+  std::copy(received_.begin(), received_.begin() + size, packet.begin());
+  uint32_t status = save_and_disable_interrupts();
+  has_received_ = false;
+  Receive(endpoint_, received_);
+  restore_interrupts(status);
+  return size;
+}
+
+void UsbVendorInterface::OnConfigured() {
+  has_received_ = false;
+  Receive(endpoint_, received_);
+  SendNext();
+}
+
+void DIAL_HOT_PATH(UsbVendorInterface::OnCompleteToSend)(uint8_t endpoint) {
+  SendNext();
+}
+
+void DIAL_HOT_PATH(UsbVendorInterface::OnCompleteToReceive)(uint8_t endpoint,
+                                                            size_t length) {
+  received_size_ = length;
+  has_received_ = true;
+}
+
+void UsbVendorInterface::OnBusReset() {
+  first_queued_ = 0;
+  num_queued_ = 0;
+  has_received_ = false;
+}
+
+void DIAL_HOT_PATH(UsbVendorInterface::SendNext)() {
+  // Both buffers of the endpoint are kept staged, so that the host can take
+  // two packets in a frame.
+  while (num_queued_ && CanSend(endpoint_)) {
+    const Packet& packet = queue_[first_queued_];
+    first_queued_ = (first_queued_ + 1) % queue_.size();
+    --num_queued_;
+    Send(endpoint_, std::span(packet.data).first(packet.size));
+  }
+}
@@ -0,0 +1,109 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef COMMON_USB_VENDOR_INTERFACE_H_
+#define COMMON_USB_VENDOR_INTERFACE_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "usb_device.h"
+
+// A vendor specific interface of a bulk IN and a bulk OUT endpoint, next to
+// the interfaces of a composite UsbDevice, e.g. for telemetry and settings
+// next to a keyboard. Hosts reach it with libusb, without a class driver.
+//
+// Data goes in packets of up to kPacketSize bytes, each a transfer of its
+// own. Packets to the host are queued and sent as the host polls; those from
+// the host are taken one at a time, and the host is NAKed until the last one
+// is read. Write() and Read() are called from one core in thread mode.
+class UsbVendorInterface final : public UsbDevice::Interface {
+ public:
+  static constexpr size_t kPacketSize = 64;
+  // Packets waiting for the host. More are dropped.
+  static constexpr size_t kMaxQueuedPackets = 8;
+
+  // The interface descriptor and its endpoints, to follow the descriptors of
+  // the other interfaces in the configuration.
+  struct Descriptors {
+    UsbDevice::InterfaceDescriptor interface;
+    std::array<UsbDevice::EndPointDescriptor, 2> endpoints;
+  } __attribute__((packed));
+
+  // Builds the descriptors of interface `number` at compile time, on the
+  // endpoints of `endpoint` IN and OUT.
+  static constexpr Descriptors MakeDescriptors(uint8_t number,
+                                               uint8_t endpoint);
+
+  // `descriptors` are those of MakeDescriptors() in the configuration of
+  // `device`.
+  UsbVendorInterface(UsbDevice& device, const Descriptors& descriptors);
+  UsbVendorInterface(const UsbVendorInterface&) = delete;
+  UsbVendorInterface& operator=(const UsbVendorInterface&) = delete;
+  ~UsbVendorInterface() override = default;
+
+  // Queues `packet` for the host. Returns false, and counts the drop, if the
+  // queue is full.
+  bool Write(std::span<const uint8_t> packet);
+  // Takes the packet from the host into `packet`, and returns its size, or 0
+  // if none came.
+  size_t Read(std::span<uint8_t, kPacketSize> packet);
+
+  uint32_t dropped_packets() const { return dropped_packets_; }
+
+ private:
+  struct Packet {
+    std::array<uint8_t, kPacketSize> data;
+    uint8_t size;
+  };
+
+  // Implement UsbDevice::Interface.
+  void OnConfigured() override;
+  void OnCompleteToSend(uint8_t endpoint) override;
+  void OnCompleteToReceive(uint8_t endpoint, size_t length) override;
+  void OnBusReset() override;
+
+  // Sends the next queued packet, if the endpoint can take it. Called with
+  // the USB interrupt masked.
+  void SendNext();
+
+  uint8_t endpoint_;
+  // Written in thread mode, and taken by the USB interrupt.
+  std::array<Packet, kMaxQueuedPackets> queue_ = {};
+  size_t first_queued_ = 0;
+  size_t num_queued_ = 0;
+  uint32_t dropped_packets_ = 0;
+  // Received in the USB interrupt, until Read() takes it.
+  std::array<uint8_t, kPacketSize> received_ = {};
+  volatile size_t received_size_ = 0;
+  volatile bool has_received_ = false;
+};
+
+constexpr UsbVendorInterface::Descriptors UsbVendorInterface::MakeDescriptors(
+    uint8_t number,
+    uint8_t endpoint) {
+  UsbDevice::EndPointDescriptor in = {
+      .bLength = sizeof(UsbDevice::EndPointDescriptor),
+      .bDescriptorType = UsbDevice::kDescriptorTypeEndPoint,
+      .bEndpointAddress = static_cast<uint8_t>(UsbDevice::kDirIn | endpoint),
+      .bmAttributes = UsbDevice::kEndPointAttributeBulk,
+      .wMaxPacketSize = kPacketSize,
+      .bInterval = 0};
+  UsbDevice::EndPointDescriptor out = in;
+  out.bEndpointAddress = UsbDevice::kDirOut | endpoint;
+  return {.interface = {.bLength = sizeof(UsbDevice::InterfaceDescriptor),
+                        .bDescriptorType = UsbDevice::kDescriptorTypeInterface,
+                        .bInterfaceNumber = number,
+                        .bAlternateSetting = 0,
+                        .bNumEndpoints = 2,
+                        .bInterfaceClass = 0xff,  // Vendor specific
+                        .bInterfaceSubClass = 0,
+                        .bInterfaceProtocol = 0,
+                        .iInterface = 0},
+          .endpoints = {in, out}};
+}
+
+#endif  // COMMON_USB_VENDOR_INTERFACE_H_
@@ -0,0 +1,607 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+// Runs the 9-dial main/sub pair in one process from scripted dial strokes, and
+// reports the main loop sampling interval and the latency from releasing a
+// dial to its key report. Exits with 1 if a key is missing or unexpected.
+//
+// Usage: dial_sim [--dual-core] [--event-driven] [--early-commit]
+//                 [--sub-attention] [--usb-1ms] [--boot-protocol]
+//                 [--trace FILE]
+//   --dual-core      runs main built with DIAL_DUAL_CORE.
+//   --event-driven   runs main built with DIAL_EVENT_DRIVEN.
+//   --early-commit   runs main and sub built with DIAL_EARLY_COMMIT.
+//   --sub-attention  runs main and sub built with DIAL_SUB_ATTENTION, with
+//                    the attention line wired.
+//   --usb-1ms        runs main built with DIAL_USB_POLL_INTERVAL_MS=1, and
+//                    polls the keyboard every frame.
+//   --boot-protocol  switches the keyboard to the boot protocol with
+//                    SET_PROTOCOL before the first stroke. The keyboard
+//                    otherwise stays in the report protocol, as after a host
+//                    configures it.
+//   --trace FILE     runs main and sub built with DIAL_TRACE, and writes
+//                    their traces around the return of the dial H to FILE,
+//                    for trace_decode. Only with --dual-core, if any other
+//                    option.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../common/keymap.h"
+#include "../common/sub_protocol.h"
+#include "../common/telemetry_protocol.h"
+#include "dial_waveform.h"
+#include "heap_check.h"
+#include "i2c_bus.h"
+#include "keyboard_report.h"
+#include "simulator.h"
+#include "trace_capture.h"
+#include "usb_controller_model.h"
+
+using host::Chip;
+using host::DialWaveform;
+using host::Nanoseconds;
+
+namespace {
+
+constexpr uint8_t kKeyboardEndpoint = 1;
+constexpr uint32_t kKeyboardPollIntervalInFrames = 10;
+constexpr uint16_t kTelemetryPeriodMs = 100;
+constexpr uint8_t kLoopProbeGpio = 1;  // Sensor A bit 0
+// The coils of the 9th motor, that returns the dial H, on the sub.
+constexpr uint32_t kMotorHMask = 0xfu << 17;
+constexpr size_t kDialH = 7;
+
+struct DialSpec {
+  const char* name;
+  bool on_sub;
+  std::vector<uint8_t> gpios;
+  keymap::Dial keymap_dial;
+};
+
+// Must match main/main.cc and sub/sub.cc.
+const DialSpec kDials[] = {
+    {"A", false, {1, 2, 3, 4, 5, 6}, keymap::kDialA},
+    {"B", false, {7, 8}, keymap::kDialB},
+    {"C", false, {9, 10, 11}, keymap::kDialE},
+    {"D", false, {12, 13}, keymap::kDialD},
+    {"E", false, {15, 16, 17}, keymap::kDialE},
+    {"F", false, {18, 19, 20}, keymap::kDialF},
+    {"G", false, {21, 22}, keymap::kDialG},
+    {"H", true, {26, 27}, keymap::kDialH},
+    {"I", false, {24, 25, 26, 27}, keymap::kDialI},
+};
+
+struct Stroke {
+  size_t dial;
+  uint8_t position;
+  Nanoseconds start;
+};
+
+struct Glitch {
+  size_t dial;
+  uint8_t gray;
+  Nanoseconds time;
+};
+
+struct KeyEvent {
+  Nanoseconds time;
+  uint8_t usage;
+  bool matched = false;
+};
+
+// A descriptor read on the control endpoint, as a host reads them while
+// enumerating.
+struct DescriptorRead {
+  uint8_t type;
+  uint8_t index;
+  std::vector<uint8_t> data;
+};
+
+// Must match main/main.cc.
+constexpr char kProductName[] = "Gboard Dial version";
+
+// Checks the device, configuration and product string descriptors in
+// `reads` against each other and the keyboard's poll interval, and prints
+// them. Interrupt endpoints are polled at that interval.
+bool CheckDescriptors(const std::vector<DescriptorRead>& reads,
+                      uint8_t poll_interval_ms) {
+  const std::vector<uint8_t>& device = reads[0].data;
+  const std::vector<uint8_t>& configuration = reads[1].data;
+  const std::vector<uint8_t>& product = reads[2].data;
+  bool ok = device.size() == 18 && device[0] == device.size() &&
+            configuration.size() >= 4 &&
+            static_cast<size_t>(configuration[2] | configuration[3] << 8) ==
+                configuration.size() &&
+            product.size() >= 2 && product[0] == product.size();
+  if (!ok) {
+    printf("usb: descriptors of %zu, %zu and %zu bytes are inconsistent\n",
+           device.size(), configuration.size(), product.size());
+    return false;
+  }
+  size_t interfaces = 0;
+  size_t interface_endpoints = 0;
+  size_t endpoints = 0;
+  for (size_t offset = 0; offset < configuration.size();
+       offset += configuration[offset]) {
+    if (configuration[offset] < 2 ||
+        offset + configuration[offset] > configuration.size()) {
+      printf("usb: configuration descriptor broken at %zu\n", offset);
+      return false;
+    }
+    if (configuration[offset + 1] == 0x04) {
+      ++interfaces;
+      interface_endpoints += configuration[offset + 4];
+    } else if (configuration[offset + 1] == 0x05) {
+      ++endpoints;
+      if (configuration[offset + 3] == 0x03) {
+        ok &= configuration[offset + 6] == poll_interval_ms;
+      }
+    }
+  }
+  ok &= endpoints == interface_endpoints && interfaces == configuration[4];
+  std::string name;
+  for (size_t i = 2; i + 1 < product.size(); i += 2) {
+    name += static_cast<char>(product[i]);
+  }
+  ok &= name == kProductName;
+  printf(
+      "usb: descriptors: device %zu bytes, configuration %zu bytes with %zu "
+      "interfaces and %zu endpoints, keyboard polled every %d ms, product "
+      "\"%s\"%s\n",
+      device.size(), configuration.size(), interfaces, endpoints,
+      poll_interval_ms, name.c_str(), ok ? "" : ", unexpected");
+  return ok;
+}
+
+// Checks the telemetry stream from its start at 60 ms: counters every
+// kTelemetryPeriodMs without a gap, reset once at `reset_index`, and a
+// decision for each stroke, counted on its dial. Prints the rates.
+bool CheckTelemetry(
+    const std::vector<std::pair<Nanoseconds, telemetry_protocol::Counters>>&
+        counters,
+    size_t reset_index,
+    const std::vector<telemetry_protocol::Decision>& decisions,
+    const std::vector<Stroke>& strokes,
+    Nanoseconds end) {
+  // The packets at the start and the reset, and one per period.
+  size_t expected =
+      2 + (end - 60 * host::kMillisecond) /
+              (kTelemetryPeriodMs * host::kMillisecond);
+  if (counters.size() + 1 < expected || reset_index >= counters.size()) {
+    printf("usb: telemetry: %zu counters packets, %zu expected\n",
+           counters.size(), expected);
+    return false;
+  }
+  bool ok = true;
+  for (size_t i = 1; i < counters.size(); ++i) {
+    ok &= counters[i].second.version == telemetry_protocol::kVersion &&
+          counters[i].second.sequence ==
+              static_cast<uint16_t>(counters[i - 1].second.sequence + 1);
+  }
+  const telemetry_protocol::Counters& reset = counters[reset_index].second;
+  const telemetry_protocol::Counters& last = counters.back().second;
+  ok &= reset.loops < counters[reset_index - 1].second.loops;
+  std::array<size_t, 32> strokes_per_dial = {};
+  for (const Stroke& stroke : strokes) {
+    ++strokes_per_dial[kDials[stroke.dial].keymap_dial];
+  }
+  for (size_t dial = 0; dial < strokes_per_dial.size(); ++dial) {
+    ok &= reset.decided_counts[dial] == 0 &&
+          last.decided_counts[dial] == strokes_per_dial[dial];
+  }
+  ok &= decisions.size() == strokes.size();
+  for (const auto& decision : decisions) {
+    ok &= std::any_of(strokes.begin(), strokes.end(), [&](const Stroke& s) {
+      return kDials[s.dial].keymap_dial == decision.dial &&
+             s.position == decision.position;
+    });
+    ok &= static_cast<int32_t>(decision.queued_time_us -
+                               decision.decided_time_us) >= 0;
+  }
+  ok &= last.i2c_failures == 0 && last.dropped_events == 0 &&
+        last.dropped_positions == 0 && last.dropped_packets == 0 &&
+        last.num_dials == 9;
+  double seconds = (last.time_us - reset.time_us) / 1e6;
+  printf(
+      "usb: telemetry: %zu counters packets, %zu decisions, %.0f loops/s, "
+      "%.0f i2c transactions/s, %u failed%s\n",
+      counters.size(), decisions.size(),
+      (last.loops - reset.loops) / seconds,
+      (last.i2c_transactions - reset.i2c_transactions) / seconds,
+      static_cast<unsigned>(last.i2c_failures), ok ? "" : ", unexpected");
+  return ok;
+}
+
+double ToMs(Nanoseconds ns) {
+  return ns / 1e6;
+}
+
+double ToUs(Nanoseconds ns) {
+  return ns / 1e3;
+}
+
+Nanoseconds Percentile(std::vector<Nanoseconds> values, double percentile) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  size_t index = static_cast<size_t>(percentile / 100.0 * (values.size() - 1));
+  return values[index];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool dual_core = false;
+  bool event_driven = false;
+  bool early_commit = false;
+  bool sub_attention = false;
+  bool usb_1ms = false;
+  bool boot_protocol = false;
+  const char* trace_path = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--dual-core")) {
+      dual_core = true;
+    } else if (!strcmp(argv[i], "--event-driven")) {
+      event_driven = true;
+    } else if (!strcmp(argv[i], "--early-commit")) {
+      early_commit = true;
+    } else if (!strcmp(argv[i], "--sub-attention")) {
+      sub_attention = true;
+    } else if (!strcmp(argv[i], "--usb-1ms")) {
+      usb_1ms = true;
+    } else if (!strcmp(argv[i], "--boot-protocol")) {
+      boot_protocol = true;
+    } else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+      trace_path = argv[++i];
+    } else {
+      fprintf(stderr,
+              "usage: %s [--dual-core] [--event-driven] [--early-commit] "
+              "[--sub-attention] [--usb-1ms] [--boot-protocol] "
+              "[--trace FILE]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  if (trace_path &&
+      (event_driven || early_commit || sub_attention || usb_1ms)) {
+    fprintf(stderr, "--trace is only built with --dual-core\n");
+    return 2;
+  }
+  // Images are named after the build options, see host/CMakeLists.txt.
+  std::string main_image = std::string(IMAGE_DIR) + "/main" +
+                           (dual_core ? "_dual_core" : "") +
+                           (event_driven ? "_event_driven" : "") +
+                           (early_commit ? "_early_commit" : "") +
+                           (sub_attention ? "_sub_attention" : "") +
+                           (usb_1ms ? "_usb_1ms" : "") +
+                           (trace_path ? "_trace" : "") + ".so";
+  std::string sub_image = std::string(IMAGE_DIR) + "/sub" +
+                          (early_commit ? "_early_commit" : "") +
+                          (sub_attention ? "_sub_attention" : "") +
+                          (trace_path ? "_trace" : "") + ".so";
+
+  host::Simulator simulator;
+  Chip& main_chip = simulator.AddChip("main", main_image);
+  Chip& sub_chip = simulator.AddChip("sub", sub_image);
+  simulator.ConnectI2C(main_chip, 0, sub_chip, 0);
+  // The last times the coils of the dial H's motor stepped, and went off.
+  std::optional<Nanoseconds> motor_h_step;
+  std::optional<Nanoseconds> motor_h_off;
+  sub_chip.SetOutputObserver([&](uint32_t outputs, uint32_t changed) {
+    if (changed & kMotorHMask) {
+      (outputs & kMotorHMask ? motor_h_step : motor_h_off) = sub_chip.time();
+    }
+    constexpr uint32_t kMask = 1u << sub_protocol::kSubAttentionGpio;
+    if (!sub_attention || !(changed & kMask)) {
+      return;
+    }
+    bool level = outputs & kMask;
+    simulator.Schedule(sub_chip.time(), [&main_chip, level] {
+      main_chip.DriveInput(sub_protocol::kMainAttentionGpio, level);
+    });
+  });
+
+  std::vector<std::unique_ptr<DialWaveform>> waveforms;
+  for (const auto& dial : kDials) {
+    waveforms.push_back(std::make_unique<DialWaveform>(
+        dial.on_sub ? sub_chip : main_chip, dial.gpios));
+  }
+
+  // Time between two samples of the same sensor is the main loop period.
+  std::vector<Nanoseconds> loop_periods;
+  std::optional<Nanoseconds> last_probe;
+  main_chip.SetInputReadObserver([&](uint32_t mask) {
+    if (!(mask & (1u << kLoopProbeGpio))) {
+      return;
+    }
+    Nanoseconds now = main_chip.time();
+    if (last_probe) {
+      loop_periods.push_back(now - *last_probe);
+    }
+    last_probe = now;
+  });
+
+  // Decode keyboard reports into key presses. Every report must be in the
+  // format of the selected protocol.
+  std::vector<KeyEvent> presses;
+  std::set<uint8_t> pressed;
+  size_t reports = 0;
+  size_t bad_reports = 0;
+  main_chip.usb().SetInPollInterval(
+      kKeyboardEndpoint, usb_1ms ? 1 : kKeyboardPollIntervalInFrames);
+  std::vector<DescriptorRead> descriptor_reads = {
+      {0x01, 0, {}},  // Device
+      {0x02, 0, {}},  // Configuration
+      {0x03, 2, {}},  // Product
+  };
+  size_t descriptor_read = 0;
+  // Telemetry packets, with when the host took them.
+  std::vector<std::pair<Nanoseconds, telemetry_protocol::Counters>> counters;
+  std::vector<telemetry_protocol::Decision> decisions;
+  size_t bad_telemetry = 0;
+  main_chip.usb().SetInListener(
+      [&](uint8_t endpoint, std::span<const uint8_t> data) {
+        if (endpoint == 0) {
+          std::vector<uint8_t>& read = descriptor_reads[descriptor_read].data;
+          read.insert(read.end(), data.begin(), data.end());
+          return;
+        }
+        if (endpoint == telemetry_protocol::kEndPoint) {
+          if (data.size() == sizeof(telemetry_protocol::Counters) &&
+              data[0] == telemetry_protocol::kPacketCounters) {
+            counters.emplace_back(simulator.now(),
+                                  telemetry_protocol::Counters());
+            memcpy(&counters.back().second, data.data(), data.size());
+          } else if (data.size() == sizeof(telemetry_protocol::Decision) &&
+                     data[0] == telemetry_protocol::kPacketDecision) {
+            memcpy(&decisions.emplace_back(), data.data(), data.size());
+          } else {
+            ++bad_telemetry;
+          }
+          return;
+        }
+        if (endpoint != kKeyboardEndpoint) {
+          return;
+        }
+        ++reports;
+        std::optional<std::set<uint8_t>> keys =
+            host::DecodeKeyboardReport(data);
+        bool boot_report = data.size() == 8;
+        if (!keys || boot_report != boot_protocol) {
+          ++bad_reports;
+          return;
+        }
+        for (uint8_t key : *keys) {
+          if (!pressed.contains(key)) {
+            presses.push_back({simulator.now(), key});
+          }
+        }
+        pressed = *keys;
+      });
+  for (size_t i = 0; i < descriptor_reads.size(); ++i) {
+    simulator.Schedule((20 + 5 * i) * host::kMillisecond, [&, i] {
+      descriptor_read = i;
+      std::array<uint8_t, 8> request = host::GetDescriptorRequest(
+          descriptor_reads[i].type, descriptor_reads[i].index, 0xff);
+      main_chip.usb().SendSetup(request);
+    });
+  }
+  // Starts the telemetry stream with decisions, and resets the counters before
+  // the first stroke.
+  simulator.Schedule(60 * host::kMillisecond, [&] {
+    telemetry_protocol::StreamCommand command = {
+        .command = telemetry_protocol::kCommandStream,
+        .flags = telemetry_protocol::kStreamDecisions,
+        .period_ms = kTelemetryPeriodMs};
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&command);
+    main_chip.usb().SendOut(telemetry_protocol::kEndPoint,
+                            {bytes, bytes + sizeof(command)});
+  });
+  // The packets taken until the counters are reset.
+  size_t counters_before_reset = 0;
+  simulator.Schedule(120 * host::kMillisecond, [&] {
+    counters_before_reset = counters.size();
+    main_chip.usb().SendOut(telemetry_protocol::kEndPoint,
+                            {telemetry_protocol::kCommandResetCounters});
+  });
+  if (boot_protocol) {
+    simulator.Schedule(50 * host::kMillisecond, [&] {
+      main_chip.usb().SendSetup(std::span<const uint8_t, 8>(
+          host::kSetBootProtocol, 8));
+    });
+  }
+
+  // Dial index, position; strokes on different dials overlap.
+  std::vector<Stroke> strokes = {
+      {0, 5, 150 * host::kMillisecond},  {1, 2, 250 * host::kMillisecond},
+      {3, 2, 400 * host::kMillisecond},  {4, 3, 550 * host::kMillisecond},
+      {5, 2, 700 * host::kMillisecond},  {6, 1, 850 * host::kMillisecond},
+      {7, 2, 1000 * host::kMillisecond}, {8, 4, 1150 * host::kMillisecond},
+      {0, 20, 1300 * host::kMillisecond},
+  };
+  DialWaveform::StrokeProfile profile;
+  std::vector<DialWaveform::StrokeTiming> timings;
+  Nanoseconds end = 0;
+  for (const auto& stroke : strokes) {
+    timings.push_back(waveforms[stroke.dial]->AddStroke(
+        stroke.start, stroke.position, profile));
+    end = std::max(end, timings.back().back);
+  }
+  // The dial E, back from its stroke, stays at 4 long enough to be decided
+  // early, backs off by one, and turns on to 6 before it is let go. Built with
+  // DIAL_EARLY_COMMIT, it types both, and otherwise 6 alone.
+  constexpr size_t kDialE = 4;
+  const Nanoseconds turn_on_start = 1000 * host::kMillisecond;
+  const DialWaveform::Keyframe turn_on[] = {
+      {40 * host::kMillisecond, 4.5},  {80 * host::kMillisecond, 4.5},
+      {100 * host::kMillisecond, 3.5}, {130 * host::kMillisecond, 6.5},
+      {170 * host::kMillisecond, 6.5}, {290 * host::kMillisecond, 0},
+  };
+  waveforms[kDialE]->AddProfile(turn_on_start, turn_on);
+  Nanoseconds turn_on_back = turn_on_start + 290 * host::kMillisecond;
+  if (early_commit) {
+    strokes.push_back({kDialE, 4, turn_on_start});
+    timings.push_back({turn_on_start + 80 * host::kMillisecond, turn_on_back});
+  }
+  strokes.push_back({kDialE, 6, turn_on_start});
+  timings.push_back({turn_on_start + 170 * host::kMillisecond, turn_on_back});
+  end = std::max(end, turn_on_back);
+  // All dials are back at the base for the last 200 ms; the bus traffic is
+  // measured from 50 ms into that.
+  Nanoseconds idle_start = end + 50 * host::kMillisecond;
+  end += 200 * host::kMillisecond;
+  uint64_t idle_start_bytes = 0;
+  simulator.Schedule(idle_start, [&] {
+    idle_start_bytes = main_chip.i2c_bus(0)->bytes();
+  });
+
+  // Sensor misreads shorter than the main loop period, that must not make
+  // keys: at the base, and one jumping far ahead while dial A is held at 5.
+  const std::vector<Glitch> glitches = {
+      {1, 0b01, 120 * host::kMillisecond},
+      {0, 20 ^ (20 >> 1), 210 * host::kMillisecond},
+      {7, 0b11, 900 * host::kMillisecond},
+  };
+  for (const auto& glitch : glitches) {
+    waveforms[glitch.dial]->AddGlitch(glitch.time, glitch.gray,
+                                      100 * host::kMicrosecond);
+  }
+
+  // From shortly before the dial H is back at the base, through its key
+  // report, the sub's motor stop and the idle polls after them.
+  std::optional<host::TraceCapture> trace_capture;
+  if (trace_path) {
+    for (size_t i = 0; i < strokes.size(); ++i) {
+      if (strokes[i].dial == kDialH) {
+        trace_capture.emplace(simulator,
+                              timings[i].back - 5 * host::kMillisecond,
+                              timings[i].back + 20 * host::kMillisecond);
+      }
+    }
+  }
+
+  auto wall_start = std::chrono::steady_clock::now();
+  simulator.RunUntil(end);
+  auto wall_time = std::chrono::steady_clock::now() - wall_start;
+
+  int failures = 0;
+  printf("simulated %.3f s in %.3f s of host time\n", end / 1e9,
+         std::chrono::duration<double>(wall_time).count());
+  if (!loop_periods.empty()) {
+    Nanoseconds total = 0;
+    for (Nanoseconds period : loop_periods) {
+      total += period;
+    }
+    printf(
+        "main loop: %zu iterations, period mean %.1f us, p50 %.1f us, "
+        "p99 %.1f us, max %.1f us, host CPU %.2f us/iteration\n",
+        loop_periods.size(), ToUs(total / loop_periods.size()),
+        ToUs(Percentile(loop_periods, 50)), ToUs(Percentile(loop_periods, 99)),
+        ToUs(*std::max_element(loop_periods.begin(), loop_periods.end())),
+        ToUs(main_chip.cpu_time() / loop_periods.size()));
+  }
+  printf("main: core0 asleep %.1f%% of the time",
+         100.0 * main_chip.core(0).sleep_time() / end);
+  if (dual_core) {
+    printf(", core1 %.1f%%", 100.0 * main_chip.core(1).sleep_time() / end);
+  }
+  printf("\n");
+  const host::I2CBus& bus = *main_chip.i2c_bus(0);
+  printf(
+      "i2c: %llu transfers, %llu data bytes, %.0f bytes/s, idle %.0f "
+      "bytes/s\n",
+      static_cast<unsigned long long>(bus.transfers()),
+      static_cast<unsigned long long>(bus.bytes()), bus.bytes() / (end / 1e9),
+      (bus.bytes() - idle_start_bytes) / ((end - idle_start) / 1e9));
+
+  if (!host::CheckHeaps(simulator)) {
+    ++failures;
+  }
+  if (trace_path) {
+    if (!trace_capture->Write(trace_path)) {
+      printf("trace: cannot write %s\n", trace_path);
+      ++failures;
+    } else if (trace_capture->overwritten()) {
+      printf("trace: %lu events overwritten before they were taken\n",
+             static_cast<unsigned long>(trace_capture->overwritten()));
+      ++failures;
+    }
+  }
+  if (!CheckDescriptors(descriptor_reads,
+                        usb_1ms ? 1 : kKeyboardPollIntervalInFrames)) {
+    ++failures;
+  }
+  printf("usb: %zu keyboard reports in the %s protocol", reports,
+         boot_protocol ? "boot" : "report");
+  if (bad_reports) {
+    printf(", %zu in another format", bad_reports);
+    ++failures;
+  }
+  printf("\n");
+  if (!CheckTelemetry(counters, counters_before_reset, decisions, strokes,
+                      end) ||
+      bad_telemetry) {
+    ++failures;
+  }
+
+  for (size_t i = 0; i < strokes.size(); ++i) {
+    const DialSpec& dial = kDials[strokes[i].dial];
+    uint8_t usage = keymap::Lookup(keymap::kLayerBase, dial.keymap_dial,
+                                   strokes[i].position)
+                        .value;
+    auto it = std::find_if(presses.begin(), presses.end(),
+                           [&](const KeyEvent& event) {
+                             return !event.matched && event.usage == usage &&
+                                    event.time >= timings[i].release;
+                           });
+    if (it == presses.end()) {
+      printf("dial %s position %d: usage $%02x missing\n", dial.name,
+             strokes[i].position, usage);
+      ++failures;
+      continue;
+    }
+    it->matched = true;
+    printf(
+        "dial %s position %2d: usage $%02x, latency %.1f ms from release, "
+        "%.1f ms from base\n",
+        dial.name, strokes[i].position, usage,
+        ToMs(it->time - timings[i].release),
+        ToMs(it->time - std::min(it->time, timings[i].back)));
+  }
+  // The motor of the dial H runs for its only stroke, until it is back. The
+  // coils may be off between two steps as it stops, so the last step counts.
+  constexpr Nanoseconds kMotorStopMargin = 1 * host::kMillisecond;
+  for (size_t i = 0; i < strokes.size(); ++i) {
+    if (strokes[i].dial != kDialH) {
+      continue;
+    }
+    if (!motor_h_step || !motor_h_off || *motor_h_off < *motor_h_step ||
+        *motor_h_step > timings[i].back + kMotorStopMargin) {
+      printf("dial H: motor did not stop after the dial was back\n");
+      ++failures;
+      continue;
+    }
+    printf("dial H: motor stepped last %.1f ms from the dial back\n",
+           ToMs(*motor_h_step) - ToMs(timings[i].back));
+  }
+  for (const auto& event : presses) {
+    if (!event.matched) {
+      printf("unexpected usage $%02x at %.3f ms\n", event.usage,
+             ToMs(event.time));
+      ++failures;
+    }
+  }
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,317 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+// Reads the telemetry of a board running main built with DIAL_USB_TELEMETRY,
+// see common/telemetry_protocol.h, over its vendor interface with libusb:
+//
+//   dial_telemetry [--period MS] [--decisions] [--reset] [--count N]
+//   dial_telemetry --keymap FILE
+//
+//   --period MS   how often main sends its counters, 1000 ms by default.
+//   --decisions   also prints each decided position as it is queued.
+//   --reset       zeroes the counters first.
+//   --count N     exits after N counters packets.
+//
+// Prints a line per counters packet, with the rates since the previous one,
+// until --count or Ctrl-C, and stops the stream on exit. The keyboard keeps
+// working meanwhile; only the vendor interface is claimed.
+//
+// With --keymap, writes FILE, from layout_compiler --binary, to a board built
+// with DIAL_KEYMAP_STORE, prints the keymap it then has, and exits. An empty
+// FILE goes back to the built-in keymap.
+
+#include <libusb.h>
+
+#include <algorithm>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <vector>
+
+#include "../common/keymap.h"
+#include "../common/telemetry_protocol.h"
+
+namespace {
+
+// Must match main/main.cc.
+constexpr uint16_t kVendorId = 0x6666;
+constexpr uint16_t kProductId = 0x2025;
+
+constexpr unsigned kTimeoutMs = 100;
+// A keymap is committed to flash within this time, even with a sector to
+// erase.
+constexpr unsigned kKeymapTimeoutMs = 2000;
+
+// By KeymapStore::Status.
+constexpr const char* kKeymapStatusNames[] = {
+    "ok", "bad size", "bad CRC", "not a layout", "flash error"};
+
+volatile std::sig_atomic_t sStop = 0;
+
+bool SendCommand(libusb_device_handle* handle, const void* command,
+                 int size) {
+  int sent = 0;
+  int result = libusb_bulk_transfer(
+      handle, LIBUSB_ENDPOINT_OUT | telemetry_protocol::kEndPoint,
+      static_cast<unsigned char*>(const_cast<void*>(command)), size, &sent,
+      kTimeoutMs * 10);
+  if (result != 0 || sent != size) {
+    fprintf(stderr, "cannot send a command: %s\n", libusb_error_name(result));
+    return false;
+  }
+  return true;
+}
+
+bool Stream(libusb_device_handle* handle, uint8_t flags, uint16_t period_ms) {
+  telemetry_protocol::StreamCommand command = {
+      .command = telemetry_protocol::kCommandStream,
+      .flags = flags,
+      .period_ms = period_ms};
+  return SendCommand(handle, &command, sizeof(command));
+}
+
+void PrintCounters(const telemetry_protocol::Counters& counters,
+                   const std::optional<telemetry_protocol::Counters>& last) {
+  printf("%10.3f s #%-5u", counters.time_us / 1e6,
+         static_cast<unsigned>(counters.sequence));
+  double seconds =
+      last ? static_cast<uint32_t>(counters.time_us - last->time_us) / 1e6 : 0;
+  if (last && seconds > 0 &&
+      static_cast<uint16_t>(last->sequence + 1) == counters.sequence) {
+    printf(" %9.0f loops/s %6.0f i2c/s",
+           static_cast<uint32_t>(counters.loops - last->loops) / seconds,
+           static_cast<uint32_t>(counters.i2c_transactions -
+                                 last->i2c_transactions) /
+               seconds);
+  } else {
+    printf(" %9s loops/s %6s i2c/s", "-", "-");
+  }
+  printf(
+      " %lu i2c failed, queue %u, dropped %lu events %lu positions %u "
+      "packets, decided",
+      static_cast<unsigned long>(counters.i2c_failures),
+      static_cast<unsigned>(counters.report_queue_depth),
+      static_cast<unsigned long>(counters.dropped_events),
+      static_cast<unsigned long>(counters.dropped_positions),
+      static_cast<unsigned>(counters.dropped_packets));
+  for (size_t dial = 0;
+       dial < counters.num_dials && dial < counters.decided_counts.size();
+       ++dial) {
+    printf(" %u", static_cast<unsigned>(counters.decided_counts[dial]));
+  }
+  printf("\n");
+}
+
+void PrintDecision(const telemetry_protocol::Decision& decision) {
+  printf("%10.3f s dial %u position %u, queued %lu us after it was decided\n",
+         decision.queued_time_us / 1e6, static_cast<unsigned>(decision.dial),
+         static_cast<unsigned>(decision.position),
+         static_cast<unsigned long>(decision.queued_time_us -
+                                    decision.decided_time_us));
+}
+
+// Writes the keymap in `path`, and prints the status main answers with.
+bool WriteKeymap(libusb_device_handle* handle, const char* path) {
+  using namespace telemetry_protocol;
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    fprintf(stderr, "%s: cannot read\n", path);
+    return false;
+  }
+  std::vector<uint8_t> keymap((std::istreambuf_iterator<char>(in)),
+                              std::istreambuf_iterator<char>());
+  if (keymap.size() > 0xffff) {
+    fprintf(stderr, "%s: too large for a keymap\n", path);
+    return false;
+  }
+
+  KeymapBegin begin = {.command = kCommandKeymapBegin,
+                       .reserved = 0,
+                       .size = static_cast<uint16_t>(keymap.size())};
+  if (!SendCommand(handle, &begin, sizeof(begin))) {
+    return false;
+  }
+  for (size_t offset = 0; offset < keymap.size();) {
+    KeymapData data = {.command = kCommandKeymapData,
+                       .reserved = 0,
+                       .offset = static_cast<uint16_t>(offset),
+                       .data = {}};
+    size_t size = std::min(data.data.size(), keymap.size() - offset);
+    memcpy(data.data.data(), keymap.data() + offset, size);
+    if (!SendCommand(handle, &data, offsetof(KeymapData, data) + size)) {
+      return false;
+    }
+    offset += size;
+  }
+  KeymapCommit commit = {
+      .command = kCommandKeymapCommit,
+      .reserved = {},
+      .crc = keymap::Crc32(keymap.data(), keymap.size())};
+  if (!SendCommand(handle, &commit, sizeof(commit))) {
+    return false;
+  }
+
+  // Main answers the first command that fails, or the commit.
+  for (unsigned waited_ms = 0; waited_ms < kKeymapTimeoutMs;
+       waited_ms += kTimeoutMs) {
+    unsigned char packet[kPacketSize];
+    int length = 0;
+    int result = libusb_bulk_transfer(handle, LIBUSB_ENDPOINT_IN | kEndPoint,
+                                      packet, sizeof(packet), &length,
+                                      kTimeoutMs);
+    if (result == LIBUSB_ERROR_TIMEOUT) {
+      continue;
+    }
+    if (result != 0) {
+      fprintf(stderr, "cannot read: %s\n", libusb_error_name(result));
+      return false;
+    }
+    if (length != sizeof(KeymapStatus) || packet[0] != kPacketKeymapStatus) {
+      continue;
+    }
+    KeymapStatus status;
+    memcpy(&status, packet, sizeof(status));
+    printf("%s; keymap #%lu of %u bytes, CRC %08lx\n",
+           status.status < std::size(kKeymapStatusNames)
+               ? kKeymapStatusNames[status.status]
+               : "unknown status",
+           static_cast<unsigned long>(status.sequence),
+           static_cast<unsigned>(status.size),
+           static_cast<unsigned long>(status.crc));
+    return status.status == 0;
+  }
+  fprintf(stderr, "no answer to the keymap; is main built with "
+                  "DIAL_KEYMAP_STORE?\n");
+  return false;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  unsigned long period_ms = 1000;
+  bool decisions = false;
+  bool reset = false;
+  unsigned long count = 0;
+  const char* keymap_path = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--period") && i + 1 < argc) {
+      period_ms = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp(argv[i], "--decisions")) {
+      decisions = true;
+    } else if (!strcmp(argv[i], "--reset")) {
+      reset = true;
+    } else if (!strcmp(argv[i], "--count") && i + 1 < argc) {
+      count = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp(argv[i], "--keymap") && i + 1 < argc) {
+      keymap_path = argv[++i];
+    } else {
+      fprintf(stderr,
+              "usage: %s [--period MS] [--decisions] [--reset] [--count N]\n"
+              "       %s --keymap FILE\n",
+              argv[0], argv[0]);
+      return 2;
+    }
+  }
+  if (period_ms < telemetry_protocol::kMinPeriodMs || period_ms > 0xffff) {
+    fprintf(stderr, "--period must be from %u to 65535 ms\n",
+            static_cast<unsigned>(telemetry_protocol::kMinPeriodMs));
+    return 2;
+  }
+
+  if (libusb_init(nullptr) != 0) {
+    fprintf(stderr, "cannot initialize libusb\n");
+    return 1;
+  }
+  libusb_device_handle* handle =
+      libusb_open_device_with_vid_pid(nullptr, kVendorId, kProductId);
+  if (!handle) {
+    fprintf(stderr, "no board at %04x:%04x, or no permission to open it\n",
+            kVendorId, kProductId);
+    libusb_exit(nullptr);
+    return 1;
+  }
+  libusb_set_auto_detach_kernel_driver(handle, 1);
+  int result =
+      libusb_claim_interface(handle, telemetry_protocol::kInterfaceNumber);
+  if (result != 0) {
+    fprintf(stderr,
+            "cannot claim the telemetry interface: %s; is main built with "
+            "DIAL_USB_TELEMETRY?\n",
+            libusb_error_name(result));
+    libusb_close(handle);
+    libusb_exit(nullptr);
+    return 1;
+  }
+
+  if (keymap_path) {
+    int status = WriteKeymap(handle, keymap_path) ? 0 : 1;
+    libusb_release_interface(handle, telemetry_protocol::kInterfaceNumber);
+    libusb_close(handle);
+    libusb_exit(nullptr);
+    return status;
+  }
+
+  std::signal(SIGINT, [](int) { sStop = 1; });
+  int status = 0;
+  uint8_t command = telemetry_protocol::kCommandResetCounters;
+  if ((reset && !SendCommand(handle, &command, sizeof(command))) ||
+      !Stream(handle, decisions ? telemetry_protocol::kStreamDecisions : 0,
+              period_ms)) {
+    status = 1;
+    sStop = 1;
+  }
+
+  std::optional<telemetry_protocol::Counters> last;
+  unsigned long num_counters = 0;
+  while (!sStop && (!count || num_counters < count)) {
+    unsigned char packet[telemetry_protocol::kPacketSize];
+    int length = 0;
+    result = libusb_bulk_transfer(
+        handle, LIBUSB_ENDPOINT_IN | telemetry_protocol::kEndPoint, packet,
+        sizeof(packet), &length, kTimeoutMs);
+    if (result == LIBUSB_ERROR_TIMEOUT || result == LIBUSB_ERROR_INTERRUPTED) {
+      continue;
+    }
+    if (result != 0) {
+      fprintf(stderr, "cannot read: %s\n", libusb_error_name(result));
+      status = 1;
+      break;
+    }
+    if (length == sizeof(telemetry_protocol::Counters) &&
+        packet[0] == telemetry_protocol::kPacketCounters) {
+      telemetry_protocol::Counters counters;
+      memcpy(&counters, packet, sizeof(counters));
+      if (counters.version != telemetry_protocol::kVersion) {
+        fprintf(stderr, "telemetry version %u, %u expected\n",
+                static_cast<unsigned>(counters.version),
+                static_cast<unsigned>(telemetry_protocol::kVersion));
+        status = 1;
+        break;
+      }
+      PrintCounters(counters, last);
+      last = counters;
+      ++num_counters;
+    } else if (length == sizeof(telemetry_protocol::Decision) &&
+               packet[0] == telemetry_protocol::kPacketDecision) {
+      telemetry_protocol::Decision decision;
+      memcpy(&decision, packet, sizeof(decision));
+      PrintDecision(decision);
+    } else {
+      fprintf(stderr, "unknown packet of %d bytes\n", length);
+    }
+    fflush(stdout);
+  }
+
+  Stream(handle, 0, 0);
+  libusb_release_interface(handle, telemetry_protocol::kInterfaceNumber);
+  libusb_close(handle);
+  libusb_exit(nullptr);
+  return status;
+}
@@ -0,0 +1,83 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#include "dial_waveform.h"
+
+#include <algorithm>
+
+namespace host {
+
+DialWaveform::DialWaveform(Chip& chip, std::vector<uint8_t> gpios)
+    : chip_(chip), gpios_(std::move(gpios)) {
+  Drive(0);
+}
+
+void DialWaveform::SetPosition(Nanoseconds time, uint8_t position) {
+  chip_.simulator().Schedule(time, [this, position] { Drive(position); });
+}
+
+DialWaveform::StrokeTiming DialWaveform::AddStroke(
+    Nanoseconds start,
+    uint8_t position,
+    const StrokeProfile& profile) {
+  Nanoseconds time = start;
+  for (uint8_t p = 1; p <= position; ++p) {
+    SetPosition(time, p);
+    time += profile.turn_per_position;
+  }
+  StrokeTiming timing;
+  timing.release = time + profile.hold;
+  time = timing.release;
+  for (uint8_t p = position; p > 0; --p) {
+    time += profile.return_per_position;
+    SetPosition(time, p - 1);
+  }
+  timing.back = time;
+  return timing;
+}
+
+uint8_t DialWaveform::AddProfile(Nanoseconds start,
+                                 std::span<const Keyframe> keyframes) {
+  Keyframe from = {0, 0};
+  uint8_t max = 0;
+  for (const Keyframe& to : keyframes) {
+    double angle = std::clamp(to.angle, 0.0, max_position() + 0.5);
+    double duration = to.time - from.time;
+    // The times the angle crosses each boundary between two positions.
+    for (int b = static_cast<int>(from.angle) + 1; b <= angle; ++b) {
+      SetPosition(start + from.time +
+                      (b - from.angle) / (angle - from.angle) * duration,
+                  b);
+    }
+    for (int b = static_cast<int>(from.angle); b > angle; --b) {
+      SetPosition(start + from.time +
+                      (from.angle - b) / (from.angle - angle) * duration,
+                  b - 1);
+    }
+    max = std::max(max, static_cast<uint8_t>(angle));
+    from = {to.time, angle};
+  }
+  return max;
+}
+
+void DialWaveform::AddGlitch(Nanoseconds time,
+                             uint8_t gray,
+                             Nanoseconds duration) {
+  Simulator& simulator = chip_.simulator();
+  simulator.Schedule(time, [this, gray] { DriveCode(gray); });
+  simulator.Schedule(time + duration, [this] { Drive(position_); });
+}
+
+void DialWaveform::Drive(uint8_t position) {
+  position_ = position;
+  DriveCode(position ^ (position >> 1));
+}
+
+void DialWaveform::DriveCode(uint8_t gray) {
+  for (size_t bit = 0; bit < gpios_.size(); ++bit) {
+    chip_.DriveInput(gpios_[bit], gray & (1u << bit));
+  }
+}
+
+}  // namespace host
@@ -0,0 +1,79 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_DIAL_WAVEFORM_H_
+#define HOST_DIAL_WAVEFORM_H_
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "simulator.h"
+
+namespace host {
+
+// Drives the photo sensor pins of one dial with the Gray code of the dial
+// position, as the encoder disc does on the real board.
+class DialWaveform final {
+ public:
+  // How a user turns the dial, per position travelled.
+  struct StrokeProfile {
+    Nanoseconds turn_per_position = 10 * kMillisecond;
+    Nanoseconds hold = 30 * kMillisecond;
+    Nanoseconds return_per_position = 20 * kMillisecond;
+  };
+
+  // A point of an angle-versus-time profile: the dial is `angle` positions
+  // from the base at `time` from the start of the stroke. The sensors show
+  // the position the angle is in.
+  struct Keyframe {
+    Nanoseconds time;
+    double angle;
+  };
+
+  struct StrokeTiming {
+    // When the user lets the dial go at the turn-around point.
+    Nanoseconds release;
+    // When the dial is back at the base position.
+    Nanoseconds back;
+  };
+
+  // `gpios` lists the sensor pins from the least significant bit.
+  DialWaveform(Chip& chip, std::vector<uint8_t> gpios);
+  DialWaveform(const DialWaveform&) = delete;
+  DialWaveform& operator=(const DialWaveform&) = delete;
+  ~DialWaveform() = default;
+
+  uint8_t max_position() const { return (1u << gpios_.size()) - 1; }
+
+  // Shows `position` on the sensor pins from `time` on.
+  void SetPosition(Nanoseconds time, uint8_t position);
+
+  // Turns the dial from the base to `position` starting at `start`, and lets
+  // it return to the base.
+  StrokeTiming AddStroke(Nanoseconds start,
+                         uint8_t position,
+                         const StrokeProfile& profile);
+
+  // Turns the dial from the base at `start` through `keyframes`, at a constant
+  // speed between each two, and leaves it at the last one. Returns the
+  // highest position it passed.
+  uint8_t AddProfile(Nanoseconds start, std::span<const Keyframe> keyframes);
+
+  // Shows the raw sensor code `gray` from `time` for `duration`, as a
+  // misaligned mark or noise would, and then the dial position again.
+  void AddGlitch(Nanoseconds time, uint8_t gray, Nanoseconds duration);
+
+ private:
+  void Drive(uint8_t position);
+  void DriveCode(uint8_t gray);
+
+  Chip& chip_;
+  const std::vector<uint8_t> gpios_;
+  uint8_t position_ = 0;
+};
+
+}  // namespace host
+
+#endif  // HOST_DIAL_WAVEFORM_H_
@@ -0,0 +1,44 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#include "flash_model.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+namespace host {
+
+FlashModel::FlashModel()
+    : data_(kSize, 0xff), erase_counts_(kSize / kSectorSize, 0) {}
+
+Nanoseconds FlashModel::Erase(uint32_t offset, size_t count) {
+  if (offset % kSectorSize || count % kSectorSize || offset + count > kSize) {
+    fprintf(stderr, "flash: erase of %zu bytes at %06x is not of sectors\n",
+            count, static_cast<unsigned>(offset));
+    abort();
+  }
+  std::fill(data_.begin() + offset, data_.begin() + offset + count, 0xff);
+  for (size_t sector = offset / kSectorSize;
+       sector < (offset + count) / kSectorSize; ++sector) {
+    ++erase_counts_[sector];
+  }
+  return count / kSectorSize * kSectorEraseTime;
+}
+
+Nanoseconds FlashModel::Program(uint32_t offset,
+                                std::span<const uint8_t> data) {
+  if (offset % kPageSize || data.size() % kPageSize ||
+      offset + data.size() > kSize) {
+    fprintf(stderr, "flash: program of %zu bytes at %06x is not of pages\n",
+            data.size(), static_cast<unsigned>(offset));
+    abort();
+  }
+  for (size_t i = 0; i < data.size(); ++i) {
+    data_[offset + i] &= data[i];
+  }
+  return data.size() / kPageSize * kPageProgramTime;
+}
+
+}  // namespace host
@@ -0,0 +1,53 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_FLASH_MODEL_H_
+#define HOST_FLASH_MODEL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "simulator.h"
+
+namespace host {
+
+// The QSPI flash of one chip, as NOR flash: erasing sets a sector to 0xff,
+// and programming only clears bits, so a page programmed twice without an
+// erase reads as the AND of both. It starts erased, and is read in place
+// through XIP_BASE. Erases are counted per sector, to check wear levelling.
+class FlashModel final {
+ public:
+  static constexpr size_t kSize = 2 * 1024 * 1024;
+  static constexpr size_t kSectorSize = 4096;
+  static constexpr size_t kPageSize = 256;
+  // Typical times of a W25Q16JV.
+  static constexpr Nanoseconds kSectorEraseTime = 45 * kMillisecond;
+  static constexpr Nanoseconds kPageProgramTime = 400 * kMicrosecond;
+
+  FlashModel();
+  FlashModel(const FlashModel&) = delete;
+  FlashModel& operator=(const FlashModel&) = delete;
+  ~FlashModel() = default;
+
+  const uint8_t* data() const { return data_.data(); }
+  // The whole flash, e.g. to carry it over to a chip of another simulation
+  // as a reset would, or to tear a write.
+  std::vector<uint8_t>& contents() { return data_; }
+  const std::vector<size_t>& erase_counts() const { return erase_counts_; }
+
+  // As flash_range_erase() and flash_range_program(); return the time taken.
+  // Misaligned ranges abort.
+  Nanoseconds Erase(uint32_t offset, size_t count);
+  Nanoseconds Program(uint32_t offset, std::span<const uint8_t> data);
+
+ private:
+  std::vector<uint8_t> data_;
+  std::vector<size_t> erase_counts_;
+};
+
+}  // namespace host
+
+#endif  // HOST_FLASH_MODEL_H_
@@ -0,0 +1,531 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+// Stand-in Pico SDK functions. Each call is forwarded to the chip executing
+// it and charged an approximate cost on the virtual clock, based on a
+// 125 MHz system clock.
+
+#include <cstdio>
+#include <cstdlib>
+#include <span>
+
+#include "flash_model.h"
+#include "hardware/flash.h"
+#include "hardware/gpio.h"
+#include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "hardware/regs/addressmap.h"
+#include "hardware/resets.h"
+#include "hardware/structs/usb.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "hardware/uart.h"
+#include "i2c_bus.h"
+#include "i2c_controller_model.h"
+#include "pico/flash.h"
+#include "pico/i2c_slave.h"
+#include "pico/multicore.h"
+#include "pico/stdlib.h"
+#include "pico/time.h"
+#include "pico/unique_id.h"
+#include "simulator.h"
+#include "usb_controller_model.h"
+
+using host::Chip;
+using host::I2CBus;
+using host::Nanoseconds;
+
+namespace {
+
+constexpr Nanoseconds kCycle = 8;  // 125 MHz
+
+// Approximate costs of SDK calls, including the call overhead.
+constexpr Nanoseconds kGpioAccessCost = 4 * kCycle;
+constexpr Nanoseconds kGpioConfigCost = 40 * kCycle;
+constexpr Nanoseconds kI2CSetupCost = 200 * kCycle;
+constexpr Nanoseconds kTimerSetupCost = 200 * kCycle;
+constexpr Nanoseconds kTimerReadCost = 8 * kCycle;
+constexpr Nanoseconds kFifoAccessCost = 4 * kCycle;
+constexpr Nanoseconds kCoreLaunchCost = 1000 * kCycle;
+// Exception entry and exit, and the SDK's GPIO IRQ dispatch.
+constexpr Nanoseconds kGpioIrqCost = 60 * kCycle;
+// Exception entry and exit for a handler installed directly.
+constexpr Nanoseconds kIrqCost = 30 * kCycle;
+
+Chip& CurrentChip() {
+  return Chip::Current();
+}
+
+uint32_t GpioMask(uint gpio) {
+  return gpio < Chip::kNumOfGpios ? 1u << gpio : 0u;
+}
+
+}  // namespace
+
+i2c_inst_t i2c0_inst = {0};
+i2c_inst_t i2c1_inst = {1};
+uart_inst_t uart0_inst = {0};
+uart_inst_t uart1_inst = {1};
+
+void host_hard_assert_failed(const char* expression,
+                             const char* file,
+                             int line) {
+  fprintf(stderr, "%s: hard_assert(%s) failed at %s:%d\n",
+          CurrentChip().name().c_str(), expression, file, line);
+  abort();
+}
+
+// pico/stdio.h
+
+bool stdio_init_all() {
+  return true;
+}
+
+int getchar_timeout_us(uint32_t) {
+  return -1;  // PICO_ERROR_TIMEOUT
+}
+
+// pico/stdlib.h
+
+void tight_loop_contents() {
+  CurrentChip().WaitForEvent();
+}
+
+uint get_core_num() {
+  host::Core* core = CurrentChip().current_core();
+  return core ? core->index() : 0;
+}
+
+uint __get_current_exception() {
+  constexpr uint kFirstIrqException = 16;
+  return CurrentChip().InInterrupt() ? kFirstIrqException : 0;
+}
+
+// pico/multicore.h
+
+void multicore_launch_core1(void (*entry)(void)) {
+  Chip& chip = CurrentChip();
+  chip.Consume(kCoreLaunchCost);
+  chip.LaunchCore1(entry);
+}
+
+bool multicore_fifo_rvalid() {
+  Chip& chip = CurrentChip();
+  chip.Consume(kFifoAccessCost);
+  return chip.FifoReadable();
+}
+
+bool multicore_fifo_wready() {
+  Chip& chip = CurrentChip();
+  chip.Consume(kFifoAccessCost);
+  return chip.FifoWritable();
+}
+
+void multicore_fifo_push_blocking(uint32_t data) {
+  // The SDK spins here; reads on the other core do not signal an event.
+  while (!multicore_fifo_wready()) {
+  }
+  Chip& chip = CurrentChip();
+  chip.Consume(kFifoAccessCost);
+  chip.FifoPush(data);
+  chip.SendEvent();
+}
+
+uint32_t multicore_fifo_pop_blocking() {
+  while (!multicore_fifo_rvalid()) {
+    __wfe();
+  }
+  Chip& chip = CurrentChip();
+  chip.Consume(kFifoAccessCost);
+  return chip.FifoPop();
+}
+
+bool multicore_fifo_pop_timeout_us(uint64_t timeout_us, uint32_t* out) {
+  absolute_time_t timeout = make_timeout_time_us(timeout_us);
+  while (!multicore_fifo_rvalid()) {
+    if (best_effort_wfe_or_timeout(timeout)) {
+      return false;
+    }
+  }
+  Chip& chip = CurrentChip();
+  chip.Consume(kFifoAccessCost);
+  *out = chip.FifoPop();
+  return true;
+}
+
+void multicore_fifo_drain() {
+  while (multicore_fifo_rvalid()) {
+    CurrentChip().FifoPop();
+  }
+}
+
+// pico/time.h and hardware/timer.h
+
+uint64_t time_us_64() {
+  Chip& chip = CurrentChip();
+  chip.Consume(kTimerReadCost);
+  return chip.time() / host::kMicrosecond;
+}
+
+uint32_t time_us_32() {
+  return static_cast<uint32_t>(time_us_64());
+}
+
+absolute_time_t get_absolute_time() {
+  return time_us_64();
+}
+
+uint64_t to_us_since_boot(absolute_time_t t) {
+  return t;
+}
+
+void busy_wait_us(uint64_t us) {
+  CurrentChip().Consume(us * host::kMicrosecond);
+}
+
+void sleep_us(uint64_t us) {
+  busy_wait_us(us);
+}
+
+void sleep_ms(uint32_t ms) {
+  busy_wait_us(static_cast<uint64_t>(ms) * 1000u);
+}
+
+absolute_time_t make_timeout_time_us(uint64_t us) {
+  return time_us_64() + us;
+}
+
+absolute_time_t make_timeout_time_ms(uint32_t ms) {
+  return make_timeout_time_us(static_cast<uint64_t>(ms) * 1000u);
+}
+
+bool time_reached(absolute_time_t t) {
+  return time_us_64() >= t;
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp) {
+  Chip& chip = CurrentChip();
+  uint64_t now = time_us_64();
+  if (now >= timeout_timestamp) {
+    return true;
+  }
+  // The SDK sets an alarm whose callback, on core 0, signals an event.
+  static int alarm_key[2];
+  void* key = &alarm_key[get_core_num()];
+  chip.Consume(kTimerSetupCost);
+  chip.AddRepeatingTimer(key, timeout_timestamp - now, [&chip] {
+    chip.SendEvent();
+    return false;
+  });
+  chip.Sleep(/*wfi=*/false);
+  chip.CancelRepeatingTimer(key);
+  return time_reached(timeout_timestamp);
+}
+
+bool add_repeating_timer_us(int64_t delay_us,
+                            repeating_timer_callback_t callback,
+                            void* user_data,
+                            repeating_timer_t* out) {
+  Chip& chip = CurrentChip();
+  chip.Consume(kTimerSetupCost);
+  out->delay_us = delay_us;
+  out->pool = nullptr;
+  out->alarm_id = 1;
+  out->callback = callback;
+  out->user_data = user_data;
+  chip.AddRepeatingTimer(out, delay_us, [out] { return out->callback(out); });
+  return true;
+}
+
+bool add_repeating_timer_ms(int32_t delay_ms,
+                            repeating_timer_callback_t callback,
+                            void* user_data,
+                            repeating_timer_t* out) {
+  return add_repeating_timer_us(static_cast<int64_t>(delay_ms) * 1000,
+                                callback, user_data, out);
+}
+
+bool cancel_repeating_timer(repeating_timer_t* timer) {
+  return CurrentChip().CancelRepeatingTimer(timer);
+}
+
+// hardware/gpio.h
+
+void gpio_init(uint gpio) {
+  Chip& chip = CurrentChip();
+  chip.Consume(kGpioConfigCost);
+  chip.GpioInit(gpio);
+}
+
+void gpio_set_function(uint gpio, gpio_function fn) {
+  CurrentChip().Consume(kGpioConfigCost);
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+  Chip& chip = CurrentChip();
+  chip.Consume(kGpioAccessCost);
+  chip.GpioSetDirection(gpio, out);
+}
+
+void gpio_pull_up(uint gpio) {
+  Chip& chip = CurrentChip();
+  chip.Consume(kGpioConfigCost);
+  chip.GpioSetPulls(gpio, /*up=*/true, /*down=*/false);
+}
+
+void gpio_pull_down(uint gpio) {
+  Chip& chip = CurrentChip();
+  chip.Consume(kGpioConfigCost);
+  chip.GpioSetPulls(gpio, /*up=*/false, /*down=*/true);
+}
+
+void gpio_disable_pulls(uint gpio) {
+  Chip& chip = CurrentChip();
+  chip.Consume(kGpioConfigCost);
+  chip.GpioSetPulls(gpio, /*up=*/false, /*down=*/false);
+}
+
+bool gpio_get(uint gpio) {
+  Chip& chip = CurrentChip();
+  chip.Consume(kGpioAccessCost);
+  return chip.GpioReadAll(GpioMask(gpio)) & GpioMask(gpio);
+}
+
+uint32_t gpio_get_all() {
+  Chip& chip = CurrentChip();
+  chip.Consume(kGpioAccessCost);
+  return chip.GpioReadAll((1u << Chip::kNumOfGpios) - 1);
+}
+
+void gpio_put(uint gpio, bool value) {
+  Chip& chip = CurrentChip();
+  chip.Consume(kGpioAccessCost);
+  chip.GpioWriteMasked(GpioMask(gpio), value ? GpioMask(gpio) : 0u);
+}
+
+void gpio_put_masked(uint32_t mask, uint32_t value) {
+  Chip& chip = CurrentChip();
+  chip.Consume(kGpioAccessCost);
+  chip.GpioWriteMasked(mask, value);
+}
+
+void gpio_set_mask(uint32_t mask) {
+  gpio_put_masked(mask, mask);
+}
+
+void gpio_clr_mask(uint32_t mask) {
+  gpio_put_masked(mask, 0u);
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled) {
+  Chip& chip = CurrentChip();
+  chip.Consume(kGpioAccessCost);
+  chip.GpioSetIrqEnabled(gpio, event_mask, enabled);
+}
+
+void gpio_set_irq_callback(gpio_irq_callback_t callback) {
+  Chip& chip = CurrentChip();
+  chip.SetGpioIrqHandler([&chip, callback](uint8_t gpio, uint32_t events) {
+    chip.Consume(kGpioIrqCost);
+    callback(gpio, events);
+  });
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio,
+                                        uint32_t event_mask,
+                                        bool enabled,
+                                        gpio_irq_callback_t callback) {
+  gpio_set_irq_enabled(gpio, event_mask, enabled);
+  gpio_set_irq_callback(callback);
+}
+
+// hardware/sync.h
+
+void __wfe() {
+  CurrentChip().Sleep(/*wfi=*/false);
+}
+
+void __wfi() {
+  CurrentChip().Sleep(/*wfi=*/true);
+}
+
+void __sev() {
+  CurrentChip().SendEvent();
+}
+
+uint32_t save_and_disable_interrupts() {
+  return CurrentChip().MaskInterrupts(true) ? 1 : 0;
+}
+
+void restore_interrupts(uint32_t status) {
+  CurrentChip().MaskInterrupts(status != 0);
+}
+
+// hardware/i2c.h and pico/i2c_slave.h
+
+uint i2c_init(i2c_inst_t* i2c, uint baudrate) {
+  Chip& chip = CurrentChip();
+  chip.Consume(kI2CSetupCost);
+  chip.set_i2c_baudrate(i2c->index, baudrate);
+  chip.i2c(i2c->index).Reset();
+  return baudrate;
+}
+
+int i2c_write_blocking(i2c_inst_t* i2c,
+                       uint8_t addr,
+                       const uint8_t* src,
+                       size_t len,
+                       bool nostop) {
+  Chip& chip = CurrentChip();
+  I2CBus* bus = chip.i2c_bus(i2c->index);
+  int result = bus ? bus->Write(addr, std::span<const uint8_t>(src, len)) : -1;
+  chip.Consume(I2CBus::TransferTime(chip.i2c_baudrate(i2c->index),
+                                    result < 0 ? 0 : len, !nostop));
+  return result < 0 ? PICO_ERROR_GENERIC : result;
+}
+
+int i2c_read_blocking(i2c_inst_t* i2c,
+                      uint8_t addr,
+                      uint8_t* dst,
+                      size_t len,
+                      bool nostop) {
+  Chip& chip = CurrentChip();
+  I2CBus* bus = chip.i2c_bus(i2c->index);
+  int result = bus ? bus->Read(addr, std::span<uint8_t>(dst, len)) : -1;
+  chip.Consume(I2CBus::TransferTime(chip.i2c_baudrate(i2c->index),
+                                    result < 0 ? 0 : len, !nostop));
+  return result < 0 ? PICO_ERROR_GENERIC : result;
+}
+
+uint8_t i2c_read_byte_raw(i2c_inst_t* i2c) {
+  I2CBus* bus = CurrentChip().i2c_bus(i2c->index);
+  return bus ? bus->ReadDataByte() : 0;
+}
+
+void i2c_write_byte_raw(i2c_inst_t* i2c, uint8_t value) {
+  I2CBus* bus = CurrentChip().i2c_bus(i2c->index);
+  if (bus) {
+    bus->WriteDataByte(value);
+  }
+}
+
+void i2c_slave_init(i2c_inst_t* i2c,
+                    uint8_t address,
+                    i2c_slave_handler_t handler) {
+  Chip& chip = CurrentChip();
+  chip.Consume(kI2CSetupCost);
+  I2CBus* bus = chip.i2c_bus(i2c->index);
+  if (!bus) {
+    return;
+  }
+  // The handler runs in the I2C interrupt of the core that initialized it.
+  uint8_t core = get_core_num();
+  bus->AddTarget(chip, address, [&chip, i2c, handler,
+                                 core](I2CBus::Event event) {
+    switch (event) {
+      case I2CBus::Event::kReceive:
+        handler(i2c, I2C_SLAVE_RECEIVE);
+        break;
+      case I2CBus::Event::kRequest:
+        handler(i2c, I2C_SLAVE_REQUEST);
+        break;
+      case I2CBus::Event::kFinish:
+        handler(i2c, I2C_SLAVE_FINISH);
+        break;
+    }
+    chip.WakeCore(core);
+  });
+}
+
+void i2c_set_slave_mode(i2c_inst_t* i2c, bool slave, uint8_t addr) {
+  Chip& chip = CurrentChip();
+  chip.Consume(kI2CSetupCost);
+  I2CBus* bus = chip.i2c_bus(i2c->index);
+  if (bus && slave) {
+    bus->SetTargetAddress(chip, addr);
+  }
+}
+
+// hardware/irq.h and hardware/resets.h
+
+void irq_set_enabled(uint num, bool enabled) {
+  if (num == USBCTRL_IRQ) {
+    CurrentChip().usb().SetIrqEnabled(enabled);
+  } else if (num == I2C0_IRQ || num == I2C1_IRQ) {
+    CurrentChip().i2c(num - I2C0_IRQ).SetIrqEnabled(enabled, get_core_num());
+  }
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+  // USBCTRL_IRQ is served by the isr_usbctrl symbol in the image.
+  if (num == I2C0_IRQ || num == I2C1_IRQ) {
+    CurrentChip().i2c(num - I2C0_IRQ).SetIrqHandler([handler] {
+      CurrentChip().Consume(kIrqCost);
+      handler();
+    });
+  }
+}
+
+void reset_unreset_block_num_wait_blocking(uint block_num) {
+  if (block_num == RESET_USBCTRL) {
+    CurrentChip().usb().Reset();
+  }
+}
+
+// hardware/flash.h and pico/flash.h
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+  Chip& chip = CurrentChip();
+  chip.Consume(chip.flash().Erase(flash_offs, count));
+}
+
+void flash_range_program(uint32_t flash_offs,
+                         const uint8_t* data,
+                         size_t count) {
+  Chip& chip = CurrentChip();
+  chip.Consume(chip.flash().Program(flash_offs, std::span(data, count)));
+}
+
+int flash_safe_execute(void (*func)(void*),
+                       void* param,
+                       uint32_t enter_exit_timeout_ms) {
+  Chip& chip = CurrentChip();
+  bool masked = chip.MaskInterrupts(true);
+  func(param);
+  chip.MaskInterrupts(masked);
+  return PICO_OK;
+}
+
+bool flash_safe_execute_core_init() {
+  return true;
+}
+
+uintptr_t host_xip_base() {
+  return reinterpret_cast<uintptr_t>(CurrentChip().flash().data());
+}
+
+// pico/unique_id.h
+
+void pico_get_unique_board_id(pico_unique_board_id_t* id_out) {
+  uint64_t id = CurrentChip().unique_id();
+  for (size_t i = 0; i < PICO_UNIQUE_BOARD_ID_SIZE_BYTES; ++i) {
+    id_out->id[i] = id >> (8 * (PICO_UNIQUE_BOARD_ID_SIZE_BYTES - 1 - i));
+  }
+}
+
+// hardware/structs/usb.h
+
+usb_hw_t* host_usb_hw() {
+  return CurrentChip().usb().hw();
+}
+
+usb_device_dpram_t* host_usb_dpram() {
+  return CurrentChip().usb().dpram();
+}
+
+// hardware/structs/i2c.h
+
+i2c_hw_t* host_i2c_hw(uint index) {
+  return CurrentChip().i2c(index).hw();
+}
@@ -0,0 +1,33 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#include "heap_check.h"
+
+#include <cstdio>
+
+#include "../common/heap_monitor.h"
+
+namespace host {
+
+bool CheckHeaps(const Simulator& simulator) {
+  bool ok = true;
+  for (const auto& chip : simulator.chips()) {
+    using StatsFunction = const heap_monitor::Stats* (*)();
+    auto stats_function = reinterpret_cast<StatsFunction>(
+        chip->FindSymbol("heap_monitor_stats"));
+    if (!stats_function) {
+      continue;
+    }
+    const heap_monitor::Stats& stats = *stats_function();
+    if (stats.isr_allocations) {
+      printf("%s: %lu heap allocations in interrupt handlers\n",
+             chip->name().c_str(),
+             static_cast<unsigned long>(stats.isr_allocations));
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+}  // namespace host
@@ -0,0 +1,19 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_HEAP_CHECK_H_
+#define HOST_HEAP_CHECK_H_
+
+#include "simulator.h"
+
+namespace host {
+
+// Reads the heap monitor of each chip's image, see common/heap_monitor.h, and
+// prints the chips that allocated in an interrupt handler. Returns false if
+// any did.
+bool CheckHeaps(const Simulator& simulator);
+
+}  // namespace host
+
+#endif  // HOST_HEAP_CHECK_H_
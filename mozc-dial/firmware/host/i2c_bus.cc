@@ -0,0 +1,131 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#include "i2c_bus.h"
+
+#include <algorithm>
+
+namespace host {
+
+// static
+Nanoseconds I2CBus::TransferTime(uint32_t baudrate, size_t bytes, bool stop) {
+  if (baudrate == 0) {
+    return 0;
+  }
+  // START, then 8 bits and an ACK for the address and every data byte.
+  uint64_t bits = 1 + 9 * (1 + bytes) + (stop ? 1 : 0);
+  return bits * kSecond / baudrate;
+}
+
+void I2CBus::AddTarget(Chip& chip, uint8_t address, Handler handler) {
+  targets_.push_back({&chip, address, std::move(handler)});
+}
+
+int I2CBus::Write(uint8_t address, std::span<const uint8_t> data) {
+  if (!Start(address)) {
+    return -1;
+  }
+  for (uint8_t byte : data) {
+    WriteByte(byte);
+  }
+  Stop();
+  return data.size();
+}
+
+int I2CBus::Read(uint8_t address, std::span<uint8_t> data) {
+  if (!Start(address)) {
+    return -1;
+  }
+  for (uint8_t& byte : data) {
+    byte = ReadByte();
+  }
+  Stop();
+  return data.size();
+}
+
+bool I2CBus::Start(uint8_t address) {
+  Stop();
+  for (auto& target : targets_) {
+    target.active = target.sending = target.address == address;
+    started_ = started_ || target.active;
+  }
+  if (!started_) {
+    return false;
+  }
+  address_ = address;
+  ++transfers_;
+  return true;
+}
+
+void I2CBus::WriteByte(uint8_t value) {
+  if (!started_) {
+    return;
+  }
+  ++bytes_;
+  for (auto& target : targets_) {
+    if (target.active) {
+      ScopedChipContext context(*target.chip);
+      data_ = value;
+      target.handler(Event::kReceive);
+    }
+  }
+  if (observer_) {
+    observer_(address_, Event::kReceive, value);
+  }
+}
+
+uint8_t I2CBus::ReadByte() {
+  if (!started_) {
+    return 0xff;
+  }
+  ++bytes_;
+  // The first bit where senders differ goes to a 0 sender, so the lowest
+  // value wins.
+  uint8_t value = 0xff;
+  for (auto& target : targets_) {
+    if (target.sending) {
+      ScopedChipContext context(*target.chip);
+      data_ = 0xff;
+      target.handler(Event::kRequest);
+      target.sent = data_;
+      value = std::min(value, data_);
+    }
+  }
+  for (auto& target : targets_) {
+    target.sending = target.sending && target.sent == value;
+  }
+  if (observer_) {
+    observer_(address_, Event::kRequest, value);
+  }
+  return value;
+}
+
+void I2CBus::Stop() {
+  if (!started_) {
+    return;
+  }
+  for (auto& target : targets_) {
+    if (target.active) {
+      ScopedChipContext context(*target.chip);
+      // The RP2040 reports both STOP and repeated START as the end of a
+      // transfer.
+      target.handler(Event::kFinish);
+      target.active = target.sending = false;
+    }
+  }
+  started_ = false;
+  if (observer_) {
+    observer_(address_, Event::kFinish, 0);
+  }
+}
+
+void I2CBus::SetTargetAddress(Chip& chip, uint8_t address) {
+  for (auto& target : targets_) {
+    if (target.chip == &chip) {
+      target.address = address;
+    }
+  }
+}
+
+}  // namespace host
@@ -0,0 +1,92 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_I2C_BUS_H_
+#define HOST_I2C_BUS_H_
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "simulator.h"
+
+namespace host {
+
+// An I2C bus shared by the I2C blocks of several chips. The target's handler
+// runs for every byte in the target's context. Write() and Read() are atomic,
+// and the controller's chip is charged the bus time; a controller that models
+// bus timing itself drives one byte at a time with Start(), WriteByte(),
+// ReadByte() and Stop().
+//
+// Several targets may answer the same address. All of them receive what the
+// controller writes, and a read byte is the one of the lowest value, as the
+// open-drain bus resolves it bit by bit from the most significant one. A
+// target that sent another value lost the arbitration and is silent until
+// the end of the transfer.
+class I2CBus final {
+ public:
+  enum class Event { kReceive, kRequest, kFinish };
+  using Handler = std::function<void(Event)>;
+
+  I2CBus() = default;
+  I2CBus(const I2CBus&) = delete;
+  I2CBus& operator=(const I2CBus&) = delete;
+  ~I2CBus() = default;
+
+  // Bus time for a transfer of `bytes` data bytes after the address byte.
+  static Nanoseconds TransferTime(uint32_t baudrate, size_t bytes, bool stop);
+
+  void AddTarget(Chip& chip, uint8_t address, Handler handler);
+  void SetTargetAddress(Chip& chip, uint8_t address);
+
+  // Called for every data byte on the bus, and with kFinish at the end of a
+  // transfer, with the address of the transfer.
+  using Observer =
+      std::function<void(uint8_t address, Event event, uint8_t value)>;
+  void SetObserver(Observer observer) { observer_ = std::move(observer); }
+
+  // Controller side. Returns the number of bytes transferred, or -1 if no
+  // target acknowledged the address.
+  int Write(uint8_t address, std::span<const uint8_t> data);
+  int Read(uint8_t address, std::span<uint8_t> data);
+
+  // Addresses a target after a START or a repeated START, ending the transfer
+  // in progress if any. Returns false if no target acknowledged it.
+  bool Start(uint8_t address);
+  void WriteByte(uint8_t value);
+  uint8_t ReadByte();
+  void Stop();
+
+  // Target side, valid inside a kReceive or kRequest event respectively.
+  uint8_t ReadDataByte() const { return data_; }
+  void WriteDataByte(uint8_t value) { data_ = value; }
+
+  uint64_t transfers() const { return transfers_; }
+  // Data bytes transferred, not counting addresses.
+  uint64_t bytes() const { return bytes_; }
+
+ private:
+  struct Target {
+    Chip* chip;
+    uint8_t address;
+    Handler handler;
+    // Addressed by the transfer in progress, and still sending if it reads.
+    bool active = false;
+    bool sending = false;
+    uint8_t sent = 0;
+  };
+
+  std::vector<Target> targets_;
+  bool started_ = false;
+  uint8_t address_ = 0;
+  uint8_t data_ = 0;
+  Observer observer_;
+  uint64_t transfers_ = 0;
+  uint64_t bytes_ = 0;
+};
+
+}  // namespace host
+
+#endif  // HOST_I2C_BUS_H_
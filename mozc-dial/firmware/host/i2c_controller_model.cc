@@ -0,0 +1,218 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#include "i2c_controller_model.h"
+
+#include "i2c_bus.h"
+
+namespace host {
+
+namespace {
+
+constexpr uint32_t kLatchedInterrupts =
+    I2C_IC_INTR_STAT_R_TX_ABRT_BITS | I2C_IC_INTR_STAT_R_STOP_DET_BITS;
+
+}  // namespace
+
+I2CControllerModel::I2CControllerModel(Chip& chip, uint8_t index)
+    : chip_(chip), index_(index) {
+  RegisterBlock::Map(&hw_[0], sizeof(i2c_hw_t), /*aliased=*/true, this);
+}
+
+I2CControllerModel::~I2CControllerModel() {
+  RegisterBlock::Unmap(this);
+}
+
+void I2CControllerModel::Reset() {
+  for (auto& alias : hw_) {
+    alias = {};
+  }
+  tx_fifo_.clear();
+  rx_fifo_.clear();
+  latched_interrupts_ = 0;
+  addressed_ = false;
+  i2c_hw_t& hw = hw_[0];
+  hw.con.value = I2C_IC_CON_MASTER_MODE_BITS |
+                 (I2C_IC_CON_SPEED_VALUE_FAST << I2C_IC_CON_SPEED_LSB) |
+                 I2C_IC_CON_IC_RESTART_EN_BITS |
+                 I2C_IC_CON_IC_SLAVE_DISABLE_BITS |
+                 I2C_IC_CON_TX_EMPTY_CTRL_BITS;
+  hw.enable.value = I2C_IC_ENABLE_ENABLE_BITS;
+}
+
+void I2CControllerModel::SetIrqHandler(std::function<void()> handler) {
+  irq_handler_ = std::move(handler);
+  UpdateInterrupt();
+}
+
+void I2CControllerModel::SetIrqEnabled(bool enabled, uint8_t core) {
+  irq_enabled_ = enabled;
+  irq_core_ = core;
+  UpdateInterrupt();
+}
+
+uint32_t I2CControllerModel::Read(const io_rw_32& reg) {
+  i2c_hw_t& hw = hw_[0];
+  uint32_t value = reg.value;
+  if (&reg == &hw.data_cmd) {
+    value = 0;
+    if (!rx_fifo_.empty()) {
+      value = rx_fifo_.front();
+      rx_fifo_.pop_front();
+    }
+  } else if (&reg == &hw.raw_intr_stat) {
+    value = RawInterruptStatus();
+  } else if (&reg == &hw.intr_stat) {
+    value = RawInterruptStatus() & hw.intr_mask.value;
+  } else if (&reg == &hw.txflr) {
+    value = tx_fifo_.size();
+  } else if (&reg == &hw.rxflr) {
+    value = rx_fifo_.size();
+  } else if (&reg == &hw.status) {
+    value = (busy_ || addressed_ ? I2C_IC_STATUS_ACTIVITY_BITS : 0) |
+            (tx_fifo_.size() < I2C_FIFO_DEPTH ? I2C_IC_STATUS_TFNF_BITS : 0) |
+            (tx_fifo_.empty() ? I2C_IC_STATUS_TFE_BITS : 0) |
+            (rx_fifo_.empty() ? 0 : I2C_IC_STATUS_RFNE_BITS);
+  } else if (&reg == &hw.clr_tx_abrt) {
+    value = (latched_interrupts_ & I2C_IC_INTR_STAT_R_TX_ABRT_BITS) ? 1 : 0;
+    latched_interrupts_ &= ~I2C_IC_INTR_STAT_R_TX_ABRT_BITS;
+    hw.tx_abrt_source.value = 0;
+  } else if (&reg == &hw.clr_stop_det) {
+    value = (latched_interrupts_ & I2C_IC_INTR_STAT_R_STOP_DET_BITS) ? 1 : 0;
+    latched_interrupts_ &= ~I2C_IC_INTR_STAT_R_STOP_DET_BITS;
+  } else if (&reg == &hw.clr_intr) {
+    value = latched_interrupts_ ? 1 : 0;
+    latched_interrupts_ = 0;
+    hw.tx_abrt_source.value = 0;
+  } else {
+    return value;
+  }
+  // A read with a side effect; the TX FIFO may restart after an abort.
+  StartCommand();
+  UpdateInterrupt();
+  return value;
+}
+
+void I2CControllerModel::Write(io_rw_32& reg,
+                               uint32_t value,
+                               RegisterAlias alias) {
+  i2c_hw_t& hw = hw_[0];
+  bool enabled = hw.enable.value & I2C_IC_ENABLE_ENABLE_BITS;
+  if (&reg == &hw.data_cmd) {
+    // Commands are dropped while disabled, on overflow, or until an abort is
+    // cleared.
+    if (enabled && tx_fifo_.size() < I2C_FIFO_DEPTH &&
+        !(latched_interrupts_ & I2C_IC_INTR_STAT_R_TX_ABRT_BITS)) {
+      tx_fifo_.push_back(value & (I2C_IC_DATA_CMD_DAT_BITS |
+                                  I2C_IC_DATA_CMD_CMD_BITS |
+                                  I2C_IC_DATA_CMD_STOP_BITS |
+                                  I2C_IC_DATA_CMD_RESTART_BITS));
+    }
+  } else {
+    RegisterBlock::Write(reg, value, alias);
+    if (&reg == &hw.enable && !(hw.enable.value & I2C_IC_ENABLE_ENABLE_BITS)) {
+      tx_fifo_.clear();
+      rx_fifo_.clear();
+    }
+  }
+  StartCommand();
+  UpdateInterrupt();
+}
+
+void I2CControllerModel::StartCommand() {
+  if (busy_ || tx_fifo_.empty() ||
+      (latched_interrupts_ & I2C_IC_INTR_STAT_R_TX_ABRT_BITS)) {
+    return;
+  }
+  uint16_t command = tx_fifo_.front();
+  tx_fifo_.pop_front();
+  bool read = command & I2C_IC_DATA_CMD_CMD_BITS;
+  // The block issues a repeated START on request, or when the direction
+  // changes.
+  bool start = !addressed_ || read != reading_ ||
+               (command & I2C_IC_DATA_CMD_RESTART_BITS);
+  // (Repeated) START, address and ACK, then 8 bits and an ACK.
+  uint64_t bits = (start ? 10 : 0) + 9 +
+                  ((command & I2C_IC_DATA_CMD_STOP_BITS) ? 1 : 0);
+  uint32_t baudrate = chip_.i2c_baudrate(index_);
+  Nanoseconds duration = baudrate ? bits * kSecond / baudrate : 0;
+  busy_ = true;
+  chip_.simulator().Schedule(chip_.caller_time() + duration,
+                             [this, command, start] {
+                               FinishCommand(command, start);
+                             });
+}
+
+void I2CControllerModel::FinishCommand(uint16_t command, bool start) {
+  busy_ = false;
+  I2CBus* bus = chip_.i2c_bus(index_);
+  bool read = command & I2C_IC_DATA_CMD_CMD_BITS;
+  if (start) {
+    if (!bus || !bus->Start(hw_[0].tar.value & 0x7f)) {
+      Abort();
+      return;
+    }
+    addressed_ = true;
+    reading_ = read;
+  }
+  if (read) {
+    uint8_t value = bus->ReadByte();
+    if (rx_fifo_.size() < I2C_FIFO_DEPTH) {
+      rx_fifo_.push_back(value);
+    }
+  } else {
+    bus->WriteByte(command & I2C_IC_DATA_CMD_DAT_BITS);
+  }
+  if (command & I2C_IC_DATA_CMD_STOP_BITS) {
+    bus->Stop();
+    addressed_ = false;
+    latched_interrupts_ |= I2C_IC_INTR_STAT_R_STOP_DET_BITS;
+  }
+  StartCommand();
+  UpdateInterrupt();
+}
+
+void I2CControllerModel::Abort() {
+  // The address was not acknowledged: the block flushes the TX FIFO, issues a
+  // STOP, and holds the FIFO until IC_CLR_TX_ABRT is read.
+  tx_fifo_.clear();
+  addressed_ = false;
+  hw_[0].tx_abrt_source.value = I2C_IC_TX_ABRT_SOURCE_ABRT_7B_ADDR_NOACK_BITS;
+  latched_interrupts_ |= kLatchedInterrupts;
+  UpdateInterrupt();
+}
+
+uint32_t I2CControllerModel::RawInterruptStatus() const {
+  const i2c_hw_t& hw = hw_[0];
+  uint32_t raw = latched_interrupts_;
+  bool tx_empty = tx_fifo_.size() <= hw.tx_tl.value;
+  // With TX_EMPTY_CTRL, the last command must also have left the shifter.
+  if (hw.con.value & I2C_IC_CON_TX_EMPTY_CTRL_BITS) {
+    tx_empty = tx_empty && !busy_;
+  }
+  if (tx_empty) {
+    raw |= I2C_IC_INTR_STAT_R_TX_EMPTY_BITS;
+  }
+  if (rx_fifo_.size() > hw.rx_tl.value) {
+    raw |= I2C_IC_INTR_STAT_R_RX_FULL_BITS;
+  }
+  return raw;
+}
+
+void I2CControllerModel::UpdateInterrupt() {
+  if (!irq_enabled_ || irq_raised_ || !irq_handler_ ||
+      (RawInterruptStatus() & hw_[0].intr_mask.value) == 0) {
+    return;
+  }
+  irq_raised_ = true;
+  chip_.RaiseInterrupt(
+      [this] {
+        irq_handler_();
+        irq_raised_ = false;
+        UpdateInterrupt();
+      },
+      irq_core_);
+}
+
+}  // namespace host
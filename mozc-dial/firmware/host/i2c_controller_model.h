@@ -0,0 +1,73 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_I2C_CONTROLLER_MODEL_H_
+#define HOST_I2C_CONTROLLER_MODEL_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+#include "hardware/structs/i2c.h"
+#include "registers.h"
+#include "simulator.h"
+
+namespace host {
+
+// The registers of one RP2040 I2C block in controller mode, for firmware that
+// drives the FIFOs from interrupts instead of the blocking SDK calls. Commands
+// written to IC_DATA_CMD go out on the chip's I2C bus one byte at a time, each
+// taking its bit time, and the interrupt is raised as the real block would:
+// TX_EMPTY and RX_FULL by the FIFO levels, and TX_ABRT and STOP_DET latched
+// until their IC_CLR_* register is read. As on the real block, the bus is
+// held between a command without STOP and the next one.
+class I2CControllerModel final : public RegisterBlock {
+ public:
+  I2CControllerModel(Chip& chip, uint8_t index);
+  I2CControllerModel(const I2CControllerModel&) = delete;
+  I2CControllerModel& operator=(const I2CControllerModel&) = delete;
+  ~I2CControllerModel() override;
+
+  i2c_hw_t* hw() { return &hw_[0]; }
+
+  // --- Used by the stand-in SDK. ---
+  // Configures the block as i2c_init() does, and enables it.
+  void Reset();
+  void SetIrqHandler(std::function<void()> handler);
+  void SetIrqEnabled(bool enabled, uint8_t core);
+
+  // Implement RegisterBlock.
+  uint32_t Read(const io_rw_32& reg) override;
+  void Write(io_rw_32& reg, uint32_t value, RegisterAlias alias) override;
+
+ private:
+  // Starts the next command on the bus unless one is in flight.
+  void StartCommand();
+  void FinishCommand(uint16_t command, bool start);
+  void Abort();
+  uint32_t RawInterruptStatus() const;
+  void UpdateInterrupt();
+
+  Chip& chip_;
+  const uint8_t index_;
+  // Normal, XOR, set and clear aliases, in this order.
+  i2c_hw_t hw_[4] = {};
+
+  std::deque<uint16_t> tx_fifo_;
+  std::deque<uint8_t> rx_fifo_;
+  uint32_t latched_interrupts_ = 0;
+  bool busy_ = false;
+  // Between a START and a STOP, and the direction of the transfer.
+  bool addressed_ = false;
+  bool reading_ = false;
+
+  std::function<void()> irq_handler_;
+  bool irq_enabled_ = false;
+  bool irq_raised_ = false;
+  uint8_t irq_core_ = 0;
+};
+
+}  // namespace host
+
+#endif  // HOST_I2C_CONTROLLER_MODEL_H_
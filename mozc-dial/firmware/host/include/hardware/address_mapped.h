@@ -0,0 +1,16 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_HARDWARE_ADDRESS_MAPPED_H_
+#define HOST_INCLUDE_HARDWARE_ADDRESS_MAPPED_H_
+
+#include "pico.h"
+
+// Peripheral blocks registered with the simulator are backed by four copies,
+// mirroring the RP2040 normal, XOR, set and clear access aliases.
+void* hw_xor_alias_untyped(volatile void* addr);
+void* hw_set_alias_untyped(volatile void* addr);
+void* hw_clear_alias_untyped(volatile void* addr);
+
+#endif  // HOST_INCLUDE_HARDWARE_ADDRESS_MAPPED_H_
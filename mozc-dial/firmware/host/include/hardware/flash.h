@@ -0,0 +1,24 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_HARDWARE_FLASH_H_
+#define HOST_INCLUDE_HARDWARE_FLASH_H_
+
+#include <cstddef>
+
+#include "pico.h"
+
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+
+// Erase and program the flash of the chip executing the call, see
+// host::FlashModel, taking the time the flash takes. Offsets are from the
+// start of flash; erases are of whole sectors, and programs of whole pages.
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs,
+                         const uint8_t* data,
+                         size_t count);
+
+#endif  // HOST_INCLUDE_HARDWARE_FLASH_H_
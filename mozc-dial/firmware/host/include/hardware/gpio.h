@@ -0,0 +1,59 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_HARDWARE_GPIO_H_
+#define HOST_INCLUDE_HARDWARE_GPIO_H_
+
+#include "pico.h"
+
+#define NUM_BANK0_GPIOS 30
+
+enum gpio_dir { GPIO_OUT = 1, GPIO_IN = 0 };
+
+enum gpio_function {
+  GPIO_FUNC_XIP = 0,
+  GPIO_FUNC_SPI = 1,
+  GPIO_FUNC_UART = 2,
+  GPIO_FUNC_I2C = 3,
+  GPIO_FUNC_PWM = 4,
+  GPIO_FUNC_SIO = 5,
+  GPIO_FUNC_PIO0 = 6,
+  GPIO_FUNC_PIO1 = 7,
+  GPIO_FUNC_GPCK = 8,
+  GPIO_FUNC_USB = 9,
+  GPIO_FUNC_NULL = 0x1f,
+};
+
+enum gpio_irq_level {
+  GPIO_IRQ_LEVEL_LOW = 0x1u,
+  GPIO_IRQ_LEVEL_HIGH = 0x2u,
+  GPIO_IRQ_EDGE_FALL = 0x4u,
+  GPIO_IRQ_EDGE_RISE = 0x8u,
+};
+
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+
+void gpio_init(uint gpio);
+void gpio_set_function(uint gpio, gpio_function fn);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_pull_up(uint gpio);
+void gpio_pull_down(uint gpio);
+void gpio_disable_pulls(uint gpio);
+
+bool gpio_get(uint gpio);
+uint32_t gpio_get_all();
+void gpio_put(uint gpio, bool value);
+void gpio_put_masked(uint32_t mask, uint32_t value);
+void gpio_set_mask(uint32_t mask);
+void gpio_clr_mask(uint32_t mask);
+
+// Only edge events are modeled.
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled);
+void gpio_set_irq_enabled_with_callback(uint gpio,
+                                        uint32_t event_mask,
+                                        bool enabled,
+                                        gpio_irq_callback_t callback);
+void gpio_set_irq_callback(gpio_irq_callback_t callback);
+
+#endif  // HOST_INCLUDE_HARDWARE_GPIO_H_
@@ -0,0 +1,51 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_HARDWARE_I2C_H_
+#define HOST_INCLUDE_HARDWARE_I2C_H_
+
+#include "hardware/structs/i2c.h"
+#include "pico.h"
+
+// Each chip in the simulation has its own pair of I2C blocks. The instance
+// objects only identify the block; the state lives in the chip that is
+// executing the call.
+typedef struct i2c_inst {
+  uint8_t index;
+} i2c_inst_t;
+
+extern i2c_inst_t i2c0_inst;
+extern i2c_inst_t i2c1_inst;
+
+#define i2c0 (&i2c0_inst)
+#define i2c1 (&i2c1_inst)
+
+#define PICO_ERROR_GENERIC (-1)
+
+inline uint i2c_hw_index(i2c_inst_t* i2c) {
+  return i2c->index;
+}
+
+inline i2c_hw_t* i2c_get_hw(i2c_inst_t* i2c) {
+  return host_i2c_hw(i2c->index);
+}
+
+uint i2c_init(i2c_inst_t* i2c, uint baudrate);
+int i2c_write_blocking(i2c_inst_t* i2c,
+                       uint8_t addr,
+                       const uint8_t* src,
+                       size_t len,
+                       bool nostop);
+int i2c_read_blocking(i2c_inst_t* i2c,
+                      uint8_t addr,
+                      uint8_t* dst,
+                      size_t len,
+                      bool nostop);
+// Only switching to target mode, i.e. changing the target address, is
+// supported.
+void i2c_set_slave_mode(i2c_inst_t* i2c, bool slave, uint8_t addr);
+uint8_t i2c_read_byte_raw(i2c_inst_t* i2c);
+void i2c_write_byte_raw(i2c_inst_t* i2c, uint8_t value);
+
+#endif  // HOST_INCLUDE_HARDWARE_I2C_H_
@@ -0,0 +1,22 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_HARDWARE_IRQ_H_
+#define HOST_INCLUDE_HARDWARE_IRQ_H_
+
+#include "pico.h"
+
+#define TIMER_IRQ_0 0
+#define USBCTRL_IRQ 5
+#define IO_IRQ_BANK0 13
+#define I2C0_IRQ 23
+#define I2C1_IRQ 24
+
+typedef void (*irq_handler_t)(void);
+
+void irq_set_enabled(uint num, bool enabled);
+// Interrupts are taken by the core that enables them.
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+
+#endif  // HOST_INCLUDE_HARDWARE_IRQ_H_
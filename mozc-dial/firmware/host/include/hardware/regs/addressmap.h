@@ -0,0 +1,16 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_HARDWARE_REGS_ADDRESSMAP_H_
+#define HOST_INCLUDE_HARDWARE_REGS_ADDRESSMAP_H_
+
+#include <cstdint>
+
+// Where the flash of the chip executing the caller is mapped, see
+// host::FlashModel. Only XIP reads of the flash are supported.
+uintptr_t host_xip_base();
+
+#define XIP_BASE (host_xip_base())
+
+#endif  // HOST_INCLUDE_HARDWARE_REGS_ADDRESSMAP_H_
@@ -0,0 +1,40 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_HARDWARE_REGS_I2C_H_
+#define HOST_INCLUDE_HARDWARE_REGS_I2C_H_
+
+#define I2C_IC_CON_MASTER_MODE_BITS 0x00000001u
+#define I2C_IC_CON_SPEED_BITS 0x00000006u
+#define I2C_IC_CON_SPEED_VALUE_FAST 0x2u
+#define I2C_IC_CON_SPEED_LSB 1u
+#define I2C_IC_CON_IC_RESTART_EN_BITS 0x00000020u
+#define I2C_IC_CON_IC_SLAVE_DISABLE_BITS 0x00000040u
+#define I2C_IC_CON_TX_EMPTY_CTRL_BITS 0x00000100u
+
+#define I2C_IC_DATA_CMD_DAT_BITS 0x000000ffu
+#define I2C_IC_DATA_CMD_CMD_BITS 0x00000100u
+#define I2C_IC_DATA_CMD_STOP_BITS 0x00000200u
+#define I2C_IC_DATA_CMD_RESTART_BITS 0x00000400u
+
+// The same bits are used in IC_INTR_STAT, IC_INTR_MASK and IC_RAW_INTR_STAT.
+#define I2C_IC_INTR_STAT_R_RX_FULL_BITS 0x00000004u
+#define I2C_IC_INTR_STAT_R_TX_EMPTY_BITS 0x00000010u
+#define I2C_IC_INTR_STAT_R_TX_ABRT_BITS 0x00000040u
+#define I2C_IC_INTR_STAT_R_STOP_DET_BITS 0x00000200u
+#define I2C_IC_INTR_MASK_M_RX_FULL_BITS 0x00000004u
+#define I2C_IC_INTR_MASK_M_TX_EMPTY_BITS 0x00000010u
+#define I2C_IC_INTR_MASK_M_TX_ABRT_BITS 0x00000040u
+#define I2C_IC_INTR_MASK_M_STOP_DET_BITS 0x00000200u
+
+#define I2C_IC_ENABLE_ENABLE_BITS 0x00000001u
+
+#define I2C_IC_STATUS_ACTIVITY_BITS 0x00000001u
+#define I2C_IC_STATUS_TFNF_BITS 0x00000002u
+#define I2C_IC_STATUS_TFE_BITS 0x00000004u
+#define I2C_IC_STATUS_RFNE_BITS 0x00000008u
+
+#define I2C_IC_TX_ABRT_SOURCE_ABRT_7B_ADDR_NOACK_BITS 0x00000001u
+
+#endif  // HOST_INCLUDE_HARDWARE_REGS_I2C_H_
@@ -0,0 +1,35 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_HARDWARE_REGS_USB_H_
+#define HOST_INCLUDE_HARDWARE_REGS_USB_H_
+
+#define USB_MAIN_CTRL_CONTROLLER_EN_BITS 0x00000001u
+
+#define USB_SIE_CTRL_EP0_INT_STALL_BITS 0x80000000u
+#define USB_SIE_CTRL_EP0_DOUBLE_BUF_BITS 0x40000000u
+#define USB_SIE_CTRL_EP0_INT_1BUF_BITS 0x20000000u
+#define USB_SIE_CTRL_EP0_INT_2BUF_BITS 0x10000000u
+#define USB_SIE_CTRL_EP0_INT_NAK_BITS 0x08000000u
+#define USB_SIE_CTRL_PULLUP_EN_BITS 0x00010000u
+
+#define USB_SIE_STATUS_VBUS_DETECTED_BITS 0x00000001u
+#define USB_SIE_STATUS_CONNECTED_BITS 0x00010000u
+#define USB_SIE_STATUS_SETUP_REC_BITS 0x00020000u
+#define USB_SIE_STATUS_TRANS_COMPLETE_BITS 0x00040000u
+#define USB_SIE_STATUS_BUS_RESET_BITS 0x00080000u
+
+#define USB_USB_MUXING_TO_PHY_BITS 0x00000001u
+#define USB_USB_MUXING_SOFTCON_BITS 0x00000008u
+
+#define USB_USB_PWR_VBUS_DETECT_BITS 0x00000004u
+#define USB_USB_PWR_VBUS_DETECT_OVERRIDE_EN_BITS 0x00000008u
+
+#define USB_INTS_TRANS_COMPLETE_BITS 0x00000008u
+#define USB_INTS_BUFF_STATUS_BITS 0x00000010u
+#define USB_INTS_BUS_RESET_BITS 0x00001000u
+#define USB_INTS_SETUP_REQ_BITS 0x00010000u
+#define USB_INTS_DEV_SOF_BITS 0x00020000u
+
+#endif  // HOST_INCLUDE_HARDWARE_REGS_USB_H_
@@ -0,0 +1,14 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_HARDWARE_RESETS_H_
+#define HOST_INCLUDE_HARDWARE_RESETS_H_
+
+#include "pico.h"
+
+#define RESET_USBCTRL 24
+
+void reset_unreset_block_num_wait_blocking(uint block_num);
+
+#endif  // HOST_INCLUDE_HARDWARE_RESETS_H_
@@ -0,0 +1,57 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_HARDWARE_STRUCTS_I2C_H_
+#define HOST_INCLUDE_HARDWARE_STRUCTS_I2C_H_
+
+#include "hardware/address_mapped.h"
+#include "hardware/regs/i2c.h"
+#include "pico.h"
+
+#define I2C_FIFO_DEPTH 16
+
+typedef struct {
+  io_rw_32 con;
+  io_rw_32 tar;
+  io_rw_32 sar;
+  uint32_t _pad0;
+  io_rw_32 data_cmd;
+  io_rw_32 ss_scl_hcnt;
+  io_rw_32 ss_scl_lcnt;
+  io_rw_32 fs_scl_hcnt;
+  io_rw_32 fs_scl_lcnt;
+  uint32_t _pad1[2];
+  io_ro_32 intr_stat;
+  io_rw_32 intr_mask;
+  io_ro_32 raw_intr_stat;
+  io_rw_32 rx_tl;
+  io_rw_32 tx_tl;
+  io_ro_32 clr_intr;
+  io_ro_32 clr_rx_under;
+  io_ro_32 clr_rx_over;
+  io_ro_32 clr_tx_over;
+  io_ro_32 clr_rd_req;
+  io_ro_32 clr_tx_abrt;
+  io_ro_32 clr_rx_done;
+  io_ro_32 clr_activity;
+  io_ro_32 clr_stop_det;
+  io_ro_32 clr_start_det;
+  io_ro_32 clr_gen_call;
+  io_rw_32 enable;
+  io_ro_32 status;
+  io_ro_32 txflr;
+  io_ro_32 rxflr;
+  io_rw_32 sda_hold;
+  io_ro_32 tx_abrt_source;
+} i2c_hw_t;
+
+static_assert(sizeof(i2c_hw_t) == 0x84);
+
+// I2C block `index` of the executing chip.
+i2c_hw_t* host_i2c_hw(uint index);
+
+#define i2c0_hw (host_i2c_hw(0))
+#define i2c1_hw (host_i2c_hw(1))
+
+#endif  // HOST_INCLUDE_HARDWARE_STRUCTS_I2C_H_
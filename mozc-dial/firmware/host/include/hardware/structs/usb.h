@@ -0,0 +1,87 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_HARDWARE_STRUCTS_USB_H_
+#define HOST_INCLUDE_HARDWARE_STRUCTS_USB_H_
+
+#include "hardware/address_mapped.h"
+#include "hardware/regs/usb.h"
+#include "pico.h"
+
+#define USB_NUM_ENDPOINTS 16
+#define USB_DPRAM_MAX 4096
+
+#define EP_CTRL_ENABLE_BITS (1u << 31u)
+#define EP_CTRL_DOUBLE_BUFFERED_BITS (1u << 30u)
+#define EP_CTRL_INTERRUPT_PER_BUFFER (1u << 29u)
+#define EP_CTRL_INTERRUPT_PER_DOUBLE_BUFFER (1u << 28u)
+#define EP_CTRL_INTERRUPT_ON_NAK (1u << 16u)
+#define EP_CTRL_INTERRUPT_ON_STALL (1u << 17u)
+#define EP_CTRL_BUFFER_TYPE_LSB 26u
+#define EP_CTRL_HOST_INTERRUPT_INTERVAL_LSB 16u
+
+#define USB_BUF_CTRL_FULL 0x00008000u
+#define USB_BUF_CTRL_LAST 0x00004000u
+#define USB_BUF_CTRL_DATA0_PID 0x00000000u
+#define USB_BUF_CTRL_DATA1_PID 0x00002000u
+#define USB_BUF_CTRL_SEL 0x00001000u
+#define USB_BUF_CTRL_STALL 0x00000800u
+#define USB_BUF_CTRL_AVAIL 0x00000400u
+#define USB_BUF_CTRL_LEN_MASK 0x000003ffu
+#define USB_BUF_CTRL_LEN_LSB 0u
+
+typedef struct {
+  io_rw_32 dev_addr_ctrl;
+  io_rw_32 int_ep_addr_ctrl[USB_NUM_ENDPOINTS - 1];
+  io_rw_32 main_ctrl;
+  io_wo_32 sof_rw;
+  io_ro_32 sof_rd;
+  io_rw_32 sie_ctrl;
+  io_rw_32 sie_status;
+  io_rw_32 int_ep_ctrl;
+  io_rw_32 buf_status;
+  io_ro_32 buf_cpu_should_handle;
+  io_rw_32 abort;
+  io_rw_32 abort_done;
+  io_rw_32 ep_stall_arm;
+  io_rw_32 nak_poll;
+  io_rw_32 ep_nak_stall_status;
+  io_rw_32 muxing;
+  io_rw_32 pwr;
+  io_rw_32 phy_direct;
+  io_rw_32 phy_direct_override;
+  io_rw_32 phy_trim;
+  uint32_t _pad0;
+  io_rw_32 intr;
+  io_rw_32 inte;
+  io_rw_32 intf;
+  io_ro_32 ints;
+} usb_hw_t;
+
+typedef struct {
+  volatile uint8_t setup_packet[8];
+  struct usb_device_dpram_ep_ctrl {
+    io_rw_32 in;
+    io_rw_32 out;
+  } ep_ctrl[USB_NUM_ENDPOINTS - 1];
+  struct usb_device_dpram_ep_buf_ctrl {
+    io_rw_32 in;
+    io_rw_32 out;
+  } ep_buf_ctrl[USB_NUM_ENDPOINTS];
+  uint8_t ep0_buf_a[0x40];
+  uint8_t ep0_buf_b[0x40];
+  uint8_t epx_data[USB_DPRAM_MAX - 0x180];
+} usb_device_dpram_t;
+
+static_assert(sizeof(usb_hw_t) == 0x9c);
+static_assert(sizeof(usb_device_dpram_t) == USB_DPRAM_MAX);
+
+// The executing chip's USB controller.
+usb_hw_t* host_usb_hw();
+usb_device_dpram_t* host_usb_dpram();
+
+#define usb_hw (host_usb_hw())
+#define usb_dpram (host_usb_dpram())
+
+#endif  // HOST_INCLUDE_HARDWARE_STRUCTS_USB_H_
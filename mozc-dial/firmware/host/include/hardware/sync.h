@@ -0,0 +1,27 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_HARDWARE_SYNC_H_
+#define HOST_INCLUDE_HARDWARE_SYNC_H_
+
+#include "pico.h"
+
+// Sleeps until an interrupt or an event; returns at once if an event is
+// already pending.
+void __wfe();
+// Sleeps until an interrupt.
+void __wfi();
+// Signals an event to both cores.
+void __sev();
+
+// Masks interrupts on the calling core, and returns the previous state for
+// restore_interrupts().
+uint32_t save_and_disable_interrupts();
+void restore_interrupts(uint32_t status);
+
+inline void __dmb() {
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#endif  // HOST_INCLUDE_HARDWARE_SYNC_H_
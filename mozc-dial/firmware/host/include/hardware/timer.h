@@ -0,0 +1,13 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_HARDWARE_TIMER_H_
+#define HOST_INCLUDE_HARDWARE_TIMER_H_
+
+#include "pico.h"
+
+uint64_t time_us_64();
+uint32_t time_us_32();
+
+#endif  // HOST_INCLUDE_HARDWARE_TIMER_H_
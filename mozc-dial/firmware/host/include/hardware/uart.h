@@ -0,0 +1,20 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_HARDWARE_UART_H_
+#define HOST_INCLUDE_HARDWARE_UART_H_
+
+#include "pico.h"
+
+typedef struct uart_inst {
+  uint8_t index;
+} uart_inst_t;
+
+extern uart_inst_t uart0_inst;
+extern uart_inst_t uart1_inst;
+
+#define uart0 (&uart0_inst)
+#define uart1 (&uart1_inst)
+
+#endif  // HOST_INCLUDE_HARDWARE_UART_H_
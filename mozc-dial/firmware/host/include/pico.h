@@ -0,0 +1,41 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+// Host stand-in for the Pico SDK. Only the subset used by the dial firmware is
+// provided, and every peripheral access is routed to the simulator in
+// host/simulator.h so that firmware sources build unmodified on Linux.
+
+#ifndef HOST_INCLUDE_PICO_H_
+#define HOST_INCLUDE_PICO_H_
+
+#include "pico/types.h"
+
+[[noreturn]] void host_hard_assert_failed(const char* expression,
+                                          const char* file,
+                                          int line);
+
+// As in pico/error.h.
+#define PICO_OK 0
+#define PICO_ERROR_TIMEOUT (-1)
+
+#define hard_assert(x) \
+  ((x) ? (void)0 : host_hard_assert_failed(#x, __FILE__, __LINE__))
+
+// On the device this is an empty hint inside busy loops. The host build
+// treats it as "nothing can change until an interrupt or an input edge", so
+// an idle chip does not burn host CPU time spinning on the virtual clock.
+void tight_loop_contents();
+
+// The core executing the caller, 0 or 1.
+uint get_core_num();
+
+// The exception number the caller handles, or 0 in thread mode. The host
+// build returns 16, the first IRQ, for any interrupt handler.
+uint __get_current_exception();
+
+#define __not_in_flash(group)
+#define __not_in_flash_func(func_name) func_name
+#define __time_critical_func(func_name) func_name
+
+#endif  // HOST_INCLUDE_PICO_H_
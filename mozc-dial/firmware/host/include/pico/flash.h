@@ -0,0 +1,17 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_PICO_FLASH_H_
+#define HOST_INCLUDE_PICO_FLASH_H_
+
+#include "pico.h"
+
+// Runs `func` with interrupts masked on the calling core. The other core is
+// not paused, as nothing runs from flash on the host.
+int flash_safe_execute(void (*func)(void*),
+                       void* param,
+                       uint32_t enter_exit_timeout_ms);
+bool flash_safe_execute_core_init();
+
+#endif  // HOST_INCLUDE_PICO_FLASH_H_
@@ -0,0 +1,19 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_PICO_MULTICORE_H_
+#define HOST_INCLUDE_PICO_MULTICORE_H_
+
+#include "pico.h"
+
+void multicore_launch_core1(void (*entry)(void));
+
+bool multicore_fifo_rvalid();
+bool multicore_fifo_wready();
+void multicore_fifo_push_blocking(uint32_t data);
+uint32_t multicore_fifo_pop_blocking();
+bool multicore_fifo_pop_timeout_us(uint64_t timeout_us, uint32_t* out);
+void multicore_fifo_drain();
+
+#endif  // HOST_INCLUDE_PICO_MULTICORE_H_
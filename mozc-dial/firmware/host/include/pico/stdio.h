@@ -0,0 +1,17 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_PICO_STDIO_H_
+#define HOST_INCLUDE_PICO_STDIO_H_
+
+#include <cstdio>
+
+#include "pico.h"
+
+bool stdio_init_all();
+
+// There is no input in the simulation; always times out.
+int getchar_timeout_us(uint32_t timeout_us);
+
+#endif  // HOST_INCLUDE_PICO_STDIO_H_
@@ -0,0 +1,14 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_PICO_STDLIB_H_
+#define HOST_INCLUDE_PICO_STDLIB_H_
+
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+#include "pico.h"
+#include "pico/stdio.h"
+#include "pico/time.h"
+
+#endif  // HOST_INCLUDE_PICO_STDLIB_H_
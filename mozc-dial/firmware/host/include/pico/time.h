@@ -0,0 +1,49 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_PICO_TIME_H_
+#define HOST_INCLUDE_PICO_TIME_H_
+
+#include "hardware/timer.h"
+#include "pico.h"
+
+typedef int32_t alarm_id_t;
+typedef struct alarm_pool alarm_pool_t;
+
+typedef struct repeating_timer repeating_timer_t;
+typedef bool (*repeating_timer_callback_t)(repeating_timer_t* rt);
+
+struct repeating_timer {
+  int64_t delay_us;
+  alarm_pool_t* pool;
+  alarm_id_t alarm_id;
+  repeating_timer_callback_t callback;
+  void* user_data;
+};
+
+absolute_time_t get_absolute_time();
+uint64_t to_us_since_boot(absolute_time_t t);
+absolute_time_t make_timeout_time_us(uint64_t us);
+absolute_time_t make_timeout_time_ms(uint32_t ms);
+bool time_reached(absolute_time_t t);
+
+// Waits for an event, or until `timeout_timestamp`. Returns true if the
+// timeout has been reached.
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp);
+
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+void busy_wait_us(uint64_t us);
+
+bool add_repeating_timer_us(int64_t delay_us,
+                            repeating_timer_callback_t callback,
+                            void* user_data,
+                            repeating_timer_t* out);
+bool add_repeating_timer_ms(int32_t delay_ms,
+                            repeating_timer_callback_t callback,
+                            void* user_data,
+                            repeating_timer_t* out);
+bool cancel_repeating_timer(repeating_timer_t* timer);
+
+#endif  // HOST_INCLUDE_PICO_TIME_H_
@@ -0,0 +1,30 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_PICO_TYPES_H_
+#define HOST_INCLUDE_PICO_TYPES_H_
+
+#include <cstddef>
+#include <cstdint>
+
+typedef unsigned int uint;
+
+typedef uint64_t absolute_time_t;
+
+// Memory mapped registers are modelled as objects so that the simulator can
+// observe accesses and implement side effects such as write-1-to-clear bits or
+// the atomic set/clear aliases.
+struct io_rw_32 {
+  uint32_t value;
+
+  operator uint32_t() const;
+  io_rw_32& operator=(uint32_t new_value);
+  io_rw_32& operator|=(uint32_t bits) { return *this = *this | bits; }
+  io_rw_32& operator&=(uint32_t bits) { return *this = *this & bits; }
+  io_rw_32& operator^=(uint32_t bits) { return *this = *this ^ bits; }
+};
+typedef io_rw_32 io_ro_32;
+typedef io_rw_32 io_wo_32;
+
+#endif  // HOST_INCLUDE_PICO_TYPES_H_
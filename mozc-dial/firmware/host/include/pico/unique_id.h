@@ -0,0 +1,19 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_INCLUDE_PICO_UNIQUE_ID_H_
+#define HOST_INCLUDE_PICO_UNIQUE_ID_H_
+
+#include "pico.h"
+
+#define PICO_UNIQUE_BOARD_ID_SIZE_BYTES 8
+
+typedef struct {
+  uint8_t id[PICO_UNIQUE_BOARD_ID_SIZE_BYTES];
+} pico_unique_board_id_t;
+
+// The ID of the chip executing the call, see host::Chip::unique_id().
+void pico_get_unique_board_id(pico_unique_board_id_t* id_out);
+
+#endif  // HOST_INCLUDE_PICO_UNIQUE_ID_H_
@@ -0,0 +1,64 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#include "keyboard_report.h"
+
+namespace host {
+
+namespace {
+
+// Must match common/usb_hid_keyboard.h.
+constexpr size_t kBootReportSize = 8;
+constexpr size_t kNkroUsages = 0xe0;
+constexpr size_t kNkroReportSize = 2 + kNkroUsages / 8;
+constexpr size_t kKeycodeReportIndex = 2;
+
+}  // namespace
+
+const uint8_t kSetBootProtocol[8] = {
+    0x21,  // Host to device, class, interface
+    0x0b,  // SET_PROTOCOL
+    0x00, 0x00,  // Boot protocol
+    0x00, 0x00,  // Interface 0
+    0x00, 0x00,  // No data stage
+};
+
+std::array<uint8_t, 8> GetDescriptorRequest(uint8_t type,
+                                            uint8_t index,
+                                            uint16_t length) {
+  uint16_t language = type == 0x03 ? 0x0409 : 0x0000;
+  return {
+      0x80,  // Device to host, standard, device
+      0x06,  // GET_DESCRIPTOR
+      index,
+      type,
+      static_cast<uint8_t>(language & 0xff),
+      static_cast<uint8_t>(language >> 8),
+      static_cast<uint8_t>(length & 0xff),
+      static_cast<uint8_t>(length >> 8),
+  };
+}
+
+std::optional<std::set<uint8_t>> DecodeKeyboardReport(
+    std::span<const uint8_t> report) {
+  std::set<uint8_t> keys;
+  if (report.size() == kBootReportSize) {
+    for (size_t i = kKeycodeReportIndex; i < kBootReportSize; ++i) {
+      if (report[i]) {
+        keys.insert(report[i]);
+      }
+    }
+  } else if (report.size() == kNkroReportSize) {
+    for (size_t usage = 0; usage < kNkroUsages; ++usage) {
+      if (report[kKeycodeReportIndex + usage / 8] & (1 << (usage % 8))) {
+        keys.insert(usage);
+      }
+    }
+  } else {
+    return std::nullopt;
+  }
+  return keys;
+}
+
+}  // namespace host
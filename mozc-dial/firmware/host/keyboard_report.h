@@ -0,0 +1,35 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_KEYBOARD_REPORT_H_
+#define HOST_KEYBOARD_REPORT_H_
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <span>
+
+namespace host {
+
+// Decodes an input report of UsbHidKeyboard into the pressed usages, except
+// modifiers. Takes boot protocol reports of 8 bytes and report protocol
+// bitmaps of UsbHidKeyboard::kNkroReportSize bytes; returns std::nullopt for
+// any other size.
+std::optional<std::set<uint8_t>> DecodeKeyboardReport(
+    std::span<const uint8_t> report);
+
+// SET_PROTOCOL(boot) to the keyboard interface, for
+// UsbControllerModel::SendSetup().
+extern const uint8_t kSetBootProtocol[8];
+
+// GET_DESCRIPTOR of `type` at `index`, for UsbControllerModel::SendSetup().
+// String descriptors are asked in English (United States).
+std::array<uint8_t, 8> GetDescriptorRequest(uint8_t type,
+                                            uint8_t index,
+                                            uint16_t length);
+
+}  // namespace host
+
+#endif  // HOST_KEYBOARD_REPORT_H_
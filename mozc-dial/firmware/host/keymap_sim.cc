@@ -0,0 +1,402 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+// Writes keymaps to main over its telemetry interface, as dial_telemetry
+// --keymap does, and checks that the dial A types by them: a new keymap from
+// the next stroke on, none for a bad one, the same after a reboot, and the
+// one before for a record torn in flash. Writes laps of the log, and checks
+// that every sector of it is erased as often. Exits with 1 on a failure.
+//
+// Usage: keymap_sim
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <set>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "../common/keymap.h"
+#include "../common/keymap_store.h"
+#include "../common/telemetry_protocol.h"
+#include "dial_waveform.h"
+#include "flash_model.h"
+#include "heap_check.h"
+#include "keyboard_report.h"
+#include "simulator.h"
+#include "usb_controller_model.h"
+
+using host::Chip;
+using host::DialWaveform;
+using host::Nanoseconds;
+using telemetry_protocol::KeymapStatus;
+
+namespace {
+
+constexpr uint8_t kKeyboardEndpoint = 1;
+constexpr uint32_t kKeyboardPollIntervalInFrames = 10;
+// Must match main/main.cc.
+const std::vector<uint8_t> kDialAGpios = {1, 2, 3, 4, 5, 6};
+// Main looks for subs for up to 1 s, and finds none here.
+constexpr Nanoseconds kBootTime = 1200 * host::kMillisecond;
+// A keymap is committed within this time, even with a sector to erase.
+constexpr Nanoseconds kCommitTimeout = 200 * host::kMillisecond;
+// Laps of the log written in a row.
+constexpr size_t kLaps = 3;
+
+// KeymapStore::Status.
+constexpr uint8_t kOk = 0;
+constexpr uint8_t kBadCrc = 2;
+constexpr uint8_t kBadLayout = 3;
+
+// The start of a record in the log, as KeymapStore writes it.
+constexpr uint32_t kRecordMagic = 0x50414d4b;
+constexpr size_t kRecordSequenceOffset = 8;
+constexpr size_t kRecordHeaderSize = 16;
+
+// The built-in keymap as keymap::StoredLayout.
+std::vector<uint8_t> BuiltInKeymap() {
+  const keymap::Layout& layout = keymap::kBuiltInLayout;
+  keymap::StoredLayout stored = {
+      static_cast<uint8_t>(layout.num_layers),
+      static_cast<uint8_t>(layout.num_dials),
+      static_cast<uint16_t>(layout.layer_size)};
+  std::vector<uint8_t> data(sizeof(stored));
+  memcpy(data.data(), &stored, sizeof(stored));
+  auto append = [&data](const void* bytes, size_t size) {
+    const uint8_t* begin = static_cast<const uint8_t*>(bytes);
+    data.insert(data.end(), begin, begin + size);
+  };
+  append(layout.dial_index, layout.num_dials * sizeof(keymap::DialIndex));
+  append(layout.keys,
+         layout.num_layers * layout.layer_size * sizeof(keymap::Key));
+  return data;
+}
+
+// The offset in a keymap from BuiltInKeymap() of the key at `position` of
+// the dial A in the base layer.
+size_t KeyOffset(uint8_t position) {
+  const keymap::Layout& layout = keymap::kBuiltInLayout;
+  return sizeof(keymap::StoredLayout) +
+         layout.num_dials * sizeof(keymap::DialIndex) +
+         (layout.dial_index[keymap::kDialA].first + position - 1) *
+             sizeof(keymap::Key);
+}
+
+// The built-in keymap, with `usage` at `position` of the dial A.
+std::vector<uint8_t> MakeKeymap(uint8_t position, uint8_t usage) {
+  std::vector<uint8_t> data = BuiltInKeymap();
+  keymap::Key key = {keymap::KeyType::kUsage, usage};
+  memcpy(data.data() + KeyOffset(position), &key, sizeof(key));
+  return data;
+}
+
+uint32_t Crc(std::span<const uint8_t> data) {
+  return keymap::Crc32(data.data(), data.size());
+}
+
+// Main on its own, with the dial A, the keyboard polled, and the telemetry
+// interface taken by a host that waits for each answer.
+class Board final {
+ public:
+  // Boots with `flash` as the contents of the flash, or an erased one.
+  Board(const std::string& image, const std::vector<uint8_t>* flash)
+      : chip_(simulator_.AddChip("main", image)),
+        dial_a_(chip_, kDialAGpios) {
+    if (flash) {
+      chip_.flash().contents() = *flash;
+    }
+    chip_.usb().SetInPollInterval(kKeyboardEndpoint,
+                                  kKeyboardPollIntervalInFrames);
+    chip_.usb().SetInListener(
+        [this](uint8_t endpoint, std::span<const uint8_t> data) {
+          if (endpoint == telemetry_protocol::kEndPoint) {
+            if (data.size() == sizeof(KeymapStatus) &&
+                data[0] == telemetry_protocol::kPacketKeymapStatus) {
+              memcpy(&status_.emplace(), data.data(), data.size());
+            }
+            return;
+          }
+          if (endpoint != kKeyboardEndpoint) {
+            return;
+          }
+          std::optional<std::set<uint8_t>> keys =
+              host::DecodeKeyboardReport(data);
+          if (!keys) {
+            return;
+          }
+          for (uint8_t key : *keys) {
+            if (!pressed_.contains(key)) {
+              usages_.push_back(key);
+            }
+          }
+          pressed_ = *keys;
+        });
+    simulator_.RunUntil(kBootTime);
+  }
+  Board(const Board&) = delete;
+  Board& operator=(const Board&) = delete;
+  ~Board() = default;
+
+  host::Simulator& simulator() { return simulator_; }
+  Chip& chip() { return chip_; }
+
+  // Writes `keymap` with `crc`, as dial_telemetry --keymap does, and returns
+  // the status main answers with.
+  std::optional<KeymapStatus> Write(std::span<const uint8_t> keymap,
+                                    uint32_t crc) {
+    using namespace telemetry_protocol;
+    std::vector<std::vector<uint8_t>> packets;
+    KeymapBegin begin = {.command = kCommandKeymapBegin,
+                         .reserved = 0,
+                         .size = static_cast<uint16_t>(keymap.size())};
+    packets.push_back(Bytes(&begin, sizeof(begin)));
+    for (size_t offset = 0; offset < keymap.size();) {
+      KeymapData data = {.command = kCommandKeymapData,
+                         .reserved = 0,
+                         .offset = static_cast<uint16_t>(offset),
+                         .data = {}};
+      size_t size = std::min(data.data.size(), keymap.size() - offset);
+      memcpy(data.data.data(), keymap.data() + offset, size);
+      packets.push_back(Bytes(&data, offsetof(KeymapData, data) + size));
+      offset += size;
+    }
+    KeymapCommit commit = {
+        .command = kCommandKeymapCommit, .reserved = {}, .crc = crc};
+    packets.push_back(Bytes(&commit, sizeof(commit)));
+    return Send(std::move(packets));
+  }
+
+  std::optional<KeymapStatus> Query() {
+    return Send({{telemetry_protocol::kCommandKeymapQuery}});
+  }
+
+  // Turns the dial A to `position` and back, and returns the usages typed.
+  std::vector<uint8_t> Stroke(uint8_t position) {
+    usages_.clear();
+    DialWaveform::StrokeTiming timing = dial_a_.AddStroke(
+        simulator_.now() + host::kMillisecond, position, {});
+    simulator_.RunUntil(timing.back + 100 * host::kMillisecond);
+    return usages_;
+  }
+
+ private:
+  static std::vector<uint8_t> Bytes(const void* data, size_t size) {
+    const uint8_t* begin = static_cast<const uint8_t*>(data);
+    return {begin, begin + size};
+  }
+
+  std::optional<KeymapStatus> Send(std::vector<std::vector<uint8_t>> packets) {
+    status_.reset();
+    for (std::vector<uint8_t>& packet : packets) {
+      chip_.usb().SendOut(telemetry_protocol::kEndPoint, std::move(packet));
+    }
+    Nanoseconds deadline = simulator_.now() + kCommitTimeout;
+    while (!status_ && simulator_.now() < deadline) {
+      simulator_.RunUntil(simulator_.now() + host::kMillisecond);
+    }
+    return status_;
+  }
+
+  host::Simulator simulator_;
+  Chip& chip_;
+  DialWaveform dial_a_;
+  std::optional<KeymapStatus> status_;
+  std::vector<uint8_t> usages_;
+  std::set<uint8_t> pressed_;
+};
+
+// Prints `status`, and returns whether it is `expected_status` of the keymap
+// of `sequence` and `crc`.
+bool CheckStatus(const char* what,
+                 const std::optional<KeymapStatus>& status,
+                 uint8_t expected_status,
+                 uint32_t sequence,
+                 uint32_t crc) {
+  if (!status) {
+    printf("%s: no answer, unexpected\n", what);
+    return false;
+  }
+  bool ok = status->status == expected_status &&
+            status->sequence == sequence && status->crc == crc;
+  printf("%s: status %u, keymap #%lu of %u bytes, CRC %08lx%s\n", what,
+         static_cast<unsigned>(status->status),
+         static_cast<unsigned long>(status->sequence),
+         static_cast<unsigned>(status->size),
+         static_cast<unsigned long>(status->crc), ok ? "" : ", unexpected");
+  return ok;
+}
+
+// Strokes `position` of the dial A, and returns whether it types `usage`.
+bool CheckStroke(const char* what,
+                 Board& board,
+                 uint8_t position,
+                 uint8_t usage) {
+  std::vector<uint8_t> usages = board.Stroke(position);
+  bool ok = usages.size() == 1 && usages[0] == usage;
+  printf("%s: dial A position %u typed", what,
+         static_cast<unsigned>(position));
+  for (uint8_t typed : usages) {
+    printf(" $%02x", typed);
+  }
+  if (!ok) {
+    printf(", $%02x expected", usage);
+  }
+  printf("\n");
+  return ok;
+}
+
+// The offset in flash of the record of `sequence`.
+std::optional<size_t> FindRecord(const std::vector<uint8_t>& flash,
+                                 uint32_t sequence) {
+  for (size_t offset = KeymapStore::kRegionOffset;
+       offset < KeymapStore::kRegionOffset + KeymapStore::kRegionSize;
+       offset += host::FlashModel::kPageSize) {
+    uint32_t magic;
+    uint32_t record_sequence;
+    memcpy(&magic, &flash[offset], sizeof(magic));
+    memcpy(&record_sequence, &flash[offset + kRecordSequenceOffset],
+           sizeof(record_sequence));
+    if (magic == kRecordMagic && record_sequence == sequence) {
+      return offset;
+    }
+  }
+  return std::nullopt;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 1) {
+    fprintf(stderr, "usage: %s\n", argv[0]);
+    return 2;
+  }
+  std::string image = std::string(IMAGE_DIR) + "/main.so";
+  int failures = 0;
+
+  // A position of the dial A with a usage, and two others for it.
+  uint8_t position = 1;
+  while (keymap::Lookup(keymap::kLayerBase, keymap::kDialA, position).type !=
+         keymap::KeyType::kUsage) {
+    ++position;
+  }
+  uint8_t built_in =
+      keymap::Lookup(keymap::kLayerBase, keymap::kDialA, position).value;
+  const uint8_t usages[2] = {
+      static_cast<uint8_t>(built_in == 0x04 ? 0x05 : 0x04),
+      static_cast<uint8_t>(built_in == 0x1d ? 0x1e : 0x1d)};
+  // The keymap of each sequence has the usage of its parity.
+  auto keymap_of = [&](uint32_t sequence) {
+    return MakeKeymap(position, usages[sequence % 2]);
+  };
+
+  std::vector<uint8_t> flash;
+  uint32_t sequence = 0;
+  {
+    Board board(image, nullptr);
+    failures += !CheckStatus("erased flash", board.Query(), kOk, 0, 0);
+    failures += !CheckStroke("built-in", board, position, built_in);
+
+    std::vector<uint8_t> keymap = keymap_of(++sequence);
+    failures += !CheckStatus("written", board.Write(keymap, Crc(keymap)), kOk,
+                             sequence, Crc(keymap));
+    failures += !CheckStroke("written", board, position, usages[1]);
+
+    std::vector<uint8_t> other = keymap_of(sequence + 1);
+    failures += !CheckStatus("bad CRC", board.Write(other, Crc(other) ^ 1),
+                             kBadCrc, sequence, Crc(keymap));
+    keymap::Key layer_key = {keymap::KeyType::kLayer, 0xff};
+    memcpy(other.data() + KeyOffset(position), &layer_key, sizeof(layer_key));
+    failures += !CheckStatus("no such layer", board.Write(other, Crc(other)),
+                             kBadLayout, sequence, Crc(keymap));
+    failures += !CheckStroke("rejected", board, position, usages[1]);
+
+    // Laps of the log, with the time each write takes.
+    size_t records = kLaps * KeymapStore::kRegionSize /
+                     ((kRecordHeaderSize + keymap.size() +
+                       host::FlashModel::kPageSize - 1) /
+                      host::FlashModel::kPageSize *
+                      host::FlashModel::kPageSize);
+    Nanoseconds max_write_time = 0;
+    Nanoseconds total_write_time = 0;
+    bool laps_ok = true;
+    for (size_t i = 0; i < records; ++i) {
+      keymap = keymap_of(++sequence);
+      Nanoseconds start = board.simulator().now();
+      std::optional<KeymapStatus> status = board.Write(keymap, Crc(keymap));
+      Nanoseconds time = board.simulator().now() - start;
+      max_write_time = std::max(max_write_time, time);
+      total_write_time += time;
+      if (!status || status->status != kOk || status->sequence != sequence) {
+        laps_ok = CheckStatus("lap", status, kOk, sequence, Crc(keymap));
+        break;
+      }
+    }
+    const std::vector<size_t>& erases = board.chip().flash().erase_counts();
+    size_t first_sector =
+        KeymapStore::kRegionOffset / host::FlashModel::kSectorSize;
+    auto [min_erases, max_erases] =
+        std::minmax_element(erases.begin() + first_sector, erases.end());
+    size_t outside = std::count_if(erases.begin(),
+                                   erases.begin() + first_sector,
+                                   [](size_t count) { return count != 0; });
+    laps_ok &= *min_erases > 0 && *max_erases - *min_erases <= 1 && !outside;
+    printf(
+        "laps: %zu keymaps written, %.1f ms each on average, %.1f ms at "
+        "most; sectors erased %zu to %zu times, %zu outside the log%s\n",
+        records, total_write_time / 1e6 / records, max_write_time / 1e6,
+        *min_erases, *max_erases, outside, laps_ok ? "" : ", unexpected");
+    failures += !laps_ok;
+    failures += !CheckStroke("laps", board, position, usages[sequence % 2]);
+    flash = board.chip().flash().contents();
+    failures += !host::CheckHeaps(board.simulator());
+  }
+
+  {
+    Board board(image, &flash);
+    failures += !CheckStatus("rebooted", board.Query(), kOk, sequence,
+                             Crc(keymap_of(sequence)));
+    failures +=
+        !CheckStroke("rebooted", board, position, usages[sequence % 2]);
+    failures += !host::CheckHeaps(board.simulator());
+  }
+
+  // A record torn by a reset is skipped, and the next one goes past it.
+  std::optional<size_t> torn = FindRecord(flash, sequence);
+  if (!torn) {
+    printf("torn: no record #%lu in flash\n",
+           static_cast<unsigned long>(sequence));
+    return 1;
+  }
+  flash[*torn + kRecordHeaderSize + KeyOffset(position)] ^= 0xff;
+  {
+    Board board(image, &flash);
+    failures += !CheckStatus("torn", board.Query(), kOk, sequence - 1,
+                             Crc(keymap_of(sequence - 1)));
+    failures +=
+        !CheckStroke("torn", board, position, usages[(sequence - 1) % 2]);
+    std::vector<uint8_t> keymap = keymap_of(sequence + 1);
+    failures += !CheckStatus("after torn", board.Write(keymap, Crc(keymap)),
+                             kOk, sequence + 1, Crc(keymap));
+    flash = board.chip().flash().contents();
+    failures += !host::CheckHeaps(board.simulator());
+  }
+  ++sequence;
+
+  {
+    Board board(image, &flash);
+    failures += !CheckStatus("rebooted", board.Query(), kOk, sequence,
+                             Crc(keymap_of(sequence)));
+    // An empty keymap goes back to the built-in one.
+    failures += !CheckStatus("empty", board.Write({}, Crc({})), kOk,
+                             sequence + 1, 0);
+    failures += !CheckStroke("empty", board, position, built_in);
+    failures += !host::CheckHeaps(board.simulator());
+  }
+  return failures ? 1 : 0;
+}
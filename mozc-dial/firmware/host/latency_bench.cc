@@ -0,0 +1,572 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+// Benchmarks the 9-dial main/sub pair end to end, from scripted strokes to
+// key reports, and writes the results in a machine-readable form for CI to
+// compare against earlier runs.
+//
+// Each stroke turns a dial along an angle-versus-time profile, that drives
+// its sensors with the Gray code of the position the angle is in, and lets
+// it go at the last point. From there the dial returns as the sub's motor
+// steps it back, as in return_sim, so a stroke measures the whole loop of
+// DialController, the main loop, MotorController and UsbHidKeyboard. A
+// stroke on a dial that is not back yet waits for it, as a user would.
+//
+// For each scenario, reports the latency from releasing a dial to its key
+// report, the time its motor takes to return it and make it ready for the
+// next stroke, the characters per minute, and dropped, duplicate and
+// unexpected keys. Exits with 1 if a key is dropped, duplicate or unexpected,
+// or a dial does not return.
+//
+// Usage: latency_bench [--dual-core] [--event-driven] [--early-commit]
+//                      [--sub-attention] [--usb-1ms] [--scenario FILE]
+//                      [--json FILE]
+//   --dual-core, --event-driven, --early-commit, --sub-attention and
+//   --usb-1ms select the images as in dial_sim.
+//   --scenario FILE  runs the strokes in FILE instead of the built-in
+//                    scenarios, one per line:
+//                      DIAL DELAY_MS MS:ANGLE [MS:ANGLE...]
+//                    DIAL is a letter from A to I, DELAY_MS the time from
+//                    the start of the previous stroke, and each MS:ANGLE a
+//                    point of the profile, in ms from the start of the
+//                    stroke and in positions from the base. '#' starts a
+//                    comment.
+//   --json FILE      writes the results to FILE, "-" for stdout.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../common/keymap.h"
+#include "../common/motor_controller.h"
+#include "../common/sub_protocol.h"
+#include "dial_waveform.h"
+#include "heap_check.h"
+#include "keyboard_report.h"
+#include "motor_coils.h"
+#include "simulator.h"
+#include "usb_controller_model.h"
+
+using host::Chip;
+using host::DialWaveform;
+using host::Nanoseconds;
+
+namespace {
+
+constexpr uint8_t kKeyboardEndpoint = 1;
+constexpr uint32_t kKeyboardPollIntervalInFrames = 10;
+// When the first stroke starts, after the sub is found.
+constexpr Nanoseconds kFirstStart = 100 * host::kMillisecond;
+// How soon a user turns a dial again once it is back.
+constexpr Nanoseconds kReaction = 40 * host::kMillisecond;
+// A scenario fails if nothing happens for this long before it is done.
+constexpr Nanoseconds kStuckTimeout = 2 * host::kSecond;
+// The scenario ends this long after the last dial is back, for its key.
+constexpr Nanoseconds kTail = 300 * host::kMillisecond;
+constexpr uint8_t kStepsPerPosition =
+    MotorController::kDefaultProfile.steps_per_position;
+
+struct DialSpec {
+  char name;
+  bool on_sub;
+  std::vector<uint8_t> gpios;
+  keymap::Dial keymap_dial;
+};
+
+// In main's order, where the index is also the motor on the sub. Must match
+// main/main.cc and sub/sub.cc.
+const DialSpec kDials[] = {
+    {'A', false, {1, 2, 3, 4, 5, 6}, keymap::kDialA},
+    {'B', false, {7, 8}, keymap::kDialB},
+    {'C', false, {9, 10, 11}, keymap::kDialC},
+    {'D', false, {12, 13}, keymap::kDialD},
+    {'E', false, {15, 16, 17}, keymap::kDialE},
+    {'F', false, {18, 19, 20}, keymap::kDialF},
+    {'G', false, {21, 22}, keymap::kDialG},
+    {'I', false, {24, 25, 26, 27}, keymap::kDialI},
+    {'H', true, {26, 27}, keymap::kDialH},
+};
+static_assert(std::size(kDials) == host::MotorCoils::kNumOfMotors);
+
+struct Stroke {
+  size_t dial;
+  // From the start of the previous stroke, at the earliest.
+  Nanoseconds delay;
+  std::vector<DialWaveform::Keyframe> profile;
+};
+
+struct Scenario {
+  std::string name;
+  std::vector<Stroke> strokes;
+};
+
+// Turns to the middle of `position` at 10 ms a position, and holds it there.
+std::vector<DialWaveform::Keyframe> Turn(uint8_t position,
+                                         Nanoseconds hold) {
+  Nanoseconds turned = position * 10 * host::kMillisecond;
+  return {{turned, position + 0.5}, {turned + hold, position + 0.5}};
+}
+
+// Eases into `position` and shakes at the finger stop without leaving it.
+std::vector<DialWaveform::Keyframe> Wobble(uint8_t position) {
+  Nanoseconds ms = host::kMillisecond;
+  Nanoseconds turned = position * 14 * ms;
+  return {{turned / 3, position * 0.2},
+          {turned, position + 0.5},
+          {turned + 8 * ms, position + 0.9},
+          {turned + 16 * ms, position + 0.1},
+          {turned + 24 * ms, position + 0.7},
+          {turned + 40 * ms, position + 0.4}};
+}
+
+// Positions with a key, on each dial but C, that has only modifiers.
+const std::pair<size_t, uint8_t> kKeys[] = {
+    {0, 5}, {1, 2}, {3, 2}, {4, 3}, {5, 2}, {6, 1}, {7, 4}, {8, 2}, {0, 20},
+};
+
+std::vector<Scenario> BuiltInScenarios() {
+  Nanoseconds ms = host::kMillisecond;
+  std::vector<Scenario> scenarios;
+  // Each key alone, with every dial back before the next stroke.
+  Scenario& single = scenarios.emplace_back(Scenario{"single", {}});
+  for (const auto& [dial, position] : kKeys) {
+    single.strokes.push_back({dial, 600 * ms, Turn(position, 30 * ms)});
+  }
+  // All keys 10 ms apart, so that the dials are back close together and
+  // their keys queue up.
+  Scenario& burst = scenarios.emplace_back(Scenario{"burst", {}});
+  for (const auto& [dial, position] : kKeys) {
+    burst.strokes.push_back({dial, 10 * ms, Turn(position, 200 * ms)});
+  }
+  // Sustained typing over all keys in a fixed, scattered order: each stroke
+  // 60 ms after the previous one is let go, or once its dial is back.
+  Scenario& typing = scenarios.emplace_back(Scenario{"typing", {}});
+  Nanoseconds previous = 0;
+  for (size_t i = 0; i < 45; ++i) {
+    const auto& [dial, position] = kKeys[(i * 4) % std::size(kKeys)];
+    std::vector<DialWaveform::Keyframe> profile = Turn(position, 30 * ms);
+    typing.strokes.push_back({dial, previous + 60 * ms, profile});
+    previous = profile.back().time;
+  }
+  // The same key over and over, bound by the motor return.
+  Scenario& repeat = scenarios.emplace_back(Scenario{"repeat", {}});
+  for (size_t i = 0; i < 16; ++i) {
+    repeat.strokes.push_back({1, 0, Turn(2, 30 * ms)});
+  }
+  // Uneven strokes that shake at the finger stop.
+  Scenario& wobble = scenarios.emplace_back(Scenario{"wobble", {}});
+  for (const auto& [dial, position] : kKeys) {
+    wobble.strokes.push_back({dial, 600 * ms, Wobble(position)});
+  }
+  return scenarios;
+}
+
+std::optional<Scenario> ReadScenario(const char* path) {
+  std::ifstream file(path);
+  if (!file) {
+    fprintf(stderr, "cannot read %s\n", path);
+    return std::nullopt;
+  }
+  Scenario scenario;
+  scenario.name = path;
+  scenario.name = scenario.name.substr(scenario.name.find_last_of('/') + 1);
+  std::string line;
+  for (size_t number = 1; std::getline(file, line); ++number) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream fields(line);
+    std::string dial;
+    if (!(fields >> dial)) {
+      continue;
+    }
+    auto spec = std::find_if(std::begin(kDials), std::end(kDials),
+                             [&](const DialSpec& d) {
+                               return dial.size() == 1 && dial[0] == d.name;
+                             });
+    double delay_ms = 0;
+    Stroke stroke = {static_cast<size_t>(spec - std::begin(kDials)), 0, {}};
+    bool ok = spec != std::end(kDials) && (fields >> delay_ms) && delay_ms >= 0;
+    stroke.delay = delay_ms * host::kMillisecond;
+    double ms;
+    char colon;
+    double angle;
+    while (ok && (fields >> ms >> colon >> angle)) {
+      ok = colon == ':' && ms >= 0 &&
+           (stroke.profile.empty() ||
+            ms * host::kMillisecond >= stroke.profile.back().time);
+      stroke.profile.push_back({static_cast<Nanoseconds>(ms * 1e6), angle});
+    }
+    if (!ok || !fields.eof() || stroke.profile.empty() ||
+        stroke.profile.back().angle < 1) {
+      fprintf(stderr, "%s:%zu: not DIAL DELAY_MS MS:ANGLE..., ending off "
+              "the base\n", path, number);
+      return std::nullopt;
+    }
+    scenario.strokes.push_back(std::move(stroke));
+  }
+  return scenario;
+}
+
+struct KeyEvent {
+  Nanoseconds time;
+  uint8_t usage;
+  bool matched = false;
+};
+
+struct Result {
+  std::string name;
+  size_t keys = 0;
+  size_t reported = 0;
+  size_t dropped = 0;
+  size_t duplicates = 0;
+  size_t unexpected = 0;
+  size_t stuck = 0;
+  // From letting a dial go to its key report, and back at the base.
+  std::vector<Nanoseconds> latencies;
+  std::vector<Nanoseconds> returns;
+  double chars_per_minute = 0;
+  bool heaps_ok = true;
+};
+
+Result Run(const std::string& main_image,
+           const std::string& sub_image,
+           uint32_t poll_interval_in_frames,
+           bool sub_attention,
+           const Scenario& scenario) {
+  host::Simulator simulator;
+  Chip& main_chip = simulator.AddChip("main", main_image);
+  Chip& sub_chip = simulator.AddChip("sub", sub_image);
+  simulator.ConnectI2C(main_chip, 0, sub_chip, 0);
+
+  std::vector<std::unique_ptr<DialWaveform>> waveforms;
+  for (const auto& dial : kDials) {
+    waveforms.push_back(std::make_unique<DialWaveform>(
+        dial.on_sub ? sub_chip : main_chip, dial.gpios));
+  }
+
+  // Where each stroke is.
+  struct Progress {
+    Nanoseconds start = 0;
+    Nanoseconds release = 0;
+    std::optional<Nanoseconds> back;
+    uint8_t position = 0;
+  };
+  std::vector<Progress> progress(scenario.strokes.size());
+  // Each dial is turned by a stroke, or returned by its motor from
+  // `position`, until it is back at the base and ready.
+  struct DialState {
+    std::optional<size_t> stroke = std::nullopt;
+    bool returning = false;
+    uint8_t position = 0;
+    uint32_t steps = 0;
+    Nanoseconds ready = 0;
+  };
+  std::vector<DialState> dials(std::size(kDials));
+  size_t next_stroke = 0;
+  Nanoseconds previous_start = kFirstStart;
+  Nanoseconds last_progress = 0;
+
+  // Starts the strokes in order, each as its dial is ready.
+  auto start_strokes = [&] {
+    while (next_stroke < scenario.strokes.size()) {
+      const Stroke& stroke = scenario.strokes[next_stroke];
+      DialState& dial = dials[stroke.dial];
+      if (dial.stroke) {
+        return;
+      }
+      Nanoseconds start =
+          std::max({next_stroke ? previous_start + stroke.delay : kFirstStart,
+                    dial.ready ? dial.ready + kReaction : 0, simulator.now()});
+      size_t index = next_stroke++;
+      dial.stroke = index;
+      previous_start = start;
+      progress[index].start = start;
+      progress[index].release = start + stroke.profile.back().time;
+      progress[index].position =
+          waveforms[stroke.dial]->AddProfile(start, stroke.profile);
+      uint8_t released = static_cast<uint8_t>(std::clamp(
+          stroke.profile.back().angle, 0.0,
+          static_cast<double>(waveforms[stroke.dial]->max_position())));
+      simulator.Schedule(progress[index].release, [&, &dial = dial, released] {
+        dial.returning = true;
+        dial.position = released;
+        dial.steps = 0;
+        last_progress = simulator.now();
+      });
+    }
+  };
+  host::MotorCoils coils([&](size_t motor, Nanoseconds time) {
+    simulator.Schedule(time, [&, motor, time] {
+      DialState& dial = dials[motor];
+      if (!dial.returning || !dial.position) {
+        return;
+      }
+      ++dial.steps;
+      uint8_t position = dial.position - std::min<uint32_t>(
+          dial.position, dial.steps / kStepsPerPosition);
+      if (dial.steps % kStepsPerPosition == 0) {
+        waveforms[motor]->SetPosition(time, position);
+      }
+      if (position) {
+        return;
+      }
+      progress[*dial.stroke].back = time;
+      dial = {.ready = time};
+      last_progress = time;
+      start_strokes();
+    });
+  });
+  sub_chip.SetOutputObserver([&](uint32_t outputs, uint32_t changed) {
+    coils.OnOutputs(outputs, sub_chip.time());
+    constexpr uint32_t kMask = 1u << sub_protocol::kSubAttentionGpio;
+    if (!sub_attention || !(changed & kMask)) {
+      return;
+    }
+    bool level = outputs & kMask;
+    simulator.Schedule(sub_chip.time(), [&main_chip, level] {
+      main_chip.DriveInput(sub_protocol::kMainAttentionGpio, level);
+    });
+  });
+
+  std::vector<KeyEvent> presses;
+  std::set<uint8_t> pressed;
+  main_chip.usb().SetInPollInterval(kKeyboardEndpoint,
+                                    poll_interval_in_frames);
+  main_chip.usb().SetInListener(
+      [&](uint8_t endpoint, std::span<const uint8_t> data) {
+        if (endpoint != kKeyboardEndpoint) {
+          return;
+        }
+        std::optional<std::set<uint8_t>> keys =
+            host::DecodeKeyboardReport(data);
+        if (!keys) {
+          return;
+        }
+        for (uint8_t key : *keys) {
+          if (!pressed.contains(key)) {
+            presses.push_back({simulator.now(), key});
+          }
+        }
+        pressed = *keys;
+      });
+
+  simulator.Schedule(0, start_strokes);
+  while (true) {
+    simulator.RunUntil(simulator.now() + 10 * host::kMillisecond);
+    bool all_back = next_stroke == scenario.strokes.size() &&
+                    std::none_of(dials.begin(), dials.end(),
+                                 [](const DialState& d) { return d.stroke; });
+    if ((all_back && simulator.now() >= last_progress + kTail) ||
+        simulator.now() >= std::max(last_progress, kFirstStart) +
+                               kStuckTimeout) {
+      break;
+    }
+  }
+
+  Result result;
+  result.name = scenario.name;
+  result.keys = scenario.strokes.size();
+  result.heaps_ok = host::CheckHeaps(simulator);
+  std::set<uint8_t> usages;
+  std::optional<Nanoseconds> last_press;
+  // In the order the dials are let go, as their keys go out.
+  std::vector<size_t> order(scenario.strokes.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return progress[a].release < progress[b].release;
+  });
+  for (size_t i : order) {
+    const Stroke& stroke = scenario.strokes[i];
+    if (i >= next_stroke) {
+      ++result.dropped;
+      continue;
+    }
+    if (!progress[i].back) {
+      ++result.stuck;
+    } else {
+      result.returns.push_back(*progress[i].back - progress[i].release);
+    }
+    uint8_t usage = keymap::Lookup(keymap::kLayerBase,
+                                   kDials[stroke.dial].keymap_dial,
+                                   progress[i].position)
+                        .value;
+    usages.insert(usage);
+    auto it = std::find_if(presses.begin(), presses.end(),
+                           [&](const KeyEvent& event) {
+                             return !event.matched && event.usage == usage &&
+                                    event.time >= progress[i].release;
+                           });
+    if (it == presses.end()) {
+      ++result.dropped;
+      continue;
+    }
+    it->matched = true;
+    ++result.reported;
+    result.latencies.push_back(it->time - progress[i].release);
+    last_press = std::max(last_press.value_or(0), it->time);
+  }
+  for (const KeyEvent& event : presses) {
+    if (!event.matched) {
+      ++(usages.contains(event.usage) ? result.duplicates : result.unexpected);
+    }
+  }
+  if (last_press && !progress.empty()) {
+    result.chars_per_minute =
+        result.reported * 60e9 / (*last_press - progress[0].start);
+  }
+  return result;
+}
+
+double ToMs(Nanoseconds ns) {
+  return ns / 1e6;
+}
+
+Nanoseconds Percentile(std::vector<Nanoseconds> values, double percentile) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  size_t index = static_cast<size_t>(percentile / 100.0 * (values.size() - 1));
+  return values[index];
+}
+
+bool Failed(const Result& result) {
+  return result.dropped || result.duplicates || result.unexpected ||
+         result.stuck || !result.heaps_ok;
+}
+
+void WriteJson(FILE* file,
+               const std::string& variant,
+               uint32_t poll_interval_ms,
+               const std::vector<Result>& results) {
+  fprintf(file, "{\n  \"variant\": \"%s\",\n  \"poll_interval_ms\": %u,\n",
+          variant.c_str(), static_cast<unsigned>(poll_interval_ms));
+  fprintf(file, "  \"scenarios\": [\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& r = results[i];
+    fprintf(file,
+            "    {\"name\": \"%s\", \"keys\": %zu, \"reported\": %zu, "
+            "\"dropped\": %zu, \"duplicates\": %zu, \"unexpected\": %zu, "
+            "\"stuck\": %zu,\n",
+            r.name.c_str(), r.keys, r.reported, r.dropped, r.duplicates,
+            r.unexpected, r.stuck);
+    fprintf(file,
+            "     \"latency_ms\": {\"p50\": %.3f, \"p99\": %.3f, "
+            "\"max\": %.3f},\n",
+            ToMs(Percentile(r.latencies, 50)),
+            ToMs(Percentile(r.latencies, 99)),
+            ToMs(Percentile(r.latencies, 100)));
+    fprintf(file,
+            "     \"motor_return_ms\": {\"p50\": %.3f, \"p99\": %.3f, "
+            "\"max\": %.3f},\n",
+            ToMs(Percentile(r.returns, 50)), ToMs(Percentile(r.returns, 99)),
+            ToMs(Percentile(r.returns, 100)));
+    fprintf(file, "     \"chars_per_minute\": %.1f, \"passed\": %s}%s\n",
+            r.chars_per_minute, Failed(r) ? "false" : "true",
+            i + 1 < results.size() ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool dual_core = false;
+  bool event_driven = false;
+  bool early_commit = false;
+  bool sub_attention = false;
+  bool usb_1ms = false;
+  const char* scenario_path = nullptr;
+  const char* json_path = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--dual-core")) {
+      dual_core = true;
+    } else if (!strcmp(argv[i], "--event-driven")) {
+      event_driven = true;
+    } else if (!strcmp(argv[i], "--early-commit")) {
+      early_commit = true;
+    } else if (!strcmp(argv[i], "--sub-attention")) {
+      sub_attention = true;
+    } else if (!strcmp(argv[i], "--usb-1ms")) {
+      usb_1ms = true;
+    } else if (!strcmp(argv[i], "--scenario") && i + 1 < argc) {
+      scenario_path = argv[++i];
+    } else if (!strcmp(argv[i], "--json") && i + 1 < argc) {
+      json_path = argv[++i];
+    } else {
+      fprintf(stderr,
+              "usage: %s [--dual-core] [--event-driven] [--early-commit] "
+              "[--sub-attention] [--usb-1ms] [--scenario FILE] "
+              "[--json FILE]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  // Images are named after the build options, see host/CMakeLists.txt.
+  std::string variant = std::string("main") +
+                        (dual_core ? "_dual_core" : "") +
+                        (event_driven ? "_event_driven" : "") +
+                        (early_commit ? "_early_commit" : "") +
+                        (sub_attention ? "_sub_attention" : "") +
+                        (usb_1ms ? "_usb_1ms" : "");
+  std::string main_image = std::string(IMAGE_DIR) + "/" + variant + ".so";
+  std::string sub_image = std::string(IMAGE_DIR) + "/sub" +
+                          (early_commit ? "_early_commit" : "") +
+                          (sub_attention ? "_sub_attention" : "") + ".so";
+  uint32_t poll_interval = usb_1ms ? 1 : kKeyboardPollIntervalInFrames;
+
+  std::vector<Scenario> scenarios;
+  if (scenario_path) {
+    std::optional<Scenario> scenario = ReadScenario(scenario_path);
+    if (!scenario) {
+      return 2;
+    }
+    scenarios.push_back(std::move(*scenario));
+  } else {
+    scenarios = BuiltInScenarios();
+  }
+
+  int failures = 0;
+  std::vector<Result> results;
+  printf("scenario  keys  dropped  dup  unexp  stuck  latency ms p50    p99  "
+         "return ms p50    p99    chars/min\n");
+  for (const Scenario& scenario : scenarios) {
+    Result result = Run(main_image, sub_image, poll_interval, sub_attention,
+                        scenario);
+    printf("%-8s  %4zu  %7zu  %3zu  %5zu  %5zu  %14.1f  %5.1f  %13.1f  "
+           "%5.1f  %11.0f\n",
+           result.name.c_str(), result.keys, result.dropped,
+           result.duplicates, result.unexpected, result.stuck,
+           ToMs(Percentile(result.latencies, 50)),
+           ToMs(Percentile(result.latencies, 99)),
+           ToMs(Percentile(result.returns, 50)),
+           ToMs(Percentile(result.returns, 99)), result.chars_per_minute);
+    if (Failed(result)) {
+      ++failures;
+    }
+    results.push_back(std::move(result));
+  }
+
+  if (json_path) {
+    FILE* file = strcmp(json_path, "-") ? fopen(json_path, "w") : stdout;
+    if (!file) {
+      fprintf(stderr, "cannot write %s\n", json_path);
+      return 2;
+    }
+    WriteJson(file, variant, poll_interval, results);
+    if (file != stdout) {
+      fclose(file);
+    }
+  }
+  return failures ? 1 : 0;
+}
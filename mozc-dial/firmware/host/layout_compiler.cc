@@ -0,0 +1,422 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+// Compiles a keymap layout, such as common/gboard_dial.layout, into the
+// constexpr tables of common/keymap_layout.h, see common/keymap.h:
+//
+//   layout_compiler [--check | --binary] LAYOUT OUTPUT
+//
+// With --check, OUTPUT is left as it is, and the exit status is non-zero if
+// it is not what LAYOUT compiles to. With --binary, OUTPUT is the keymap in
+// the format of keymap::StoredLayout instead, to write to a keyboard with
+// dial_telemetry --keymap.
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// As keymap::KeyType.
+enum class KeyType { kNone, kUsage, kModifier, kLayer, kFirstLayer };
+
+struct Key {
+  KeyType type = KeyType::kNone;
+  int value = 0;
+  // The layer name of a kLayer key, until all layers are known.
+  std::string layer;
+};
+
+struct Layer {
+  std::string name;
+  // Keys by dial, by position.
+  std::vector<std::vector<Key>> dials;
+};
+
+struct Layout {
+  std::vector<std::string> dials;
+  std::vector<Layer> layers;
+};
+
+const std::map<std::string, int> kModifiers = {
+    {"lctrl", 1 << 0}, {"lshift", 1 << 1}, {"lalt", 1 << 2},
+    {"lgui", 1 << 3},  {"rctrl", 1 << 4},  {"rshift", 1 << 5},
+    {"ralt", 1 << 6},  {"rgui", 1 << 7},
+};
+
+class Parser {
+ public:
+  explicit Parser(std::string path) : path_(std::move(path)) {}
+
+  std::optional<Layout> Parse() {
+    std::ifstream in(path_);
+    if (!in) {
+      fprintf(stderr, "%s: cannot read\n", path_.c_str());
+      return std::nullopt;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+      ++line_number_;
+      line = line.substr(0, line.find('#'));
+      std::istringstream words(line);
+      std::string word;
+      if (!(words >> word)) {
+        continue;
+      }
+      bool ok = word == "dials"   ? ParseDials(words)
+                : word == "layer" ? ParseLayer(words)
+                                  : ParseKeys(word, words);
+      if (!ok) {
+        return std::nullopt;
+      }
+    }
+    if (layout_.layers.empty()) {
+      Error("no layers");
+      return std::nullopt;
+    }
+    if (!ResolveLayers()) {
+      return std::nullopt;
+    }
+    return layout_;
+  }
+
+ private:
+  // Prints `message` at the current line, and returns false.
+  bool Error(const std::string& message) {
+    fprintf(stderr, "%s:%d: %s\n", path_.c_str(), line_number_,
+            message.c_str());
+    return false;
+  }
+
+  static bool IsName(const std::string& name) {
+    if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) {
+      return false;
+    }
+    for (char c : name) {
+      if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool ParseDials(std::istringstream& words) {
+    if (!layout_.dials.empty() || !layout_.layers.empty()) {
+      return Error("dials must come once, before the layers");
+    }
+    std::string name;
+    while (words >> name) {
+      if (!IsName(name) || FindDial(name)) {
+        return Error("bad or duplicate dial name " + name);
+      }
+      layout_.dials.push_back(name);
+    }
+    if (layout_.dials.empty() || layout_.dials.size() > 255) {
+      return Error("1 to 255 dials expected");
+    }
+    return true;
+  }
+
+  bool ParseLayer(std::istringstream& words) {
+    std::string name;
+    std::string rest;
+    if (layout_.dials.empty()) {
+      return Error("layer before dials");
+    }
+    if (!(words >> name) || words >> rest || !IsName(name) ||
+        FindLayer(name)) {
+      return Error("bad or duplicate layer name");
+    }
+    layout_.layers.push_back({name, std::vector<std::vector<Key>>(
+                                        layout_.dials.size())});
+    return true;
+  }
+
+  bool ParseKeys(const std::string& dial_name, std::istringstream& words) {
+    std::optional<size_t> dial = FindDial(dial_name);
+    if (!dial || layout_.layers.empty()) {
+      return Error("unknown dial " + dial_name + ", or no layer yet");
+    }
+    std::vector<Key>& keys = layout_.layers.back().dials[*dial];
+    std::string word;
+    while (words >> word) {
+      std::optional<Key> key = ParseKey(word);
+      if (!key) {
+        return Error("bad key " + word);
+      }
+      if (key->type == KeyType::kFirstLayer && layout_.layers.size() == 1) {
+        return Error("_ in the first layer");
+      }
+      keys.push_back(*key);
+    }
+    if (keys.size() > 255) {
+      return Error("more than 255 positions");
+    }
+    return true;
+  }
+
+  static std::optional<Key> ParseKey(const std::string& word) {
+    if (word == "-") {
+      return Key{};
+    }
+    if (word == "_") {
+      return Key{KeyType::kFirstLayer, 0, {}};
+    }
+    if (auto it = kModifiers.find(word); it != kModifiers.end()) {
+      return Key{KeyType::kModifier, it->second, {}};
+    }
+    if (word.starts_with("layer:")) {
+      return Key{KeyType::kLayer, 0, word.substr(strlen("layer:"))};
+    }
+    char* end = nullptr;
+    long usage = strtol(word.c_str(), &end, 0);
+    if (word.empty() || *end || usage <= 0 || usage > 0xff) {
+      return std::nullopt;
+    }
+    return Key{KeyType::kUsage, static_cast<int>(usage), {}};
+  }
+
+  // Resolves `_` and layer names, and pads each dial to the same number of
+  // positions in all layers.
+  bool ResolveLayers() {
+    for (size_t dial = 0; dial < layout_.dials.size(); ++dial) {
+      size_t positions = 0;
+      for (const Layer& layer : layout_.layers) {
+        positions = std::max(positions, layer.dials[dial].size());
+      }
+      for (Layer& layer : layout_.layers) {
+        layer.dials[dial].resize(positions);
+      }
+    }
+    for (Layer& layer : layout_.layers) {
+      for (size_t dial = 0; dial < layout_.dials.size(); ++dial) {
+        std::vector<Key>& keys = layer.dials[dial];
+        for (size_t position = 0; position < keys.size(); ++position) {
+          Key& key = keys[position];
+          if (key.type == KeyType::kFirstLayer) {
+            key = layout_.layers[0].dials[dial][position];
+          }
+          if (key.type == KeyType::kLayer) {
+            std::optional<size_t> target = FindLayer(key.layer);
+            if (!target) {
+              return Error("unknown layer " + key.layer);
+            }
+            key.value = *target;
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  std::optional<size_t> FindDial(const std::string& name) const {
+    for (size_t i = 0; i < layout_.dials.size(); ++i) {
+      if (layout_.dials[i] == name) {
+        return i;
+      }
+    }
+    return std::nullopt;
+  }
+
+  std::optional<size_t> FindLayer(const std::string& name) const {
+    for (size_t i = 0; i < layout_.layers.size(); ++i) {
+      if (layout_.layers[i].name == name) {
+        return i;
+      }
+    }
+    return std::nullopt;
+  }
+
+  const std::string path_;
+  int line_number_ = 0;
+  Layout layout_;
+};
+
+std::string ConstantName(const std::string& prefix, const std::string& name) {
+  std::string result = prefix;
+  bool upper = true;
+  for (char c : name) {
+    if (c == '_') {
+      upper = true;
+      continue;
+    }
+    result += upper ? std::toupper(static_cast<unsigned char>(c)) : c;
+    upper = false;
+  }
+  return result;
+}
+
+std::string FormatKey(const Key& key) {
+  char buffer[32];
+  switch (key.type) {
+    case KeyType::kUsage:
+      snprintf(buffer, sizeof(buffer), "{KeyType::kUsage, 0x%02x}", key.value);
+      break;
+    case KeyType::kModifier:
+      snprintf(buffer, sizeof(buffer), "{KeyType::kModifier, 0x%02x}",
+               key.value);
+      break;
+    case KeyType::kLayer:
+      snprintf(buffer, sizeof(buffer), "{KeyType::kLayer, %d}", key.value);
+      break;
+    default:
+      return "{}";
+  }
+  return buffer;
+}
+
+std::string Generate(const Layout& layout, const std::string& source) {
+  std::ostringstream out;
+  out << "// Generated by host/layout_compiler from " << source
+      << ". Do not edit.\n"
+         "// Included by keymap.h.\n"
+         "\n"
+         "#ifndef COMMON_KEYMAP_LAYOUT_H_\n"
+         "#define COMMON_KEYMAP_LAYOUT_H_\n"
+         "\n"
+         "namespace keymap {\n"
+         "\n";
+
+  out << "enum Layer : uint8_t {\n";
+  for (const Layer& layer : layout.layers) {
+    out << "  " << ConstantName("kLayer", layer.name) << ",\n";
+  }
+  out << "};\n"
+         "\n"
+         "enum Dial : uint8_t {\n";
+  for (const std::string& dial : layout.dials) {
+    out << "  " << ConstantName("kDial", dial) << ",\n";
+  }
+  out << "};\n\n";
+
+  std::vector<size_t> first;
+  size_t layer_size = 0;
+  for (const std::vector<Key>& keys : layout.layers[0].dials) {
+    first.push_back(layer_size);
+    layer_size += keys.size();
+  }
+  out << "inline constexpr size_t kNumLayers = " << layout.layers.size()
+      << ";\n"
+      << "inline constexpr size_t kNumDials = " << layout.dials.size() << ";\n"
+      << "inline constexpr size_t kLayerSize = " << layer_size << ";\n"
+      << "\n"
+         "inline constexpr DialIndex kDialIndex[kNumDials] = {\n";
+  for (size_t dial = 0; dial < layout.dials.size(); ++dial) {
+    out << "    {" << first[dial] << ", "
+        << layout.layers[0].dials[dial].size() << "},  // "
+        << layout.dials[dial] << "\n";
+  }
+  out << "};\n"
+         "\n"
+         "inline constexpr Key kKeys[kNumLayers * kLayerSize] = {\n";
+  for (const Layer& layer : layout.layers) {
+    for (size_t dial = 0; dial < layout.dials.size(); ++dial) {
+      const std::vector<Key>& keys = layer.dials[dial];
+      if (keys.empty()) {
+        continue;
+      }
+      out << "    // " << layer.name << " " << layout.dials[dial] << "\n";
+      for (const Key& key : keys) {
+        out << "    " << FormatKey(key) << ",\n";
+      }
+    }
+  }
+  out << "};\n"
+         "\n"
+         "}  // namespace keymap\n"
+         "\n"
+         "#endif  // COMMON_KEYMAP_LAYOUT_H_\n";
+  return out.str();
+}
+
+// The layout as keymap::StoredLayout.
+std::string GenerateBinary(const Layout& layout) {
+  std::string out;
+  auto put16 = [&out](int value) {
+    out += static_cast<char>(value & 0xff);
+    out += static_cast<char>(value >> 8);
+  };
+  size_t layer_size = 0;
+  for (const std::vector<Key>& keys : layout.layers[0].dials) {
+    layer_size += keys.size();
+  }
+  out += static_cast<char>(layout.layers.size());
+  out += static_cast<char>(layout.dials.size());
+  put16(layer_size);
+  size_t first = 0;
+  for (const std::vector<Key>& keys : layout.layers[0].dials) {
+    put16(first);
+    out += static_cast<char>(keys.size());
+    out += '\0';
+    first += keys.size();
+  }
+  for (const Layer& layer : layout.layers) {
+    for (const std::vector<Key>& keys : layer.dials) {
+      for (const Key& key : keys) {
+        out += static_cast<char>(key.type);
+        out += static_cast<char>(key.type == KeyType::kNone ? 0 : key.value);
+      }
+    }
+  }
+  return out;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool check = argc == 4 && !strcmp(argv[1], "--check");
+  bool binary = argc == 4 && !strcmp(argv[1], "--binary");
+  if (argc != 3 && !check && !binary) {
+    fprintf(stderr, "usage: %s [--check | --binary] LAYOUT OUTPUT\n",
+            argv[0]);
+    return 2;
+  }
+  std::string layout_path = argv[argc - 2];
+  std::string output_path = argv[argc - 1];
+  std::optional<Layout> layout = Parser(layout_path).Parse();
+  if (!layout) {
+    return 1;
+  }
+  if (layout->layers.size() > 255) {
+    fprintf(stderr, "%s: more than 255 layers\n", layout_path.c_str());
+    return 1;
+  }
+  size_t slash = layout_path.rfind('/');
+  std::string generated =
+      binary ? GenerateBinary(*layout)
+             : Generate(*layout, slash == std::string::npos
+                                     ? layout_path
+                                     : layout_path.substr(slash + 1));
+
+  if (check) {
+    std::ifstream in(output_path);
+    std::ostringstream current;
+    current << in.rdbuf();
+    if (current.str() != generated) {
+      fprintf(stderr,
+              "%s is not up to date with %s; run layout_compiler %s %s\n",
+              output_path.c_str(), layout_path.c_str(), layout_path.c_str(),
+              output_path.c_str());
+      return 1;
+    }
+    return 0;
+  }
+  std::ofstream out(output_path, std::ios::binary);
+  out << generated;
+  if (!out) {
+    fprintf(stderr, "%s: cannot write\n", output_path.c_str());
+    return 1;
+  }
+  return 0;
+}
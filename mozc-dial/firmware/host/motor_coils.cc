@@ -0,0 +1,49 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#include "motor_coils.h"
+
+namespace host {
+
+MotorCoils::MotorCoils(StepListener listener)
+    : listener_(std::move(listener)) {}
+
+void MotorCoils::OnOutputs(uint32_t outputs, Nanoseconds time) {
+  if (time - last_time_ >= kMinPulse) {
+    std::array<std::optional<uint8_t>, kNumOfMotors> coils =
+        Decode(last_outputs_);
+    for (size_t i = 0; i < kNumOfMotors; ++i) {
+      if (!coils[i]) {
+        continue;
+      }
+      if (coils_[i] && ((*coils_[i] + 4 - *coils[i]) & 3) == 1) {
+        listener_(i, last_time_);
+      }
+      coils_[i] = coils[i];
+    }
+  }
+  last_outputs_ = outputs;
+  last_time_ = time;
+}
+
+std::array<std::optional<uint8_t>, MotorCoils::kNumOfMotors>
+MotorCoils::Decode(uint32_t outputs) {
+  std::array<std::optional<uint8_t>, kNumOfMotors> coils;
+  for (uint8_t decoder = 0; decoder < 4; ++decoder) {
+    uint8_t first_gpio = 1 + decoder * 4;
+    if (!(outputs & (1u << (first_gpio + 3)))) {
+      continue;
+    }
+    uint8_t motor = (outputs >> first_gpio) & 7;
+    coils[motor] = (decoder + 4 - motor % 4) & 3;
+  }
+  for (uint8_t coil = 0; coil < 4; ++coil) {
+    if (outputs & (1u << (17 + coil))) {
+      coils[8] = coil;
+    }
+  }
+  return coils;
+}
+
+}  // namespace host
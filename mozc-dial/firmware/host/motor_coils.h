@@ -0,0 +1,51 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_MOTOR_COILS_H_
+#define HOST_MOTOR_COILS_H_
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <optional>
+
+#include "simulator.h"
+
+namespace host {
+
+// Follows the coils the motors of a sub of the 9-dial edition energize, from
+// its output pins wired as in common/motor_controller.cc, and tells each step
+// a motor takes to return its dial. MotorController runs the coils backwards
+// for that; a coil two away is a step the rotor cannot follow.
+class MotorCoils final {
+ public:
+  static constexpr size_t kNumOfMotors = 9;
+  // Coils energized for less than this are glitches while a decoder changes
+  // its address pins, that the motors do not follow.
+  static constexpr Nanoseconds kMinPulse = 10 * kMicrosecond;
+
+  using StepListener = std::function<void(size_t motor, Nanoseconds time)>;
+
+  explicit MotorCoils(StepListener listener);
+  MotorCoils(const MotorCoils&) = delete;
+  MotorCoils& operator=(const MotorCoils&) = delete;
+  ~MotorCoils() = default;
+
+  // Takes the output pins of the chip, as they change at `time`.
+  void OnOutputs(uint32_t outputs, Nanoseconds time);
+
+  // The coil each motor has energized at `outputs`.
+  static std::array<std::optional<uint8_t>, kNumOfMotors> Decode(
+      uint32_t outputs);
+
+ private:
+  StepListener listener_;
+  uint32_t last_outputs_ = 0;
+  Nanoseconds last_time_ = 0;
+  std::array<std::optional<uint8_t>, kNumOfMotors> coils_;
+};
+
+}  // namespace host
+
+#endif  // HOST_MOTOR_COILS_H_
@@ -0,0 +1,117 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+// Strokes the dial of one_dial to each of its positions that types a usage,
+// and checks that it types the key of the dial A in the built-in keymap, and
+// that its motor steps while the dial is away from the base. Exits with 1 on
+// a failure.
+//
+// Usage: one_dial_sim
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <set>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "../common/keymap.h"
+#include "dial_waveform.h"
+#include "heap_check.h"
+#include "keyboard_report.h"
+#include "motor_coils.h"
+#include "simulator.h"
+#include "usb_controller_model.h"
+
+using host::Chip;
+using host::DialWaveform;
+using host::Nanoseconds;
+
+namespace {
+
+constexpr uint8_t kKeyboardEndpoint = 1;
+constexpr uint32_t kKeyboardPollIntervalInFrames = 10;
+// Must match one_dial/one_dial.cc.
+const std::vector<uint8_t> kDialGpios = {2, 3, 4, 5, 6, 7};
+// The motor on GPIO17 to 20 is the 9th one of MotorCoils.
+constexpr size_t kMotor = 8;
+constexpr Nanoseconds kBootTime = 100 * host::kMillisecond;
+// Time for the last key report after the dial is back.
+constexpr Nanoseconds kSettleTime = 100 * host::kMillisecond;
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 1) {
+    fprintf(stderr, "usage: %s\n", argv[0]);
+    return 2;
+  }
+  host::Simulator simulator;
+  Chip& chip =
+      simulator.AddChip("one_dial", std::string(IMAGE_DIR) + "/one_dial.so");
+  DialWaveform dial(chip, kDialGpios);
+
+  size_t steps = 0;
+  host::MotorCoils coils([&steps](size_t motor, Nanoseconds) {
+    steps += motor == kMotor;
+  });
+  chip.SetOutputObserver([&](uint32_t outputs, uint32_t) {
+    coils.OnOutputs(outputs, chip.time());
+  });
+
+  std::vector<uint8_t> usages;
+  std::set<uint8_t> pressed;
+  chip.usb().SetInPollInterval(kKeyboardEndpoint,
+                               kKeyboardPollIntervalInFrames);
+  chip.usb().SetInListener(
+      [&](uint8_t endpoint, std::span<const uint8_t> data) {
+        if (endpoint != kKeyboardEndpoint) {
+          return;
+        }
+        std::optional<std::set<uint8_t>> keys =
+            host::DecodeKeyboardReport(data);
+        if (!keys) {
+          return;
+        }
+        for (uint8_t key : *keys) {
+          if (!pressed.contains(key)) {
+            usages.push_back(key);
+          }
+        }
+        pressed = *keys;
+      });
+  simulator.RunUntil(kBootTime);
+
+  int failures = 0;
+  size_t strokes = 0;
+  for (uint8_t position = 1; position <= dial.max_position(); ++position) {
+    keymap::Key key =
+        keymap::Lookup(keymap::kLayerBase, keymap::kDialA, position);
+    if (key.type != keymap::KeyType::kUsage) {
+      continue;
+    }
+    usages.clear();
+    steps = 0;
+    DialWaveform::StrokeTiming timing =
+        dial.AddStroke(simulator.now() + host::kMillisecond, position, {});
+    simulator.RunUntil(timing.back + kSettleTime);
+    ++strokes;
+    bool ok = usages.size() == 1 && usages[0] == key.value && steps;
+    if (ok) {
+      continue;
+    }
+    printf("position %u typed", static_cast<unsigned>(position));
+    for (uint8_t typed : usages) {
+      printf(" $%02x", typed);
+    }
+    printf(", $%02x expected, with %zu motor steps, unexpected\n", key.value,
+           steps);
+    ++failures;
+  }
+  printf("one_dial: %zu strokes, %d unexpected\n", strokes, failures);
+  failures += !host::CheckHeaps(simulator);
+  return failures ? 1 : 0;
+}
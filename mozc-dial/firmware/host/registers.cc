@@ -0,0 +1,130 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#include "registers.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "hardware/address_mapped.h"
+
+namespace host {
+
+namespace {
+
+struct Mapping {
+  uintptr_t begin;
+  size_t size;
+  bool aliased;
+  RegisterBlock* block;
+};
+
+std::vector<Mapping>& Mappings() {
+  static std::vector<Mapping> mappings;
+  return mappings;
+}
+
+const Mapping* Find(uintptr_t address) {
+  for (const auto& mapping : Mappings()) {
+    size_t extent = mapping.size * (mapping.aliased ? 4 : 1);
+    if (address >= mapping.begin && address < mapping.begin + extent) {
+      return &mapping;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+void RegisterBlock::Write(io_rw_32& reg, uint32_t value, RegisterAlias alias) {
+  switch (alias) {
+    case RegisterAlias::kNormal:
+      reg.value = value;
+      break;
+    case RegisterAlias::kXor:
+      reg.value ^= value;
+      break;
+    case RegisterAlias::kSet:
+      reg.value |= value;
+      break;
+    case RegisterAlias::kClear:
+      reg.value &= ~value;
+      break;
+  }
+}
+
+// static
+void RegisterBlock::Map(void* begin,
+                        size_t size,
+                        bool aliased,
+                        RegisterBlock* block) {
+  Mappings().push_back(
+      {reinterpret_cast<uintptr_t>(begin), size, aliased, block});
+}
+
+// static
+void RegisterBlock::Unmap(RegisterBlock* block) {
+  auto& mappings = Mappings();
+  mappings.erase(std::remove_if(mappings.begin(), mappings.end(),
+                                [block](const Mapping& mapping) {
+                                  return mapping.block == block;
+                                }),
+                 mappings.end());
+}
+
+// static
+void* RegisterBlock::GetAlias(volatile void* addr, RegisterAlias alias) {
+  uintptr_t address = reinterpret_cast<uintptr_t>(addr);
+  const Mapping* mapping = Find(address);
+  if (!mapping || !mapping->aliased) {
+    fprintf(stderr, "no register alias for %p\n", addr);
+    abort();
+  }
+  size_t offset = (address - mapping->begin) % mapping->size;
+  return reinterpret_cast<void*>(mapping->begin +
+                                 static_cast<size_t>(alias) * mapping->size +
+                                 offset);
+}
+
+}  // namespace host
+
+io_rw_32::operator uint32_t() const {
+  uintptr_t address = reinterpret_cast<uintptr_t>(this);
+  const host::Mapping* mapping = host::Find(address);
+  if (!mapping) {
+    return value;
+  }
+  size_t offset = (address - mapping->begin) % mapping->size;
+  return mapping->block->Read(
+      *reinterpret_cast<const io_rw_32*>(mapping->begin + offset));
+}
+
+io_rw_32& io_rw_32::operator=(uint32_t new_value) {
+  uintptr_t address = reinterpret_cast<uintptr_t>(this);
+  const host::Mapping* mapping = host::Find(address);
+  if (!mapping) {
+    value = new_value;
+    return *this;
+  }
+  size_t offset = (address - mapping->begin) % mapping->size;
+  auto alias = static_cast<host::RegisterAlias>(
+      (address - mapping->begin) / mapping->size);
+  mapping->block->Write(*reinterpret_cast<io_rw_32*>(mapping->begin + offset),
+                        new_value, alias);
+  return *this;
+}
+
+void* hw_xor_alias_untyped(volatile void* addr) {
+  return host::RegisterBlock::GetAlias(addr, host::RegisterAlias::kXor);
+}
+
+void* hw_set_alias_untyped(volatile void* addr) {
+  return host::RegisterBlock::GetAlias(addr, host::RegisterAlias::kSet);
+}
+
+void* hw_clear_alias_untyped(volatile void* addr) {
+  return host::RegisterBlock::GetAlias(addr, host::RegisterAlias::kClear);
+}
@@ -0,0 +1,38 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_REGISTERS_H_
+#define HOST_REGISTERS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "pico/types.h"
+
+namespace host {
+
+enum class RegisterAlias { kNormal = 0, kXor = 1, kSet = 2, kClear = 3 };
+
+// A model of a memory mapped peripheral. Accesses to io_rw_32 objects inside
+// a registered range are forwarded here instead of touching plain memory.
+class RegisterBlock {
+ public:
+  virtual ~RegisterBlock() = default;
+
+  // `reg` always points into the normal alias.
+  virtual uint32_t Read(const io_rw_32& reg) { return reg.value; }
+  virtual void Write(io_rw_32& reg, uint32_t value, RegisterAlias alias);
+
+  // Maps [begin, begin + size) to `block`. With `aliased`, the range is
+  // followed by XOR, set and clear copies of `size` bytes each.
+  static void Map(void* begin, size_t size, bool aliased, RegisterBlock* block);
+  static void Unmap(RegisterBlock* block);
+
+  // The address of `addr` in the `alias` copy of its block.
+  static void* GetAlias(volatile void* addr, RegisterAlias alias);
+};
+
+}  // namespace host
+
+#endif  // HOST_REGISTERS_H_
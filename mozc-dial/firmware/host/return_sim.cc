@@ -0,0 +1,193 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+// Times the return of a dial by its motor, from each position to the base,
+// with MotorController::kFixedProfile, the speed before motors had profiles,
+// and with kFastProfile. Then releases all nine dials a few milliseconds
+// apart, so that the motors on the decoders step out of phase and take turns.
+//
+// The dials are modelled from the motor coils the chip energizes: a dial
+// returns by a position every kStepsPerPosition steps, and the motor follows
+// every step. The firmware side stands for the sub of the 9-dial edition, and
+// sees the dial positions at once, without the sensors and I2C of main.
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <vector>
+
+#include "../common/motor_controller.h"
+#include "motor_coils.h"
+#include "pico/stdlib.h"
+#include "simulator.h"
+
+using host::Chip;
+using host::Nanoseconds;
+
+namespace {
+
+constexpr size_t kNumOfMotors = host::MotorCoils::kNumOfMotors;
+constexpr uint8_t kMaxPosition = 36;  // Dial A
+constexpr uint8_t kStepsPerPosition = 5;
+// How often the firmware side passes the positions to the motors.
+constexpr uint32_t kPollIntervalUs = 100;
+
+// One dial, moved by the steps of its motor.
+struct Dial {
+  uint8_t position = 0;
+  uint32_t steps = 0;
+  uint8_t start_position = 0;
+  Nanoseconds release = 0;
+  std::optional<Nanoseconds> back;
+
+  void Step(Nanoseconds time) {
+    if (!position) {
+      return;
+    }
+    ++steps;
+    position = std::max(0, start_position -
+                               static_cast<int>(steps / kStepsPerPosition));
+    if (!position) {
+      back = time;
+    }
+  }
+};
+
+std::array<Dial, kNumOfMotors> sDials;
+// The worst latency of the motor refresh over all runs.
+uint32_t sMaxRefreshLatencyUs = 0;
+
+// Releases each dial in `releases`, a motor index and a position, at the
+// given time, and returns the time each took back to the base, or nullopt if
+// it did not make it in time. `idle` tells whether the motor refresh stopped
+// once all dials were back.
+std::vector<std::optional<Nanoseconds>> Run(
+    const MotorController::Profile& profile,
+    const std::vector<std::pair<Nanoseconds, std::pair<size_t, uint8_t>>>&
+        releases,
+    bool* idle) {
+  sDials = {};
+  host::Simulator simulator;
+  Chip* chip = nullptr;
+  chip = &simulator.AddChip("sub", [&]() -> int {
+    host::MotorCoils coils(
+        [](size_t motor, Nanoseconds time) { sDials[motor].Step(time); });
+    chip->SetOutputObserver([&](uint32_t outputs, uint32_t) {
+      coils.OnOutputs(outputs, chip->time());
+    });
+
+    MotorController motor_controller;
+    for (uint8_t i = 0; i < kNumOfMotors; ++i) {
+      motor_controller.SetProfile(i, profile);
+    }
+    while (true) {
+      for (uint8_t i = 0; i < kNumOfMotors; ++i) {
+        if (sDials[i].position) {
+          motor_controller.Start(i, sDials[i].position);
+        } else {
+          motor_controller.Stop(i);
+        }
+      }
+      sMaxRefreshLatencyUs =
+          std::max(sMaxRefreshLatencyUs,
+                   motor_controller.refresh_latency().GetStats().max_us);
+      sleep_us(kPollIntervalUs);
+    }
+    return 0;
+  });
+
+  Nanoseconds end = 0;
+  for (const auto& [time, release] : releases) {
+    auto [motor, position] = release;
+    simulator.Schedule(time, [&dial = sDials[motor], time, position] {
+      dial.start_position = position;
+      dial.position = position;
+      dial.steps = 0;
+      dial.release = time;
+      dial.back.reset();
+    });
+    // Far more than the slowest return.
+    end = std::max(end, time + position * 50 * host::kMillisecond);
+  }
+  simulator.RunUntil(end + 100 * host::kMillisecond);
+  *idle = chip->repeating_timers() == 0;
+
+  std::vector<std::optional<Nanoseconds>> times;
+  for (const auto& [time, release] : releases) {
+    const Dial& dial = sDials[release.first];
+    times.push_back(dial.back ? std::optional(*dial.back - dial.release)
+                              : std::nullopt);
+  }
+  return times;
+}
+
+double ToMs(Nanoseconds ns) {
+  return ns / 1e6;
+}
+
+}  // namespace
+
+int main() {
+  int failures = 0;
+  bool idle = true;
+  auto print = [&](const std::optional<Nanoseconds>& time) {
+    if (!time) {
+      ++failures;
+      printf("  %8s", "stuck");
+      return;
+    }
+    printf("  %8.1f", ToMs(*time));
+  };
+
+  printf("position  fixed ms   fast ms\n");
+  for (uint8_t position = 1; position <= kMaxPosition; ++position) {
+    printf("%8d", position);
+    for (const MotorController::Profile& profile :
+         {MotorController::kFixedProfile, MotorController::kFastProfile}) {
+      bool run_idle = false;
+      print(Run(profile, {{0, {0, position}}}, &run_idle)[0]);
+      idle &= run_idle;
+    }
+    printf("\n");
+  }
+
+  // All dials from the middle of the dial A, 3 ms apart.
+  std::vector<std::pair<Nanoseconds, std::pair<size_t, uint8_t>>> releases;
+  for (size_t i = 0; i < kNumOfMotors; ++i) {
+    releases.push_back({i * 3 * host::kMillisecond, {i, kMaxPosition / 2}});
+  }
+  printf("nine dials from position %d, 3 ms apart, mean and max ms:\n",
+         kMaxPosition / 2);
+  for (const auto& [name, profile] :
+       {std::pair{"fixed", MotorController::kFixedProfile},
+        std::pair{"fast", MotorController::kFastProfile}}) {
+    bool run_idle = false;
+    std::vector<std::optional<Nanoseconds>> times =
+        Run(profile, releases, &run_idle);
+    idle &= run_idle;
+    Nanoseconds total = 0;
+    Nanoseconds max = 0;
+    bool stuck = false;
+    for (const auto& time : times) {
+      stuck |= !time;
+      total += time.value_or(0);
+      max = std::max(max, time.value_or(0));
+    }
+    if (stuck) {
+      ++failures;
+    }
+    printf("%8s  %8.1f  %8.1f%s\n", name, ToMs(total / times.size()),
+           ToMs(max), stuck ? ", some stuck" : "");
+  }
+  // With all dials at the base, the motors take no CPU time.
+  printf("motor refresh stopped at the base: %s\n", idle ? "yes" : "no");
+  printf("worst motor refresh latency: %u us\n",
+         static_cast<unsigned>(sMaxRefreshLatencyUs));
+  if (!idle) {
+    ++failures;
+  }
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,354 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+// Runs main with one, three and five sub-controllers, as boards of 9, 18 and
+// 27 dials, turns all dials at about the same time, and reports how often the
+// local dials and the dials on each sub are sampled against the number of
+// dials, and how long their keys take to be reported from the dials back at
+// the base, as they come in a burst.
+// Exits with 1 if a key is missing or unexpected, or if the dials of a larger
+// board are sampled less often than kMinRateRatio of the 9-dial board's.
+//
+// The 18- and 27-dial boards add pairs of a sensor board, that has eight
+// dials wired as main's, and a sub of the 9-dial edition, that has one more
+// dial and the motors of nine.
+//
+// Usage: scale_sim [--dual-core] [--event-driven] [--usb-1ms]
+//                  [--address-assignment]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../common/keymap.h"
+#include "dial_waveform.h"
+#include "heap_check.h"
+#include "i2c_bus.h"
+#include "keyboard_report.h"
+#include "simulator.h"
+#include "usb_controller_model.h"
+
+using host::Chip;
+using host::DialWaveform;
+using host::I2CBus;
+using host::Nanoseconds;
+
+namespace {
+
+constexpr uint8_t kKeyboardEndpoint = 1;
+constexpr uint32_t kKeyboardPollIntervalInFrames = 10;
+constexpr uint8_t kLoopProbeGpio = 1;  // Sensor A bit 0
+// How much less often the dials may be sampled as subs are added.
+constexpr double kMinRateRatio = 0.9;
+
+struct LocalDial {
+  std::vector<uint8_t> gpios;
+  keymap::Dial keymap_dial;
+  // A position with a key, or 0 to leave the dial alone.
+  uint8_t position;
+};
+
+// The main's dials and the sensor board's, A to G and I, in main's order.
+// Must match main/main.cc and sub/sub.cc.
+const LocalDial kLocalDials[] = {
+    {{1, 2, 3, 4, 5, 6}, keymap::kDialA, 5},
+    {{7, 8}, keymap::kDialB, 2},
+    {{9, 10, 11}, keymap::kDialC, 0},  // Modifiers only.
+    {{12, 13}, keymap::kDialD, 2},
+    {{15, 16, 17}, keymap::kDialE, 3},
+    {{18, 19, 20}, keymap::kDialF, 2},
+    {{21, 22}, keymap::kDialG, 1},
+    {{24, 25, 26, 27}, keymap::kDialI, 4},
+};
+// The dial H on the sub of the 9-dial edition.
+const LocalDial kSubDial = {{26, 27}, keymap::kDialH, 2};
+
+struct Board {
+  const char* image;
+  bool sensor_board;
+};
+
+// In the order of their slots.
+const Board kBoards[] = {
+    {"sub", false},
+    {"sub_sensor_board_slot1", true},
+    {"sub_slot2", false},
+    {"sub_sensor_board_slot3", true},
+    {"sub_slot4", false},
+};
+
+struct KeyEvent {
+  Nanoseconds time;
+  uint8_t usage;
+  bool matched = false;
+};
+
+struct Result {
+  size_t dials = 0;
+  size_t subs = 0;
+  // Samples per second while all dials are off the base.
+  double local_rate = 0;
+  double min_sub_rate = 0;
+  double mean_sub_rate = 0;
+  double bus_bytes_per_second = 0;
+  // From each dial back at the base to its key report.
+  Nanoseconds mean_key_latency = 0;
+  Nanoseconds max_key_latency = 0;
+  size_t reports = 0;
+  int failures = 0;
+};
+
+Result Run(const std::string& main_image,
+           const std::string& sub_suffix,
+           uint32_t poll_interval_in_frames,
+           size_t num_subs) {
+  host::Simulator simulator;
+  Chip& main_chip = simulator.AddChip("main", main_image);
+  std::vector<Chip*> sub_chips;
+  for (size_t i = 0; i < num_subs; ++i) {
+    sub_chips.push_back(&simulator.AddChip(
+        "sub" + std::to_string(i),
+        std::string(IMAGE_DIR) + "/" + kBoards[i].image + sub_suffix +
+            ".so"));
+  }
+  I2CBus& bus = simulator.ConnectI2C(main_chip, 0, *sub_chips[0], 0);
+  for (size_t i = 1; i < num_subs; ++i) {
+    simulator.ConnectI2C(bus, *sub_chips[i], 0);
+  }
+
+  // All dials in main's order: the local ones, then the subs' in slot order.
+  std::vector<std::unique_ptr<DialWaveform>> waveforms;
+  std::vector<const LocalDial*> dials;
+  for (const LocalDial& dial : kLocalDials) {
+    waveforms.push_back(std::make_unique<DialWaveform>(main_chip, dial.gpios));
+    dials.push_back(&dial);
+  }
+  for (size_t i = 0; i < num_subs; ++i) {
+    if (kBoards[i].sensor_board) {
+      for (const LocalDial& dial : kLocalDials) {
+        waveforms.push_back(
+            std::make_unique<DialWaveform>(*sub_chips[i], dial.gpios));
+        dials.push_back(&dial);
+      }
+    } else {
+      waveforms.push_back(
+          std::make_unique<DialWaveform>(*sub_chips[i], kSubDial.gpios));
+      dials.push_back(&kSubDial);
+    }
+  }
+
+  // Each 9 dials turn 10 ms apart, and hold long enough that all dials are
+  // off the base together for a while. Every 9 dials start 40 ms after the
+  // previous ones, so that the same keys do not overlap.
+  DialWaveform::StrokeProfile profile;
+  profile.hold = 200 * host::kMillisecond;
+  struct Stroke {
+    size_t dial;
+    DialWaveform::StrokeTiming timing;
+    Nanoseconds turned;
+    // The index of its key in the presses.
+    std::optional<size_t> press = std::nullopt;
+  };
+  std::vector<Stroke> strokes;
+  Nanoseconds all_off = 0;
+  Nanoseconds first_back = host::kForever;
+  Nanoseconds end = 0;
+  for (size_t i = 0; i < dials.size(); ++i) {
+    if (!dials[i]->position) {
+      continue;
+    }
+    Nanoseconds start =
+        (100 + (i % 9) * 10 + (i / 9) * 40) * host::kMillisecond;
+    DialWaveform::StrokeTiming timing =
+        waveforms[i]->AddStroke(start, dials[i]->position, profile);
+    Nanoseconds turned = start + dials[i]->position * profile.turn_per_position;
+    strokes.push_back({i, timing, turned});
+    all_off = std::max(all_off, turned);
+    first_back = std::min(first_back, timing.release);
+    end = std::max(end, timing.back);
+  }
+  end += 100 * host::kMillisecond;
+
+  std::optional<uint64_t> local_samples_at_start;
+  uint64_t local_samples = 0;
+  uint64_t local_samples_at_end = 0;
+  main_chip.SetInputReadObserver([&](uint32_t mask) {
+    if (mask & (1u << kLoopProbeGpio)) {
+      ++local_samples;
+    }
+  });
+  simulator.Schedule(all_off, [&] { local_samples_at_start = local_samples; });
+  simulator.Schedule(first_back,
+                     [&] { local_samples_at_end = local_samples; });
+  // The subs sample their own sensors; count the samples of each sub's first
+  // dial in the same window.
+  std::vector<uint64_t> sub_samples(num_subs);
+  for (size_t i = 0; i < num_subs; ++i) {
+    Chip& chip = *sub_chips[i];
+    uint32_t probe = 1u << (kBoards[i].sensor_board
+                                ? kLocalDials[0].gpios[0]
+                                : kSubDial.gpios[0]);
+    chip.SetInputReadObserver([&, i, probe](uint32_t mask) {
+      if ((mask & probe) && chip.time() >= all_off &&
+          chip.time() < first_back) {
+        ++sub_samples[i];
+      }
+    });
+  }
+
+  std::vector<KeyEvent> presses;
+  std::set<uint8_t> pressed;
+  size_t reports = 0;
+  main_chip.usb().SetInPollInterval(kKeyboardEndpoint,
+                                    poll_interval_in_frames);
+  main_chip.usb().SetInListener(
+      [&](uint8_t endpoint, std::span<const uint8_t> data) {
+        if (endpoint != kKeyboardEndpoint) {
+          return;
+        }
+        std::optional<std::set<uint8_t>> keys =
+            host::DecodeKeyboardReport(data);
+        if (!keys) {
+          return;
+        }
+        ++reports;
+        for (uint8_t key : *keys) {
+          if (!pressed.contains(key)) {
+            presses.push_back({simulator.now(), key});
+          }
+        }
+        pressed = *keys;
+      });
+
+  simulator.RunUntil(end);
+
+  Result result;
+  result.dials = dials.size();
+  result.subs = num_subs;
+  double window = (first_back - all_off) / 1e9;
+  result.local_rate =
+      (local_samples_at_end - local_samples_at_start.value_or(0)) / window;
+  result.min_sub_rate = HUGE_VAL;
+  for (size_t i = 0; i < num_subs; ++i) {
+    double rate = sub_samples[i] / window;
+    result.min_sub_rate = std::min(result.min_sub_rate, rate);
+    result.mean_sub_rate += rate / num_subs;
+  }
+  result.bus_bytes_per_second = bus.bytes() / (end / 1e9);
+  if (!host::CheckHeaps(simulator)) {
+    ++result.failures;
+  }
+  result.reports = reports;
+
+  std::sort(strokes.begin(), strokes.end(), [](const auto& a, const auto& b) {
+    return a.timing.release < b.timing.release;
+  });
+  for (Stroke& stroke : strokes) {
+    const LocalDial& dial = *dials[stroke.dial];
+    uint8_t usage =
+        keymap::Lookup(keymap::kLayerBase, dial.keymap_dial, dial.position)
+            .value;
+    auto it = std::find_if(presses.begin(), presses.end(),
+                           [&](const KeyEvent& event) {
+                             return !event.matched && event.usage == usage &&
+                                    event.time >= stroke.timing.release;
+                           });
+    if (it == presses.end()) {
+      printf("%zu dials: dial %zu position %d: usage $%02x missing\n",
+             dials.size(), stroke.dial + 1, dial.position, usage);
+      ++result.failures;
+      continue;
+    }
+    it->matched = true;
+    stroke.press = it - presses.begin();
+    Nanoseconds latency = it->time - std::min(it->time, stroke.timing.back);
+    result.mean_key_latency += latency / strokes.size();
+    result.max_key_latency = std::max(result.max_key_latency, latency);
+  }
+  // Keys go out in the order the dials are back at the base; the keys of one
+  // report count in usage order, as hosts take them.
+  for (const Stroke& a : strokes) {
+    for (const Stroke& b : strokes) {
+      if (a.press && b.press && a.timing.back < b.timing.back &&
+          *a.press > *b.press) {
+        printf("%zu dials: dial %zu reported after dial %zu\n", dials.size(),
+               a.dial + 1, b.dial + 1);
+        ++result.failures;
+      }
+    }
+  }
+  for (const auto& event : presses) {
+    if (!event.matched) {
+      printf("%zu dials: unexpected usage $%02x at %.3f ms\n", dials.size(),
+             event.usage, event.time / 1e6);
+      ++result.failures;
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool dual_core = false;
+  bool event_driven = false;
+  bool usb_1ms = false;
+  bool address_assignment = false;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--dual-core")) {
+      dual_core = true;
+    } else if (!strcmp(argv[i], "--event-driven")) {
+      event_driven = true;
+    } else if (!strcmp(argv[i], "--usb-1ms")) {
+      usb_1ms = true;
+    } else if (!strcmp(argv[i], "--address-assignment")) {
+      address_assignment = true;
+    } else {
+      fprintf(stderr,
+              "usage: %s [--dual-core] [--event-driven] [--usb-1ms] "
+              "[--address-assignment]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  // Images are named after the build options, see host/CMakeLists.txt.
+  std::string main_image = std::string(IMAGE_DIR) + "/main" +
+                           (dual_core ? "_dual_core" : "") +
+                           (event_driven ? "_event_driven" : "") +
+                           (usb_1ms ? "_usb_1ms" : "") +
+                           (address_assignment ? "_sub_address_assignment"
+                                               : "") +
+                           ".so";
+  std::string sub_suffix = address_assignment ? "_address_assignment" : "";
+
+  int failures = 0;
+  std::optional<Result> first;
+  printf("dials  subs  local samples/s  sub samples/s min  mean  "
+         "i2c bytes/s  reports  key ms from base mean  max\n");
+  for (size_t num_subs : {1, 3, 5}) {
+    Result result = Run(main_image, sub_suffix,
+                        usb_1ms ? 1 : kKeyboardPollIntervalInFrames, num_subs);
+    printf("%5zu  %4zu  %15.0f  %17.0f  %4.0f  %11.0f  %7zu  %21.1f  %3.0f\n",
+           result.dials, result.subs, result.local_rate, result.min_sub_rate,
+           result.mean_sub_rate, result.bus_bytes_per_second, result.reports,
+           result.mean_key_latency / 1e6, result.max_key_latency / 1e6);
+    failures += result.failures;
+    if (!first) {
+      first = result;
+    } else if (result.local_rate < kMinRateRatio * first->local_rate ||
+               result.min_sub_rate < kMinRateRatio * first->min_sub_rate) {
+      printf("%zu dials: sampled less than %.0f%% as often as %zu dials\n",
+             result.dials, kMinRateRatio * 100, first->dials);
+      ++failures;
+    }
+  }
+  return failures ? 1 : 0;
+}
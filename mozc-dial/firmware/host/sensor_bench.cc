@@ -0,0 +1,126 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+// Compares sampling the eight local dial sensors of the main chip with
+// PhotoSensor::Read(), one gpio_get() per bit, against one SensorBank
+// snapshot. Reports GPIO reads, virtual time and the skew between the first
+// and last sample per round, and the host time per round.
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#include "../common/photo_sensor.h"
+#include "../common/sensor_bank.h"
+#include "simulator.h"
+
+using host::Chip;
+using host::Nanoseconds;
+
+namespace {
+
+constexpr int kRounds = 100000;
+
+struct Result {
+  uint64_t reads = 0;
+  Nanoseconds virtual_time = 0;
+  Nanoseconds max_skew = 0;
+  double host_ns = 0;
+};
+
+// Timestamps of the first and last sample in the current round.
+Nanoseconds sRoundFirst = 0;
+Nanoseconds sRoundLast = 0;
+uint64_t sReads = 0;
+
+void StartRound() {
+  sRoundFirst = host::kForever;
+  sRoundLast = 0;
+}
+
+template <typename Round>
+Result Measure(Chip& chip, Round round) {
+  Result result;
+  uint32_t sink = 0;
+  sReads = 0;
+  Nanoseconds start = chip.time();
+  auto host_start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kRounds; ++i) {
+    StartRound();
+    sink += round();
+    result.max_skew = std::max(result.max_skew, sRoundLast - sRoundFirst);
+  }
+  auto host_time = std::chrono::steady_clock::now() - host_start;
+  result.reads = sReads;
+  result.virtual_time = chip.time() - start;
+  result.host_ns =
+      std::chrono::duration<double, std::nano>(host_time).count() / kRounds;
+  if (sink == UINT32_MAX) {
+    printf("\n");  // Keeps `sink` alive.
+  }
+  return result;
+}
+
+void Print(const char* name, const Result& result) {
+  printf(
+      "%-28s %5.1f GPIO reads, %6.1f ns virtual, skew %5.1f ns, "
+      "host %6.1f ns per round\n",
+      name, static_cast<double>(result.reads) / kRounds,
+      static_cast<double>(result.virtual_time) / kRounds,
+      static_cast<double>(result.max_skew), result.host_ns);
+}
+
+}  // namespace
+
+int main() {
+  host::Simulator simulator;
+  Chip* chip = nullptr;
+  Result per_bit;
+  Result bank;
+  chip = &simulator.AddChip("bench", [&]() -> int {
+    chip->SetInputReadObserver([chip](uint32_t mask) {
+      ++sReads;
+      sRoundFirst = std::min(sRoundFirst, chip->time());
+      sRoundLast = std::max(sRoundLast, chip->time());
+    });
+
+    // Same wiring as main/main.cc.
+    std::array<PhotoSensor, 8> sensors = {
+        PhotoSensor(1, 2, 3, 4, 5, 6),  // A
+        PhotoSensor(7, 8),              // B
+        PhotoSensor(9, 10, 11),         // C
+        PhotoSensor(12, 13),            // D
+        PhotoSensor(15, 16, 17),        // E
+        PhotoSensor(18, 19, 20),        // F
+        PhotoSensor(21, 22),            // G
+        PhotoSensor(24, 25, 26, 27),    // I
+    };
+    per_bit = Measure(*chip, [&sensors] {
+      uint32_t sum = 0;
+      for (auto& sensor : sensors) {
+        sum += sensor.Read();
+      }
+      return sum;
+    });
+
+    SensorBank sensor_bank = {
+        {1, 6}, {7, 2}, {9, 3}, {12, 2}, {15, 3}, {18, 3}, {21, 2}, {24, 4},
+    };
+    bank = Measure(*chip, [&sensor_bank] {
+      uint32_t sum = 0;
+      sensor_bank.Sample();
+      for (size_t i = 0; i < sensor_bank.size(); ++i) {
+        sum += sensor_bank.Read(i);
+      }
+      return sum;
+    });
+    return 0;
+  });
+  simulator.RunUntil(host::kForever);
+
+  Print("PhotoSensor::Read() x 8", per_bit);
+  Print("SensorBank::Sample()", bank);
+  return 0;
+}
@@ -0,0 +1,682 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#include "simulator.h"
+
+#include <dlfcn.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+
+#include "flash_model.h"
+#include "hardware/gpio.h"
+#include "i2c_bus.h"
+#include "i2c_controller_model.h"
+#include "usb_controller_model.h"
+
+namespace host {
+
+namespace {
+
+// How far a chip may run ahead of another runnable chip before it yields.
+constexpr Nanoseconds kQuantum = 10 * kMicrosecond;
+
+Simulator* sSimulator = nullptr;
+
+// The chip whose peripherals the thread accesses, and the core that owns the
+// thread (nullptr on the simulator thread).
+thread_local Chip* tCurrentChip = nullptr;
+thread_local Core* tOwnerCore = nullptr;
+
+// Thrown into a chip's thread to unwind its firmware when the simulator is
+// destroyed.
+struct Halt {};
+
+// FNV-1a.
+uint64_t HashName(const std::string& name) {
+  uint64_t hash = 0xcbf29ce484222325u;
+  for (char c : name) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3u;
+  }
+  return hash;
+}
+
+// Images loaded in this process. dlopen() returns the loaded copy for a path
+// again, so another chip, or a later simulation, gets a private copy.
+std::set<std::string> sLoadedImages;
+
+void* LoadImage(const std::string& path) {
+  if (sLoadedImages.insert(path).second) {
+    return dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  }
+  char copy_path[] = "/tmp/dial_image_XXXXXX";
+  int fd = mkstemp(copy_path);
+  if (fd < 0) {
+    return nullptr;
+  }
+  {
+    std::ifstream in(path, std::ios::binary);
+    std::ofstream out(copy_path, std::ios::binary);
+    out << in.rdbuf();
+  }
+  close(fd);
+  void* image = dlopen(copy_path, RTLD_NOW | RTLD_LOCAL);
+  unlink(copy_path);
+  return image;
+}
+
+Nanoseconds ThreadCpuTime() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<Nanoseconds>(ts.tv_sec) * kSecond + ts.tv_nsec;
+}
+
+}  // namespace
+
+Simulator::Simulator() {
+  if (sSimulator) {
+    fprintf(stderr, "only one host::Simulator can exist at a time\n");
+    abort();
+  }
+  sSimulator = this;
+}
+
+Simulator::~Simulator() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    halting_ = true;
+  }
+  for (auto& chip : chips_) {
+    for (auto& core : chip->cores_) {
+      if (!core->thread_.joinable()) {
+        continue;
+      }
+      if (!core->finished_) {
+        Resume(*core, kForever);
+      }
+      core->thread_.join();
+    }
+  }
+  chips_.clear();
+  sSimulator = nullptr;
+}
+
+// static
+Simulator& Simulator::Get() {
+  if (!sSimulator) {
+    fprintf(stderr, "no host::Simulator is running\n");
+    abort();
+  }
+  return *sSimulator;
+}
+
+Chip& Simulator::AddChip(std::string name, std::string image_path) {
+  chips_.push_back(std::make_unique<Chip>(*this, std::move(name),
+                                         std::move(image_path), nullptr));
+  return *chips_.back();
+}
+
+Chip& Simulator::AddChip(std::string name, std::function<int()> entry) {
+  chips_.push_back(
+      std::make_unique<Chip>(*this, std::move(name), "", std::move(entry)));
+  return *chips_.back();
+}
+
+I2CBus& Simulator::ConnectI2C(Chip& a,
+                              uint8_t index_a,
+                              Chip& b,
+                              uint8_t index_b) {
+  i2c_buses_.push_back(std::make_unique<I2CBus>());
+  ConnectI2C(*i2c_buses_.back(), a, index_a);
+  ConnectI2C(*i2c_buses_.back(), b, index_b);
+  return *i2c_buses_.back();
+}
+
+void Simulator::ConnectI2C(I2CBus& bus, Chip& chip, uint8_t index) {
+  chip.set_i2c_bus(index, &bus);
+}
+
+void Simulator::Schedule(Nanoseconds time, std::function<void()> action) {
+  events_.push({std::max(time, now_), sequence_++, std::move(action)});
+  // An event a core schedules for itself, such as a timer, must not be
+  // overtaken by the rest of its turn.
+  if (tOwnerCore && time < tOwnerCore->horizon_) {
+    tOwnerCore->horizon_ = std::max(time, tOwnerCore->time_);
+  }
+}
+
+void Simulator::RunUntil(Nanoseconds time) {
+  for (auto& chip : chips_) {
+    Core& core = *chip->cores_[0];
+    if (!core.started_) {
+      core.started_ = true;
+      core.time_ = now_;
+    }
+  }
+  while (true) {
+    Core* next_core = nullptr;
+    for (auto& chip : chips_) {
+      for (auto& core : chip->cores_) {
+        if (core->runnable() &&
+            (!next_core || core->time_ < next_core->time_)) {
+          next_core = core.get();
+        }
+      }
+    }
+    Nanoseconds next_event = NextEventTime();
+    if (next_core && next_core->time_ < next_event &&
+        next_core->time_ < time) {
+      now_ = std::max(now_, next_core->time_);
+      Nanoseconds horizon = std::min(next_event, time);
+      for (auto& chip : chips_) {
+        for (auto& core : chip->cores_) {
+          if (core.get() != next_core && core->runnable()) {
+            horizon = std::min(horizon, core->time_ + kQuantum);
+          }
+        }
+      }
+      Resume(*next_core, horizon);
+      continue;
+    }
+    if (!events_.empty() && next_event <= time) {
+      Event event = events_.top();
+      events_.pop();
+      now_ = event.time;
+      event.action();
+      continue;
+    }
+    now_ = time;
+    break;
+  }
+}
+
+void Simulator::Resume(Core& core, Nanoseconds horizon) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  core.horizon_ = horizon;
+  core.has_turn_ = true;
+  core.cv_.notify_one();
+  cv_.wait(lock, [&core] { return !core.has_turn_; });
+}
+
+Nanoseconds Simulator::NextEventTime() const {
+  return events_.empty() ? kForever : events_.top().time;
+}
+
+struct Chip::RepeatingTimer {
+  void* key;
+  int64_t delay_us;
+  std::function<bool()> callback;
+  Nanoseconds next;
+  bool cancelled = false;
+};
+
+Chip::Chip(Simulator& simulator,
+           std::string name,
+           std::string image_path,
+           std::function<int()> entry)
+    : simulator_(simulator),
+      name_(std::move(name)),
+      image_path_(std::move(image_path)),
+      unique_id_(HashName(name_)),
+      usb_(std::make_unique<UsbControllerModel>(*this)),
+      i2c_{std::make_unique<I2CControllerModel>(*this, 0),
+           std::make_unique<I2CControllerModel>(*this, 1)},
+      flash_(std::make_unique<FlashModel>()) {
+  for (uint8_t i = 0; i < kNumOfCores; ++i) {
+    cores_[i] = std::make_unique<Core>(*this, i);
+  }
+  cores_[0]->Start(std::move(entry));
+}
+
+Chip::~Chip() = default;
+
+// static
+Chip& Chip::Current() {
+  if (!tCurrentChip) {
+    fprintf(stderr, "peripheral access outside of a simulated chip\n");
+    abort();
+  }
+  return *tCurrentChip;
+}
+
+Nanoseconds Chip::time() const {
+  Core* core = current_core();
+  return (core ? core : cores_[0].get())->time_;
+}
+
+Nanoseconds Chip::cpu_time() const {
+  Nanoseconds total = 0;
+  for (const auto& core : cores_) {
+    total += core->cpu_time_;
+  }
+  return total;
+}
+
+void* Chip::FindSymbol(const char* name) const {
+  return image_ ? dlsym(image_, name) : nullptr;
+}
+
+void Chip::DriveInput(uint8_t gpio, bool level) {
+  uint32_t bit = 1u << gpio;
+  uint32_t inputs = level ? (inputs_ | bit) : (inputs_ & ~bit);
+  bool changed = !(driven_ & bit) || inputs != inputs_;
+  uint32_t before = levels();
+  driven_ |= bit;
+  inputs_ = inputs;
+  uint32_t after = levels();
+  uint32_t edges = (before ^ after) & ~output_enables_;
+  uint32_t events = ((edges & after & irq_rises_) ? GPIO_IRQ_EDGE_RISE : 0) |
+                    ((edges & ~after & irq_falls_) ? GPIO_IRQ_EDGE_FALL : 0);
+  if (events) {
+    RaiseInterrupt(
+        [this, gpio, events] {
+          if (gpio_irq_handler_) {
+            gpio_irq_handler_(gpio, events);
+          }
+        },
+        gpio_irq_core_);
+  }
+  if (!changed) {
+    return;
+  }
+  for (auto& core : cores_) {
+    if (core->idle_ && core->wake_on_input_) {
+      core->Wake(simulator_.now_);
+    }
+  }
+}
+
+void Chip::ReleaseInput(uint8_t gpio) {
+  driven_ &= ~(1u << gpio);
+}
+
+void Chip::SetOutputObserver(OutputObserver observer) {
+  output_observer_ = std::move(observer);
+}
+
+void Chip::SetInputReadObserver(InputReadObserver observer) {
+  input_read_observer_ = std::move(observer);
+}
+
+Core* Chip::current_core() const {
+  return tOwnerCore && &tOwnerCore->chip_ == this ? tOwnerCore : nullptr;
+}
+
+bool Chip::InInterrupt() const {
+  Core* core = current_core();
+  return !core || core->in_interrupt_;
+}
+
+void Chip::Consume(Nanoseconds cost) {
+  if (Core* core = current_core()) {
+    core->Consume(cost);
+  }
+}
+
+void Chip::WaitForEvent() {
+  if (Core* core = current_core()) {
+    core->WaitForEvent();
+  }
+}
+
+void Chip::Sleep(bool wfi) {
+  if (Core* core = current_core()) {
+    core->Sleep(wfi);
+  }
+}
+
+void Chip::SendEvent() {
+  for (auto& core : cores_) {
+    core->SendEvent();
+  }
+}
+
+void Chip::RaiseInterrupt(std::function<void()> handler, uint8_t core_index) {
+  Core& core = *cores_[core_index];
+  core.interrupts_.push(std::move(handler));
+  if (core.idle_) {
+    core.Wake(caller_time());
+  }
+}
+
+void Chip::WakeCore(uint8_t core_index) {
+  Core& core = *cores_[core_index];
+  if (core.idle_) {
+    core.Wake(caller_time());
+  }
+}
+
+bool Chip::MaskInterrupts(bool masked) {
+  Core* core = current_core();
+  if (!core) {
+    return false;
+  }
+  bool previous = core->interrupts_masked_;
+  core->interrupts_masked_ = masked;
+  if (!masked) {
+    core->DispatchInterrupts();
+  }
+  return previous;
+}
+
+void Chip::LaunchCore1(std::function<void()> entry) {
+  Core& core = *cores_[1];
+  if (core.thread_.joinable()) {
+    return;
+  }
+  core.started_ = true;
+  core.time_ = caller_time();
+  core.Start([entry = std::move(entry)] {
+    entry();
+    return 0;
+  });
+}
+
+bool Chip::FifoWritable() const {
+  Core* core = current_core();
+  return core && fifos_[1 - core->index_].size() < kFifoDepth;
+}
+
+bool Chip::FifoReadable() const {
+  Core* core = current_core();
+  return core && !fifos_[core->index_].empty();
+}
+
+void Chip::FifoPush(uint32_t value) {
+  // Writes to a full FIFO are lost, as on the hardware.
+  Core* core = current_core();
+  if (core && FifoWritable()) {
+    fifos_[1 - core->index_].push(value);
+  }
+}
+
+uint32_t Chip::FifoPop() {
+  Core* core = current_core();
+  if (!core || fifos_[core->index_].empty()) {
+    return 0;
+  }
+  uint32_t value = fifos_[core->index_].front();
+  fifos_[core->index_].pop();
+  return value;
+}
+
+void Chip::GpioInit(uint8_t gpio) {
+  if (gpio >= kNumOfGpios) {
+    return;
+  }
+  GpioSetDirection(gpio, false);
+  GpioWriteMasked(1u << gpio, 0);
+}
+
+void Chip::GpioSetDirection(uint8_t gpio, bool out) {
+  if (gpio >= kNumOfGpios) {
+    return;
+  }
+  uint32_t before = outputs();
+  if (out) {
+    output_enables_ |= 1u << gpio;
+  } else {
+    output_enables_ &= ~(1u << gpio);
+  }
+  if (output_observer_ && before != outputs()) {
+    output_observer_(outputs(), before ^ outputs());
+  }
+}
+
+void Chip::GpioSetPulls(uint8_t gpio, bool up, bool down) {
+  if (gpio >= kNumOfGpios) {
+    return;
+  }
+  uint32_t bit = 1u << gpio;
+  pull_ups_ = up ? (pull_ups_ | bit) : (pull_ups_ & ~bit);
+  pull_downs_ = down ? (pull_downs_ | bit) : (pull_downs_ & ~bit);
+}
+
+uint32_t Chip::GpioReadAll(uint32_t mask) {
+  if (input_read_observer_) {
+    input_read_observer_(mask & ~output_enables_);
+  }
+  return levels();
+}
+
+void Chip::GpioWriteMasked(uint32_t mask, uint32_t value) {
+  uint32_t before = outputs();
+  outputs_ = (outputs_ & ~mask) | (value & mask);
+  if (output_observer_ && before != outputs()) {
+    output_observer_(outputs(), before ^ outputs());
+  }
+}
+
+void Chip::GpioSetIrqEnabled(uint8_t gpio, uint32_t events, bool enabled) {
+  if (gpio >= kNumOfGpios) {
+    return;
+  }
+  uint32_t bit = 1u << gpio;
+  if (events & GPIO_IRQ_EDGE_RISE) {
+    irq_rises_ = enabled ? (irq_rises_ | bit) : (irq_rises_ & ~bit);
+  }
+  if (events & GPIO_IRQ_EDGE_FALL) {
+    irq_falls_ = enabled ? (irq_falls_ | bit) : (irq_falls_ & ~bit);
+  }
+  Core* core = current_core();
+  gpio_irq_core_ = core ? core->index_ : 0;
+}
+
+void Chip::SetGpioIrqHandler(GpioIrqHandler handler) {
+  gpio_irq_handler_ = std::move(handler);
+}
+
+void Chip::AddRepeatingTimer(void* key,
+                             int64_t delay_us,
+                             std::function<bool()> callback) {
+  auto timer = std::make_shared<RepeatingTimer>(RepeatingTimer{
+      .key = key,
+      .delay_us = delay_us,
+      .callback = std::move(callback),
+      .next = caller_time() + std::abs(delay_us) * kMicrosecond});
+  timers_.push_back(timer);
+  ScheduleTimer(timer);
+}
+
+bool Chip::CancelRepeatingTimer(void* key) {
+  auto it =
+      std::find_if(timers_.begin(), timers_.end(),
+                   [key](const auto& timer) { return timer->key == key; });
+  if (it == timers_.end()) {
+    return false;
+  }
+  (*it)->cancelled = true;
+  timers_.erase(it);
+  return true;
+}
+
+void Chip::ScheduleTimer(std::shared_ptr<RepeatingTimer> timer) {
+  simulator_.Schedule(timer->next, [this, timer] {
+    if (timer->cancelled) {
+      return;
+    }
+    RaiseInterrupt([this, timer] {
+      if (timer->cancelled) {
+        return;
+      }
+      if (!timer->callback() || timer->cancelled) {
+        CancelRepeatingTimer(timer->key);
+        return;
+      }
+      // A negative delay is measured from the previous start, a positive one
+      // from the end of this callback.
+      if (timer->delay_us < 0) {
+        timer->next += -timer->delay_us * kMicrosecond;
+      } else {
+        timer->next = cores_[0]->time_ + timer->delay_us * kMicrosecond;
+      }
+      ScheduleTimer(timer);
+    });
+  });
+}
+
+uint32_t Chip::levels() const {
+  return (outputs_ & output_enables_) | (inputs_ & driven_ & ~output_enables_) |
+         (pull_ups_ & ~driven_ & ~output_enables_);
+}
+
+Nanoseconds Chip::caller_time() const {
+  return tOwnerCore ? tOwnerCore->time_ : simulator_.now_;
+}
+
+Core::Core(Chip& chip, uint8_t index) : chip_(chip), index_(index) {}
+
+Core::~Core() = default;
+
+void Core::Start(std::function<int()> entry) {
+  entry_ = std::move(entry);
+  thread_ = std::thread(&Core::ThreadMain, this);
+}
+
+void Core::Consume(Nanoseconds cost) {
+  if (chip_.simulator_.halting_) {
+    return;
+  }
+  Nanoseconds target = time_ + cost;
+  while (target > horizon_ && !booting_) {
+    Nanoseconds yielded_at = horizon_;
+    time_ = yielded_at;
+    Yield();
+    // Interrupts handled while yielding delay the rest of the work.
+    target += time_ - yielded_at;
+  }
+  time_ = target;
+}
+
+void Core::WaitForEvent() {
+  if (chip_.simulator_.halting_ || booting_) {
+    return;
+  }
+  if (!interrupts_.empty() && !in_interrupt_) {
+    DispatchInterrupts();
+    return;
+  }
+  idle_ = true;
+  Yield();
+}
+
+void Core::Sleep(bool wfi) {
+  if (chip_.simulator_.halting_ || booting_) {
+    return;
+  }
+  if (!wfi && event_) {
+    event_ = false;
+    return;
+  }
+  if (!interrupts_.empty() && !in_interrupt_) {
+    DispatchInterrupts();
+    return;
+  }
+  Nanoseconds start = time_;
+  idle_ = true;
+  wake_on_input_ = false;
+  wake_on_event_ = !wfi;
+  Yield();
+  wake_on_input_ = true;
+  wake_on_event_ = false;
+  sleep_time_ += time_ - start;
+}
+
+void Core::SendEvent() {
+  if (idle_ && wake_on_event_) {
+    Wake(chip_.caller_time());
+    return;
+  }
+  event_ = true;
+}
+
+void Core::Wake(Nanoseconds time) {
+  idle_ = false;
+  time_ = std::max(time_, time);
+}
+
+void Core::ThreadMain() {
+  tOwnerCore = this;
+  tCurrentChip = &chip_;
+  Simulator& simulator = chip_.simulator_;
+  std::unique_lock<std::mutex> lock(simulator.mutex_);
+  WaitForTurn(lock);
+  if (!simulator.halting_) {
+    lock.unlock();
+    cpu_resumed_at_ = ThreadCpuTime();
+    try {
+      if (!entry_) {
+        // Static initializers of the image run on this core, as they would
+        // on boot.
+        booting_ = true;
+        chip_.image_ = LoadImage(chip_.image_path_);
+        booting_ = false;
+        if (!chip_.image_) {
+          fprintf(stderr, "%s: %s\n", chip_.name_.c_str(), dlerror());
+          abort();
+        }
+        entry_ = reinterpret_cast<int (*)()>(dlsym(chip_.image_, "main"));
+        if (!entry_) {
+          fprintf(stderr, "%s: no main() in %s\n", chip_.name_.c_str(),
+                  chip_.image_path_.c_str());
+          abort();
+        }
+      }
+      entry_();
+    } catch (const Halt&) {
+    }
+    lock.lock();
+  }
+  finished_ = true;
+  has_turn_ = false;
+  simulator.cv_.notify_all();
+}
+
+void Core::Yield() {
+  Simulator& simulator = chip_.simulator_;
+  cpu_time_ += ThreadCpuTime() - cpu_resumed_at_;
+  {
+    std::unique_lock<std::mutex> lock(simulator.mutex_);
+    has_turn_ = false;
+    simulator.cv_.notify_all();
+    WaitForTurn(lock);
+  }
+  cpu_resumed_at_ = ThreadCpuTime();
+  if (simulator.halting_) {
+    throw Halt();
+  }
+  DispatchInterrupts();
+}
+
+void Core::WaitForTurn(std::unique_lock<std::mutex>& lock) {
+  cv_.wait(lock, [this] { return has_turn_; });
+}
+
+void Core::DispatchInterrupts() {
+  if (in_interrupt_ || interrupts_masked_) {
+    return;
+  }
+  while (!interrupts_.empty()) {
+    std::function<void()> handler = std::move(interrupts_.front());
+    interrupts_.pop();
+    in_interrupt_ = true;
+    handler();
+    in_interrupt_ = false;
+  }
+}
+
+ScopedChipContext::ScopedChipContext(Chip& chip) : previous_(tCurrentChip) {
+  tCurrentChip = &chip;
+}
+
+ScopedChipContext::~ScopedChipContext() {
+  tCurrentChip = previous_;
+}
+
+}  // namespace host
@@ -0,0 +1,347 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_SIMULATOR_H_
+#define HOST_SIMULATOR_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace host {
+
+// Virtual time in nanoseconds since the simulated power-on.
+using Nanoseconds = uint64_t;
+
+constexpr Nanoseconds kMicrosecond = 1000u;
+constexpr Nanoseconds kMillisecond = 1000u * kMicrosecond;
+constexpr Nanoseconds kSecond = 1000u * kMillisecond;
+constexpr Nanoseconds kForever = UINT64_MAX;
+
+class Chip;
+class Core;
+class FlashModel;
+class I2CBus;
+class I2CControllerModel;
+class UsbControllerModel;
+
+// Runs a set of RP2040 chips, each executing an unmodified firmware image, on
+// a single virtual clock.
+//
+// Every core runs on its own host thread, but only one thread runs at a time,
+// so a simulation is fully deterministic. Firmware code is free in virtual
+// time; the stand-in Pico SDK functions charge a cost for each peripheral
+// access, and that is where a chip may be preempted so that timers, waveform
+// edges and other chips can catch up.
+class Simulator final {
+ public:
+  Simulator();
+  Simulator(const Simulator&) = delete;
+  Simulator& operator=(const Simulator&) = delete;
+  ~Simulator();
+
+  // The simulator that owns the calling thread. Only one simulator can exist
+  // at a time.
+  static Simulator& Get();
+
+  // Adds a chip that boots the firmware image at `image_path` on the first
+  // call to RunUntil(). An image is a shared object built from the same
+  // sources as the UF2 image (see host/CMakeLists.txt); its static
+  // initializers and `main()` run on the chip.
+  Chip& AddChip(std::string name, std::string image_path);
+  // Adds a chip that runs `entry` instead of an image, for benchmarks that
+  // link firmware sources directly.
+  Chip& AddChip(std::string name, std::function<int()> entry);
+
+  // Wires I2C block `index_a` of `a` and `index_b` of `b` to the same bus.
+  I2CBus& ConnectI2C(Chip& a, uint8_t index_a, Chip& b, uint8_t index_b);
+  // Wires I2C block `index` of `chip` to `bus` as well.
+  void ConnectI2C(I2CBus& bus, Chip& chip, uint8_t index);
+
+  // Runs `action` on the simulator thread at virtual time `time`. Actions at
+  // the same time run in the order they were scheduled, and before any chip
+  // executes at that time.
+  void Schedule(Nanoseconds time, std::function<void()> action);
+
+  // Advances the simulation until the virtual clock reaches `time`.
+  void RunUntil(Nanoseconds time);
+
+  Nanoseconds now() const { return now_; }
+  const std::vector<std::unique_ptr<Chip>>& chips() const { return chips_; }
+
+ private:
+  friend class Chip;
+  friend class Core;
+
+  struct Event {
+    Nanoseconds time;
+    uint64_t sequence;
+    std::function<void()> action;
+    bool operator>(const Event& other) const {
+      return time != other.time ? time > other.time
+                                : sequence > other.sequence;
+    }
+  };
+
+  // Gives the baton to `core` and blocks until it yields.
+  void Resume(Core& core, Nanoseconds horizon);
+  Nanoseconds NextEventTime() const;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  Nanoseconds now_ = 0;
+  uint64_t sequence_ = 0;
+  bool halting_ = false;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+  std::vector<std::unique_ptr<Chip>> chips_;
+  std::vector<std::unique_ptr<I2CBus>> i2c_buses_;
+};
+
+// One simulated RP2040. The public accessors are meant for test harnesses on
+// the simulator thread; the methods in the second half are called by the
+// stand-in SDK functions on one of the chip's cores.
+class Chip final {
+ public:
+  using OutputObserver =
+      std::function<void(uint32_t outputs, uint32_t changed)>;
+  using InputReadObserver = std::function<void(uint32_t mask)>;
+  using GpioIrqHandler = std::function<void(uint8_t gpio, uint32_t events)>;
+
+  static constexpr uint8_t kNumOfGpios = 30;
+  static constexpr uint8_t kNumOfCores = 2;
+  static constexpr size_t kFifoDepth = 8;
+
+  Chip(Simulator& simulator,
+       std::string name,
+       std::string image_path,
+       std::function<int()> entry);
+  Chip(const Chip&) = delete;
+  Chip& operator=(const Chip&) = delete;
+  ~Chip();
+
+  // The chip whose peripherals the calling thread is accessing. This is
+  // usually the chip owning the thread, but an I2C transaction runs the
+  // target's slave handler in the target's context.
+  static Chip& Current();
+
+  const std::string& name() const { return name_; }
+  // The flash unique ID, made from the name so that it is stable across runs.
+  uint64_t unique_id() const { return unique_id_; }
+  Simulator& simulator() { return simulator_; }
+  Core& core(uint8_t index) { return *cores_[index]; }
+
+  // The clock of the calling core if it belongs to this chip, or of core 0.
+  // It runs ahead of Simulator::now() by at most one scheduling quantum while
+  // the core executes.
+  Nanoseconds time() const;
+
+  // Host CPU time spent executing this chip's firmware, on both cores.
+  Nanoseconds cpu_time() const;
+  // Repeating timers the firmware has running.
+  size_t repeating_timers() const { return timers_.size(); }
+
+  // External signal on an input pin. Pins that nobody drives read as their
+  // pull, or low.
+  void DriveInput(uint8_t gpio, bool level);
+  void ReleaseInput(uint8_t gpio);
+  uint32_t outputs() const { return outputs_ & output_enables_; }
+
+  // Called whenever firmware changes output levels.
+  void SetOutputObserver(OutputObserver observer);
+  // Called whenever firmware samples input pins, with the pins sampled.
+  void SetInputReadObserver(InputReadObserver observer);
+
+  UsbControllerModel& usb() { return *usb_; }
+  FlashModel& flash() { return *flash_; }
+  I2CControllerModel& i2c(uint8_t index) { return *i2c_[index]; }
+
+  // Looks up a symbol, such as an interrupt handler, in the chip's image.
+  void* FindSymbol(const char* name) const;
+
+  // --- Used by the stand-in SDK on one of the chip's cores. ---
+
+  // The calling core. Costs and sleeps are no-ops when the caller is not a
+  // core of this chip, e.g. an I2C target handler run by the controller.
+  Core* current_core() const;
+  // Whether the caller runs as an interrupt handler: one taken on a core of
+  // this chip, or one the simulation runs outside of the cores.
+  bool InInterrupt() const;
+  // The time of the calling thread, for scheduling from firmware.
+  Nanoseconds caller_time() const;
+
+  // Spends `cost` of virtual time; interrupts may run inside.
+  void Consume(Nanoseconds cost);
+  // Sleeps until an interrupt has been handled or an input pin changed.
+  void WaitForEvent();
+  // Sleeps as the WFE instruction does: until an interrupt or SendEvent(),
+  // or not at all if an event is pending. With `wfi`, only an interrupt
+  // wakes it up.
+  void Sleep(bool wfi);
+  // Sets the event flag of both cores, or wakes up cores sleeping in WFE.
+  void SendEvent();
+  // Queues `handler` to run as an interrupt on `core`. Callable from any
+  // thread holding the baton.
+  void RaiseInterrupt(std::function<void()> handler, uint8_t core = 0);
+
+  // Wakes up `core` from WaitForEvent() or Sleep() as an interrupt taken on it
+  // does, for handlers that the simulation runs outside of the core, such as
+  // I2C target handlers.
+  void WakeCore(uint8_t core = 0);
+
+  // Masks interrupts on the calling core, as PRIMASK does; pending ones run
+  // once unmasked. Returns the previous mask.
+  bool MaskInterrupts(bool masked);
+
+  // Starts core 1 running `entry`.
+  void LaunchCore1(std::function<void()> entry);
+
+  // Inter-core FIFO from the calling core to the other one.
+  bool FifoWritable() const;
+  bool FifoReadable() const;
+  void FifoPush(uint32_t value);
+  uint32_t FifoPop();
+
+  void GpioInit(uint8_t gpio);
+  void GpioSetDirection(uint8_t gpio, bool out);
+  void GpioSetPulls(uint8_t gpio, bool up, bool down);
+  uint32_t GpioReadAll(uint32_t mask);
+  void GpioWriteMasked(uint32_t mask, uint32_t value);
+  // Edges on input pins raise an interrupt on the calling core, that calls
+  // `handler` for each pin with GPIO_IRQ_EDGE_* `events`.
+  void GpioSetIrqEnabled(uint8_t gpio, uint32_t events, bool enabled);
+  void SetGpioIrqHandler(GpioIrqHandler handler);
+
+  // Repeating timers run on core 0, as the SDK's default alarm pool does.
+  struct RepeatingTimer;
+  void AddRepeatingTimer(void* key,
+                         int64_t delay_us,
+                         std::function<bool()> callback);
+  bool CancelRepeatingTimer(void* key);
+
+  I2CBus* i2c_bus(uint8_t index) { return i2c_buses_[index]; }
+  void set_i2c_bus(uint8_t index, I2CBus* bus) { i2c_buses_[index] = bus; }
+  uint32_t i2c_baudrate(uint8_t index) const { return i2c_baudrates_[index]; }
+  void set_i2c_baudrate(uint8_t index, uint32_t baudrate) {
+    i2c_baudrates_[index] = baudrate;
+  }
+
+ private:
+  friend class Core;
+  friend class Simulator;
+  friend class ScopedChipContext;
+
+  void ScheduleTimer(std::shared_ptr<RepeatingTimer> timer);
+  uint32_t levels() const;
+
+  Simulator& simulator_;
+  const std::string name_;
+  const std::string image_path_;
+  const uint64_t unique_id_;
+  void* image_ = nullptr;
+  std::unique_ptr<Core> cores_[kNumOfCores];
+
+  std::vector<std::shared_ptr<RepeatingTimer>> timers_;
+  std::queue<uint32_t> fifos_[kNumOfCores];  // Indexed by the reading core.
+
+  uint32_t inputs_ = 0;
+  uint32_t driven_ = 0;
+  uint32_t outputs_ = 0;
+  uint32_t output_enables_ = 0;
+  uint32_t pull_ups_ = 0;
+  uint32_t pull_downs_ = 0;
+  OutputObserver output_observer_;
+  InputReadObserver input_read_observer_;
+  uint32_t irq_rises_ = 0;
+  uint32_t irq_falls_ = 0;
+  uint8_t gpio_irq_core_ = 0;
+  GpioIrqHandler gpio_irq_handler_;
+
+  I2CBus* i2c_buses_[2] = {nullptr, nullptr};
+  uint32_t i2c_baudrates_[2] = {0, 0};
+
+  std::unique_ptr<UsbControllerModel> usb_;
+  std::unique_ptr<I2CControllerModel> i2c_[2];
+  std::unique_ptr<FlashModel> flash_;
+};
+
+// One Cortex-M0+ core of a chip, running firmware on its own host thread.
+// Core 0 boots the image; core 1 runs once launched.
+class Core final {
+ public:
+  Core(Chip& chip, uint8_t index);
+  Core(const Core&) = delete;
+  Core& operator=(const Core&) = delete;
+  ~Core();
+
+  Chip& chip() { return chip_; }
+  uint8_t index() const { return index_; }
+  Nanoseconds time() const { return time_; }
+  Nanoseconds cpu_time() const { return cpu_time_; }
+  // Virtual time spent sleeping in WFE or WFI.
+  Nanoseconds sleep_time() const { return sleep_time_; }
+
+ private:
+  friend class Chip;
+  friend class Simulator;
+
+  void Start(std::function<int()> entry);
+  void ThreadMain();
+  void Consume(Nanoseconds cost);
+  void WaitForEvent();
+  void Sleep(bool wfi);
+  void SendEvent();
+  void Wake(Nanoseconds time);
+  void Yield();
+  void WaitForTurn(std::unique_lock<std::mutex>& lock);
+  void DispatchInterrupts();
+
+  bool runnable() const { return started_ && !idle_ && !finished_; }
+
+  Chip& chip_;
+  const uint8_t index_;
+  std::function<int()> entry_;
+
+  std::thread thread_;
+  std::condition_variable cv_;
+  bool has_turn_ = false;
+  bool started_ = false;
+  bool booting_ = false;
+  bool idle_ = false;
+  bool wake_on_input_ = true;
+  bool wake_on_event_ = false;
+  bool event_ = false;
+  bool finished_ = false;
+  bool in_interrupt_ = false;
+  bool interrupts_masked_ = false;
+  Nanoseconds time_ = 0;
+  Nanoseconds horizon_ = 0;
+  Nanoseconds cpu_time_ = 0;
+  Nanoseconds cpu_resumed_at_ = 0;
+  Nanoseconds sleep_time_ = 0;
+
+  std::queue<std::function<void()>> interrupts_;
+};
+
+// Makes `chip` the target of peripheral accesses from the calling thread
+// while in scope, without moving time on it.
+class ScopedChipContext final {
+ public:
+  explicit ScopedChipContext(Chip& chip);
+  ScopedChipContext(const ScopedChipContext&) = delete;
+  ScopedChipContext& operator=(const ScopedChipContext&) = delete;
+  ~ScopedChipContext();
+
+ private:
+  Chip* previous_;
+};
+
+}  // namespace host
+
+#endif  // HOST_SIMULATOR_H_
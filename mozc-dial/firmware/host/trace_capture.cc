@@ -0,0 +1,95 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#include "trace_capture.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace host {
+
+TraceCapture::TraceCapture(Simulator& simulator,
+                           Nanoseconds start,
+                           Nanoseconds end)
+    : simulator_(simulator), end_(end) {
+  // The images are loaded once the simulation runs.
+  simulator_.Schedule(start, [this] { Start(); });
+}
+
+void TraceCapture::Start() {
+  for (const auto& chip : simulator_.chips()) {
+    using RingsFunction = const trace::Ring* (*)();
+    auto rings_function =
+        reinterpret_cast<RingsFunction>(chip->FindSymbol("trace_rings"));
+    if (!rings_function) {
+      continue;
+    }
+    Source& source = sources_.emplace_back();
+    source.name = chip->name();
+    source.rings = rings_function();
+    for (size_t core = 0; core < trace::kNumOfCores; ++core) {
+      source.taken[core] = source.rings[core].count;
+    }
+  }
+  if (!sources_.empty()) {
+    simulator_.Schedule(simulator_.now() + kTakeInterval, [this] { Take(); });
+  }
+}
+
+void TraceCapture::Take() {
+  for (Source& source : sources_) {
+    for (size_t core = 0; core < trace::kNumOfCores; ++core) {
+      const trace::Ring& ring = source.rings[core];
+      uint32_t count = ring.count;
+      uint32_t& taken = source.taken[core];
+      if (count - taken > trace::kEventsPerCore) {
+        source.overwritten[core] += count - taken - trace::kEventsPerCore;
+        taken = count - trace::kEventsPerCore;
+      }
+      for (; taken != count; ++taken) {
+        source.events[core].push_back(
+            ring.events[taken % trace::kEventsPerCore]);
+      }
+    }
+  }
+  if (simulator_.now() < end_) {
+    simulator_.Schedule(std::min(simulator_.now() + kTakeInterval, end_),
+                        [this] { Take(); });
+  }
+}
+
+uint32_t TraceCapture::overwritten() const {
+  uint32_t overwritten = 0;
+  for (const Source& source : sources_) {
+    for (uint32_t count : source.overwritten) {
+      overwritten += count;
+    }
+  }
+  return overwritten;
+}
+
+bool TraceCapture::Write(const std::string& path) const {
+  FILE* file = fopen(path.c_str(), "w");
+  if (!file) {
+    return false;
+  }
+  for (const Source& source : sources_) {
+    for (size_t core = 0; core < trace::kNumOfCores; ++core) {
+      const std::vector<trace::Event>& events = source.events[core];
+      fprintf(file, "%s: trace core %zu, %zu events, %lu overwritten\n",
+              source.name.c_str(), core,
+              events.size() + source.overwritten[core],
+              static_cast<unsigned long>(source.overwritten[core]));
+      for (const trace::Event& event : events) {
+        fprintf(file, "%s: trace %zu %08lx %u %c %04x\n", source.name.c_str(),
+                core, static_cast<unsigned long>(event.time_us),
+                static_cast<unsigned>(event.stage),
+                event.kind == trace::Kind::kBegin ? 'b' : 'e', event.tag);
+      }
+    }
+  }
+  return fclose(file) == 0;
+}
+
+}  // namespace host
@@ -0,0 +1,59 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_TRACE_CAPTURE_H_
+#define HOST_TRACE_CAPTURE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../common/trace.h"
+#include "simulator.h"
+
+namespace host {
+
+// Takes the events out of the trace rings of each chip built with DIAL_TRACE,
+// see common/trace.h, as the simulation runs, so that a whole window of it is
+// kept rather than the last kEventsPerCore events. Firmware code takes no
+// virtual time, so busy loops record far more events than on the device.
+class TraceCapture final {
+ public:
+  // Takes the events recorded from `start` until `end`, from the chips added
+  // so far that have trace rings.
+  TraceCapture(Simulator& simulator, Nanoseconds start, Nanoseconds end);
+  TraceCapture(const TraceCapture&) = delete;
+  TraceCapture& operator=(const TraceCapture&) = delete;
+  ~TraceCapture() = default;
+
+  // Writes the events as trace::Dump() prints them, for host/trace_decode.
+  // Returns false if `path` cannot be written.
+  bool Write(const std::string& path) const;
+
+  // Events overwritten before they were taken; kTakeInterval is too long.
+  uint32_t overwritten() const;
+
+ private:
+  static constexpr Nanoseconds kTakeInterval = 20 * kMicrosecond;
+
+  struct Source {
+    std::string name;
+    const trace::Ring* rings;
+    uint32_t taken[trace::kNumOfCores] = {};
+    uint32_t overwritten[trace::kNumOfCores] = {};
+    std::vector<trace::Event> events[trace::kNumOfCores];
+  };
+
+  // Finds the chips with trace rings, and skips the events before `start`.
+  void Start();
+  void Take();
+
+  Simulator& simulator_;
+  const Nanoseconds end_;
+  std::vector<Source> sources_;
+};
+
+}  // namespace host
+
+#endif  // HOST_TRACE_CAPTURE_H_
@@ -0,0 +1,177 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+// Decodes the trace of firmware built with DIAL_TRACE, as printed over stdio
+// by trace::Dump(), see common/trace.h, or written by dial_sim --trace, into
+// the latency of each stage:
+//
+//   trace_decode [LOG]
+//
+// LOG, or the standard input, may hold other output too; only trace lines are
+// read. Begins and ends are paired per chip, core and stage, and stages left
+// open at either end of the trace are dropped.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../common/trace.h"
+
+namespace {
+
+constexpr size_t kNumOfStages = static_cast<size_t>(trace::Stage::kNumOfStages);
+// Histogram buckets: under 1 us, then powers of two up to 2^kNumOfBuckets us.
+constexpr size_t kNumOfBuckets = 24;
+constexpr int kBarWidth = 40;
+
+struct Begin {
+  uint32_t time_us;
+  uint16_t tag;
+};
+
+struct Chip {
+  // Latencies by stage, in us.
+  std::vector<uint32_t> latencies[kNumOfStages];
+  // Begins without their ends yet, by core and stage.
+  std::map<std::pair<unsigned, unsigned>, std::vector<Begin>> open;
+  // The first and last event times, by core.
+  std::map<unsigned, std::pair<uint32_t, uint32_t>> spans;
+};
+
+size_t Bucket(uint32_t latency_us) {
+  size_t bucket = 0;
+  while (latency_us) {
+    latency_us >>= 1;
+    ++bucket;
+  }
+  return std::min(bucket, kNumOfBuckets - 1);
+}
+
+uint32_t Percentile(const std::vector<uint32_t>& sorted, int percent) {
+  return sorted[(sorted.size() - 1) * percent / 100];
+}
+
+void Print(const std::string& name, Chip& chip) {
+  // Stages in flight on different cores may overlap, so shares are of the
+  // longest core span.
+  uint32_t span_us = 0;
+  for (const auto& [core, span] : chip.spans) {
+    span_us = std::max(span_us, span.second - span.first);
+  }
+  printf("%s: %.3f ms traced\n", name.c_str(), span_us / 1e3);
+  printf("  %-15s %8s %9s %7s %7s %7s %7s %7s %6s\n", "stage", "count",
+         "mean us", "min", "p50", "p90", "p99", "max", "share");
+  for (size_t stage = 0; stage < kNumOfStages; ++stage) {
+    std::vector<uint32_t>& latencies = chip.latencies[stage];
+    if (latencies.empty()) {
+      continue;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    uint64_t total = 0;
+    for (uint32_t latency : latencies) {
+      total += latency;
+    }
+    printf("  %-15s %8zu %9.1f %7u %7u %7u %7u %7u %5.1f%%\n",
+           trace::kStageNames[stage], latencies.size(),
+           static_cast<double>(total) / latencies.size(), latencies.front(),
+           Percentile(latencies, 50), Percentile(latencies, 90),
+           Percentile(latencies, 99), latencies.back(),
+           span_us ? 100.0 * total / span_us : 0.0);
+  }
+  for (size_t stage = 0; stage < kNumOfStages; ++stage) {
+    const std::vector<uint32_t>& latencies = chip.latencies[stage];
+    if (latencies.empty()) {
+      continue;
+    }
+    size_t counts[kNumOfBuckets] = {};
+    for (uint32_t latency : latencies) {
+      ++counts[Bucket(latency)];
+    }
+    size_t first = Bucket(latencies.front());
+    size_t last = Bucket(latencies.back());
+    size_t peak = *std::max_element(counts, counts + kNumOfBuckets);
+    printf("%s %s:\n", name.c_str(), trace::kStageNames[stage]);
+    for (size_t bucket = first; bucket <= last; ++bucket) {
+      uint32_t low = bucket ? 1u << (bucket - 1) : 0;
+      int width = static_cast<int>(counts[bucket] * kBarWidth / peak);
+      printf("  %8u us %8zu %.*s\n", low, counts[bucket], width,
+             "########################################");
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc > 2) {
+    fprintf(stderr, "usage: %s [LOG]\n", argv[0]);
+    return 2;
+  }
+  FILE* in = argc == 2 ? fopen(argv[1], "r") : stdin;
+  if (!in) {
+    fprintf(stderr, "%s: cannot read\n", argv[1]);
+    return 1;
+  }
+
+  // Chips in the order they appear.
+  std::vector<std::string> names;
+  std::map<std::string, Chip> chips;
+  size_t num_events = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), in)) {
+    char name[64];
+    unsigned core;
+    unsigned long time_us;
+    unsigned stage;
+    char kind;
+    unsigned tag;
+    // The name may be preceded by other output on the same line.
+    const char* start = strstr(line, ": trace ");
+    if (!start) {
+      continue;
+    }
+    while (start > line && start[-1] != ' ') {
+      --start;
+    }
+    if (sscanf(start, "%63[^:]: trace %u %lx %u %c %x", name, &core, &time_us,
+               &stage, &kind, &tag) != 6 ||
+        stage >= kNumOfStages || (kind != 'b' && kind != 'e')) {
+      continue;
+    }
+    ++num_events;
+    if (!chips.count(name)) {
+      names.push_back(name);
+    }
+    Chip& chip = chips[name];
+    uint32_t time = static_cast<uint32_t>(time_us);
+    chip.spans.try_emplace(core, time, time).first->second.second = time;
+    std::vector<Begin>& open = chip.open[{core, stage}];
+    if (kind == 'b') {
+      open.push_back({time, static_cast<uint16_t>(tag)});
+      continue;
+    }
+    auto begin = std::find_if(open.rbegin(), open.rend(),
+                              [tag](const Begin& b) { return b.tag == tag; });
+    if (begin == open.rend()) {
+      continue;
+    }
+    chip.latencies[stage].push_back(time - begin->time_us);
+    open.erase(std::next(begin).base());
+  }
+  if (in != stdin) {
+    fclose(in);
+  }
+  if (!num_events) {
+    fprintf(stderr, "no trace events\n");
+    return 1;
+  }
+  for (const std::string& name : names) {
+    Print(name, chips[name]);
+  }
+  return 0;
+}
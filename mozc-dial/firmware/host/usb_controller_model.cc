@@ -0,0 +1,313 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#include "usb_controller_model.h"
+
+#include <algorithm>
+
+namespace host {
+
+namespace {
+
+constexpr uint32_t kBufferAddressMask = 0xffc0u;
+constexpr uint32_t kBufferSize = 64u;
+constexpr uint32_t kBufferControlShift = 16u;
+constexpr uint32_t kBufferControlMask = 0xffffu;
+// The endpoint type in EP_CTRL, as in bmAttributes.
+constexpr uint32_t kBufferTypeMask = 0x3u;
+constexpr uint32_t kBulkType = 0x2u;
+constexpr uint32_t kAddressMask = 0x7fu;
+constexpr uint8_t kSetConfiguration[8] = {0x00, 0x09, 0x01, 0x00,
+                                          0x00, 0x00, 0x00, 0x00};
+
+}  // namespace
+
+UsbControllerModel::UsbControllerModel(Chip& chip) : chip_(chip) {
+  std::fill(std::begin(poll_intervals_), std::end(poll_intervals_), 1u);
+  RegisterBlock::Map(&hw_[0], sizeof(usb_hw_t), /*aliased=*/true, this);
+  RegisterBlock::Map(&dpram_, sizeof(dpram_), /*aliased=*/false, this);
+}
+
+UsbControllerModel::~UsbControllerModel() {
+  RegisterBlock::Unmap(this);
+}
+
+void UsbControllerModel::SetInPollInterval(uint8_t endpoint, uint32_t frames) {
+  poll_intervals_[endpoint] = std::max(frames, 1u);
+}
+
+void UsbControllerModel::SetInListener(InListener listener) {
+  in_listener_ = std::move(listener);
+}
+
+void UsbControllerModel::SendSetup(std::span<const uint8_t, 8> packet) {
+  for (size_t i = 0; i < packet.size(); ++i) {
+    dpram_.setup_packet[i] = packet[i];
+  }
+  hw_[0].sie_status.value |= USB_SIE_STATUS_SETUP_REC_BITS;
+  UpdateInterrupt();
+}
+
+void UsbControllerModel::SendOut(uint8_t endpoint, std::vector<uint8_t> data) {
+  out_packets_[endpoint].push_back(std::move(data));
+}
+
+void UsbControllerModel::SetFrameListener(FrameListener listener) {
+  frame_listener_ = std::move(listener);
+}
+
+uint8_t UsbControllerModel::address() const {
+  return hw_[0].dev_addr_ctrl.value & kAddressMask;
+}
+
+void UsbControllerModel::BusReset() {
+  hw_[0].sie_status.value |= USB_SIE_STATUS_BUS_RESET_BITS;
+  UpdateInterrupt();
+}
+
+UsbControllerModel::Transaction UsbControllerModel::Setup(
+    uint8_t address,
+    std::span<const uint8_t, 8> packet) {
+  if (!connected_ || address != this->address()) {
+    return {};
+  }
+  SendSetup(packet);
+  return {.handshake = Handshake::kAck};
+}
+
+UsbControllerModel::Transaction UsbControllerModel::In(uint8_t address,
+                                                       uint8_t endpoint) {
+  if (!connected_ || address != this->address() ||
+      endpoint >= USB_NUM_ENDPOINTS || !IsEnabled(endpoint, /*in=*/true)) {
+    return {};
+  }
+  uint32_t control = InBufferControl(endpoint);
+  if (control & USB_BUF_CTRL_STALL) {
+    return {.handshake = Handshake::kStall};
+  }
+  if (!(control & USB_BUF_CTRL_AVAIL)) {
+    return {.handshake = Handshake::kNak};
+  }
+  return CompleteIn(endpoint);
+}
+
+UsbControllerModel::Transaction UsbControllerModel::Out(
+    uint8_t address,
+    uint8_t endpoint,
+    std::span<const uint8_t> data) {
+  if (!connected_ || address != this->address() ||
+      endpoint >= USB_NUM_ENDPOINTS || !IsEnabled(endpoint, /*in=*/false)) {
+    return {};
+  }
+  uint32_t control = dpram_.ep_buf_ctrl[endpoint].out.value;
+  if (control & USB_BUF_CTRL_STALL) {
+    return {.handshake = Handshake::kStall};
+  }
+  if (!(control & USB_BUF_CTRL_AVAIL)) {
+    return {.handshake = Handshake::kNak};
+  }
+  CompleteOut(endpoint, data);
+  return {.handshake = Handshake::kAck,
+          .data1 = (control & USB_BUF_CTRL_DATA1_PID) != 0};
+}
+
+void UsbControllerModel::Reset() {
+  for (auto& alias : hw_) {
+    alias = {};
+  }
+  connected_ = false;
+  std::fill(std::begin(in_buffer_b_), std::end(in_buffer_b_), false);
+}
+
+void UsbControllerModel::SetIrqEnabled(bool enabled) {
+  irq_enabled_ = enabled;
+  UpdateInterrupt();
+}
+
+uint32_t UsbControllerModel::Read(const io_rw_32& reg) {
+  if (&reg == &hw_[0].ints) {
+    return InterruptStatus();
+  }
+  return reg.value;
+}
+
+void UsbControllerModel::Write(io_rw_32& reg,
+                               uint32_t value,
+                               RegisterAlias alias) {
+  usb_hw_t& hw = hw_[0];
+  bool write_to_clear = &reg == &hw.sie_status || &reg == &hw.buf_status;
+  if (write_to_clear && alias == RegisterAlias::kNormal) {
+    reg.value &= ~value;
+  } else {
+    RegisterBlock::Write(reg, value, alias);
+  }
+
+  for (uint8_t endpoint = 0; endpoint < USB_NUM_ENDPOINTS; ++endpoint) {
+    io_rw_32& control = dpram_.ep_buf_ctrl[endpoint].in;
+    if (&reg == &control && (control.value & USB_BUF_CTRL_SEL)) {
+      in_buffer_b_[endpoint] = false;
+      control.value &= ~USB_BUF_CTRL_SEL;
+    }
+  }
+
+  if (&reg == &hw.sie_ctrl) {
+    bool connected = hw.sie_ctrl.value & USB_SIE_CTRL_PULLUP_EN_BITS;
+    if (connected && !connected_) {
+      configuring_ = true;
+      configured_ = false;
+      chip_.simulator().Schedule(chip_.time() + kFrameInterval,
+                                 [this] { OnFrame(); });
+    }
+    connected_ = connected;
+  }
+  UpdateInterrupt();
+}
+
+void UsbControllerModel::OnFrame() {
+  if (!connected_) {
+    return;
+  }
+  ++frame_;
+  chip_.simulator().Schedule(chip_.simulator().now() + kFrameInterval,
+                             [this] { OnFrame(); });
+  if (frame_listener_) {
+    frame_listener_();
+    return;
+  }
+  if (configuring_) {
+    configuring_ = false;
+    configured_ = true;
+    SendSetup(kSetConfiguration);
+    return;
+  }
+  for (uint8_t endpoint = 0; endpoint < USB_NUM_ENDPOINTS; ++endpoint) {
+    if (!(InBufferControl(endpoint) & USB_BUF_CTRL_AVAIL)) {
+      continue;
+    }
+    uint32_t control =
+        endpoint != 0 ? dpram_.ep_ctrl[endpoint - 1].in.value : 0;
+    if (endpoint != 0 && !(control & EP_CTRL_ENABLE_BITS)) {
+      continue;
+    }
+    if (frame_ % poll_intervals_[endpoint] != 0) {
+      continue;
+    }
+    CompleteIn(endpoint);
+    bool bulk =
+        ((control >> EP_CTRL_BUFFER_TYPE_LSB) & kBufferTypeMask) == kBulkType;
+    if (bulk && (InBufferControl(endpoint) & USB_BUF_CTRL_AVAIL)) {
+      CompleteIn(endpoint);
+    }
+  }
+  for (uint8_t endpoint = 1; configured_ && endpoint < USB_NUM_ENDPOINTS;
+       ++endpoint) {
+    if (!out_packets_[endpoint].empty() &&
+        IsEnabled(endpoint, /*in=*/false) &&
+        (dpram_.ep_buf_ctrl[endpoint].out.value & USB_BUF_CTRL_AVAIL)) {
+      std::vector<uint8_t> data = std::move(out_packets_[endpoint].front());
+      out_packets_[endpoint].pop_front();
+      CompleteOut(endpoint, data);
+    }
+  }
+}
+
+bool UsbControllerModel::IsEnabled(uint8_t endpoint, bool in) const {
+  if (endpoint == 0) {
+    return true;
+  }
+  const auto& control = dpram_.ep_ctrl[endpoint - 1];
+  return (in ? control.in.value : control.out.value) & EP_CTRL_ENABLE_BITS;
+}
+
+uint32_t UsbControllerModel::InBufferControl(uint8_t endpoint) const {
+  uint32_t shift = in_buffer_b_[endpoint] ? kBufferControlShift : 0;
+  return (dpram_.ep_buf_ctrl[endpoint].in.value >> shift) & kBufferControlMask;
+}
+
+UsbControllerModel::Transaction UsbControllerModel::CompleteIn(
+    uint8_t endpoint) {
+  bool double_buffered =
+      endpoint != 0 &&
+      (dpram_.ep_ctrl[endpoint - 1].in.value & EP_CTRL_DOUBLE_BUFFERED_BITS);
+  bool buffer_b = double_buffered && in_buffer_b_[endpoint];
+  uint32_t control = InBufferControl(endpoint);
+  size_t length = control & USB_BUF_CTRL_LEN_MASK;
+  const uint8_t* buffer =
+      endpoint == 0
+          ? dpram_.ep0_buf_a
+          : reinterpret_cast<const uint8_t*>(&dpram_) +
+                (dpram_.ep_ctrl[endpoint - 1].in.value & kBufferAddressMask) +
+                (buffer_b ? kBufferSize : 0);
+  Transaction transaction = {.handshake = Handshake::kAck,
+                             .data1 = (control & USB_BUF_CTRL_DATA1_PID) != 0,
+                             .data = {buffer, buffer + length}};
+  if (in_listener_) {
+    in_listener_(endpoint, transaction.data);
+  }
+  uint32_t shift = buffer_b ? kBufferControlShift : 0;
+  dpram_.ep_buf_ctrl[endpoint].in.value &=
+      ~((USB_BUF_CTRL_AVAIL | USB_BUF_CTRL_FULL) << shift);
+  hw_[0].buf_status.value |= 1u << (endpoint * 2);
+  if (buffer_b) {
+    hw_[0].buf_cpu_should_handle.value |= 1u << (endpoint * 2);
+  } else {
+    hw_[0].buf_cpu_should_handle.value &= ~(1u << (endpoint * 2));
+  }
+  if (double_buffered) {
+    in_buffer_b_[endpoint] = !buffer_b;
+  }
+  UpdateInterrupt();
+  return transaction;
+}
+
+void UsbControllerModel::CompleteOut(uint8_t endpoint,
+                                     std::span<const uint8_t> data) {
+  io_rw_32& control = dpram_.ep_buf_ctrl[endpoint].out;
+  // Longer packets than the buffer takes would be a babble error.
+  size_t length = std::min<size_t>(data.size(),
+                                   control.value & USB_BUF_CTRL_LEN_MASK);
+  uint8_t* buffer =
+      endpoint == 0
+          ? dpram_.ep0_buf_a
+          : reinterpret_cast<uint8_t*>(&dpram_) +
+                (dpram_.ep_ctrl[endpoint - 1].out.value & kBufferAddressMask);
+  std::copy(data.begin(), data.begin() + length, buffer);
+  control.value = (control.value & ~(USB_BUF_CTRL_AVAIL |
+                                     USB_BUF_CTRL_LEN_MASK)) |
+                  USB_BUF_CTRL_FULL | length;
+  hw_[0].buf_status.value |= 1u << (endpoint * 2 + 1);
+  UpdateInterrupt();
+}
+
+uint32_t UsbControllerModel::InterruptStatus() const {
+  const usb_hw_t& hw = hw_[0];
+  uint32_t raw = 0;
+  if (hw.buf_status.value) {
+    raw |= USB_INTS_BUFF_STATUS_BITS;
+  }
+  if (hw.sie_status.value & USB_SIE_STATUS_SETUP_REC_BITS) {
+    raw |= USB_INTS_SETUP_REQ_BITS;
+  }
+  if (hw.sie_status.value & USB_SIE_STATUS_BUS_RESET_BITS) {
+    raw |= USB_INTS_BUS_RESET_BITS;
+  }
+  return (raw | hw.intf.value) & hw.inte.value;
+}
+
+void UsbControllerModel::UpdateInterrupt() {
+  if (!irq_enabled_ || irq_raised_ || InterruptStatus() == 0) {
+    return;
+  }
+  irq_raised_ = true;
+  chip_.RaiseInterrupt([this] {
+    auto isr = reinterpret_cast<void (*)()>(chip_.FindSymbol("isr_usbctrl"));
+    if (isr) {
+      isr();
+    }
+    irq_raised_ = false;
+    UpdateInterrupt();
+  });
+}
+
+}  // namespace host
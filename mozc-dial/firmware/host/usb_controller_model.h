@@ -0,0 +1,135 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_USB_CONTROLLER_MODEL_H_
+#define HOST_USB_CONTROLLER_MODEL_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "hardware/structs/usb.h"
+#include "registers.h"
+#include "simulator.h"
+
+namespace host {
+
+// The RP2040 USB controller registers and DPRAM of one chip, in device mode,
+// attached to a host that skips enumeration. Once firmware enables the D+
+// pull-up, the host sets configuration 1 at the first frame, with no other
+// request before it, and from then polls every IN endpoint with a buffer
+// available at its poll interval, and completes it as the real controller
+// would: the buffer is handed back, BUFF_STATUS is set and USBCTRL_IRQ fires.
+// Double buffered endpoints are polled on buffers A and B in turn, and bulk
+// ones on both in the same frame. Packets the host sends on OUT endpoints wait
+// for the configuration, as the device arms them only then, and go out at the
+// next frame that finds a buffer available, one per endpoint.
+//
+// With a frame listener, the bus is left to a scripted host instead, see
+// UsbHost, that runs each transaction itself: the controller answers it from
+// the device address, and the buffer control of the endpoint.
+class UsbControllerModel final : public RegisterBlock {
+ public:
+  using InListener =
+      std::function<void(uint8_t endpoint, std::span<const uint8_t> data)>;
+
+  static constexpr Nanoseconds kFrameInterval = kMillisecond;
+
+  enum class Handshake { kAck, kNak, kStall, kNoResponse };
+  // A transaction as the controller answers it.
+  struct Transaction {
+    Handshake handshake = Handshake::kNoResponse;
+    // The data PID sent on IN, or the one the buffer expects on OUT.
+    bool data1 = false;
+    // Sent on IN.
+    std::vector<uint8_t> data = {};
+  };
+  using FrameListener = std::function<void()>;
+
+  explicit UsbControllerModel(Chip& chip);
+  UsbControllerModel(const UsbControllerModel&) = delete;
+  UsbControllerModel& operator=(const UsbControllerModel&) = delete;
+  ~UsbControllerModel() override;
+
+  usb_hw_t* hw() { return &hw_[0]; }
+  usb_device_dpram_t* dpram() { return &dpram_; }
+
+  // Polls IN endpoint `endpoint` every `frames` frames. Defaults to every
+  // frame.
+  void SetInPollInterval(uint8_t endpoint, uint32_t frames);
+  // Receives every packet the host reads from an IN endpoint.
+  void SetInListener(InListener listener);
+  // Sends a SETUP packet on the control endpoint. The status or IN data stage
+  // completes at the next frame. Requests with an OUT data stage are not
+  // supported.
+  void SendSetup(std::span<const uint8_t, 8> packet);
+  // Queues `data` to send on OUT `endpoint`, other than the control endpoint,
+  // once the device is configured. A frame that finds no buffer available
+  // NAKs it, and it is sent again at the next one.
+  void SendOut(uint8_t endpoint, std::vector<uint8_t> data);
+
+  uint32_t frame() const { return frame_; }
+
+  // --- For a scripted host. ---
+  // Calls `listener` at the start of each frame once the device is connected,
+  // instead of polling the endpoints.
+  void SetFrameListener(FrameListener listener);
+  bool connected() const { return connected_; }
+  // The address the firmware set in DEV_ADDR_CTRL.
+  uint8_t address() const;
+  // Signals a bus reset; the firmware sees BUS_RESET in SIE_STATUS.
+  void BusReset();
+  // Transactions to the device at `address`, that a device at another address
+  // does not answer. SETUP is always acknowledged.
+  Transaction Setup(uint8_t address, std::span<const uint8_t, 8> packet);
+  Transaction In(uint8_t address, uint8_t endpoint);
+  Transaction Out(uint8_t address,
+                  uint8_t endpoint,
+                  std::span<const uint8_t> data);
+
+  // --- Used by the stand-in SDK. ---
+  void Reset();
+  void SetIrqEnabled(bool enabled);
+
+  // Implement RegisterBlock.
+  uint32_t Read(const io_rw_32& reg) override;
+  void Write(io_rw_32& reg, uint32_t value, RegisterAlias alias) override;
+
+ private:
+  void OnFrame();
+  // The control half of the buffer the host polls next on IN `endpoint`.
+  uint32_t InBufferControl(uint8_t endpoint) const;
+  // Whether `endpoint` is answered at all: the control endpoint always is,
+  // others once enabled.
+  bool IsEnabled(uint8_t endpoint, bool in) const;
+  Transaction CompleteIn(uint8_t endpoint);
+  void CompleteOut(uint8_t endpoint, std::span<const uint8_t> data);
+  uint32_t InterruptStatus() const;
+  void UpdateInterrupt();
+
+  Chip& chip_;
+  // Normal, XOR, set and clear aliases, in this order.
+  usb_hw_t hw_[4] = {};
+  usb_device_dpram_t dpram_ = {};
+
+  bool irq_enabled_ = false;
+  bool irq_raised_ = false;
+  bool connected_ = false;
+  // SET_CONFIGURATION is due at the next frame, or was sent.
+  bool configuring_ = false;
+  bool configured_ = false;
+  uint32_t frame_ = 0;
+  uint32_t poll_intervals_[USB_NUM_ENDPOINTS];
+  // Buffer B is next on a double buffered IN endpoint.
+  bool in_buffer_b_[USB_NUM_ENDPOINTS] = {};
+  InListener in_listener_;
+  FrameListener frame_listener_;
+  std::deque<std::vector<uint8_t>> out_packets_[USB_NUM_ENDPOINTS];
+};
+
+}  // namespace host
+
+#endif  // HOST_USB_CONTROLLER_MODEL_H_
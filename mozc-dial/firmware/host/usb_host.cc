@@ -0,0 +1,237 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#include "usb_host.h"
+
+#include <algorithm>
+
+namespace host {
+
+namespace {
+
+using Handshake = UsbControllerModel::Handshake;
+
+constexpr uint8_t kDirIn = 0x80;
+constexpr uint8_t kRequestSetConfiguration = 0x09;
+
+uint16_t Length(const std::array<uint8_t, 8>& setup) {
+  return setup[6] | setup[7] << 8;
+}
+
+}  // namespace
+
+UsbHost::UsbHost(Simulator& simulator, UsbControllerModel& usb)
+    : simulator_(simulator), usb_(usb) {
+  usb_.SetFrameListener([this] { OnFrame(); });
+}
+
+void UsbHost::SetConnectListener(std::function<void()> listener) {
+  connect_listener_ = std::move(listener);
+}
+
+void UsbHost::Reset(Nanoseconds duration, std::function<void()> done) {
+  resetting_ = true;
+  polls_.clear();
+  usb_.BusReset();
+  simulator_.Schedule(simulator_.now() + duration,
+                      [this, done = std::move(done)] {
+                        resetting_ = false;
+                        address_ = 0;
+                        ResetToggles();
+                        done();
+                        ScheduleControl();
+                      });
+}
+
+void UsbHost::Control(std::span<const uint8_t, 8> setup,
+                      std::vector<uint8_t> data,
+                      ControlCallback done) {
+  Transfer& transfer = transfers_.emplace_back();
+  std::copy(setup.begin(), setup.end(), transfer.setup.begin());
+  transfer.data = std::move(data);
+  transfer.done = std::move(done);
+  ScheduleControl();
+}
+
+void UsbHost::PollInterrupt(uint8_t endpoint,
+                            uint32_t interval,
+                            InterruptListener listener) {
+  polls_.push_back({endpoint, std::max(interval, 1u), std::move(listener)});
+}
+
+void UsbHost::OnFrame() {
+  if (!connected_) {
+    connected_ = true;
+    if (connect_listener_) {
+      connect_listener_();
+    }
+  }
+  if (resetting_) {
+    return;
+  }
+  frame_start_ = simulator_.now();
+  bus_time_ = std::max(bus_time_, frame_start_);
+  for (const Poll& poll : polls_) {
+    if (usb_.frame() % poll.interval != 0) {
+      continue;
+    }
+    UsbControllerModel::Transaction transaction =
+        usb_.In(address_, poll.endpoint);
+    Account(transaction.handshake, transaction.data.size());
+    if (transaction.handshake == Handshake::kNak) {
+      ++interrupt_naks_[poll.endpoint];
+    } else if (transaction.handshake == Handshake::kAck &&
+               CheckToggle(poll.endpoint, /*in=*/true, transaction.data1)) {
+      poll.listener(transaction.data);
+    }
+  }
+  ScheduleControl();
+}
+
+void UsbHost::RunControl() {
+  control_scheduled_ = false;
+  Nanoseconds now = simulator_.now();
+  if (resetting_ || transfers_.empty() ||
+      now + kFrameMargin >=
+          frame_start_ + UsbControllerModel::kFrameInterval) {
+    // The next frame picks it up.
+    return;
+  }
+  Transfer& transfer = transfers_.front();
+  if (!transfer.started) {
+    transfer.started = true;
+    transfer.start = now;
+  } else if (now - transfer.start > kControlTimeout) {
+    Finish(false);
+    ScheduleControl();
+    return;
+  }
+  bus_time_ = std::max(bus_time_, now);
+  bool in = transfer.setup[0] & kDirIn;
+  UsbControllerModel::Transaction transaction;
+  switch (transfer.stage) {
+    case Stage::kSetup:
+      transaction = usb_.Setup(address_, transfer.setup);
+      Account(transaction.handshake, transfer.setup.size());
+      if (transaction.handshake == Handshake::kAck) {
+        transfer.data1 = true;
+        if (in) {
+          transfer.data.clear();
+          transfer.stage =
+              Length(transfer.setup) ? Stage::kDataIn : Stage::kStatusOut;
+        } else {
+          transfer.stage =
+              transfer.data.empty() ? Stage::kStatusIn : Stage::kDataOut;
+        }
+      } else if (++transfer.setup_tries >= kSetupTries) {
+        Finish(false);
+      }
+      break;
+    case Stage::kDataIn:
+      transaction = usb_.In(address_, 0);
+      Account(transaction.handshake, transaction.data.size());
+      if (transaction.handshake == Handshake::kAck) {
+        stats_.toggle_errors += transaction.data1 != transfer.data1;
+        transfer.data1 = !transfer.data1;
+        transfer.data.insert(transfer.data.end(), transaction.data.begin(),
+                             transaction.data.end());
+        if (transaction.data.size() < max_packet_size0_ ||
+            transfer.data.size() >= Length(transfer.setup)) {
+          transfer.stage = Stage::kStatusOut;
+        }
+      }
+      break;
+    case Stage::kDataOut: {
+      size_t size =
+          std::min<size_t>(transfer.data.size() - transfer.offset,
+                           max_packet_size0_);
+      transaction = usb_.Out(
+          address_, 0,
+          std::span<const uint8_t>(transfer.data).subspan(transfer.offset,
+                                                          size));
+      Account(transaction.handshake, size);
+      if (transaction.handshake == Handshake::kAck) {
+        stats_.toggle_errors += transaction.data1 != transfer.data1;
+        transfer.data1 = !transfer.data1;
+        transfer.offset += size;
+        if (transfer.offset >= transfer.data.size()) {
+          transfer.stage = Stage::kStatusIn;
+        }
+      }
+      break;
+    }
+    case Stage::kStatusIn:
+      transaction = usb_.In(address_, 0);
+      Account(transaction.handshake, transaction.data.size());
+      if (transaction.handshake == Handshake::kAck) {
+        stats_.toggle_errors += !transaction.data1;
+        Finish(transaction.data.empty());
+      }
+      break;
+    case Stage::kStatusOut:
+      transaction = usb_.Out(address_, 0, {});
+      Account(transaction.handshake, 0);
+      if (transaction.handshake == Handshake::kAck) {
+        stats_.toggle_errors += !transaction.data1;
+        Finish(true);
+      }
+      break;
+  }
+  if (transaction.handshake == Handshake::kStall) {
+    Finish(false);
+  }
+  ScheduleControl();
+}
+
+void UsbHost::ScheduleControl() {
+  if (transfers_.empty() || control_scheduled_) {
+    return;
+  }
+  control_scheduled_ = true;
+  simulator_.Schedule(std::max(simulator_.now(), bus_time_),
+                      [this] { RunControl(); });
+}
+
+void UsbHost::Finish(bool success) {
+  Transfer transfer = std::move(transfers_.front());
+  transfers_.pop_front();
+  ++stats_.control_transfers;
+  stats_.failed_transfers += !success;
+  stats_.control_time += simulator_.now() - transfer.start;
+  if (success && transfer.setup[0] == 0 &&
+      transfer.setup[1] == kRequestSetConfiguration) {
+    ResetToggles();
+  }
+  if (!success) {
+    transfer.done(std::nullopt);
+  } else if (transfer.setup[0] & kDirIn) {
+    transfer.done(std::move(transfer.data));
+  } else {
+    transfer.done(std::vector<uint8_t>());
+  }
+}
+
+void UsbHost::Account(Handshake handshake, size_t payload) {
+  ++stats_.transactions;
+  stats_.naks += handshake == Handshake::kNak;
+  stats_.no_responses += handshake == Handshake::kNoResponse;
+  bus_time_ += kTransactionOverhead + payload * kByteTime;
+}
+
+bool UsbHost::CheckToggle(uint8_t endpoint, bool in, bool data1) {
+  bool& expected = in ? in_data1_[endpoint] : out_data1_[endpoint];
+  if (data1 != expected) {
+    ++stats_.toggle_errors;
+    return false;
+  }
+  expected = !data1;
+  return true;
+}
+
+void UsbHost::ResetToggles() {
+  in_data1_ = {};
+  out_data1_ = {};
+}
+
+}  // namespace host
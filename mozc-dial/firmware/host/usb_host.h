@@ -0,0 +1,148 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef HOST_USB_HOST_H_
+#define HOST_USB_HOST_H_
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "simulator.h"
+#include "usb_controller_model.h"
+
+namespace host {
+
+// A full-speed USB host that runs scripted transfers on the bus of a
+// UsbControllerModel, a transaction at a time, as a host controller schedules
+// them: the interrupt IN endpoints it polls are read at the start of the
+// frames of their interval, and control transfers take the rest of each
+// frame. Transactions take their bus time, and one that is NAKed is tried
+// again in the next slot.
+//
+// Data toggles are checked on every data packet, from DATA0 after a bus
+// reset or SET_CONFIGURATION on each endpoint, and from DATA1 in each stage
+// of a control transfer after SETUP. An interrupt IN packet with the wrong
+// toggle is dropped, as a host takes it for one sent again.
+class UsbHost final {
+ public:
+  // Bus time of a byte at 12 Mbit/s, and of the token, handshake and gaps of
+  // a transaction.
+  static constexpr Nanoseconds kByteTime = 667;
+  static constexpr Nanoseconds kTransactionOverhead = 3 * kMicrosecond;
+  // No transaction starts this close to the end of a frame.
+  static constexpr Nanoseconds kFrameMargin = 100 * kMicrosecond;
+  // A control transfer fails after this long.
+  static constexpr Nanoseconds kControlTimeout = 50 * kMillisecond;
+  // A SETUP that gets no response is tried this many times in all.
+  static constexpr int kSetupTries = 3;
+
+  struct Stats {
+    size_t control_transfers = 0;
+    size_t failed_transfers = 0;
+    size_t transactions = 0;
+    size_t naks = 0;
+    size_t no_responses = 0;
+    size_t toggle_errors = 0;
+    // Time from the start of each control transfer to its completion.
+    Nanoseconds control_time = 0;
+  };
+
+  // Gets the data of an IN data stage, or std::nullopt if the transfer
+  // failed.
+  using ControlCallback =
+      std::function<void(std::optional<std::vector<uint8_t>> data)>;
+  using InterruptListener = std::function<void(std::span<const uint8_t> data)>;
+
+  // Takes the bus of `usb`, for the lifetime of the host.
+  UsbHost(Simulator& simulator, UsbControllerModel& usb);
+  UsbHost(const UsbHost&) = delete;
+  UsbHost& operator=(const UsbHost&) = delete;
+  ~UsbHost() = default;
+
+  // Calls `listener` at the first frame after the device pulls D+ up.
+  void SetConnectListener(std::function<void()> listener);
+
+  // Holds the bus in reset for `duration`, and calls `done` after it. The
+  // device is at address 0 then.
+  void Reset(Nanoseconds duration, std::function<void()> done);
+  // Addresses the device at `address` from now on.
+  void SetAddress(uint8_t address) { address_ = address; }
+  void SetMaxPacketSize0(uint8_t size) { max_packet_size0_ = size; }
+
+  // Runs a control transfer of `setup`, with the OUT data stage `data` if
+  // any, after the transfers before it.
+  void Control(std::span<const uint8_t, 8> setup,
+               std::vector<uint8_t> data,
+               ControlCallback done);
+  // Reads IN `endpoint` every `interval` frames, until the next bus reset.
+  void PollInterrupt(uint8_t endpoint,
+                     uint32_t interval,
+                     InterruptListener listener);
+
+  const Stats& stats() const { return stats_; }
+  // Interrupt IN transactions NAKed on `endpoint`.
+  size_t interrupt_naks(uint8_t endpoint) const {
+    return interrupt_naks_[endpoint];
+  }
+
+ private:
+  enum class Stage { kSetup, kDataIn, kDataOut, kStatusIn, kStatusOut };
+
+  struct Transfer {
+    std::array<uint8_t, 8> setup;
+    std::vector<uint8_t> data;
+    ControlCallback done;
+    Stage stage = Stage::kSetup;
+    Nanoseconds start = 0;
+    int setup_tries = 0;
+    bool started = false;
+    size_t offset = 0;
+    bool data1 = true;
+  };
+
+  struct Poll {
+    uint8_t endpoint;
+    uint32_t interval;
+    InterruptListener listener;
+  };
+
+  void OnFrame();
+  // Runs a transaction of the current control transfer, and schedules the
+  // next one.
+  void RunControl();
+  void ScheduleControl();
+  void Finish(bool success);
+  // Accounts a transaction of `payload` bytes with `handshake`.
+  void Account(UsbControllerModel::Handshake handshake, size_t payload);
+  // Expects `data1` as the toggle of IN or OUT `endpoint`, and flips it.
+  bool CheckToggle(uint8_t endpoint, bool in, bool data1);
+  void ResetToggles();
+
+  Simulator& simulator_;
+  UsbControllerModel& usb_;
+  std::function<void()> connect_listener_;
+  bool connected_ = false;
+  bool resetting_ = false;
+  uint8_t address_ = 0;
+  uint8_t max_packet_size0_ = 8;
+  // When the bus is free for the next transaction.
+  Nanoseconds bus_time_ = 0;
+  Nanoseconds frame_start_ = 0;
+  bool control_scheduled_ = false;
+  std::deque<Transfer> transfers_;
+  std::vector<Poll> polls_;
+  std::array<bool, USB_NUM_ENDPOINTS> in_data1_ = {};
+  std::array<bool, USB_NUM_ENDPOINTS> out_data1_ = {};
+  std::array<size_t, USB_NUM_ENDPOINTS> interrupt_naks_ = {};
+  Stats stats_;
+};
+
+}  // namespace host
+
+#endif  // HOST_USB_HOST_H_
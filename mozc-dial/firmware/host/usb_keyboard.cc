@@ -0,0 +1,46 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+// A firmware image for usb_sim: a keyboard of the common USB sources alone,
+// that types the letters a to z over and over, as fast as the host takes the
+// reports. Built with DIAL_USB_POLL_INTERVAL_MS for its bInterval.
+
+#include <cstdint>
+
+#include "pico/stdlib.h"
+
+#include "../common/usb_hid_keyboard.h"
+
+namespace {
+
+constexpr uint8_t kUsbPollIntervalMs = DIAL_USB_POLL_INTERVAL_MS;
+
+constexpr auto kUsbDescriptors = UsbHidKeyboard::MakeDescriptors(
+    /*vendor_id=*/0x6666, /*product_id=*/0x2025,
+    /*version=*/0x0101, /*vendor_name=*/"Gboard DIY prototype",
+    /*product_name=*/"Gboard Dial version", /*version_name=*/"usb_sim",
+    kUsbPollIntervalMs);
+
+constexpr uint8_t kUsageA = 0x04;
+constexpr uint8_t kUsageZ = 0x1d;
+
+}  // namespace
+
+int main() {
+  stdio_init_all();
+
+  UsbHidKeyboard usb_hid_keyboard(kUsbDescriptors);
+  usb_hid_keyboard.SetAutoKeyRelease(true);
+
+  uint8_t usage = kUsageA;
+  while (true) {
+    // A press and its release.
+    if (usb_hid_keyboard.queued_events() + 2 > UsbHidKeyboard::kMaxEvents) {
+      sleep_us(100);
+      continue;
+    }
+    usb_hid_keyboard.PressByUsageId(usage);
+    usage = usage == kUsageZ ? kUsageA : usage + 1;
+  }
+}
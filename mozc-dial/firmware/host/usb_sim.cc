@@ -0,0 +1,395 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+// Enumerates a keyboard of the common USB sources alone, UsbDevice,
+// UsbHidDevice and UsbHidKeyboard, with a scripted host on the registers and
+// DPRAM of the RP2040 USB controller, as Linux does: a bus reset, the device
+// descriptor at address 0, another reset, SET_ADDRESS, the descriptors,
+// SET_CONFIGURATION and the HID requests. Reports the time it takes, and the
+// control transfers, transactions and NAKs on the way.
+//
+// Then reads the reports at the keyboard's bInterval for a second, while the
+// firmware types as fast as they go, and checks that every poll gets one and
+// that the keys come in the order they were typed. Last, resets the bus and
+// enumerates the keyboard again, as after a host resumes.
+//
+// Runs an image for each bInterval in kPollIntervals, and exits with 1 if an
+// enumeration fails, a data toggle is wrong, a poll finds no report, or a key
+// is out of order.
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "heap_check.h"
+#include "keyboard_report.h"
+#include "simulator.h"
+#include "usb_controller_model.h"
+#include "usb_host.h"
+
+using host::Nanoseconds;
+using host::UsbHost;
+
+namespace {
+
+// Must match host/CMakeLists.txt.
+constexpr uint8_t kPollIntervals[] = {1, 2, 4, 8, 10, 32};
+
+// Host timings, as Linux takes them.
+constexpr Nanoseconds kDebounce = 100 * host::kMillisecond;
+constexpr Nanoseconds kResetTime = 10 * host::kMillisecond;
+constexpr Nanoseconds kResetRecovery = 10 * host::kMillisecond;
+constexpr Nanoseconds kSetAddressRecovery = 2 * host::kMillisecond;
+
+constexpr uint8_t kAddress = 5;
+constexpr uint8_t kKeyboardInterface = 0;
+constexpr Nanoseconds kThroughputTime = host::kSecond;
+// Reads after the second enumeration.
+constexpr Nanoseconds kResumeTime = 100 * host::kMillisecond;
+constexpr Nanoseconds kEnd = 3 * host::kSecond;
+
+// Must match host/usb_keyboard.cc.
+constexpr uint8_t kUsageA = 0x04;
+constexpr uint8_t kUsageZ = 0x1d;
+
+std::array<uint8_t, 8> Setup(uint8_t request_type,
+                             uint8_t request,
+                             uint16_t value,
+                             uint16_t index,
+                             uint16_t length) {
+  return {request_type,
+          request,
+          static_cast<uint8_t>(value),
+          static_cast<uint8_t>(value >> 8),
+          static_cast<uint8_t>(index),
+          static_cast<uint8_t>(index >> 8),
+          static_cast<uint8_t>(length),
+          static_cast<uint8_t>(length >> 8)};
+}
+
+// Runs steps one after another. Each calls `next` once it is done, or stops
+// the script by not calling it.
+class Script final {
+ public:
+  using Step = std::function<void(std::function<void()> next)>;
+
+  void Add(Step step) { steps_.push_back(std::move(step)); }
+  void Run() { Next(0); }
+
+ private:
+  void Next(size_t index) {
+    if (index < steps_.size()) {
+      steps_[index]([this, index] { Next(index + 1); });
+    }
+  }
+
+  std::vector<Step> steps_;
+};
+
+struct Enumeration {
+  Nanoseconds start = 0;
+  std::optional<Nanoseconds> configured;
+  // Once the HID requests are done, and the host polls the keyboard.
+  std::optional<Nanoseconds> ready;
+  UsbHost::Stats stats_at_start;
+  UsbHost::Stats stats;
+  std::vector<uint8_t> device;
+  std::vector<uint8_t> configuration;
+};
+
+// The keyboard's interrupt IN endpoint in `configuration`, and its bInterval.
+std::optional<std::pair<uint8_t, uint8_t>> FindKeyboardEndpoint(
+    const std::vector<uint8_t>& configuration) {
+  for (size_t offset = 0; offset + 1 < configuration.size();
+       offset += std::max<uint8_t>(configuration[offset], 1)) {
+    if (configuration[offset + 1] == 0x05 &&
+        offset + 7 <= configuration.size() &&
+        (configuration[offset + 2] & 0x80) &&
+        configuration[offset + 3] == 0x03) {
+      return std::pair(configuration[offset + 2] & 0x0f,
+                       configuration[offset + 6]);
+    }
+  }
+  return std::nullopt;
+}
+
+// The wDescriptorLength of the HID descriptor in `configuration`.
+uint16_t FindReportDescriptorLength(const std::vector<uint8_t>& configuration) {
+  for (size_t offset = 0; offset + 1 < configuration.size();
+       offset += std::max<uint8_t>(configuration[offset], 1)) {
+    if (configuration[offset + 1] == 0x21 &&
+        offset + 9 <= configuration.size()) {
+      return configuration[offset + 7] | configuration[offset + 8] << 8;
+    }
+  }
+  return 0;
+}
+
+struct Result {
+  Enumeration first;
+  Enumeration second;
+  uint8_t poll_interval = 0;
+  size_t polls = 0;
+  size_t reports = 0;
+  size_t keys = 0;
+  size_t keys_out_of_order = 0;
+  size_t reports_after_reset = 0;
+  size_t toggle_errors = 0;
+  size_t failed_transfers = 0;
+  bool heaps_ok = true;
+};
+
+Result Run(uint8_t poll_interval) {
+  host::Simulator simulator;
+  host::Chip& chip = simulator.AddChip(
+      "keyboard", std::string(IMAGE_DIR) + "/usb_keyboard_" +
+                      std::to_string(poll_interval) + "ms.so");
+  UsbHost usb_host(simulator, chip.usb());
+  Result result;
+  result.poll_interval = poll_interval;
+
+  // Keys come in the order they are typed, a to z and again.
+  std::optional<uint8_t> last_key;
+  std::set<uint8_t> pressed;
+  bool counting = false;
+  auto on_report = [&](std::span<const uint8_t> data) {
+    if (counting) {
+      ++result.reports;
+    }
+    std::optional<std::set<uint8_t>> keys = host::DecodeKeyboardReport(data);
+    if (!keys) {
+      ++result.keys_out_of_order;
+      return;
+    }
+    for (uint8_t key : *keys) {
+      if (pressed.contains(key)) {
+        continue;
+      }
+      uint8_t expected =
+          !last_key || *last_key == kUsageZ ? kUsageA : *last_key + 1;
+      if (last_key && key != expected) {
+        ++result.keys_out_of_order;
+      }
+      last_key = key;
+      result.keys += counting;
+    }
+    pressed = *keys;
+  };
+
+  Script script;
+  auto control = [&](std::function<std::array<uint8_t, 8>()> setup,
+                     std::vector<uint8_t> data,
+                     std::vector<uint8_t>* reply) -> Script::Step {
+    return [&, setup, data, reply](std::function<void()> next) {
+      std::array<uint8_t, 8> packet = setup();
+      usb_host.Control(
+          packet, data,
+          [packet, reply, next](std::optional<std::vector<uint8_t>> data) {
+            if (!data) {
+              printf("usb: control transfer %02x %02x failed\n", packet[0],
+                     packet[1]);
+              return;
+            }
+            if (reply) {
+              *reply = std::move(*data);
+            }
+            next();
+          });
+    };
+  };
+  auto wait = [&](Nanoseconds duration) -> Script::Step {
+    return [&, duration](std::function<void()> next) {
+      simulator.Schedule(simulator.now() + duration, next);
+    };
+  };
+  // From a bus reset to the first poll of the keyboard.
+  auto enumerate = [&](Enumeration& enumeration) {
+    script.Add([&](std::function<void()> next) {
+      enumeration.start = simulator.now();
+      enumeration.stats_at_start = usb_host.stats();
+      usb_host.Reset(kResetTime, next);
+    });
+    script.Add(wait(kResetRecovery));
+    // The first 64 bytes of the device descriptor, for bMaxPacketSize0.
+    script.Add([&](std::function<void()> next) {
+      usb_host.SetMaxPacketSize0(64);
+      next();
+    });
+    script.Add(control([] { return host::GetDescriptorRequest(0x01, 0, 64); },
+                       {}, &enumeration.device));
+    script.Add([&](std::function<void()> next) {
+      if (enumeration.device.size() < 8) {
+        printf("usb: device descriptor of %zu bytes\n",
+               enumeration.device.size());
+        return;
+      }
+      usb_host.SetMaxPacketSize0(enumeration.device[7]);
+      usb_host.Reset(kResetTime, next);
+    });
+    script.Add(wait(kResetRecovery));
+    script.Add(control([] { return Setup(0x00, 0x05, kAddress, 0, 0); }, {},
+                       nullptr));
+    script.Add([&](std::function<void()> next) {
+      usb_host.SetAddress(kAddress);
+      next();
+    });
+    script.Add(wait(kSetAddressRecovery));
+    script.Add(control([] { return host::GetDescriptorRequest(0x01, 0, 18); },
+                       {}, &enumeration.device));
+    script.Add(control([] { return host::GetDescriptorRequest(0x02, 0, 9); },
+                       {}, &enumeration.configuration));
+    script.Add(control(
+        [&] {
+          const std::vector<uint8_t>& header = enumeration.configuration;
+          uint16_t length = header.size() >= 4 ? header[2] | header[3] << 8 : 9;
+          return host::GetDescriptorRequest(0x02, 0, length);
+        },
+        {}, &enumeration.configuration));
+    // Languages, product, manufacturer and serial number.
+    for (size_t i = 0; i < 4; ++i) {
+      script.Add(control(
+          [&, i] {
+            const std::vector<uint8_t>& device = enumeration.device;
+            uint8_t index =
+                i == 0 ? 0 : (device.size() >= 18 ? device[13 + i] : 0);
+            return host::GetDescriptorRequest(0x03, index, 0xff);
+          },
+          {}, nullptr));
+    }
+    script.Add(control([] { return Setup(0x00, 0x09, 1, 0, 0); }, {},
+                       nullptr));
+    script.Add([&](std::function<void()> next) {
+      enumeration.configured = simulator.now();
+      next();
+    });
+    // SET_IDLE, the report descriptor, and SET_REPORT to turn the LEDs off.
+    script.Add(control(
+        [] { return Setup(0x21, 0x0a, 0, kKeyboardInterface, 0); }, {},
+        nullptr));
+    script.Add(control(
+        [&] {
+          return Setup(0x81, 0x06, 0x2200, kKeyboardInterface,
+                       FindReportDescriptorLength(enumeration.configuration));
+        },
+        {}, nullptr));
+    script.Add(control(
+        [] { return Setup(0x21, 0x09, 0x0200, kKeyboardInterface, 1); }, {0},
+        nullptr));
+    script.Add([&](std::function<void()> next) {
+      std::optional<std::pair<uint8_t, uint8_t>> endpoint =
+          FindKeyboardEndpoint(enumeration.configuration);
+      if (!endpoint) {
+        printf("usb: no keyboard endpoint\n");
+        return;
+      }
+      enumeration.ready = simulator.now();
+      enumeration.stats = usb_host.stats();
+      usb_host.PollInterrupt(endpoint->first, endpoint->second, on_report);
+      next();
+    });
+  };
+
+  script.Add(wait(kDebounce));
+  enumerate(result.first);
+  size_t naks_at_start = 0;
+  script.Add([&](std::function<void()> next) {
+    counting = true;
+    naks_at_start = usb_host.interrupt_naks(1);
+    next();
+  });
+  script.Add(wait(kThroughputTime));
+  script.Add([&](std::function<void()> next) {
+    counting = false;
+    result.polls = kThroughputTime /
+                   (poll_interval * host::kMillisecond);
+    // A poll that found no report.
+    result.polls = std::max(result.polls,
+                            result.reports + usb_host.interrupt_naks(1) -
+                                naks_at_start);
+    next();
+  });
+  // The report in flight at the reset is lost, and the keys start over.
+  script.Add([&](std::function<void()> next) {
+    last_key.reset();
+    pressed.clear();
+    next();
+  });
+  enumerate(result.second);
+  size_t reports_before_reset = 0;
+  script.Add([&](std::function<void()> next) {
+    reports_before_reset = result.reports;
+    counting = true;
+    next();
+  });
+  script.Add(wait(kResumeTime));
+  script.Add([&](std::function<void()> next) {
+    counting = false;
+    result.reports_after_reset = result.reports - reports_before_reset;
+    result.reports = reports_before_reset;
+    next();
+  });
+
+  usb_host.SetConnectListener([&] { script.Run(); });
+  simulator.RunUntil(kEnd);
+
+  result.toggle_errors = usb_host.stats().toggle_errors;
+  result.failed_transfers = usb_host.stats().failed_transfers;
+  result.heaps_ok = host::CheckHeaps(simulator);
+  return result;
+}
+
+double ToMs(Nanoseconds ns) {
+  return ns / 1e6;
+}
+
+bool Failed(const Result& result) {
+  return !result.first.ready || !result.second.ready ||
+         result.reports < result.polls || result.keys_out_of_order ||
+         !result.reports_after_reset || result.toggle_errors ||
+         result.failed_transfers || !result.heaps_ok;
+}
+
+void PrintEnumeration(const char* name, const Enumeration& enumeration) {
+  if (!enumeration.ready) {
+    printf("  %s: did not complete\n", name);
+    return;
+  }
+  const UsbHost::Stats& from = enumeration.stats_at_start;
+  const UsbHost::Stats& to = enumeration.stats;
+  printf(
+      "  %s: configured %.1f ms after the bus reset, polled at %.1f ms, %zu "
+      "control transfers taking %.2f ms, %zu transactions, %zu NAKs\n",
+      name, ToMs(*enumeration.configured - enumeration.start),
+      ToMs(*enumeration.ready - enumeration.start),
+      to.control_transfers - from.control_transfers,
+      ToMs(to.control_time - from.control_time),
+      to.transactions - from.transactions, to.naks - from.naks);
+}
+
+}  // namespace
+
+int main() {
+  int failures = 0;
+  for (uint8_t poll_interval : kPollIntervals) {
+    Result result = Run(poll_interval);
+    printf("bInterval %d ms:\n", poll_interval);
+    PrintEnumeration("enumeration", result.first);
+    PrintEnumeration("after bus reset", result.second);
+    printf(
+        "  %zu reports in %zu polls, %zu keys/s, %zu out of order, %zu "
+        "reports after the bus reset, %zu toggle errors, %zu failed "
+        "transfers%s\n",
+        result.reports, result.polls, result.keys, result.keys_out_of_order,
+        result.reports_after_reset, result.toggle_errors,
+        result.failed_transfers, Failed(result) ? ", unexpected" : "");
+    failures += Failed(result);
+  }
+  return failures ? 1 : 0;
+}
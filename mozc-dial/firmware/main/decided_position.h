@@ -0,0 +1,24 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef DECIDED_POSITION_H_
+#define DECIDED_POSITION_H_
+
+#include <cstdint>
+
+#include "../common/spsc_ring.h"
+
+// A position decided on a dial, to be sent over USB HID.
+struct DecidedPosition {
+  uint8_t dial;
+  uint8_t position;
+  // When it was decided. Keys are sent in this order.
+  uint32_t time_us;
+};
+
+// Decided positions from sensing to reporting. With DIAL_DUAL_CORE, core1
+// pushes and core0 pops.
+using DecidedPositionQueue = SpscRing<DecidedPosition, 16>;
+
+#endif  // DECIDED_POSITION_H_
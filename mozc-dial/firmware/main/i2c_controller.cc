@@ -5,15 +5,88 @@
 #include "i2c_controller.h"
 
 #include <algorithm>
-#include <vector>
+#include <utility>
 
 #include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "pico/stdlib.h"
+
+#include "../common/hot_path.h"
+#include "../common/trace.h"
 
 static constexpr int kI2CSpeedInHz = 400 * 1000;
 
+// Interrupts taken while a transaction runs: the TX FIFO needs refilling, a
+// byte was read, the address was not acknowledged, or the STOP went out.
+static constexpr uint32_t kRunningInterrupts =
+    I2C_IC_INTR_MASK_M_TX_EMPTY_BITS | I2C_IC_INTR_MASK_M_RX_FULL_BITS |
+    I2C_IC_INTR_MASK_M_TX_ABRT_BITS | I2C_IC_INTR_MASK_M_STOP_DET_BITS;
+
+namespace {
+
+I2CController* sControllers[2] = {nullptr, nullptr};
+
+}  // namespace
+
+I2CController::Future::Future(Future&& other)
+    : controller_(std::exchange(other.controller_, nullptr)),
+      slot_(other.slot_) {}
+
+I2CController::Future& I2CController::Future::operator=(Future&& other) {
+  if (this != &other) {
+    Release();
+    controller_ = std::exchange(other.controller_, nullptr);
+    slot_ = other.slot_;
+  }
+  return *this;
+}
+
+I2CController::Future::~Future() {
+  Release();
+}
+
+bool DIAL_HOT_PATH(I2CController::Future::ready)() const {
+  if (!controller_) {
+    return true;
+  }
+  State state = controller_->transactions_[slot_].state.load();
+  return state == State::kSucceeded || state == State::kFailed;
+}
+
+bool I2CController::Future::Wait() {
+  // The I2C interrupt wakes the core up.
+  while (!ready()) {
+    __wfe();
+  }
+  return success();
+}
+
+bool DIAL_HOT_PATH(I2CController::Future::success)() const {
+  return controller_ &&
+         controller_->transactions_[slot_].state.load() == State::kSucceeded;
+}
+
+std::span<const uint8_t> DIAL_HOT_PATH(I2CController::Future::data)() const {
+  if (!success()) {
+    return {};
+  }
+  const Transaction& transaction = controller_->transactions_[slot_];
+  return {transaction.read_data.data(), transaction.received};
+}
+
+void DIAL_HOT_PATH(I2CController::Future::Release)() {
+  if (controller_) {
+    controller_->Release(slot_);
+    controller_ = nullptr;
+  }
+}
+
 I2CController::I2CController(i2c_inst_t* i2c, int8_t sda, int8_t scl)
     : i2c_(i2c) {
   hard_assert(i2c == i2c0 || i2c == i2c1);
+  hard_assert(!sControllers[i2c_hw_index(i2c)]);
+  sControllers[i2c_hw_index(i2c)] = this;
   gpio_init(sda);
   gpio_init(scl);
   gpio_set_function(sda, GPIO_FUNC_I2C);
@@ -21,27 +94,235 @@ I2CController::I2CController(i2c_inst_t* i2c, int8_t sda, int8_t scl)
   gpio_pull_up(sda);
   gpio_pull_up(scl);
   i2c_init(i2c_, kI2CSpeedInHz);
+
+  i2c_hw_t* hw = i2c_get_hw(i2c_);
+  hw->intr_mask = 0;
+  // Refill when half of the TX FIFO is sent, and take every byte read.
+  hw->tx_tl = I2C_FIFO_DEPTH / 2;
+  hw->rx_tl = 0;
+}
+
+I2CController::Future DIAL_HOT_PATH(I2CController::WriteAsync)(
+    uint8_t device_addr,
+    uint8_t mem_addr,
+    std::span<const uint8_t> data) {
+  int slot = Enqueue(device_addr, mem_addr, data, 0, nullptr, nullptr,
+                     /*has_future=*/true);
+  return slot < 0 ? Future() : Future(this, slot);
+}
+
+I2CController::Future DIAL_HOT_PATH(I2CController::ReadAsync)(
+    uint8_t device_addr,
+    uint8_t mem_addr,
+    size_t size) {
+  int slot = Enqueue(device_addr, mem_addr, {}, size, nullptr, nullptr,
+                     /*has_future=*/true);
+  return slot < 0 ? Future() : Future(this, slot);
+}
+
+bool DIAL_HOT_PATH(I2CController::WriteAsync)(uint8_t device_addr,
+                                              uint8_t mem_addr,
+                                              std::span<const uint8_t> data,
+                                              Callback callback,
+                                              void* context) {
+  return Enqueue(device_addr, mem_addr, data, 0, callback, context,
+                 /*has_future=*/false) >= 0;
+}
+
+bool DIAL_HOT_PATH(I2CController::ReadAsync)(uint8_t device_addr,
+                                             uint8_t mem_addr,
+                                             size_t size,
+                                             Callback callback,
+                                             void* context) {
+  return Enqueue(device_addr, mem_addr, {}, size, callback, context,
+                 /*has_future=*/false) >= 0;
+}
+
+bool I2CController::Write(uint8_t device_addr,
+                          uint8_t mem_addr,
+                          std::span<const uint8_t> data) {
+  return WriteAsync(device_addr, mem_addr, data).Wait();
 }
 
 bool I2CController::Read(uint8_t device_addr,
                          uint8_t mem_addr,
                          std::span<uint8_t> data) {
-  uint8_t addr[1] = {mem_addr};
-  int result = i2c_write_blocking(i2c_, device_addr, addr, 1, true);
-  if (result != 1) {
+  Future future = ReadAsync(device_addr, mem_addr, data.size());
+  if (!future.Wait() || future.data().size() != data.size()) {
     return false;
   }
-  result = i2c_read_blocking(i2c_, device_addr, data.data(), data.size(), false);
-  return result == data.size();
+  std::copy(future.data().begin(), future.data().end(), data.begin());
+  return true;
 }
 
-bool I2CController::Write(uint8_t device_addr,
-                          uint8_t mem_addr,
-                          std::span<uint8_t> data) {
-  std::vector<uint8_t> buf;
-  buf.reserve(data.size() + 1);
-  buf.push_back(mem_addr);
-  buf.insert(buf.end(), data.begin(), data.end());
-  int rc = i2c_write_blocking(i2c_, device_addr, buf.data(), buf.size(), false);
-  return rc == buf.size();
-}
\ No newline at end of file
+// static
+void DIAL_HOT_PATH(I2CController::HandleInterrupt0)() {
+  trace::Begin(trace::Stage::kI2CIsr);
+  sControllers[0]->HandleInterrupt();
+  trace::End(trace::Stage::kI2CIsr);
+}
+
+// static
+void DIAL_HOT_PATH(I2CController::HandleInterrupt1)() {
+  trace::Begin(trace::Stage::kI2CIsr);
+  sControllers[1]->HandleInterrupt();
+  trace::End(trace::Stage::kI2CIsr);
+}
+
+int DIAL_HOT_PATH(I2CController::Enqueue)(uint8_t device_addr,
+                                          uint8_t mem_addr,
+                                          std::span<const uint8_t> data,
+                                          size_t read_size,
+                                          Callback callback,
+                                          void* context,
+                                          bool has_future) {
+  if (data.size() > kMaxDataSize || read_size > kMaxDataSize) {
+    return -1;
+  }
+  if (!irq_enabled_) {
+    uint irq = i2c_hw_index(i2c_) ? I2C1_IRQ : I2C0_IRQ;
+    irq_set_exclusive_handler(
+        irq, i2c_hw_index(i2c_) ? &HandleInterrupt1 : &HandleInterrupt0);
+    irq_set_enabled(irq, true);
+    irq_enabled_ = true;
+  }
+
+  uint32_t status = save_and_disable_interrupts();
+  int slot = -1;
+  for (size_t i = 0; i < transactions_.size(); ++i) {
+    if (transactions_[i].state.load() == State::kFree) {
+      slot = i;
+      break;
+    }
+  }
+  if (slot >= 0) {
+    Transaction& transaction = transactions_[slot];
+    transaction.has_future = has_future;
+    transaction.device_addr = device_addr;
+    transaction.write_data[0] = mem_addr;
+    std::copy(data.begin(), data.end(), transaction.write_data.begin() + 1);
+    transaction.write_size = 1 + data.size();
+    transaction.read_size = read_size;
+    transaction.received = 0;
+    transaction.sequence = next_sequence_++;
+    transaction.callback = callback;
+    transaction.context = context;
+    transaction.state.store(State::kQueued);
+    trace::Begin(read_size ? trace::Stage::kI2CRead : trace::Stage::kI2CWrite,
+                 transaction.sequence);
+    if (!running_) {
+      StartNext();
+    }
+  }
+  restore_interrupts(status);
+  return slot;
+}
+
+void DIAL_HOT_PATH(I2CController::HandleInterrupt)() {
+  if (!running_) {
+    return;
+  }
+  i2c_hw_t* hw = i2c_get_hw(i2c_);
+  uint32_t status = hw->intr_stat;
+  if (status & I2C_IC_INTR_STAT_R_TX_ABRT_BITS) {
+    // The target did not acknowledge. The block flushes the TX FIFO and sends
+    // a STOP, that completes the transaction as failed.
+    static_cast<void>(static_cast<uint32_t>(hw->clr_tx_abrt));
+    aborted_ = true;
+  }
+  while (hw->rxflr) {
+    uint8_t value = hw->data_cmd & I2C_IC_DATA_CMD_DAT_BITS;
+    if (running_->received < running_->read_size) {
+      running_->read_data[running_->received++] = value;
+    }
+  }
+  if (status & I2C_IC_INTR_STAT_R_STOP_DET_BITS) {
+    static_cast<void>(static_cast<uint32_t>(hw->clr_stop_det));
+    Complete(!aborted_ && running_->received == running_->read_size);
+    StartNext();
+    return;
+  }
+  if (!aborted_) {
+    FillTxFifo();
+  }
+}
+
+void DIAL_HOT_PATH(I2CController::StartNext)() {
+  i2c_hw_t* hw = i2c_get_hw(i2c_);
+  running_ = nullptr;
+  for (auto& transaction : transactions_) {
+    if (transaction.state.load() == State::kQueued &&
+        (!running_ ||
+         static_cast<int32_t>(transaction.sequence - running_->sequence) < 0)) {
+      running_ = &transaction;
+    }
+  }
+  if (!running_) {
+    hw->intr_mask = 0;
+    return;
+  }
+  running_->state.store(State::kRunning);
+  issued_ = 0;
+  aborted_ = false;
+  // The target address can only be changed while the block is disabled.
+  hw->enable = 0;
+  hw->tar = running_->device_addr;
+  hw->enable = I2C_IC_ENABLE_ENABLE_BITS;
+  hw->intr_mask = kRunningInterrupts;
+  FillTxFifo();
+}
+
+void DIAL_HOT_PATH(I2CController::FillTxFifo)() {
+  i2c_hw_t* hw = i2c_get_hw(i2c_);
+  const Transaction& transaction = *running_;
+  size_t total = transaction.write_size + transaction.read_size;
+  while (issued_ < total && hw->txflr < I2C_FIFO_DEPTH) {
+    uint32_t command;
+    if (issued_ < transaction.write_size) {
+      command = transaction.write_data[issued_];
+    } else {
+      command = I2C_IC_DATA_CMD_CMD_BITS;
+      if (issued_ == transaction.write_size) {
+        command |= I2C_IC_DATA_CMD_RESTART_BITS;
+      }
+    }
+    if (issued_ + 1u == total) {
+      command |= I2C_IC_DATA_CMD_STOP_BITS;
+    }
+    hw->data_cmd = command;
+    ++issued_;
+  }
+  if (issued_ == total) {
+    // Nothing more to send; wait for the read data and the STOP.
+    hw->intr_mask = kRunningInterrupts & ~I2C_IC_INTR_MASK_M_TX_EMPTY_BITS;
+  }
+}
+
+void DIAL_HOT_PATH(I2CController::Complete)(bool success) {
+  Transaction& transaction = *running_;
+  trace::End(transaction.read_size ? trace::Stage::kI2CRead
+                                   : trace::Stage::kI2CWrite,
+             transaction.sequence);
+  if (!success) {
+    failures_ = failures_ + 1;
+  }
+  if (transaction.callback) {
+    transaction.callback(
+        transaction.context, success,
+        {transaction.read_data.data(), success ? transaction.received : 0u});
+  }
+  transaction.state.store(transaction.has_future
+                              ? (success ? State::kSucceeded : State::kFailed)
+                              : State::kFree);
+}
+
+void DIAL_HOT_PATH(I2CController::Release)(uint8_t slot) {
+  uint32_t status = save_and_disable_interrupts();
+  Transaction& transaction = transactions_[slot];
+  transaction.has_future = false;
+  State state = transaction.state.load();
+  if (state == State::kSucceeded || state == State::kFailed) {
+    transaction.state.store(State::kFree);
+  }
+  restore_interrupts(status);
+}
@@ -5,23 +5,153 @@
 #ifndef I2C_CONTROLLER_H_
 #define I2C_CONTROLLER_H_
 
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <span>
 
 #include "hardware/i2c.h"
 
+// Runs register reads and writes on an I2C bus from the I2C interrupt, so that
+// the caller can do other work while bytes are on the bus. Transactions are
+// queued without blocking and run back to back in order. All storage is
+// preallocated: each transaction has its own buffers of kMaxDataSize bytes,
+// and at most kMaxTransactions can be waiting, running, or holding a result.
+//
+// The interrupt is taken by the core that queues the first transaction, and
+// all transactions must be queued from that core.
 class I2CController final {
  public:
+  static constexpr size_t kMaxTransactions = 8;
+  static constexpr size_t kMaxDataSize = 49;
+
+  // Called in the interrupt when a transaction completes. `data` holds the
+  // bytes read, and is valid only during the call.
+  using Callback = void (*)(void* context,
+                            bool success,
+                            std::span<const uint8_t> data);
+
+  // The result of a queued transaction, to poll. It holds the transaction
+  // until destroyed.
+  class Future final {
+   public:
+    Future() = default;
+    Future(Future&& other);
+    Future& operator=(Future&& other);
+    Future(const Future&) = delete;
+    Future& operator=(const Future&) = delete;
+    ~Future();
+
+    // False if the transaction could not be queued, as all were in use.
+    bool valid() const { return controller_ != nullptr; }
+    // True once the transaction has completed or failed.
+    bool ready() const;
+    // Waits until ready(), and returns whether the transaction succeeded.
+    bool Wait();
+    // Whether a ready transaction succeeded, and the bytes it read.
+    bool success() const;
+    std::span<const uint8_t> data() const;
+
+   private:
+    friend class I2CController;
+
+    Future(I2CController* controller, uint8_t slot)
+        : controller_(controller), slot_(slot) {}
+    void Release();
+
+    I2CController* controller_ = nullptr;
+    uint8_t slot_ = 0;
+  };
+
   I2CController(i2c_inst_t* i2c, int8_t sda, int8_t scl);
   I2CController(const I2CController&) = delete;
   I2CController& operator=(const I2CController&) = delete;
   ~I2CController() = default;
 
-  bool Write(uint8_t device_addr, uint8_t mem_addr, std::span<uint8_t> data);
+  // Queues writing `data` to the registers from `mem_addr`.
+  Future WriteAsync(uint8_t device_addr,
+                    uint8_t mem_addr,
+                    std::span<const uint8_t> data);
+  // Queues reading `size` bytes from the registers from `mem_addr`, as one
+  // transfer: `mem_addr` is written, and the data is read after a repeated
+  // START.
+  Future ReadAsync(uint8_t device_addr, uint8_t mem_addr, size_t size);
+
+  // Same as above, but `callback` is called instead, and may be nullptr.
+  // Return false if the transaction could not be queued.
+  bool WriteAsync(uint8_t device_addr,
+                  uint8_t mem_addr,
+                  std::span<const uint8_t> data,
+                  Callback callback,
+                  void* context);
+  bool ReadAsync(uint8_t device_addr,
+                 uint8_t mem_addr,
+                 size_t size,
+                 Callback callback,
+                 void* context);
+
+  // Blocking versions, queued behind pending transactions.
+  bool Write(uint8_t device_addr,
+             uint8_t mem_addr,
+             std::span<const uint8_t> data);
   bool Read(uint8_t device_addr, uint8_t mem_addr, std::span<uint8_t> data);
 
+  // Transactions queued so far, and those of them that failed, e.g. on a NAK
+  // or a lost arbitration. They wrap around.
+  uint32_t transactions() const { return next_sequence_; }
+  uint32_t failures() const { return failures_; }
+
  private:
+  enum class State : uint8_t {
+    kFree,
+    kQueued,
+    kRunning,
+    kSucceeded,
+    kFailed,
+  };
+
+  struct Transaction {
+    std::atomic<State> state = State::kFree;
+    // Held by a Future; otherwise freed on completion.
+    bool has_future = false;
+    uint8_t device_addr = 0;
+    uint8_t write_size = 0;
+    uint8_t read_size = 0;
+    uint8_t received = 0;
+    uint32_t sequence = 0;
+    Callback callback = nullptr;
+    void* context = nullptr;
+    std::array<uint8_t, 1 + kMaxDataSize> write_data = {};
+    std::array<uint8_t, kMaxDataSize> read_data = {};
+  };
+
+  static void HandleInterrupt0();
+  static void HandleInterrupt1();
+
+  // Returns the slot of a new transaction, or -1 if all are in use.
+  int Enqueue(uint8_t device_addr,
+              uint8_t mem_addr,
+              std::span<const uint8_t> data,
+              size_t read_size,
+              Callback callback,
+              void* context,
+              bool has_future);
+  void HandleInterrupt();
+  void StartNext();
+  void FillTxFifo();
+  void Complete(bool success);
+  void Release(uint8_t slot);
+
   i2c_inst_t* i2c_ = nullptr;
+  bool irq_enabled_ = false;
+  std::array<Transaction, kMaxTransactions> transactions_;
+  uint32_t next_sequence_ = 0;
+  volatile uint32_t failures_ = 0;
+  // Touched only in the interrupt once a transaction is running.
+  Transaction* running_ = nullptr;
+  uint8_t issued_ = 0;
+  bool aborted_ = false;
 };
 
-#endif  // I2C_CONTROLLER_H_
\ No newline at end of file
+#endif  // I2C_CONTROLLER_H_
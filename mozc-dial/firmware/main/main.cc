@@ -2,23 +2,313 @@
 // Use of this source code is governed by an Apache License that can be found
 // in the LICENSE file.
 
+#include <algorithm>
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <cstdio>
-#include <vector>
+#include <span>
 
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
 #include "hardware/uart.h"
+#if DIAL_KEYMAP_STORE
+#include "pico/flash.h"
+#endif
+#if DIAL_DUAL_CORE
+#include "pico/multicore.h"
+#endif
 #if LIB_PICO_STDIO_UART
 #include "pico/stdio_uart.h"
 #endif
 #include "pico/stdlib.h"
 
-#include "../common/dial_controller.h"
+#include "../common/dial_keyboard.h"
+#include "../common/heap_monitor.h"
+#include "../common/hot_path.h"
+#if DIAL_KEYMAP_STORE
+#include "../common/keymap_store.h"
+#endif
 #include "../common/motor_controller.h"
-#include "../common/photo_sensor.h"
-#include "../common/usage_tables.h"
+#include "../common/sensor_bank.h"
+#include "../common/sub_protocol.h"
+#include "../common/telemetry_protocol.h"
+#include "../common/trace.h"
 #include "../common/usb_hid_keyboard.h"
+#include "../common/usb_vendor_interface.h"
+#include "decided_position.h"
 #include "i2c_controller.h"
+#include "sub_dials.h"
+#if DIAL_USB_TELEMETRY
+#include "telemetry.h"
+#endif
+
+#if DIAL_SUB_ATTENTION && LIB_PICO_STDIO_UART
+#error "DIAL_SUB_ATTENTION takes the UART TX pin; disable stdio over UART"
+#endif
+#if DIAL_KEYMAP_STORE && !DIAL_USB_TELEMETRY
+#error "DIAL_KEYMAP_STORE takes keymaps over the DIAL_USB_TELEMETRY interface"
+#endif
+
+using namespace sub_protocol;
+
+namespace {
+
+// The sub-controllers boot at the same time as main, and are polled for their
+// protocol version until they are ready, for up to this time.
+constexpr uint32_t kSubHandshakeTimeoutMs = 1000;
+
+#if !DIAL_SUB_ATTENTION
+// While all dials of a sub are at the base, its sensors are polled only at
+// this interval. With DIAL_SUB_ATTENTION, the subs tell when to poll instead.
+// With DIAL_EVENT_DRIVEN, the idle main loop also wakes up for it.
+constexpr uint64_t kSubIdlePollIntervalUs = 4000;
+#endif
+
+
+// The local dials, and the dials of all subs. The motor bitmap has a bit per
+// dial.
+constexpr size_t kMaxDials = 32;
+constexpr size_t kNumOfLocalDials = 8;
+
+#if DIAL_USB_POLL_INTERVAL_MS
+constexpr uint8_t kUsbPollIntervalMs = DIAL_USB_POLL_INTERVAL_MS;
+#else
+constexpr uint8_t kUsbPollIntervalMs = UsbHidKeyboard::kDefaultPollIntervalMs;
+#endif
+
+constexpr auto kUsbKeyboardDescriptors = UsbHidKeyboard::MakeDescriptors(
+    /*vendor_id=*/0x6666, /*product_id=*/0x2025,
+    /*version=*/0x0109, /*vendor_name=*/"Gboard DIY prototype",
+    /*product_name=*/"Gboard Dial version", /*version_name=*/"9 Dial",
+    kUsbPollIntervalMs);
+#if DIAL_USB_TELEMETRY
+// The keyboard, and the vendor interface of common/telemetry_protocol.h.
+constexpr auto kUsbDescriptors = UsbHidKeyboard::AddInterface(
+    kUsbKeyboardDescriptors,
+    UsbVendorInterface::MakeDescriptors(telemetry_protocol::kInterfaceNumber,
+                                        telemetry_protocol::kEndPoint));
+#else
+constexpr const auto& kUsbDescriptors = kUsbKeyboardDescriptors;
+#endif
+
+// The motor positions of the local dials, that the subs run.
+struct MotorPositions {
+  std::span<uint8_t> positions;
+
+  void Drive(size_t dial, uint8_t position) { positions[dial] = position; }
+};
+
+// Decided positions from sensing to reporting. With DIAL_DUAL_CORE, core1
+// rings core0 with a word on the inter-core FIFO for each batch.
+DecidedPositionQueue sDecidedPositions;
+
+#if DIAL_KEYMAP_STORE
+// Keymaps written over the vendor interface. It takes one in a buffer of its
+// own, too large for the stack.
+KeymapStore sKeymapStore;
+#endif
+
+// The loop of main: senses the local dials and those of the subs as one
+// keyboard, as one_dial does its dial, queues the positions they decide, and
+// types them with the telemetry alongside. With DIAL_DUAL_CORE, Start() and
+// Sense() run on core1, and Report() on core0.
+class MainLoop final {
+ public:
+  MainLoop();
+  MainLoop(const MainLoop&) = delete;
+  MainLoop& operator=(const MainLoop&) = delete;
+  ~MainLoop() = default;
+
+  // Finds the sub-controllers and lays out their dials after the local ones,
+  // and enables the interrupts Sense() waits for. Runs where Sense() runs, as
+  // the I2C and GPIO interrupts are taken there.
+  void Start();
+
+  // Samples all dials, drives the motors, and queues decided positions.
+  // Returns true if any is queued.
+  bool Sense();
+
+  // Sends queued decided positions over USB HID, and serves the telemetry.
+  void Report();
+
+ private:
+  I2CController i2c_;
+  SensorBank sensors_;
+  // How far each dial is from the base, for its motor to slow down near it.
+  // The subs run the motors of the local dials too.
+  std::array<uint8_t, kMaxDials> motor_positions_ = {};
+  MotorPositions local_motors_ = {motor_positions_};
+  // The local dials A, B, C, D, E, F, G and I, that also type the keys of
+  // all dials. The dials on the subs follow them in the order of their slots,
+  // e.g. H on the sub of the 9-dial edition; the subs decide their positions.
+  DialKeyboard<kNumOfLocalDials, SensorBank, MotorPositions> dials_;
+  SubDials subs_;
+  size_t num_dials_ = kNumOfLocalDials;
+  UsbHidKeyboard usb_hid_keyboard_;
+#if DIAL_USB_TELEMETRY
+  UsbVendorInterface usb_vendor_;
+  Telemetry telemetry_;
+#endif
+  uint32_t motor_start_bitmap_ = 0;
+  // Positions decided in a pass of Sense().
+  std::array<DecidedPosition, kMaxDials> decided_positions_;
+#if !DIAL_SUB_ATTENTION
+  absolute_time_t sub_poll_deadline_ = get_absolute_time();
+#endif
+#if DIAL_EVENT_DRIVEN
+  bool settled_ = true;
+#endif
+};
+
+MainLoop::MainLoop()
+    : i2c_(i2c0, /*sda=*/28, /*scl=*/29),
+      // Sensor A, B, C, D, E, F, G, I (note: H is missing here as it's
+      // accessed via I2C). Each sensor is given as {first GPIO, width}.
+      sensors_({
+          {1, 6},   // A
+          {7, 2},   // B
+          {9, 3},   // C
+          {12, 2},  // D (3 sensors are implemented, but...)
+          {15, 3},  // E
+          {18, 3},  // F
+          {21, 2},  // G (3 sensors are implemented, but...)
+          {24, 4},  // I
+      }),
+      dials_(sensors_, local_motors_),
+      subs_(i2c_),
+      usb_hid_keyboard_(kUsbDescriptors)
+#if DIAL_USB_TELEMETRY
+      ,
+      usb_vendor_(usb_hid_keyboard_, kUsbDescriptors.configuration.interface),
+      telemetry_(usb_vendor_, i2c_, usb_hid_keyboard_, sDecidedPositions)
+#endif
+{
+#if DIAL_SUB_ATTENTION
+  gpio_init(kMainAttentionGpio);
+  gpio_set_dir(kMainAttentionGpio, GPIO_IN);
+  gpio_pull_down(kMainAttentionGpio);
+#endif
+#if DIAL_EARLY_COMMIT
+  dials_.SetEarlyCommit(true);
+#endif
+  // Without I2C work in most iterations, and with DIAL_EVENT_DRIVEN edges, the
+  // sensors are sampled much more often than a misread lasts.
+  dials_.SetConfirmTime(kConfirmTimeUs);
+#if DIAL_KEYMAP_STORE
+  dials_.SetLayout(sKeymapStore.Load());
+  telemetry_.SetKeymapStore(sKeymapStore);
+#endif
+  usb_hid_keyboard_.SetAutoKeyRelease(true);
+}
+
+void MainLoop::Start() {
+  num_dials_ = subs_.Connect(kNumOfLocalDials, kMaxDials,
+                             kSubHandshakeTimeoutMs);
+#if DIAL_USB_TELEMETRY
+  telemetry_.SetNumDials(num_dials_);
+#endif
+#if DIAL_EVENT_DRIVEN
+  // GPIO interrupts are taken by the core that enables them.
+  sensors_.EnableEdgeCapture();
+#if DIAL_SUB_ATTENTION
+  gpio_set_irq_enabled(kMainAttentionGpio, GPIO_IRQ_EDGE_RISE, true);
+#endif
+#endif
+}
+
+bool DIAL_HOT_LOOP(MainLoop::Sense)() {
+#if DIAL_USB_TELEMETRY
+  telemetry_.CountLoop();
+#endif
+#if DIAL_EVENT_DRIVEN
+  if (!motor_start_bitmap_ && settled_ && !sensors_.HasEdges()) {
+#if DIAL_SUB_ATTENTION
+    // The attention line raises a GPIO interrupt, that wakes up from WFE.
+    // So does the I2C interrupt of a read in flight.
+    if (!gpio_get(kMainAttentionGpio)) {
+      __wfe();
+    }
+#else
+    best_effort_wfe_or_timeout(sub_poll_deadline_);
+#endif
+  }
+  // Captured edges first, as the loop may have been busy on I2C or USB.
+  dials_.SenseEdges();
+#endif
+  // Ask the subs for their dials first, so that the transfers run on the bus
+  // while the local sensors are processed, and over later iterations. A sub
+  // is only read while its dials may be moving.
+#if DIAL_SUB_ATTENTION
+  bool poll_all = gpio_get(kMainAttentionGpio);
+#else
+  bool poll_all = time_reached(sub_poll_deadline_);
+  if (poll_all) {
+    sub_poll_deadline_ = make_timeout_time_us(kSubIdlePollIntervalUs);
+  }
+#endif
+  subs_.QueueReads(poll_all);
+
+  dials_.Sense(time_us_32());
+  size_t num_decided = subs_.Update(motor_positions_, decided_positions_);
+  motor_start_bitmap_ = 0;
+  for (size_t i = 0; i < num_dials_; ++i) {
+    if (motor_positions_[i]) {
+      motor_start_bitmap_ |= (1u << i);
+    }
+  }
+
+#if DIAL_EVENT_DRIVEN
+  settled_ = dials_.IsSettled() && !subs_.IsBusy();
+#endif
+
+  // The writes go out while decided positions are reported.
+  subs_.DriveMotors(motor_positions_);
+
+  // Positions decided in this pass go out in the order of their times, as the
+  // subs decided theirs earlier.
+  trace::Begin(trace::Stage::kDecide);
+  dials_.PopDecided([this, &num_decided](size_t dial, uint8_t position,
+                                         uint32_t time_us) {
+    decided_positions_[num_decided++] = {static_cast<uint8_t>(dial), position,
+                                         time_us};
+  });
+  std::sort(decided_positions_.begin(),
+            decided_positions_.begin() + num_decided,
+            [](const DecidedPosition& a, const DecidedPosition& b) {
+              return static_cast<int32_t>(a.time_us - b.time_us) < 0;
+            });
+  for (size_t i = 0; i < num_decided; ++i) {
+    sDecidedPositions.Push(decided_positions_[i]);
+  }
+  trace::End(trace::Stage::kDecide);
+  return num_decided != 0;
+}
+
+void DIAL_HOT_LOOP(MainLoop::Report)() {
+  while (std::optional<DecidedPosition> decided = sDecidedPositions.Pop()) {
+    trace::Begin(trace::Stage::kReport);
+    dials_.Type(usb_hid_keyboard_, decided->dial, decided->position,
+                decided->time_us);
+#if DIAL_USB_TELEMETRY
+    telemetry_.CountDecision(*decided);
+#endif
+    trace::End(trace::Stage::kReport);
+  }
+#if DIAL_USB_TELEMETRY
+#if DIAL_KEYMAP_STORE
+  if (telemetry_.Poll()) {
+    dials_.SetLayout(sKeymapStore.layout());
+  }
+#else
+  telemetry_.Poll();
+#endif
+#endif
+  heap_monitor::Poll("main");
+  trace::Poll("main");
+}
+
+}  // namespace
 
 int main() {
 #if LIB_PICO_STDIO_UART
@@ -28,143 +318,50 @@ int main() {
   stdio_init_all();
 #endif
 
-  I2CController i2c(i2c0, /*sda=*/28, /*scl=*/29);
-
-  // Sensor A, B, C, D, E, F, G, I (note: H is missing here as it's accessed via
-  // I2C)
-  std::array<PhotoSensor, 8> sensors = {
-      PhotoSensor(1, 2, 3, 4, 5, 6),  // A
-      PhotoSensor(7, 8),              // B
-      PhotoSensor(9, 10, 11),         // C
-      PhotoSensor(12, 13),            // D (3 sensors are implemented, but...)
-      PhotoSensor(15, 16, 17),        // E
-      PhotoSensor(18, 19, 20),        // F
-      PhotoSensor(21, 22),            // G (3 sensors are implemented, but...)
-      PhotoSensor(24, 25, 26, 27),    // I
-  };
-
-  std::array<DialController, 9> dials = {
-      DialController(),  // A
-      DialController(),  // B
-      DialController(),  // C
-      DialController(),  // D
-      DialController(),  // E
-      DialController(),  // F
-      DialController(),  // G
-      DialController(),  // I
-
-      DialController(),  // H
-  };
-
-  std::array<const std::vector<uint8_t>*, 9> usages = {
-      &usage_tables::a,  // A
-      &usage_tables::b,  // B
-      &usage_tables::c,  // C
-      &usage_tables::d,  // D
-      &usage_tables::e,  // E
-      &usage_tables::f,  // F
-      &usage_tables::g,  // G
-      &usage_tables::i,  // I
-
-      &usage_tables::h,  // H
-  };
-
-  std::array<const std::vector<uint8_t>*, 9> fn_usages = {
-      &usage_tables::fn_a,  // A
-      &usage_tables::fn_b,  // B
-      &usage_tables::fn_c,  // C
-      &usage_tables::fn_d,  // D
-      &usage_tables::fn_e,  // E
-      &usage_tables::fn_f,  // F
-      &usage_tables::fn_g,  // G
-      &usage_tables::fn_i,  // I
-
-      &usage_tables::fn_h,  // H
-  };
-
-  std::array<const std::vector<uint8_t>*, 9> modifiers = {
-      &usage_tables::modifier_a,  // A
-      &usage_tables::modifier_b,  // B
-      &usage_tables::modifier_c,  // C
-      &usage_tables::modifier_d,  // D
-      &usage_tables::modifier_e,  // E
-      &usage_tables::modifier_f,  // F
-      &usage_tables::modifier_g,  // G
-      &usage_tables::modifier_i,  // I
-
-      &usage_tables::modifier_h,  // H
-  };
-
-  UsbHidKeyboard usb_hid_keyboard(
-      /*vendor_id=*/0x6666, /*product_id=*/0x2025,
-      /*version=*/0x0109, /*vendor_name=*/"Gboard DIY prototype",
-      /*product_name=*/"Gboard Dial version", /*version_name=*/"9 Dial");
-  usb_hid_keyboard.SetAutoKeyRelease(true);
-
-  // Wait for a while, just in case, so that the sub-controller can be ready on
-  // I2C.
-  sleep_ms(100);
-
-  std::vector<uint8_t> i2c_buffer(2);
-  bool fn = false;
+  MainLoop loop;
 
-  while (true) {
-    uint16_t motor_start_bitmap = 0;
-    for (size_t i = 0; i < sensors.size(); ++i) {
-      dials[i].Update(sensors[i].Read());
-      if (!dials[i].IsBasePosition()) {
-        motor_start_bitmap |= (1 << i);
-      }
-    }
-    // Read the remote sensor H value via I2C.
-    bool rc = i2c.Read(68, 0, std::span<uint8_t>({i2c_buffer.data(), 1}));
-    if (rc) {
-      dials[8].Update(i2c_buffer[0]);
-      if (!dials[8].IsBasePosition()) {
-        motor_start_bitmap |= (1 << 8);
+#if DIAL_DUAL_CORE
+  // Core1 owns the sensors and the I2C bus, thus the motors, so that the
+  // sampling interval does not depend on USB work on core0.
+  static MainLoop* core1_loop = &loop;
+  multicore_launch_core1([] {
+#if DIAL_KEYMAP_STORE
+    // Core0 pauses core1 while it writes a keymap to flash.
+    flash_safe_execute_core_init();
+#endif
+    core1_loop->Start();
+    while (true) {
+      trace::Begin(trace::Stage::kLoop);
+      // A full FIFO already has rings pending.
+      if (core1_loop->Sense() && multicore_fifo_wready()) {
+        multicore_fifo_push_blocking(0);
       }
+      trace::End(trace::Stage::kLoop);
     }
+  });
 
-    // Drive all motors via I2C.
-    i2c_buffer[0] = motor_start_bitmap & 0xff;
-    i2c_buffer[1] = motor_start_bitmap >> 8;
-    rc = i2c.Write(68, 0, i2c_buffer);
-
-    // Check all dials to see if we have pending inputs to send over USB HID.
-    for (size_t i = 0; i < dials.size(); ++i) {
-      // `decided_position` is std::nullopt while the dial is not moved at the
-      // base position, or moving. But once it returns to the base position from
-      // non-base positions, it will have a 1 or a larger value that indicates
-      // the position where the dial starts returning.
-      std::optional<uint8_t> decided_position = dials[i].PopDecidedPosition();
-      if (!decided_position) {
-        continue;
-      }
-      // One-time flip to use an alternative set of usages, by the Fn key.
-      std::array<const std::vector<uint8_t>*, 9>& current_usages =
-          fn ? fn_usages : usages;
-
-      // Adjust the index as it is 1-based.
-      size_t index = *decided_position - 1;
-
-      if (index < current_usages[i]->size()) {
-        uint8_t usage = (*current_usages[i])[index];
-        if (usage) {
-          usb_hid_keyboard.PressByUsageId(usage);
-          fn = false;
-        }
-      }
-      if (index < modifiers[i]->size()) {
-        uint8_t modifier = (*modifiers[i])[index];
-        if (modifier == usage_tables::kModifierLeftGUI) {
-          // This device interprets the left GUI key as a one-time keymap
-          // alternate key instead of the normal GUI modifier key use.
-          fn = true;
-        } else {
-          usb_hid_keyboard.SetModifiers(
-              (usb_hid_keyboard.GetModifiers() | modifier));
-        }
-      }
+  while (true) {
+    loop.Report();
+    // Sleep until core1 rings. USB is handled in interrupts meanwhile.
+    if (sDecidedPositions.empty()) {
+#if DIAL_USB_TELEMETRY
+      // Also wake up for telemetry commands and counters, as often as they
+      // may be due.
+      uint32_t ring;
+      multicore_fifo_pop_timeout_us(telemetry_protocol::kMinPeriodMs * 1000,
+                                    &ring);
+#else
+      multicore_fifo_pop_blocking();
+#endif
     }
   }
-}
\ No newline at end of file
+#else
+  loop.Start();
+  while (true) {
+    trace::Begin(trace::Stage::kLoop);
+    loop.Sense();
+    loop.Report();
+    trace::End(trace::Stage::kLoop);
+  }
+#endif
+}
@@ -0,0 +1,159 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#include "sub_dials.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "pico/stdlib.h"
+
+#include "../common/hot_path.h"
+
+using namespace sub_protocol;
+
+static_assert(DialStateSize(kMaxSubSensors) <= I2CController::kMaxDataSize);
+
+size_t SubDials::Connect(size_t first_dial,
+                         size_t max_dials,
+                         uint32_t timeout_ms) {
+  std::array<SubInfo, kMaxSubs> infos;
+  size_t found = DiscoverSubs(i2c_, infos, timeout_ms);
+  size_t num_dials = first_dial;
+  size_t num_motors = 0;
+  for (size_t i = 0; i < found; ++i) {
+    if (num_dials + infos[i].sensors > max_dials ||
+        num_motors + infos[i].motors > max_dials) {
+      printf("too many dials, ignoring sub-controller at $%02x\n",
+             infos[i].address);
+      continue;
+    }
+    Sub& sub = subs_[num_subs_++];
+    sub.info = infos[i];
+    sub.first_dial = num_dials;
+    sub.first_motor = num_motors;
+    num_dials += infos[i].sensors;
+    num_motors += infos[i].motors;
+  }
+  // A sub runs the motors of its own dials itself. Main drives them from the
+  // reported positions if the write fails.
+  for (size_t i = 0; i < num_subs_; ++i) {
+    Sub& sub = subs_[i];
+    std::array<uint8_t, LocalMotorsSize(kMaxSubSensors)> burst;
+    for (size_t j = 0; j < sub.info.sensors; ++j) {
+      size_t motor = sub.first_dial + j;
+      bool local = motor >= sub.first_motor &&
+                   motor < sub.first_motor + sub.info.motors;
+      burst[j] = local ? motor - sub.first_motor : kNoLocalMotor;
+    }
+    std::span<const uint8_t> motors(burst.data(), sub.info.sensors);
+    burst[sub.info.sensors] = Crc8(motors);
+    if (!i2c_.Write(sub.info.address, kLocalMotorsRegister,
+                    std::span(burst).first(
+                        LocalMotorsSize(sub.info.sensors)))) {
+      printf("sub-controller at $%02x does not run its motors\n",
+             sub.info.address);
+    }
+  }
+  return num_dials;
+}
+
+void DIAL_HOT_PATH(SubDials::QueueReads)(bool poll_all) {
+  for (size_t i = 0; i < num_subs_; ++i) {
+    size_t index = (next_sub_ + i) % num_subs_;
+    Sub& sub = subs_[index];
+    if (sub.state_read.valid() || !(poll_all || sub.busy_bitmap)) {
+      continue;
+    }
+    sub.state_read = i2c_.ReadAsync(sub.info.address, kDialStateRegister,
+                                    DialStateSize(sub.info.sensors));
+    if (!sub.state_read.valid()) {
+      next_sub_ = index;
+      break;
+    }
+  }
+}
+
+size_t DIAL_HOT_PATH(SubDials::Update)(std::span<uint8_t> positions,
+                                       std::span<DecidedPosition> decided) {
+  size_t num_decided = 0;
+  for (size_t i = 0; i < num_subs_; ++i) {
+    Sub& sub = subs_[i];
+    if (sub.state_read.valid() && sub.state_read.ready()) {
+      num_decided += TakeState(sub, decided.subspan(num_decided));
+      sub.state_read = {};
+    }
+    std::copy(sub.positions.begin(), sub.positions.begin() + sub.info.sensors,
+              positions.begin() + sub.first_dial);
+  }
+  return num_decided;
+}
+
+size_t DIAL_HOT_PATH(SubDials::TakeState)(Sub& sub,
+                                          std::span<DecidedPosition> decided) {
+  size_t size = DialStateSize(sub.info.sensors);
+  std::span<const uint8_t> state = sub.state_read.data();
+  if (state.size() != size ||
+      Crc8(state.first(size - 1)) != state[size - 1]) {
+    return 0;
+  }
+  uint32_t now = time_us_32();
+  size_t num_decided = 0;
+  sub.busy_bitmap = 0;
+  for (size_t i = 0; i < sub.info.sensors; ++i) {
+    std::span<const uint8_t> entry =
+        state.subspan(i * kDialEntrySize, kDialEntrySize);
+    sub.positions[i] = entry[kDialPosition];
+    if (entry[kDialFlags] & kDialBusy) {
+      sub.busy_bitmap |= 1u << i;
+    }
+    if (sub.synced && entry[kDialDecidedCount] != sub.decided_counts[i]) {
+      uint32_t age_us =
+          entry[kDialDecidedAgeLow] | (entry[kDialDecidedAgeHigh] << 8);
+      decided[num_decided++] = {static_cast<uint8_t>(sub.first_dial + i),
+                                entry[kDialDecidedPosition], now - age_us};
+    }
+    sub.decided_counts[i] = entry[kDialDecidedCount];
+  }
+  sub.synced = true;
+  return num_decided;
+}
+
+void DIAL_HOT_PATH(SubDials::DriveMotors)(std::span<const uint8_t> positions) {
+  for (size_t i = 0; i < num_subs_; ++i) {
+    DriveMotors(subs_[i], positions);
+  }
+}
+
+void DIAL_HOT_PATH(SubDials::DriveMotors)(Sub& sub,
+                                          std::span<const uint8_t> positions) {
+  if (!sub.info.motors || !sub.motors_write.ready()) {
+    return;
+  }
+  if (sub.motors_write.valid() && !sub.motors_write.success()) {
+    sub.motors_written = false;
+  }
+  sub.motors_write = {};
+  std::span<const uint8_t> motors =
+      positions.subspan(sub.first_motor, sub.info.motors);
+  if (sub.motors_written &&
+      std::equal(motors.begin(), motors.end(), sub.motors.begin())) {
+    return;
+  }
+  std::array<uint8_t, MotorsSize(kMaxSubMotors)> burst;
+  std::copy(motors.begin(), motors.end(), burst.begin());
+  burst[motors.size()] = Crc8(motors);
+  sub.motors_write =
+      i2c_.WriteAsync(sub.info.address, kMotorsRegister,
+                      std::span(burst).first(MotorsSize(sub.info.motors)));
+  if (sub.motors_write.valid()) {
+    std::copy(motors.begin(), motors.end(), sub.motors.begin());
+    sub.motors_written = true;
+  }
+}
+
+bool SubDials::IsBusy() const {
+  return std::any_of(subs_.begin(), subs_.begin() + num_subs_,
+                     [](const Sub& sub) { return sub.busy_bitmap != 0; });
+}
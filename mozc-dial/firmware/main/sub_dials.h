@@ -0,0 +1,90 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef SUB_DIALS_H_
+#define SUB_DIALS_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "../common/sub_protocol.h"
+#include "decided_position.h"
+#include "i2c_controller.h"
+#include "sub_discovery.h"
+
+// The dials of the sub-controllers, that follow the local dials of main. The
+// subs decide the positions of their dials and run their motors themselves;
+// main reads their dial states over I2C while the dials may be moving, takes
+// the positions decided since, and writes the motor positions of the dials
+// whose motors a sub runs for main.
+//
+// All calls are made from the core that takes the I2C interrupt.
+class SubDials final {
+ public:
+  explicit SubDials(I2CController& i2c) : i2c_(i2c) {}
+  SubDials(const SubDials&) = delete;
+  SubDials& operator=(const SubDials&) = delete;
+  ~SubDials() = default;
+
+  // Finds the sub-controllers, waiting up to `timeout_ms` for them to boot,
+  // and lays out their dials and motors from `first_dial`, up to `max_dials`
+  // dials in all. Tells each sub which of its dials its own motors return.
+  // Returns the number of dials, those before `first_dial` included.
+  size_t Connect(size_t first_dial, size_t max_dials, uint32_t timeout_ms);
+
+  // Queues dial state reads of the subs whose dials may be moving, or of all
+  // with `poll_all`. Reads are queued round-robin, as long as transactions
+  // are left, so that all subs get their turn.
+  void QueueReads(bool poll_all);
+
+  // Takes the completed reads, and copies the positions of the dials of each
+  // sub into `positions`, for the motors of main. Appends the positions
+  // decided since the last read to `decided`, at the times the subs decided
+  // them, and returns how many. `decided` holds a position per dial.
+  size_t Update(std::span<uint8_t> positions,
+                std::span<DecidedPosition> decided);
+
+  // Writes the motor positions in `positions` to the subs that run them, as
+  // they change, one write per sub at a time. A failed write is retried.
+  void DriveMotors(std::span<const uint8_t> positions);
+
+  // Whether the dials of any sub may be moving.
+  bool IsBusy() const;
+
+ private:
+  // A sub-controller, and where its sensors and motors are in the dials.
+  struct Sub {
+    SubInfo info;
+    uint8_t first_dial = 0;
+    uint8_t first_motor = 0;
+    // The dial state read in flight, and from the last one, the positions of
+    // the dials, which are busy, and the counts of their decided positions,
+    // once a first read has set them.
+    I2CController::Future state_read;
+    std::array<uint8_t, sub_protocol::kMaxSubSensors> positions = {};
+    uint8_t busy_bitmap = 0;
+    std::array<uint8_t, sub_protocol::kMaxSubSensors> decided_counts = {};
+    bool synced = false;
+    // The motor positions last written to the sub, unless a write failed, and
+    // the write in flight.
+    std::array<uint8_t, sub_protocol::kMaxSubMotors> motors = {};
+    bool motors_written = false;
+    I2CController::Future motors_write;
+  };
+
+  // Takes the completed dial state read of `sub`, and appends the positions
+  // decided since the last one to `decided`. Returns how many.
+  size_t TakeState(Sub& sub, std::span<DecidedPosition> decided);
+  void DriveMotors(Sub& sub, std::span<const uint8_t> positions);
+
+  I2CController& i2c_;
+  std::array<Sub, sub_protocol::kMaxSubs> subs_;
+  size_t num_subs_ = 0;
+  // The sub to start polling from.
+  size_t next_sub_ = 0;
+};
+
+#endif  // SUB_DIALS_H_
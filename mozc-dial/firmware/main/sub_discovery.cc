@@ -0,0 +1,173 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#include "sub_discovery.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+
+#include "pico/stdlib.h"
+
+#include "../common/sub_protocol.h"
+
+using namespace sub_protocol;
+
+namespace {
+
+constexpr uint64_t kRetryIntervalUs = 500;
+#if DIAL_SUB_ADDRESS_ASSIGNMENT
+// A sub moves to its new address from its main loop, that is quick.
+constexpr uint32_t kAssignTimeoutMs = 10;
+// Reads of the unique ID that may fail their CRC in a row, e.g. on noise.
+constexpr int kMaxIdRetries = 3;
+#endif
+
+uint8_t SubAddress(size_t index) {
+#if DIAL_SUB_ADDRESS_ASSIGNMENT
+  return kFirstSubAddress + index;
+#else
+  return SlotAddress(index);
+#endif
+}
+
+// Reads the version at `address`; 0 while the sub is booting, or if no sub
+// answers.
+uint8_t ReadVersion(I2CController& i2c, uint8_t address) {
+  uint8_t version = 0;
+  if (!i2c.Read(address, kVersionRegister, {&version, 1})) {
+    return 0;
+  }
+  return version;
+}
+
+#if DIAL_SUB_ADDRESS_ASSIGNMENT
+// Gives a free address to the unassigned sub with the lowest unique ID.
+// Returns false if none answers.
+bool AssignAddress(I2CController& i2c, uint8_t address) {
+  std::array<uint8_t, kUniqueIdBurstSize> id;
+  for (int retry = 0;; ++retry) {
+    if (!i2c.Read(kUnassignedAddress, kUniqueIdRegister, id)) {
+      return false;
+    }
+    if (Crc8(std::span<const uint8_t>(id).first(kUniqueIdSize)) ==
+        id[kUniqueIdCrc]) {
+      break;
+    }
+    if (retry == kMaxIdRetries) {
+      return false;
+    }
+  }
+  std::array<uint8_t, kAssignAddressSize> assign;
+  std::copy(id.begin(), id.begin() + kUniqueIdSize,
+            assign.begin() + kAssignUniqueId);
+  assign[kAssignAddress] = address;
+  assign[kAssignCrc] =
+      Crc8(std::span<const uint8_t>(assign).first(kAssignCrc));
+  if (!i2c.Write(kUnassignedAddress, kAssignAddressRegister, assign)) {
+    return false;
+  }
+  absolute_time_t deadline = make_timeout_time_ms(kAssignTimeoutMs);
+  while (!ReadVersion(i2c, address)) {
+    if (time_reached(deadline)) {
+      return false;
+    }
+    sleep_us(kRetryIntervalUs);
+  }
+  return true;
+}
+#endif
+
+}  // namespace
+
+size_t DiscoverSubs(I2CController& i2c,
+                    std::span<SubInfo> subs,
+                    uint32_t timeout_ms) {
+  std::array<bool, kMaxSubs> assigned = {};
+  absolute_time_t deadline = make_timeout_time_ms(timeout_ms);
+#if DIAL_SUB_ADDRESS_ASSIGNMENT
+  // Subs boot at the same time as main. Unassigned ones answer at once, and
+  // the version reads 0 until all of them are ready.
+  while (true) {
+    for (size_t i = 0; i < kMaxSubs; ++i) {
+      assigned[i] = ReadVersion(i2c, SubAddress(i)) != 0;
+    }
+    uint8_t unassigned_version = 0;
+    bool has_unassigned = i2c.Read(kUnassignedAddress, kVersionRegister,
+                                   {&unassigned_version, 1});
+    if (has_unassigned ? unassigned_version != 0
+                       : std::find(assigned.begin(), assigned.end(), true) !=
+                             assigned.end()) {
+      break;
+    }
+    if (time_reached(deadline)) {
+      break;
+    }
+    sleep_us(kRetryIntervalUs);
+  }
+
+  for (size_t i = 0; i < kMaxSubs; ++i) {
+    if (!assigned[i]) {
+      assigned[i] = AssignAddress(i2c, SubAddress(i));
+      if (!assigned[i]) {
+        break;
+      }
+    }
+  }
+#else
+  // Subs boot at the same time as main, each at the address of its slot. The
+  // version reads 0 until a sub is ready, and is waited for once one answers.
+  while (true) {
+    bool booting = false;
+    for (size_t i = 0; i < kMaxSubs; ++i) {
+      uint8_t version = 0;
+      bool answered =
+          i2c.Read(SubAddress(i), kVersionRegister, {&version, 1});
+      assigned[i] = answered && version != 0;
+      booting |= answered && version == 0;
+    }
+    if (!booting &&
+        std::find(assigned.begin(), assigned.end(), true) != assigned.end()) {
+      break;
+    }
+    if (time_reached(deadline)) {
+      break;
+    }
+    sleep_us(kRetryIntervalUs);
+  }
+#endif
+
+  size_t size = 0;
+  for (size_t i = 0; i < kMaxSubs && size < subs.size(); ++i) {
+    if (!assigned[i]) {
+      continue;
+    }
+    uint8_t version = ReadVersion(i2c, SubAddress(i));
+    std::array<uint8_t, kCapabilitiesSize> capabilities;
+    if (version != kVersion ||
+        !i2c.Read(SubAddress(i), kCapabilitiesRegister, capabilities) ||
+        Crc8(std::span<const uint8_t>(capabilities).first(kCapabilityCrc)) !=
+            capabilities[kCapabilityCrc] ||
+        capabilities[kCapabilitySensors] > kMaxSubSensors ||
+        capabilities[kCapabilityMotors] > kMaxSubMotors) {
+      printf("sub-controller at $%02x: protocol version %d, expected %d\n",
+             SubAddress(i), version, kVersion);
+      continue;
+    }
+    subs[size++] = {SubAddress(i), capabilities[kCapabilitySlot],
+                    capabilities[kCapabilitySensors],
+                    capabilities[kCapabilityMotors]};
+  }
+  // An insertion sort, that is stable as std::stable_sort(), but needs no
+  // buffer from the heap.
+  for (size_t i = 1; i < size; ++i) {
+    SubInfo sub = subs[i];
+    size_t j = i;
+    for (; j > 0 && subs[j - 1].slot > sub.slot; --j) {
+      subs[j] = subs[j - 1];
+    }
+    subs[j] = sub;
+  }
+  return size;
+}
@@ -0,0 +1,34 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef SUB_DISCOVERY_H_
+#define SUB_DISCOVERY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "i2c_controller.h"
+
+// A sub-controller on the I2C bus, see common/sub_protocol.h.
+struct SubInfo {
+  uint8_t address = 0;
+  uint8_t slot = 0;
+  uint8_t sensors = 0;
+  uint8_t motors = 0;
+};
+
+// Finds the sub-controllers on the bus at the addresses of their slots. Built
+// with DIAL_SUB_ADDRESS_ASSIGNMENT, gives an address to each one that has none
+// yet instead, the one with the lowest unique ID first; subs that already have
+// one, e.g. as main was reset alone, keep it. Waits up to `timeout_ms` for the
+// subs to boot.
+//
+// Stores the subs that serve the current protocol version in `subs`, sorted by
+// slot, and returns how many.
+size_t DiscoverSubs(I2CController& i2c,
+                    std::span<SubInfo> subs,
+                    uint32_t timeout_ms);
+
+#endif  // SUB_DISCOVERY_H_
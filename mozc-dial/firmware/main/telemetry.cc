@@ -0,0 +1,163 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#include "telemetry.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#include "pico/stdlib.h"
+
+using namespace telemetry_protocol;
+
+Telemetry::Telemetry(UsbVendorInterface& vendor,
+                     const I2CController& i2c,
+                     const UsbHidKeyboard& keyboard,
+                     const DecidedPositionQueue& decided_positions)
+    : vendor_(vendor),
+      i2c_(i2c),
+      keyboard_(keyboard),
+      decided_positions_(decided_positions),
+      counters_({.type = kPacketCounters,
+                 .version = kVersion,
+                 .sequence = 0,
+                 .time_us = 0,
+                 .loops = 0,
+                 .i2c_transactions = 0,
+                 .i2c_failures = 0,
+                 .dropped_events = 0,
+                 .dropped_positions = 0,
+                 .dropped_packets = 0,
+                 .report_queue_depth = 0,
+                 .num_dials = 0,
+                 .decided_counts = {}}),
+      base_(counters_),
+      deadline_(get_absolute_time()) {}
+
+void Telemetry::CountDecision(const DecidedPosition& decided) {
+  if (decided.dial < counters_.decided_counts.size()) {
+    ++counters_.decided_counts[decided.dial];
+  }
+  if (stream_decisions_) {
+    Decision decision = {.type = kPacketDecision,
+                         .dial = decided.dial,
+                         .position = decided.position,
+                         .reserved = 0,
+                         .decided_time_us = decided.time_us,
+                         .queued_time_us = time_us_32()};
+    vendor_.Write(UsbDevice::AsBytes(decision));
+  }
+}
+
+bool Telemetry::Poll() {
+  bool committed = false;
+  std::array<uint8_t, UsbVendorInterface::kPacketSize> command;
+  size_t size = vendor_.Read(command);
+#if DIAL_KEYMAP_STORE
+  if (TakeKeymapCommand(std::span(command).first(size), committed)) {
+    size = 0;
+  }
+#endif
+  if (size >= sizeof(StreamCommand) && command[0] == kCommandStream) {
+    StreamCommand stream;
+    memcpy(&stream, command.data(), sizeof(stream));
+    period_ms_ =
+        stream.period_ms ? std::max(stream.period_ms, kMinPeriodMs) : 0;
+    stream_decisions_ = period_ms_ && (stream.flags & kStreamDecisions);
+    if (period_ms_) {
+      SendCounters();
+      deadline_ = make_timeout_time_ms(period_ms_);
+    }
+  } else if (size && command[0] == kCommandResetCounters) {
+    base_ = ReadCounters();
+    counters_.decided_counts = {};
+    SendCounters();
+  } else if (size) {
+    printf("unsupported telemetry command: $%02x\n", command[0]);
+  }
+  if (period_ms_ && time_reached(deadline_)) {
+    SendCounters();
+    deadline_ = make_timeout_time_ms(period_ms_);
+  }
+  return committed;
+}
+
+Counters Telemetry::ReadCounters() const {
+  Counters counters = counters_;
+  counters.time_us = time_us_32();
+  counters.loops = loops_;
+  counters.i2c_transactions = i2c_.transactions();
+  counters.i2c_failures = i2c_.failures();
+  counters.dropped_events = keyboard_.dropped_events();
+  counters.dropped_positions = decided_positions_.dropped();
+  counters.dropped_packets = vendor_.dropped_packets();
+  counters.report_queue_depth = keyboard_.queued_events();
+  counters.num_dials = num_dials_;
+  return counters;
+}
+
+void Telemetry::SendCounters() {
+  Counters counters = ReadCounters();
+  counters.loops -= base_.loops;
+  counters.i2c_transactions -= base_.i2c_transactions;
+  counters.i2c_failures -= base_.i2c_failures;
+  counters.dropped_events -= base_.dropped_events;
+  counters.dropped_positions -= base_.dropped_positions;
+  counters.dropped_packets -= base_.dropped_packets;
+  vendor_.Write(UsbDevice::AsBytes(counters));
+  ++counters_.sequence;
+}
+
+#if DIAL_KEYMAP_STORE
+bool Telemetry::TakeKeymapCommand(std::span<const uint8_t> command,
+                                  bool& committed) {
+  if (!keymap_store_) {
+    return false;
+  }
+  KeymapStore& store = *keymap_store_;
+  if (command.size() >= sizeof(KeymapBegin) &&
+      command[0] == kCommandKeymapBegin) {
+    KeymapBegin begin;
+    memcpy(&begin, command.data(), sizeof(begin));
+    KeymapStore::Status status = store.Begin(begin.size);
+    if (status != KeymapStore::Status::kOk) {
+      SendKeymapStatus(status);
+    }
+  } else if (command.size() > offsetof(KeymapData, data) &&
+             command[0] == kCommandKeymapData) {
+    uint16_t offset;
+    memcpy(&offset, command.data() + offsetof(KeymapData, offset),
+           sizeof(offset));
+    KeymapStore::Status status =
+        store.Write(offset, command.subspan(offsetof(KeymapData, data)));
+    if (status != KeymapStore::Status::kOk) {
+      SendKeymapStatus(status);
+    }
+  } else if (command.size() >= sizeof(KeymapCommit) &&
+             command[0] == kCommandKeymapCommit) {
+    KeymapCommit commit;
+    memcpy(&commit, command.data(), sizeof(commit));
+    KeymapStore::Status status = store.Commit(commit.crc);
+    committed = status == KeymapStore::Status::kOk;
+    SendKeymapStatus(status);
+  } else if (!command.empty() && command[0] == kCommandKeymapQuery) {
+    SendKeymapStatus(KeymapStore::Status::kOk);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void Telemetry::SendKeymapStatus(KeymapStore::Status status) {
+  KeymapStatus packet = {.type = kPacketKeymapStatus,
+                         .status = static_cast<uint8_t>(status),
+                         .size = keymap_store_->size(),
+                         .sequence = keymap_store_->sequence(),
+                         .crc = keymap_store_->crc()};
+  vendor_.Write(UsbDevice::AsBytes(packet));
+}
+#endif
@@ -0,0 +1,89 @@
+// Copyright 2025 Google Inc.
+// Use of this source code is governed by an Apache License that can be found
+// in the LICENSE file.
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "pico/time.h"
+
+#include "../common/telemetry_protocol.h"
+#include "../common/usb_hid_keyboard.h"
+#include "../common/usb_vendor_interface.h"
+#if DIAL_KEYMAP_STORE
+#include "../common/keymap_store.h"
+#endif
+#include "decided_position.h"
+#include "i2c_controller.h"
+
+// The telemetry of main over its USB vendor interface, see
+// common/telemetry_protocol.h: takes the commands of the host, and streams
+// the counters of the other parts and the decided positions. Built with
+// DIAL_KEYMAP_STORE, also takes keymaps into a KeymapStore.
+//
+// CountLoop() is called where the dials are sensed; the rest where the
+// positions are reported.
+class Telemetry final {
+ public:
+  // Reads the counters of `i2c`, `keyboard` and `decided_positions`, and
+  // talks to the host over `vendor`.
+  Telemetry(UsbVendorInterface& vendor,
+            const I2CController& i2c,
+            const UsbHidKeyboard& keyboard,
+            const DecidedPositionQueue& decided_positions);
+  Telemetry(const Telemetry&) = delete;
+  Telemetry& operator=(const Telemetry&) = delete;
+  ~Telemetry() = default;
+
+#if DIAL_KEYMAP_STORE
+  // Takes keymap commands into `store`.
+  void SetKeymapStore(KeymapStore& store) { keymap_store_ = &store; }
+#endif
+  void SetNumDials(size_t num_dials) { num_dials_ = num_dials; }
+
+  // Counts a pass of the main loop over the sensors.
+  void CountLoop() { loops_ = loops_ + 1; }
+
+  // Counts `decided` on its way to the keyboard, and streams it if asked.
+  void CountDecision(const DecidedPosition& decided);
+
+  // Takes a command from the host, and sends counters when they are due.
+  // Returns true if a keymap was committed, that the keyboard types by from
+  // its next key on.
+  bool Poll();
+
+ private:
+  // The counters of all parts now, from their start.
+  telemetry_protocol::Counters ReadCounters() const;
+  // Sends the counters since the last reset.
+  void SendCounters();
+#if DIAL_KEYMAP_STORE
+  // Takes `command` if it is a keymap command, and returns whether it was.
+  // Sets `committed` if a keymap was committed.
+  bool TakeKeymapCommand(std::span<const uint8_t> command, bool& committed);
+  void SendKeymapStatus(KeymapStore::Status status);
+#endif
+
+  UsbVendorInterface& vendor_;
+  const I2CController& i2c_;
+  const UsbHidKeyboard& keyboard_;
+  const DecidedPositionQueue& decided_positions_;
+#if DIAL_KEYMAP_STORE
+  KeymapStore* keymap_store_ = nullptr;
+#endif
+  size_t num_dials_ = 0;
+  // Counted where the dials are sensed, maybe on the other core.
+  volatile uint32_t loops_ = 0;
+  // The counters kept here, and those of all parts at the last reset.
+  telemetry_protocol::Counters counters_;
+  telemetry_protocol::Counters base_;
+  uint16_t period_ms_ = 0;
+  bool stream_decisions_ = false;
+  absolute_time_t deadline_;
+};
+
+#endif  // TELEMETRY_H_
@@ -2,55 +2,99 @@
 // Use of this source code is governed by an Apache License that can be found
 // in the LICENSE file.
 
+#include <cstddef>
 #include <cstdint>
 #include <cstdio>
-#include <optional>
 
+#include "hardware/sync.h"
 #include "pico/stdlib.h"
 
-#include "../common/dial_controller.h"
+#include "../common/dial_keyboard.h"
+#include "../common/heap_monitor.h"
+#include "../common/hot_path.h"
 #include "../common/motor_controller.h"
-#include "../common/photo_sensor.h"
-#include "../common/usage_tables.h"
+#include "../common/sensor_bank.h"
+#include "../common/trace.h"
 #include "../common/usb_hid_keyboard.h"
 
+namespace {
+
+#if DIAL_USB_POLL_INTERVAL_MS
+constexpr uint8_t kUsbPollIntervalMs = DIAL_USB_POLL_INTERVAL_MS;
+#else
+constexpr uint8_t kUsbPollIntervalMs = UsbHidKeyboard::kDefaultPollIntervalMs;
+#endif
+
+constexpr auto kUsbDescriptors = UsbHidKeyboard::MakeDescriptors(
+    /*vendor_id=*/0x6666, /*product_id=*/0x2025,
+    /*version=*/0x0101, /*vendor_name=*/"Gboard DIY prototype",
+    /*product_name=*/"Gboard Dial version", /*version_name=*/"1 Dial",
+    kUsbPollIntervalMs);
+
+// Runs the motor of the dial, on GPIO17, 18, 19, and 20.
+struct DialMotor {
+  MotorController& motor_controller;
+
+  void DIAL_HOT_PATH(Drive)(size_t, uint8_t position) {
+    if (position) {
+      motor_controller.Start(8, position);
+    } else {
+      motor_controller.Stop(8);
+    }
+  }
+};
+
+}  // namespace
+
 int main() {
   // GPIO0 and 1 are used for stdout, and stdin by default.
   stdio_init_all();
 
   // GPIO17, 18, 19, and 20 are used for motor phase control.
   MotorController motor_controller(MotorController::Mode::k1Motor);
+  DialMotor motor = {motor_controller};
 
   // GPIO2, 3, 4, 5, 6, and 7 are used for 6bit photo sensing.
-  PhotoSensor photo_sensor(2, 3, 4, 5, 6, 7);
+  SensorBank sensors = {{2, 6}};
 
-  DialController dial_controller;
+  // The dial A of the keymap.
+  DialKeyboard<1, SensorBank, DialMotor> dial(sensors, motor);
+#if DIAL_EARLY_COMMIT
+  dial.SetEarlyCommit(true);
+#endif
+#if DIAL_EVENT_DRIVEN
+  // Edges come much closer than loop iterations, so a new position also needs
+  // to stay for a while.
+  dial.SetConfirmTime(/*confirm_us=*/300);
+  sensors.EnableEdgeCapture();
+#endif
 
-  UsbHidKeyboard usb_hid_keyboard(
-      /*vendor_id=*/0x6666, /*product_id=*/0x2025,
-      /*version=*/0x0101, /*vendor_name=*/"Gboard DIY prototype",
-      /*product_name=*/"Gboard Dial version", /*version_name=*/"1 Dial");
+  UsbHidKeyboard usb_hid_keyboard(kUsbDescriptors);
   usb_hid_keyboard.SetAutoKeyRelease(true);
 
-  while (true) {
-    dial_controller.Update(photo_sensor.Read());
-    if (dial_controller.IsBasePosition()) {
-      motor_controller.Stop(8);
-    } else {
-      motor_controller.Start(8);
-    }
-    // `decided_position` is std::nullopt while the dial is not moved at the
-    // base position, or moving. But once it returns to the base position from
-    // non-base positions, it will have a 1 or a larger value that indicates the
-    // position where the dial starts returning.
-    std::optional<uint8_t> decided_position =
-        dial_controller.PopDecidedPosition();
-    if (decided_position && *decided_position <= usage_tables::a.size()) {
-      // Adjust the index as it is 1-based.
-      uint8_t usage = usage_tables::a[*decided_position - 1];
-      if (usage) {
-        usb_hid_keyboard.PressByUsageId(usage);
-      }
+  // Samples the dial, drives its motor, and types the position it decides.
+  auto sense = [&]() DIAL_HOT_LAMBDA("sense") {
+#if DIAL_EVENT_DRIVEN
+    // Sleep until a sensor edge, or any other interrupt, while at the base.
+    if (dial.IsIdle() && !sensors.HasEdges()) {
+      __wfe();
     }
+    dial.SenseEdges();
+#endif
+    dial.Sense(time_us_32());
+    trace::Begin(trace::Stage::kDecide);
+    dial.PopDecided([&](size_t index, uint8_t position, uint32_t time_us) {
+      dial.Type(usb_hid_keyboard, index, position, time_us);
+    });
+    trace::End(trace::Stage::kDecide);
+  };
+
+  while (true) {
+    trace::Begin(trace::Stage::kLoop);
+    sense();
+    heap_monitor::Poll("one_dial");
+    trace::Poll("one_dial");
+    motor_controller.refresh_latency().Poll("one_dial", "motor refresh");
+    trace::End(trace::Stage::kLoop);
   }
 }
@@ -10,6 +10,9 @@
 #include "hardware/i2c.h"
 #include "pico/i2c_slave.h"
 
+#include "../common/hot_path.h"
+#include "../common/trace.h"
+
 static constexpr int kI2CSpeedInHz = 400 * 1000;
 
 namespace {
@@ -17,14 +20,18 @@ I2CDevice* sI2CDevice = nullptr;
 };  // namespace
 
 // static
-void I2CDevice::HandleEvent(i2c_inst_t* i2c, i2c_slave_event_t event) {
+void DIAL_HOT_PATH(I2CDevice::HandleEvent)(i2c_inst_t* i2c,
+                                           i2c_slave_event_t event) {
+  trace::Begin(trace::Stage::kI2CDeviceIsr);
   sI2CDevice->HandleEventInternal(i2c, event);
+  trace::End(trace::Stage::kI2CDeviceIsr);
 }
 
 I2CDevice::I2CDevice(i2c_inst_t* i2c,
                      uint8_t sda,
                      uint8_t scl,
-                     uint8_t address) {
+                     uint8_t address)
+    : i2c_(i2c) {
   hard_assert(sI2CDevice == nullptr);
   sI2CDevice = this;
 
@@ -47,7 +54,12 @@ void I2CDevice::SetWriteHandler(WriteHandler handler) {
   writer_ = handler;
 }
 
-void I2CDevice::HandleEventInternal(i2c_inst_t* i2c, i2c_slave_event_t event) {
+void I2CDevice::SetAddress(uint8_t address) {
+  i2c_set_slave_mode(i2c_, true, address);
+}
+
+void DIAL_HOT_PATH(I2CDevice::HandleEventInternal)(i2c_inst_t* i2c,
+                                                   i2c_slave_event_t event) {
   switch (event) {
     case I2C_SLAVE_RECEIVE:
       if (!address_ready_) {
@@ -6,15 +6,15 @@
 #define I2C_DEVICE_H_
 
 #include <cstdint>
-#include <functional>
 
 #include "hardware/i2c.h"
 #include "pico/i2c_slave.h"
 
 class I2CDevice final {
  public:
-  using ReadHandler = std::function<uint8_t(uint8_t /*address*/)>;
-  using WriteHandler = std::function<void(uint8_t /*address*/, uint8_t /*value*/)>;
+  // Called from the I2C interrupt handler.
+  using ReadHandler = uint8_t (*)(uint8_t address);
+  using WriteHandler = void (*)(uint8_t address, uint8_t value);
 
   I2CDevice(i2c_inst_t* i2c, uint8_t sda, uint8_t scl, uint8_t address);
   I2CDevice(const I2CDevice&) = delete;
@@ -24,10 +24,14 @@ class I2CDevice final {
   void SetReadHandler(ReadHandler handler);
   void SetWriteHandler(WriteHandler handler);
 
+  // Moves the target to `address`. Not to be called from the handlers.
+  void SetAddress(uint8_t address);
+
  private:
   static void HandleEvent(i2c_inst_t* i2c, i2c_slave_event_t event);
   void HandleEventInternal(i2c_inst_t* i2c, i2c_slave_event_t event);
 
+  i2c_inst_t* i2c_ = nullptr;
   ReadHandler reader_ = nullptr;
   WriteHandler writer_ = nullptr;
   bool address_ready_ = false;
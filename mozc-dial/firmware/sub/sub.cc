@@ -2,51 +2,300 @@
 // Use of this source code is governed by an Apache License that can be found
 // in the LICENSE file.
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstdio>
+#include <optional>
+#include <utility>
 
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
 #include "hardware/uart.h"
 #include "pico/stdio.h"
 #if LIB_PICO_STDIO_UART
 #include "pico/stdio_uart.h"
 #endif
+#include "pico/unique_id.h"
 
+#include "../common/dial_controller.h"
+#if !DIAL_SUB_SENSOR_BOARD
 #include "../common/motor_controller.h"
-#include "../common/photo_sensor.h"
+#endif
+#include "../common/heap_monitor.h"
+#include "../common/hot_path.h"
+#include "../common/sensor_bank.h"
+#include "../common/sub_protocol.h"
+#include "../common/trace.h"
 #include "i2c_device.h"
 
+using namespace sub_protocol;
+
 namespace {
 
+#if DIAL_SUB_SLOT
+constexpr uint8_t kSlot = DIAL_SUB_SLOT;
+#else
+constexpr uint8_t kSlot = 0;
+#endif
+
+#if DIAL_SUB_SENSOR_BOARD
+// Eight dials wired as the main's dials A to G and I, and no motors.
+SensorBank sensors = {
+    {1, 6}, {7, 2}, {9, 3}, {12, 2}, {15, 3}, {18, 3}, {21, 2}, {24, 4},
+};
+constexpr uint8_t kNumOfMotors = 0;
+#if DIAL_SUB_ATTENTION
+constexpr uint8_t kAttentionGpio = kSensorBoardAttentionGpio;
+#endif
+#else
+// The sub of the 9-dial edition: the sensor H, and the motors of all nine
+// dials.
 MotorController motor_controller;
-PhotoSensor sensor_h(26, 27);
+SensorBank sensors = {{26, 2}};
+constexpr uint8_t kNumOfMotors = 9;
+#if DIAL_SUB_ATTENTION
+constexpr uint8_t kAttentionGpio = kSubAttentionGpio;
+#endif
+#endif
+static_assert(kNumOfMotors <= kMaxSubMotors);
+
+// What main reads of a dial.
+struct DialState {
+  uint8_t position = 0;
+  bool busy = false;
+  uint8_t decided_count = 0;
+  uint8_t decided_position = 0;
+  uint32_t decided_at_us = 0;
+
+  bool operator==(const DialState&) const = default;
+};
+
+// Each dial, owned by the main loop but for `motor`, which the I2C handler
+// sets.
+struct Dial {
+  DialController controller;
+  uint8_t code = 0;
+  DialState state;
+  // The motor that returns the dial, run here rather than by main.
+  std::atomic<uint8_t> motor = kNoLocalMotor;
+};
+std::array<Dial, kMaxSubSensors> sDials;
+
+// The dial states the main loop published last, for the I2C handler. The main
+// loop only masks interrupts to copy them.
+std::array<DialState, kMaxSubSensors> sDialStates;
+bool sReady = false;
+
+// Read-only bursts, filled at boot.
+std::array<uint8_t, kCapabilitiesSize> sCapabilitiesBurst = {};
+std::array<uint8_t, kUniqueIdBurstSize> sUniqueIdBurst = {};
+
+// The kDialStateRegister burst being read, latched at its first byte, and the
+// bursts being written.
+std::array<uint8_t, DialStateSize(kMaxSubSensors)> sDialStateBurst = {};
+#if DIAL_SUB_ADDRESS_ASSIGNMENT
+std::array<uint8_t, kAssignAddressSize> sAssignAddressBurst = {};
+#endif
+std::array<uint8_t, MotorsSize(kMaxSubMotors)> sMotorsBurst = {};
+std::array<uint8_t, LocalMotorsSize(kMaxSubSensors)> sLocalMotorsBurst = {};
 
-uint8_t i2c_reader(uint8_t address) {
+#if DIAL_SUB_ADDRESS_ASSIGNMENT
+// An address given by main, for the main loop to move to.
+std::atomic<uint8_t> sNewAddress = 0;
+#endif
+
+// Returns the byte at `address` if it is in `burst`, placed at `base`.
+std::optional<uint8_t> DIAL_HOT_PATH(ReadBurst)(
+    uint8_t address,
+    uint8_t base,
+    std::span<const uint8_t> burst) {
+  if (address < base || address >= base + burst.size()) {
+    return std::nullopt;
+  }
+  return burst[address - base];
+}
+
+// Stores `value` if `address` is in `burst`, placed at `base`. Returns true
+// once the last byte is stored with a matching CRC.
+bool DIAL_HOT_PATH(WriteBurst)(uint8_t address,
+                               uint8_t value,
+                               uint8_t base,
+                               std::span<uint8_t> burst) {
+  if (address < base || address >= base + burst.size()) {
+    return false;
+  }
+  burst[address - base] = value;
+  return address - base + 1u == burst.size() &&
+         Crc8(burst.first(burst.size() - 1)) == value;
+}
+
+void DIAL_HOT_PATH(SetAttention)(bool on) {
+#if DIAL_SUB_ATTENTION
+  // The line is shared; it is only driven while pulled high.
+  gpio_set_dir(kAttentionGpio, on ? GPIO_OUT : GPIO_IN);
+#else
+  (void)on;
+#endif
+}
+
+// Runs `motor` for a dial `positions` away from the base, or 0 where that is
+// not known, as with the legacy registers.
+void DIAL_HOT_PATH(SetMotor)(uint8_t motor, bool on, uint8_t positions) {
+#if DIAL_SUB_SENSOR_BOARD
+  (void)motor;
+  (void)on;
+  (void)positions;
+#else
+  if (on) {
+    motor_controller.Start(motor, positions);
+  } else {
+    motor_controller.Stop(motor);
+  }
+#endif
+}
+
+bool DIAL_HOT_PATH(IsLocalMotor)(uint8_t motor) {
+  for (size_t i = 0; i < sensors.size(); ++i) {
+    if (sDials[i].motor == motor) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Samples the sensors, decides positions, and runs the local motors: a motor
+// stops as soon as its dial is confirmed at the base, without waiting for
+// main.
+void DIAL_HOT_LOOP(SenseDials)() {
+  trace::Begin(trace::Stage::kSensorRead);
+  sensors.Sample();
+  uint32_t now = time_us_32();
+  bool changed = false;
+  for (size_t i = 0; i < sensors.size(); ++i) {
+    Dial& dial = sDials[i];
+    uint8_t code = sensors.Read(i);
+    changed |= code != dial.code;
+    dial.code = code;
+    dial.controller.Update(code, now);
+    DialState state = dial.state;
+    if (std::optional<uint8_t> decided =
+            dial.controller.PopDecidedPosition()) {
+      ++state.decided_count;
+      state.decided_position = *decided;
+      state.decided_at_us = dial.controller.decided_time_us();
+    }
+    state.position = dial.controller.position();
+    state.busy =
+        !dial.controller.IsBasePosition() || !dial.controller.IsSettled();
+    changed |= state != dial.state;
+    dial.state = state;
+    if (uint8_t motor = dial.motor; motor != kNoLocalMotor) {
+      SetMotor(motor, !dial.controller.IsBasePosition(),
+               dial.controller.position());
+    }
+  }
+  if (changed) {
+    uint32_t status = save_and_disable_interrupts();
+    for (size_t i = 0; i < sensors.size(); ++i) {
+      sDialStates[i] = sDials[i].state;
+    }
+    SetAttention(true);
+    restore_interrupts(status);
+  }
+  trace::End(trace::Stage::kSensorRead);
+}
+
+void DIAL_HOT_PATH(LatchDialStates)() {
+  uint32_t now = time_us_32();
+  uint8_t* entry = sDialStateBurst.data();
+  for (size_t i = 0; i < sensors.size(); ++i, entry += kDialEntrySize) {
+    const DialState& state = sDialStates[i];
+    uint32_t age_us = now - state.decided_at_us;
+    if (age_us > kMaxDecidedAgeUs) {
+      age_us = kMaxDecidedAgeUs;
+    }
+    entry[kDialPosition] = state.position;
+    entry[kDialFlags] = state.busy ? kDialBusy : 0;
+    entry[kDialDecidedCount] = state.decided_count;
+    entry[kDialDecidedPosition] = state.decided_position;
+    entry[kDialDecidedAgeLow] = age_us & 0xff;
+    entry[kDialDecidedAgeHigh] = age_us >> 8;
+  }
+  *entry = Crc8(std::span<const uint8_t>(sDialStateBurst.data(), entry));
+  SetAttention(false);
+}
+
+uint8_t DIAL_HOT_PATH(i2c_reader)(uint8_t address) {
   switch (address) {
-    case 0:  // Read Sensor H
-      return sensor_h.Read();
+    case kLegacySensorRegister:  // Read the first sensor
+      return sensors.ReadNow(0);
+    case kVersionRegister:
+      return sReady ? kVersion : 0;
+    case kDialStateRegister:
+      LatchDialStates();
+      return sDialStateBurst[0];
     default:
-      return 0xff;
+      break;
+  }
+  std::span<const uint8_t> dial_states(sDialStateBurst.data(),
+                                       DialStateSize(sensors.size()));
+  for (auto [base, burst] : {
+           std::pair{kCapabilitiesRegister,
+                     std::span<const uint8_t>(sCapabilitiesBurst)},
+           std::pair{kUniqueIdRegister,
+                     std::span<const uint8_t>(sUniqueIdBurst)},
+           std::pair{kDialStateRegister, dial_states},
+       }) {
+    if (std::optional<uint8_t> value = ReadBurst(address, base, burst)) {
+      return *value;
+    }
   }
+  return 0xff;
 }
 
-void i2c_writer(uint8_t address, uint8_t value) {
+void DIAL_HOT_PATH(i2c_writer)(uint8_t address, uint8_t value) {
   switch (address) {
-    case 0:  // Set Motor 1-8 State
-      for (uint8_t motor = 0; motor < 8; ++motor) {
-        if (value & (1 << motor)) {
-          motor_controller.Start(motor);
-        } else {
-          motor_controller.Stop(motor);
-        }
+    case kLegacySensorRegister:  // Set Motor 1-8 State
+      for (uint8_t motor = 0; motor < 8 && motor < kNumOfMotors; ++motor) {
+        SetMotor(motor, value & (1 << motor), /*positions=*/0);
       }
-      break;
-    case 1:  // Set Motor 9 State
-      if (value & 1) {
-        motor_controller.Start(8);
-      } else {
-        motor_controller.Stop(8);
+      return;
+    case kLegacyMotor9Register:  // Set Motor 9 State
+      if (kNumOfMotors > 8) {
+        SetMotor(8, value & 1, /*positions=*/0);
       }
+      return;
+    default:
       break;
   }
+#if DIAL_SUB_ADDRESS_ASSIGNMENT
+  if (WriteBurst(address, value, kAssignAddressRegister,
+                 sAssignAddressBurst)) {
+    if (std::equal(sUniqueIdBurst.begin(),
+                   sUniqueIdBurst.begin() + kUniqueIdSize,
+                   sAssignAddressBurst.begin() + kAssignUniqueId)) {
+      sNewAddress = sAssignAddressBurst[kAssignAddress];
+    }
+    return;
+  }
+#endif
+  if (WriteBurst(address, value, kMotorsRegister,
+                 std::span(sMotorsBurst).first(MotorsSize(kNumOfMotors)))) {
+    for (uint8_t motor = 0; motor < kNumOfMotors; ++motor) {
+      if (!IsLocalMotor(motor)) {
+        SetMotor(motor, sMotorsBurst[motor] != 0, sMotorsBurst[motor]);
+      }
+    }
+  } else if (WriteBurst(address, value, kLocalMotorsRegister,
+                        std::span(sLocalMotorsBurst)
+                            .first(LocalMotorsSize(sensors.size())))) {
+    for (size_t i = 0; i < sensors.size(); ++i) {
+      uint8_t motor = sLocalMotorsBurst[i];
+      sDials[i].motor = motor < kNumOfMotors ? motor : kNoLocalMotor;
+    }
+  }
 }
 
 }  // namespace
@@ -60,11 +309,60 @@ int main() {
   stdio_init_all();
 #endif
 
-  I2CDevice i2c(/*i2c=*/i2c0, /*sda=*/28, /*scl=*/29, /*address=*/68);
+#if DIAL_SUB_ATTENTION
+  gpio_init(kAttentionGpio);
+  gpio_put(kAttentionGpio, true);
+  SetAttention(false);
+#endif
+
+  hard_assert(sensors.size() <= kMaxSubSensors);
+  sCapabilitiesBurst[kCapabilitySlot] = kSlot;
+  sCapabilitiesBurst[kCapabilitySensors] = sensors.size();
+  sCapabilitiesBurst[kCapabilityMotors] = kNumOfMotors;
+  sCapabilitiesBurst[kCapabilityCrc] = Crc8(
+      std::span<const uint8_t>(sCapabilitiesBurst.data(), kCapabilityCrc));
+  pico_unique_board_id_t id;
+  pico_get_unique_board_id(&id);
+  static_assert(sizeof(id.id) == kUniqueIdSize);
+  std::copy(std::begin(id.id), std::end(id.id), sUniqueIdBurst.begin());
+  sUniqueIdBurst[kUniqueIdCrc] = Crc8(
+      std::span<const uint8_t>(sUniqueIdBurst.data(), kUniqueIdSize));
+
+#if DIAL_SUB_ADDRESS_ASSIGNMENT
+  I2CDevice i2c(/*i2c=*/i2c0, /*sda=*/28, /*scl=*/29,
+                /*address=*/kUnassignedAddress);
+#else
+  I2CDevice i2c(/*i2c=*/i2c0, /*sda=*/28, /*scl=*/29,
+                /*address=*/SlotAddress(kSlot));
+#endif
   i2c.SetReadHandler(i2c_reader);
   i2c.SetWriteHandler(i2c_writer);
 
+  sensors.Sample();
+  for (size_t i = 0; i < sensors.size(); ++i) {
+    sDials[i].code = sensors.Read(i);
+#if DIAL_EARLY_COMMIT
+    sDials[i].controller.SetEarlyCommit(true);
+#endif
+    // The debounce main applied to these dials before the sub decided them.
+    sDials[i].controller.SetConfirmTime(kConfirmTimeUs);
+  }
+  sReady = true;
+
+  // Samples as often as it can: each pass reads the sensors once, so the loop
+  // rate bounds how late a code change is seen, and how far a local motor
+  // runs past the base before it stops.
   while (true) {
-    tight_loop_contents();
+    SenseDials();
+#if DIAL_SUB_ADDRESS_ASSIGNMENT
+    if (uint8_t address = sNewAddress.exchange(0)) {
+      i2c.SetAddress(address);
+    }
+#endif
+    heap_monitor::Poll("sub");
+    trace::Poll("sub");
+#if !DIAL_SUB_SENSOR_BOARD
+    motor_controller.refresh_latency().Poll("sub", "motor refresh");
+#endif
   }
 }